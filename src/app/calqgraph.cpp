@@ -1,11 +1,18 @@
 #include "calqgraph.h"
 
+#include "interpreter/bytecode.h"
+#include "math/interval.h"
+
 #include <QMouseEvent>
 #include <QOpenGLFunctions>
 #include <QPaintEvent>
 #include <QPainter>
 #include <QtLogging>
 
+#include <cmath>
+#include <limits>
+#include <utility>
+
 calqapp::CalQGraph::CalQGraph(QWidget* parent)
     : QOpenGLWidget{parent}
 {
@@ -18,7 +25,8 @@ calqapp::CalQGraph::CalQGraph(QWidget* parent)
 
 void calqapp::CalQGraph::setExpression(calqmath::Expression const& expression)
 {
-    m_expression = expression;
+    // Only ever sampled, never shown, so cheaper is all that matters.
+    m_expression = expression.simplified().expression;
 }
 
 void calqapp::CalQGraph::resizeGL(int const width, int const height)
@@ -235,64 +243,81 @@ void calqapp::CalQGraph::paintGL()
 
     if (m_expression.has_value())
     {
-        auto const& expression = m_expression.value();
-
+        auto const& expression{m_expression.value()};
         auto const xMin{rectGraph.left() * MATH_UNITS_PER_GRAPH_UNITS};
         auto const xMax{rectGraph.right() * MATH_UNITS_PER_GRAPH_UNITS};
+        auto const pixelHeight{m_graphScale * MATH_UNITS_PER_GRAPH_UNITS};
 
-        auto const deltaFractionX{0.5 / rectViewport.width()};
-
-        size_t constexpr GRAPH_SCALAR_PRECISION{32};
+        // Compiled once per paint, every sample then reuses the same registers.
+        // Pixels need far less than double precision, so samples are
+        // evaluated in hardware.
+        auto program{calqmath::Program::compile(expression)};
+        if (!program.has_value())
+        {
+            return;
+        }
+        calqmath::VirtualMachine machine{std::move(program).value()};
 
-        QPointF prev{0.0, 0.0};
-        QPointF next{
-            xMin,
-            expression.evaluate(calqmath::Scalar{xMin, GRAPH_SCALAR_PRECISION})
-                ->toDouble()
+        auto const toViewport = [&](double const x)
+        {
+            return ((QPointF{x, -machine.run(x)} / MATH_UNITS_PER_GRAPH_UNITS)
+                    - rectGraph.center())
+                     / m_graphScale
+                 + rectViewport.center();
         };
 
-        painter.setPen(functionPen);
-        auto fractionX{0.0};
-        while (fractionX < 1.0)
+        /*
+         * One interval evaluation bounds the function over a whole span of
+         * pixel columns. Where it is continuous and stays within a pixel, a
+         * single line covers the span. Otherwise the span is split, down to
+         * single columns, and a column containing a pole or jump is left out
+         * so the lines on either side are not joined.
+         */
+        size_t constexpr INTERVAL_PRECISION{
+            std::numeric_limits<double>::digits
+        };
+        auto const plot = [&](
+                              auto const& self,
+                              double const xStart,
+                              double const xEnd,
+                              int const columns
+                          ) -> void
         {
-            fractionX += deltaFractionX;
-
-            auto const oldSlope = (next.y() - prev.y()) / (next.x() - prev.x());
-            prev = next;
+            auto const range{expression.evaluate(calqmath::Interval{
+                calqmath::Scalar{xStart, INTERVAL_PRECISION},
+                calqmath::Scalar{xEnd, INTERVAL_PRECISION}
+            })};
+            if (!range.has_value() || range->isEmpty())
+            {
+                return;
+            }
 
-            auto const xNext{(fractionX * (xMax - xMin)) + xMin};
-            next = {
-                xNext,
-                expression
-                    .evaluate(calqmath::Scalar{xNext, GRAPH_SCALAR_PRECISION})
-                    ->toDouble()
-            };
+            double const height{(range->upper() - range->lower()).toDouble()};
+            if (range->continuous() && (height <= pixelHeight || columns <= 1))
+            {
+                auto const start{toViewport(xStart)};
+                auto const end{toViewport(xEnd)};
+                if (std::isfinite(start.y()) && std::isfinite(end.y()))
+                {
+                    painter.drawLine(start, end);
+                }
+                return;
+            }
+            if (columns <= 1)
+            {
+                return;
+            }
 
-            QPointF const viewportStart{
-                ((QPointF{prev.x(), -prev.y()} / MATH_UNITS_PER_GRAPH_UNITS)
-                 - rectGraph.center())
-                    / m_graphScale
-                + rectViewport.center()
-            };
-            QPointF const viewportEnd{
-                ((QPointF{next.x(), -next.y()} / MATH_UNITS_PER_GRAPH_UNITS)
-                 - rectGraph.center())
-                    / m_graphScale
-                + rectViewport.center()
+            int const half{columns / 2};
+            double const xMiddle{
+                xStart + ((xEnd - xStart) * half / columns)
             };
+            self(self, xStart, xMiddle, half);
+            self(self, xMiddle, xEnd, columns - half);
+        };
 
-            auto const newSlope = (next.y() - prev.y()) / (next.x() - prev.x());
-
-            /*
-             * Detect discontinuities. Not 100% foolproof, but good enough for
-             * now.
-             */
-            double constexpr SLOPE_ABSOLUTE_DELTA_MAX{0.1};
-            if (std::abs(newSlope - oldSlope) < SLOPE_ABSOLUTE_DELTA_MAX)
-            {
-                painter.drawLine(viewportStart, viewportEnd);
-            }
-        }
+        painter.setPen(functionPen);
+        plot(plot, xMin, xMax, static_cast<int>(rectViewport.width()));
     }
 }
 
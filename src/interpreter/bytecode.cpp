@@ -0,0 +1,721 @@
+#include "bytecode.h"
+
+#include "expression.h"
+#include "math/functions.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace calqmath
+{
+namespace
+{
+uint32_t constexpr VARIABLE_SLOT = 0;
+
+// Registers are numbered from here while compiling, since the slot they end
+// up in depends on how many constants are found.
+uint32_t constexpr REGISTER_TAG = uint32_t{1} << 31U;
+
+// Stands for no slot, such as when a product has no pending factor.
+uint32_t constexpr NO_FACTOR = UINT32_MAX;
+
+auto isRegister(uint32_t const slot) -> bool
+{
+    return (slot & REGISTER_TAG) != 0;
+}
+} // namespace
+
+/*
+ * Walks an expression in the same order as Expression::evaluate, emitting an
+ * instruction wherever evaluation would perform an operation.
+ *
+ * A shared node is compiled once, and its register is pinned so that none of
+ * its consumers overwrite it.
+ */
+class ProgramCompiler
+{
+public:
+    // Without folds, folded groups and prepared arguments are compiled from
+    // their subtrees instead.
+    ProgramCompiler(Program& program, bool const folds)
+        : m_program(program)
+        , m_folds(folds)
+    {
+    }
+
+    auto compileExpression(Expression const& expression) -> uint32_t;
+
+    // Moves registers after the constants, now that those are all known.
+    void finish(uint32_t result);
+
+private:
+    auto compileNode(Expression const& expression, uint32_t index)
+        -> uint32_t;
+    auto compileValue(Expression const& expression, uint32_t index)
+        -> uint32_t;
+
+    auto constant(Scalar const& value) -> uint32_t;
+    auto acquire() -> uint32_t;
+    void release(uint32_t slot);
+    // Registers holding an intermediate with a single consumer, which may be
+    // overwritten or released by it.
+    [[nodiscard]] auto isTemporary(uint32_t slot) const -> bool;
+
+    auto binary(OpCode code, uint32_t lhs, uint32_t rhs) -> uint32_t;
+    auto unary(
+        OpCode code, uint32_t argument, FunctionId function = NO_FUNCTION
+    ) -> uint32_t;
+    auto multiplyAdd(uint32_t lhs, uint32_t rhs, uint32_t addend) -> uint32_t;
+    auto call(
+        OpCode code, FunctionId function, std::span<uint32_t const> arguments
+    ) -> uint32_t;
+
+    Program& m_program;
+    bool m_folds;
+    std::vector<uint32_t> m_freeRegisters;
+
+    // The slots of shared nodes compiled so far, by node.
+    std::vector<std::optional<uint32_t>> m_compiled;
+    // By register number, whether it holds a shared node.
+    std::vector<bool> m_pinned;
+};
+
+auto ProgramCompiler::compileExpression(Expression const& expression)
+    -> uint32_t
+{
+    if (expression.empty())
+    {
+        return constant(Scalar{"0.0"});
+    }
+
+    m_compiled.assign(expression.m_shared ? expression.m_nodes.size() : 0, {});
+    return compileNode(expression, expression.root());
+}
+
+auto ProgramCompiler::compileNode(
+    Expression const& expression, uint32_t const index
+) -> uint32_t
+{
+    if (!expression.m_nodes[index].shared)
+    {
+        return compileValue(expression, index);
+    }
+
+    std::optional<uint32_t>& compiled{m_compiled[index]};
+    if (!compiled.has_value())
+    {
+        uint32_t const slot{compileValue(expression, index)};
+        if (isRegister(slot))
+        {
+            uint32_t const number{slot & ~REGISTER_TAG};
+            if (number >= m_pinned.size())
+            {
+                m_pinned.resize(number + 1, false);
+            }
+            m_pinned[number] = true;
+        }
+        compiled = slot;
+    }
+    return compiled.value();
+}
+
+auto ProgramCompiler::compileValue(
+    Expression const& expression, uint32_t const index
+) -> uint32_t
+{
+    Expression::Node const& node{expression.m_nodes[index]};
+
+    switch (node.kind)
+    {
+    case Expression::NodeKind::Literal:
+        return constant(expression.m_literals[node.begin]);
+    case Expression::NodeKind::Variable:
+        return VARIABLE_SLOT;
+    case Expression::NodeKind::Square:
+    {
+        uint32_t const operand{
+            compileNode(expression, expression.operands(node).front().node)
+        };
+        return binary(OpCode::Multiply, operand, operand);
+    }
+    case Expression::NodeKind::Sum:
+    case Expression::NodeKind::Product:
+    case Expression::NodeKind::Call:
+        break;
+    }
+
+    assert(
+        node.kind == Expression::NodeKind::Sum
+        || node.kind == Expression::NodeKind::Call
+    );
+
+    if (Scalar const* const value{
+            m_folds ? expression.foldedScalar(node) : nullptr
+        };
+        value != nullptr)
+    {
+        m_program.m_foldContext = MathContext::current();
+        return constant(*value);
+    }
+
+    if (node.kind == Expression::NodeKind::Call)
+    {
+        // A prepared first argument is a constant, see Expression::folded.
+        Scalar const* const prepared{
+            m_folds ? expression.partialScalar(node) : nullptr
+        };
+        if (prepared != nullptr)
+        {
+            m_program.m_foldContext = MathContext::current();
+        }
+        std::array<uint32_t, NaryFunction::MAX_ARITY> arguments{};
+        auto const operands{expression.operands(node)};
+        for (size_t position = 0; position < operands.size(); position++)
+        {
+            arguments[position] =
+                position == 0 && prepared != nullptr
+                    ? constant(*prepared)
+                    : compileNode(expression, operands[position].node);
+        }
+
+        uint32_t result{call(
+            prepared != nullptr ? OpCode::CallPartial : OpCode::CallNary,
+            node.function,
+            std::span{arguments}.first(operands.size())
+        )};
+        if (node.negate)
+        {
+            result = unary(OpCode::Negate, result);
+        }
+        return result;
+    }
+
+    auto const summands{expression.operands(node)};
+
+    std::optional<uint32_t> sum{};
+    std::optional<std::pair<uint32_t, uint32_t>> pendingProduct{};
+
+    for (size_t position = 0; position < summands.size(); position++)
+    {
+        bool const subtract{summands[position].invert};
+        bool const last{position + 1 == summands.size()};
+        auto const terms{expression.factors(summands[position])};
+        auto const square{expression.squareOperand(summands[position])};
+
+        uint32_t product{
+            compileNode(expression, square.value_or(terms.front().node))
+        };
+
+        uint32_t factor{NO_FACTOR};
+        if (square.has_value())
+        {
+            factor = product;
+        }
+        for (auto const& next : terms | std::views::drop(1))
+        {
+            uint32_t const term{compileNode(expression, next.node)};
+
+            if (factor != NO_FACTOR)
+            {
+                product = binary(OpCode::Multiply, product, factor);
+                factor = NO_FACTOR;
+            }
+
+            if (!next.invert)
+            {
+                factor = term;
+            }
+            else
+            {
+                product = binary(OpCode::Divide, product, term);
+            }
+        }
+
+        if (!sum.has_value() && !pendingProduct.has_value()
+            && factor != NO_FACTOR && !last)
+        {
+            pendingProduct.emplace(product, factor);
+            continue;
+        }
+
+        if (factor != NO_FACTOR
+            && (pendingProduct.has_value() || !sum.has_value()))
+        {
+            product = binary(OpCode::Multiply, product, factor);
+            factor = NO_FACTOR;
+        }
+
+        if (!sum.has_value() && !pendingProduct.has_value())
+        {
+            sum = product;
+            continue;
+        }
+
+        if (subtract && factor == product)
+        {
+            // The product is also the factor of a square, so it is negated
+            // into a new register to keep the factor intact.
+            uint32_t const negated{acquire()};
+            m_program.m_instructions.push_back({
+                .code = OpCode::Negate,
+                .result = negated,
+                .operands = {product, 0, 0},
+            });
+            product = negated;
+        }
+        else if (subtract
+                 && (pendingProduct.has_value() || factor != NO_FACTOR))
+        {
+            product = unary(OpCode::Negate, product);
+        }
+
+        if (pendingProduct.has_value())
+        {
+            auto const [lhs, rhs] = pendingProduct.value();
+            sum = multiplyAdd(lhs, rhs, product);
+            pendingProduct.reset();
+        }
+        else if (factor != NO_FACTOR)
+        {
+            sum = multiplyAdd(product, factor, sum.value());
+        }
+        else
+        {
+            sum = binary(
+                subtract ? OpCode::Subtract : OpCode::Add, sum.value(), product
+            );
+        }
+    }
+
+    assert(sum.has_value());
+    uint32_t result{sum.value()};
+
+    if (node.function != NO_FUNCTION)
+    {
+        result = unary(OpCode::Call, result, node.function);
+    }
+
+    if (node.negate)
+    {
+        result = unary(OpCode::Negate, result);
+    }
+
+    return result;
+}
+
+void ProgramCompiler::finish(uint32_t const result)
+{
+    auto const registerBase{
+        static_cast<uint32_t>(1 + m_program.m_constants.size())
+    };
+    auto const relocate = [registerBase](uint32_t& slot)
+    {
+        if (isRegister(slot))
+        {
+            slot = registerBase + (slot & ~REGISTER_TAG);
+        }
+    };
+
+    for (auto& instruction : m_program.m_instructions)
+    {
+        relocate(instruction.result);
+        for (auto& operand : instruction.operands)
+        {
+            relocate(operand);
+        }
+    }
+
+    m_program.m_result = result;
+    relocate(m_program.m_result);
+}
+
+auto ProgramCompiler::constant(Scalar const& value) -> uint32_t
+{
+    m_program.m_constants.push_back(value);
+    return static_cast<uint32_t>(m_program.m_constants.size());
+}
+
+auto ProgramCompiler::acquire() -> uint32_t
+{
+    if (!m_freeRegisters.empty())
+    {
+        uint32_t const slot{m_freeRegisters.back()};
+        m_freeRegisters.pop_back();
+        return slot;
+    }
+
+    auto const slot{static_cast<uint32_t>(m_program.m_registerCount)};
+    m_program.m_registerCount++;
+    return slot | REGISTER_TAG;
+}
+
+void ProgramCompiler::release(uint32_t const slot)
+{
+    if (isTemporary(slot))
+    {
+        m_freeRegisters.push_back(slot);
+    }
+}
+
+auto ProgramCompiler::isTemporary(uint32_t const slot) const -> bool
+{
+    if (!isRegister(slot))
+    {
+        return false;
+    }
+
+    uint32_t const number{slot & ~REGISTER_TAG};
+    return number >= m_pinned.size() || !m_pinned[number];
+}
+
+auto ProgramCompiler::binary(
+    OpCode const code, uint32_t const lhs, uint32_t const rhs
+) -> uint32_t
+{
+    // Intermediates have a single consumer, so this one can be overwritten.
+    // Both operands are the same slot when squaring.
+    uint32_t result{};
+    if (isTemporary(lhs))
+    {
+        result = lhs;
+        if (rhs != lhs)
+        {
+            release(rhs);
+        }
+    }
+    else if (isTemporary(rhs))
+    {
+        result = rhs;
+    }
+    else
+    {
+        result = acquire();
+    }
+
+    m_program.m_instructions.push_back({
+        .code = code,
+        .result = result,
+        .operands = {lhs, rhs, 0},
+    });
+    return result;
+}
+
+auto ProgramCompiler::unary(
+    OpCode const code, uint32_t const argument, FunctionId const function
+) -> uint32_t
+{
+    uint32_t const result{isTemporary(argument) ? argument : acquire()};
+
+    m_program.m_instructions.push_back({
+        .code = code,
+        .function = function,
+        .result = result,
+        .operands = {argument, 0, 0},
+    });
+    return result;
+}
+
+auto ProgramCompiler::multiplyAdd(
+    uint32_t const lhs, uint32_t const rhs, uint32_t const addend
+) -> uint32_t
+{
+    uint32_t result{};
+    if (isTemporary(addend))
+    {
+        result = addend;
+        release(lhs);
+        if (rhs != lhs)
+        {
+            release(rhs);
+        }
+    }
+    else if (isTemporary(lhs))
+    {
+        result = lhs;
+        if (rhs != lhs)
+        {
+            release(rhs);
+        }
+    }
+    else if (isTemporary(rhs))
+    {
+        result = rhs;
+    }
+    else
+    {
+        result = acquire();
+    }
+
+    m_program.m_instructions.push_back({
+        .code = OpCode::MultiplyAdd,
+        .result = result,
+        .operands = {lhs, rhs, addend},
+    });
+    return result;
+}
+
+auto ProgramCompiler::call(
+    OpCode const code,
+    FunctionId const function,
+    std::span<uint32_t const> const arguments
+) -> uint32_t
+{
+    // Overwrites the first temporary argument and releases the others, which
+    // are all distinct since each has a single consumer.
+    auto const temporary{std::ranges::find_if(
+        arguments, [this](uint32_t const slot) { return isTemporary(slot); }
+    )};
+    uint32_t const result{
+        temporary != arguments.end() ? *temporary : acquire()
+    };
+    for (uint32_t const argument : arguments)
+    {
+        if (argument != result)
+        {
+            release(argument);
+        }
+    }
+
+    Instruction instruction{
+        .code = code,
+        .function = function,
+        .result = result,
+        .operands = {},
+    };
+    std::ranges::copy(arguments, instruction.operands.begin());
+    m_program.m_instructions.push_back(instruction);
+    return result;
+}
+
+auto Program::compile(Expression const& expression) -> std::optional<Program>
+{
+    if (!expression.valid())
+    {
+        return std::nullopt;
+    }
+
+    Program program{};
+    ProgramCompiler compiler{program, true};
+    compiler.finish(compiler.compileExpression(expression));
+
+    if (program.m_foldContext.has_value())
+    {
+        Program unfolded{};
+        ProgramCompiler fallback{unfolded, false};
+        fallback.finish(fallback.compileExpression(expression));
+        program.m_unfolded =
+            std::make_shared<Program const>(std::move(unfolded));
+    }
+
+    return program;
+}
+
+auto Program::instructions() const -> std::vector<Instruction> const&
+{
+    return m_instructions;
+}
+
+auto Program::constants() const -> std::vector<Scalar> const&
+{
+    return m_constants;
+}
+
+auto Program::constantCount() const -> size_t { return m_constants.size(); }
+
+auto Program::registerCount() const -> size_t { return m_registerCount; }
+
+auto Program::resultSlot() const -> uint32_t { return m_result; }
+
+VirtualMachine::VirtualMachine(Program program)
+    : m_program(std::move(program))
+{
+    size_t const precision{MathContext::current().precision};
+
+    m_slots.reserve(
+        1 + m_program.m_constants.size() + m_program.m_registerCount
+    );
+    m_slots.emplace_back(0.0, precision);
+    for (auto const& constant : m_program.m_constants)
+    {
+        m_slots.emplace_back(constant, precision);
+    }
+    for (size_t index = 0; index < m_program.m_registerCount; index++)
+    {
+        m_slots.emplace_back(0.0, precision);
+    }
+
+    m_doubleSlots.resize(m_slots.size());
+    for (size_t index = 0; index < m_program.m_constants.size(); index++)
+    {
+        m_doubleSlots[1 + index] = m_program.m_constants[index].toDouble();
+    }
+}
+
+auto VirtualMachine::run(Scalar const& variable) -> Scalar const&
+{
+    auto const& context{MathContext::current()};
+
+    // Folds only stand for their groups under the context they were computed
+    // in, as in Expression::evaluate.
+    if (m_program.m_foldContext.has_value()
+        && m_program.m_foldContext != context)
+    {
+        if (m_unfolded == nullptr)
+        {
+            m_unfolded =
+                std::make_unique<VirtualMachine>(*m_program.m_unfolded);
+        }
+        return m_unfolded->run(variable);
+    }
+
+    m_slots[VARIABLE_SLOT] = variable;
+
+    // Constants are rounded to the context's precision as evaluation rounds
+    // literals. Registers keep the working precision of the previous run, so
+    // they are narrowed again after a wider variable.
+    auto const constants{
+        std::span{m_slots}.subspan(1, m_program.m_constants.size())
+    };
+    for (size_t index = 0; index < constants.size(); index++)
+    {
+        if (constants[index].precision() != context.precision)
+        {
+            constants[index] =
+                Scalar{m_program.m_constants[index], context.precision};
+        }
+    }
+    size_t const precision{std::max(variable.precision(), context.precision)};
+    for (auto& slot : std::span{m_slots}.subspan(
+             1 + m_program.m_constants.size()
+         ))
+    {
+        if (slot.precision() != precision)
+        {
+            slot = Scalar{0.0, precision};
+        }
+    }
+
+    for (auto const& instruction : m_program.m_instructions)
+    {
+        auto& result{m_slots[instruction.result]};
+        auto const& [first, second, third] = instruction.operands;
+
+        switch (instruction.code)
+        {
+        case OpCode::Add:
+            Functions::add(result, m_slots[first], m_slots[second]);
+            break;
+        case OpCode::Subtract:
+            Functions::subtract(result, m_slots[first], m_slots[second]);
+            break;
+        case OpCode::Multiply:
+            Functions::multiply(result, m_slots[first], m_slots[second]);
+            break;
+        case OpCode::Divide:
+            Functions::divide(result, m_slots[first], m_slots[second]);
+            break;
+        case OpCode::MultiplyAdd:
+            Functions::fma(
+                result, m_slots[first], m_slots[second], m_slots[third]
+            );
+            break;
+        case OpCode::Negate:
+            Functions::negate(result, m_slots[first]);
+            break;
+        case OpCode::Call:
+            unaryFunction(instruction.function)
+                .function(result, m_slots[first], context);
+            break;
+        case OpCode::CallNary:
+            // Operands past the arity are zero, the variable, and ignored.
+            naryFunction(instruction.function)
+                .function(
+                    result,
+                    m_slots[first],
+                    m_slots[second],
+                    m_slots[third],
+                    context
+                );
+            break;
+        case OpCode::CallPartial:
+            naryFunction(instruction.function)
+                .partial.function(
+                    result,
+                    m_slots[first],
+                    m_slots[second],
+                    m_slots[third],
+                    context
+                );
+            break;
+        }
+    }
+
+    return m_slots[m_program.m_result];
+}
+
+auto VirtualMachine::run(double const variable) -> double
+{
+    m_doubleSlots[VARIABLE_SLOT] = variable;
+
+    for (auto const& instruction : m_program.m_instructions)
+    {
+        auto& result{m_doubleSlots[instruction.result]};
+        auto const& [first, second, third] = instruction.operands;
+
+        switch (instruction.code)
+        {
+        case OpCode::Add:
+            result = m_doubleSlots[first] + m_doubleSlots[second];
+            break;
+        case OpCode::Subtract:
+            result = m_doubleSlots[first] - m_doubleSlots[second];
+            break;
+        case OpCode::Multiply:
+            result = m_doubleSlots[first] * m_doubleSlots[second];
+            break;
+        case OpCode::Divide:
+            result = m_doubleSlots[first] / m_doubleSlots[second];
+            break;
+        case OpCode::MultiplyAdd:
+            result = (m_doubleSlots[first] * m_doubleSlots[second])
+                   + m_doubleSlots[third];
+            break;
+        case OpCode::Negate:
+            result = -m_doubleSlots[first];
+            break;
+        case OpCode::Call:
+            result = unaryFunction(instruction.function)
+                         .doubleFunction(m_doubleSlots[first]);
+            break;
+        case OpCode::CallNary:
+            result = naryFunction(instruction.function)
+                         .doubleFunction(
+                             m_doubleSlots[first],
+                             m_doubleSlots[second],
+                             m_doubleSlots[third]
+                         );
+            break;
+        case OpCode::CallPartial:
+            result = naryFunction(instruction.function)
+                         .partial.doubleFunction(
+                             m_doubleSlots[first],
+                             m_doubleSlots[second],
+                             m_doubleSlots[third]
+                         );
+            break;
+        }
+    }
+
+    return m_doubleSlots[m_program.m_result];
+}
+
+auto VirtualMachine::program() const -> Program const& { return m_program; }
+} // namespace calqmath
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "function_database.h"
+#include "math/number.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace calqmath
+{
+class Expression;
+
+enum class OpCode : uint8_t
+{
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    // result = operands[0] * operands[1] + operands[2], rounded once
+    MultiplyAdd,
+    Negate,
+    // result = the unary function applied to operands[0]
+    Call,
+    // result = the n-ary function applied to its arity in operands
+    CallNary,
+    // The same through its partial variant, where operands[0] is the constant
+    // prepared from the first argument. See NaryFunction::Partial.
+    CallPartial
+};
+
+/*
+ * A three address instruction. The result and operands index slots in the
+ * register file of a VirtualMachine, unused operands are zero.
+ */
+struct Instruction
+{
+    OpCode code;
+    // The function of a call, see FunctionId. It fits in the padding.
+    FunctionId function{NO_FUNCTION};
+    uint32_t result;
+    std::array<uint32_t, 3> operands;
+};
+
+/**
+ * @brief A flat, register based translation of an Expression.
+ *
+ * Slots are laid out as the variable, then every constant, then the registers
+ * holding intermediate values. Registers are reused as soon as their value is
+ * consumed, so their count is the most intermediates alive at once rather
+ * than the number of instructions. Shared subexpressions are computed once
+ * into a register of their own that is never reused.
+ *
+ * Instructions are ordered and fused exactly as Expression::evaluate performs
+ * them, so both produce identical results. Groups folded under the context
+ * compiled in become constants, see Expression::folded. The expression is
+ * then also compiled without them, for running under any other context.
+ */
+class Program
+{
+public:
+    /**
+     * @brief compile - Flattens an expression into instructions.
+     * @return The program, or nullopt if the expression is invalid.
+     */
+    static auto compile(Expression const& expression) -> std::optional<Program>;
+
+    [[nodiscard]] auto instructions() const -> std::vector<Instruction> const&;
+    [[nodiscard]] auto constants() const -> std::vector<Scalar> const&;
+    [[nodiscard]] auto constantCount() const -> size_t;
+    [[nodiscard]] auto registerCount() const -> size_t;
+
+    // Slot holding the result once every instruction has run.
+    [[nodiscard]] auto resultSlot() const -> uint32_t;
+
+private:
+    friend class ProgramCompiler;
+    friend class VirtualMachine;
+
+    Program() = default;
+
+    std::vector<Instruction> m_instructions;
+    std::vector<Scalar> m_constants;
+    size_t m_registerCount{0};
+    uint32_t m_result{0};
+    // The context folds were compiled in as constants under, if any were.
+    std::optional<MathContext> m_foldContext;
+    // The same expression without folds, whenever there are some.
+    std::shared_ptr<Program const> m_unfolded;
+};
+
+/**
+ * @brief Runs a Program over a register file that is allocated once, up front.
+ *
+ * Every slot is initialized at the current MathContext's precision when the
+ * machine is created, and constants are rounded to it just as evaluation
+ * rounds literals. At or below INLINE_BASE_2_PRECISION running the program
+ * then never touches the heap. Constants are only rounded again when the
+ * context's precision changes between runs, and registers when the larger of
+ * the variable's and the context's precision does. Under a context other than
+ * the one folds were compiled under, runs go to a second machine over the
+ * program without them. A second register file of doubles backs the hardware
+ * path.
+ *
+ * A machine is not thread safe, use one per thread.
+ */
+class VirtualMachine
+{
+public:
+    explicit VirtualMachine(Program program);
+
+    /**
+     * @brief run - Evaluates the program for the given variable.
+     * @return The result, which stays valid until the next run.
+     */
+    auto run(Scalar const& variable) -> Scalar const&;
+
+    /**
+     * @brief run - Evaluates the program in hardware doubles, see
+     * Expression::evaluate(double).
+     */
+    auto run(double variable) -> double;
+
+    [[nodiscard]] auto program() const -> Program const&;
+
+private:
+    Program m_program;
+    std::vector<Scalar> m_slots;
+    std::vector<double> m_doubleSlots;
+    // Runs the program without folds, created on first use.
+    std::unique_ptr<VirtualMachine> m_unfolded;
+};
+} // namespace calqmath
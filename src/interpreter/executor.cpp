@@ -0,0 +1,270 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace calqmath
+{
+namespace
+{
+// Values per chunk of evaluateMany. Small enough to balance uneven costs, and
+// large enough for Expression::evaluateMany to amortize its tree walk.
+size_t constexpr EVALUATION_GRAIN_SIZE = 256;
+
+// A participant's remaining chunks, [begin, end).
+struct ChunkQueue
+{
+    std::mutex mutex;
+    size_t begin{0};
+    size_t end{0};
+};
+} // namespace
+
+struct Executor::Batch
+{
+    std::function<void(size_t, size_t)> const& task;
+    size_t count;
+    size_t grainSize;
+    MathContext context;
+    std::unique_ptr<ChunkQueue[]> queues;
+    size_t queueCount;
+};
+
+Executor::Executor(size_t participants)
+{
+    if (participants == 0)
+    {
+        participants = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    // The caller is participant zero.
+    m_workers.reserve(participants - 1);
+    for (size_t participant = 1; participant < participants; participant++)
+    {
+        m_workers.emplace_back([this, participant]() { work(participant); });
+    }
+}
+
+Executor::~Executor()
+{
+    {
+        std::lock_guard const lock{m_mutex};
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+auto Executor::participants() const -> size_t { return m_workers.size() + 1; }
+
+void Executor::parallelFor(
+    size_t const count,
+    size_t const grainSize,
+    std::function<void(size_t begin, size_t end)> const& task
+)
+{
+    assert(grainSize > 0);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    std::lock_guard const submitLock{m_submit};
+
+    size_t const chunks{(count + grainSize - 1) / grainSize};
+    size_t const queueCount{participants()};
+
+    Batch batch{
+        .task = task,
+        .count = count,
+        .grainSize = grainSize,
+        .context = MathContext::current(),
+        .queues = std::make_unique<ChunkQueue[]>(queueCount),
+        .queueCount = queueCount,
+    };
+    for (size_t queue = 0; queue < queueCount; queue++)
+    {
+        batch.queues[queue].begin = chunks * queue / queueCount;
+        batch.queues[queue].end = chunks * (queue + 1) / queueCount;
+    }
+
+    {
+        std::lock_guard const lock{m_mutex};
+        m_batch = &batch;
+        m_finished = 0;
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    participate(batch, 0);
+
+    // Workers may still be looking for chunks to steal, so the batch must
+    // outlive all of them, not just its last chunk.
+    std::unique_lock lock{m_mutex};
+    m_done.wait(lock, [&]() { return m_finished == m_workers.size(); });
+    m_batch = nullptr;
+}
+
+auto Executor::evaluateMany(
+    Expression const& expression,
+    std::span<Scalar const> const variables,
+    std::span<Scalar> const results
+) -> bool
+{
+    assert(variables.size() == results.size());
+
+    std::atomic<bool> valid{true};
+    parallelFor(
+        variables.size(),
+        EVALUATION_GRAIN_SIZE,
+        [&](size_t const begin, size_t const end)
+    {
+        if (!expression.evaluateMany(
+                variables.subspan(begin, end - begin),
+                results.subspan(begin, end - begin)
+            ))
+        {
+            valid = false;
+        }
+    }
+    );
+    return valid;
+}
+
+auto Executor::evaluateMany(
+    Expression const& expression,
+    std::span<double const> const variables,
+    std::span<double> const results
+) -> bool
+{
+    assert(variables.size() == results.size());
+
+    std::atomic<bool> valid{true};
+    parallelFor(
+        variables.size(),
+        EVALUATION_GRAIN_SIZE,
+        [&](size_t const begin, size_t const end)
+    {
+        if (!expression.evaluateMany(
+                variables.subspan(begin, end - begin),
+                results.subspan(begin, end - begin)
+            ))
+        {
+            valid = false;
+        }
+    }
+    );
+    return valid;
+}
+
+void Executor::work(size_t const participant)
+{
+    size_t generation{0};
+    while (true)
+    {
+        Batch* batch{nullptr};
+        {
+            std::unique_lock lock{m_mutex};
+            m_wake.wait(
+                lock,
+                [&]() { return m_stopping || m_generation != generation; }
+            );
+            if (m_stopping)
+            {
+                break;
+            }
+            generation = m_generation;
+            batch = m_batch;
+        }
+
+        participate(*batch, participant);
+
+        {
+            std::lock_guard const lock{m_mutex};
+            m_finished++;
+        }
+        m_done.notify_one();
+    }
+
+    releaseThreadCaches();
+}
+
+void Executor::participate(Batch& batch, size_t const participant)
+{
+    MathContextScope const scope{batch.context};
+
+    ChunkQueue& own{batch.queues[participant]};
+
+    auto const pop = [&]() -> std::optional<size_t>
+    {
+        std::lock_guard const lock{own.mutex};
+        if (own.begin == own.end)
+        {
+            return std::nullopt;
+        }
+        return own.begin++;
+    };
+
+    /*
+     * Takes the back half of the first non-empty queue after this one's, so
+     * that victims keep the chunks next to the ones they are working on. The
+     * first stolen chunk is returned and the rest become this queue's.
+     */
+    auto const steal = [&]() -> std::optional<size_t>
+    {
+        for (size_t offset = 1; offset < batch.queueCount; offset++)
+        {
+            ChunkQueue& victim{
+                batch.queues[(participant + offset) % batch.queueCount]
+            };
+
+            size_t begin{0};
+            size_t end{0};
+            {
+                std::lock_guard const lock{victim.mutex};
+                if (victim.begin == victim.end)
+                {
+                    continue;
+                }
+                begin = victim.end - (victim.end - victim.begin + 1) / 2;
+                end = victim.end;
+                victim.end = begin;
+            }
+
+            std::lock_guard const lock{own.mutex};
+            own.begin = begin + 1;
+            own.end = end;
+            return begin;
+        }
+        return std::nullopt;
+    };
+
+    while (true)
+    {
+        auto chunk{pop()};
+        if (!chunk.has_value())
+        {
+            chunk = steal();
+        }
+        if (!chunk.has_value())
+        {
+            // Chunks only move between queues under their locks, so nothing
+            // is left that another participant is not already holding.
+            break;
+        }
+
+        size_t const begin{chunk.value() * batch.grainSize};
+        size_t const end{std::min(batch.count, begin + batch.grainSize)};
+        batch.task(begin, end);
+    }
+}
+} // namespace calqmath
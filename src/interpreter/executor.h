@@ -0,0 +1,96 @@
+#pragma once
+
+#include "expression.h"
+#include "math/number.h"
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace calqmath
+{
+/**
+ * @brief A pool of worker threads that split batch evaluations between them.
+ *
+ * A batch is cut into chunks, and every participant starts with an equal
+ * contiguous share of them. A participant that runs out steals half of what
+ * remains of another's share, so batches whose cost varies along the input,
+ * such as gamma near its poles, still keep every core busy.
+ *
+ * The calling thread participates too, and every participant runs under the
+ * caller's MathContext. Backend state such as caches is per thread, so workers
+ * never contend on it.
+ *
+ * One batch runs at a time. Calls from several threads are serialized, and a
+ * task must not submit to the executor running it.
+ */
+class Executor
+{
+public:
+    // Zero picks one participant per hardware thread.
+    explicit Executor(size_t participants = 0);
+    ~Executor();
+
+    Executor(Executor const&) = delete;
+    Executor(Executor&&) = delete;
+    auto operator=(Executor const&) -> Executor& = delete;
+    auto operator=(Executor&&) -> Executor& = delete;
+
+    // The number of threads a batch runs on, including the caller.
+    [[nodiscard]] auto participants() const -> size_t;
+
+    /**
+     * @brief parallelFor - Calls task(begin, end) for disjoint ranges covering
+     * [0, count), each at most grainSize long, and returns once all are done.
+     */
+    void parallelFor(
+        size_t count,
+        size_t grainSize,
+        std::function<void(size_t begin, size_t end)> const& task
+    );
+
+    /**
+     * @brief evaluateMany - Expression::evaluateMany, split across the
+     * participants.
+     *
+     * Each chunk picks its precision as Expression::evaluateMany does, so
+     * results only match a single call exactly when the variables share a
+     * precision.
+     *
+     * @return Whether results were written. False if the tree was invalid.
+     */
+    [[nodiscard]] auto evaluateMany(
+        Expression const& expression,
+        std::span<Scalar const> variables,
+        std::span<Scalar> results
+    ) -> bool;
+    [[nodiscard]] auto evaluateMany(
+        Expression const& expression,
+        std::span<double const> variables,
+        std::span<double> results
+    ) -> bool;
+
+private:
+    struct Batch;
+
+    void work(size_t participant);
+    static void participate(Batch& batch, size_t participant);
+
+    std::vector<std::thread> m_workers;
+
+    // Serializes batches.
+    std::mutex m_submit;
+
+    // Guards the fields below, which hand batches to the workers.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    Batch* m_batch{nullptr};
+    size_t m_generation{0};
+    size_t m_finished{0};
+    bool m_stopping{false};
+};
+} // namespace calqmath
@@ -1,360 +1,2419 @@
 #include "expression.h"
 
 #include "function_database.h"
+#include "math/functions.h"
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cctype>
+#include <cmath>
 #include <cstddef>
-#include <deque>
 #include <expected>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <ranges>
+#include <span>
 #include <string>
-#include <variant>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-// Helper for std::visit
-// See example at https://en.cppreference.com/w/cpp/utility/variant/visit
-template <class... Ts> struct overloads : Ts...
+namespace calqmath
+{
+auto Expression::operator==(Expression const& rhs) const -> bool
+{
+    // Functions compare by FunctionId, within the nodes.
+    return m_nodes == rhs.m_nodes && m_operands == rhs.m_operands
+        && m_literals == rhs.m_literals;
+}
+
+namespace
+{
+auto mathOperatorToString(BinaryOp const binaryOp) -> char const*
+{
+    switch (binaryOp)
+    {
+    case BinaryOp::Plus:
+        return "+";
+    case BinaryOp::Minus:
+        return "-";
+    case BinaryOp::Multiply:
+        return "*";
+    case BinaryOp::Divide:
+        return "/";
+    }
+
+    return "?";
+}
+} // namespace
+
+auto Expression::string() const -> std::string
+{
+    if (!valid())
+    {
+        return "Invalid";
+    }
+
+    if (empty())
+    {
+        return "Empty";
+    }
+
+    return stringNode(root());
+}
+
+auto Expression::evaluate(Scalar const& variable) const -> std::optional<Scalar>
+{
+    if (!valid())
+    {
+        return std::nullopt;
+    }
+
+    if (empty())
+    {
+        return Scalar{"0.0"};
+    }
+
+    auto memo{newMemo<Scalar>()};
+    return evaluateNode(root(), variable, memo);
+}
+
+auto Expression::evaluate(
+    Scalar const& variable, MathContext const& context
+) const -> std::optional<Scalar>
+{
+    MathContextScope const scope{context};
+    return evaluate(variable);
+}
+
+auto Expression::evaluate(double const variable) const -> std::optional<double>
+{
+    return evaluateGeneric(variable);
+}
+
+auto Expression::evaluate(DoubleDouble const& variable) const
+    -> std::optional<DoubleDouble>
+{
+    return evaluateGeneric(variable);
+}
+
+auto Expression::evaluate(QuadDouble const& variable) const
+    -> std::optional<QuadDouble>
+{
+    return evaluateGeneric(variable);
+}
+
+auto Expression::evaluate(Interval const& variable) const
+    -> std::optional<Interval>
+{
+    return evaluateGeneric(variable);
+}
+
+auto Expression::evaluate(Jet const& variable) const -> std::optional<Jet>
+{
+    return evaluateGeneric(variable);
+}
+
+namespace
+{
+/*
+ * Evaluates a shared node once per walk, keeping its value in the memo for
+ * its other parents. Anything else is computed every time it is reached.
+ */
+template <typename T, typename Compute>
+auto memoized(
+    bool const shared,
+    uint32_t const index,
+    std::vector<std::optional<T>>& memo,
+    Compute const& compute
+) -> std::optional<T>
+{
+    if (!shared)
+    {
+        return compute();
+    }
+
+    std::optional<T>& cached{memo[index]};
+    if (!cached.has_value())
+    {
+        cached = compute();
+    }
+    return cached;
+}
+
+auto applyGeneric(UnaryFunction const& function, double const argument)
+    -> double
+{
+    assert(function.doubleFunction != nullptr);
+    return function.doubleFunction(argument);
+}
+
+auto applyGeneric(UnaryFunction const& function, DoubleDouble const& argument)
+    -> DoubleDouble
+{
+    assert(function.doubleDoubleFunction != nullptr);
+    return function.doubleDoubleFunction(argument);
+}
+
+auto applyGeneric(UnaryFunction const& function, QuadDouble const& argument)
+    -> QuadDouble
+{
+    assert(function.quadDoubleFunction != nullptr);
+    return function.quadDoubleFunction(argument);
+}
+
+auto applyGeneric(UnaryFunction const& function, Interval const& argument)
+    -> Interval
+{
+    assert(function.intervalFunction != nullptr);
+    return function.intervalFunction(argument);
+}
+
+auto applyGeneric(UnaryFunction const& function, Jet const& argument) -> Jet
+{
+    assert(function.jetFunction != nullptr);
+    return function.jetFunction(argument);
+}
+
+// The arguments of a call. Those past its arity are empty.
+template <typename T>
+using CallArguments = std::array<std::optional<T>, NaryFunction::MAX_ARITY>;
+
+// The argument at a position of a call, where those past its arity, which the
+// function ignores, are the first.
+template <typename T>
+auto argument(CallArguments<T> const& arguments, size_t const position)
+    -> T const&
+{
+    return arguments[position].has_value() ? arguments[position].value()
+                                           : arguments.front().value();
+}
+
+auto applyGeneric(
+    NaryFunction const& function, CallArguments<double> const& arguments
+) -> double
+{
+    assert(function.doubleFunction != nullptr);
+    return function.doubleFunction(
+        argument(arguments, 0), argument(arguments, 1), argument(arguments, 2)
+    );
+}
+
+// The partial variant, whose first argument is the prepared value.
+auto applyGeneric(
+    NaryFunction::Partial const& function,
+    CallArguments<double> const& arguments
+) -> double
+{
+    assert(function.doubleFunction != nullptr);
+    return function.doubleFunction(
+        argument(arguments, 0), argument(arguments, 1), argument(arguments, 2)
+    );
+}
+
+auto applyGeneric(
+    NaryFunction const& function, CallArguments<DoubleDouble> const& arguments
+) -> DoubleDouble
+{
+    assert(function.doubleDoubleFunction != nullptr);
+    return function.doubleDoubleFunction(
+        argument(arguments, 0), argument(arguments, 1), argument(arguments, 2)
+    );
+}
+
+auto applyGeneric(
+    NaryFunction const& function, CallArguments<QuadDouble> const& arguments
+) -> QuadDouble
+{
+    assert(function.quadDoubleFunction != nullptr);
+    return function.quadDoubleFunction(
+        argument(arguments, 0), argument(arguments, 1), argument(arguments, 2)
+    );
+}
+
+auto applyGeneric(
+    NaryFunction const& function, CallArguments<Interval> const& arguments
+) -> Interval
+{
+    assert(function.intervalFunction != nullptr);
+    return function.intervalFunction(
+        argument(arguments, 0), argument(arguments, 1), argument(arguments, 2)
+    );
+}
+
+auto applyGeneric(
+    NaryFunction const& function, CallArguments<Jet> const& arguments
+) -> Jet
+{
+    assert(function.jetFunction != nullptr);
+    return function.jetFunction(
+        argument(arguments, 0), argument(arguments, 1), argument(arguments, 2)
+    );
+}
+} // namespace
+
+template <typename T>
+auto Expression::evaluateGeneric(T const& variable) const -> std::optional<T>
+{
+    if (!valid())
+    {
+        return std::nullopt;
+    }
+
+    if (empty())
+    {
+        return T{0.0};
+    }
+
+    auto memo{newMemo<T>()};
+    return evaluateGeneric(root(), variable, memo);
+}
+
+namespace
+{
+// Values per block of evaluateMany, small enough that a block's intermediate
+// values stay in cache.
+size_t constexpr EVALUATION_BLOCK_SIZE = 256;
+} // namespace
+
+auto Expression::evaluateMany(
+    std::span<Scalar const> const variables, std::span<Scalar> const results
+) const -> bool
+{
+    assert(variables.size() == results.size());
+
+    if (!valid())
+    {
+        return false;
+    }
+
+    size_t precision{MathContext::current().precision};
+    for (Scalar const& variable : variables)
+    {
+        precision = std::max(precision, variable.precision());
+    }
+
+    for (size_t start = 0; start < variables.size();
+         start += EVALUATION_BLOCK_SIZE)
+    {
+        size_t const size{
+            std::min(EVALUATION_BLOCK_SIZE, variables.size() - start)
+        };
+
+        ScalarVector block{size, precision};
+        for (size_t i = 0; i < size; i++)
+        {
+            block.set(i, variables[start + i]);
+        }
+
+        auto const blockResults{evaluateBlock(block)};
+        if (!blockResults.has_value())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < size; i++)
+        {
+            results[start + i] = blockResults->get(i);
+        }
+    }
+
+    return true;
+}
+
+auto Expression::evaluateMany(
+    std::span<double const> const variables, std::span<double> const results
+) const -> bool
+{
+    assert(variables.size() == results.size());
+
+    if (!valid())
+    {
+        return false;
+    }
+
+    for (size_t start = 0; start < variables.size();
+         start += EVALUATION_BLOCK_SIZE)
+    {
+        size_t const size{
+            std::min(EVALUATION_BLOCK_SIZE, variables.size() - start)
+        };
+
+        auto const blockResults{evaluateBlock(variables.subspan(start, size))};
+        if (!blockResults.has_value())
+        {
+            return false;
+        }
+
+        std::ranges::copy(blockResults.value(), results.begin() + start);
+    }
+
+    return true;
+}
+
+auto Expression::evaluateBlock(ScalarVector const& variables) const
+    -> std::optional<ScalarVector>
+{
+    if (!valid())
+    {
+        return std::nullopt;
+    }
+
+    if (empty())
+    {
+        return ScalarVector{variables.size()};
+    }
+
+    auto memo{newMemo<ScalarVector>()};
+    return evaluateBlock(root(), variables, memo);
+}
+
+auto Expression::evaluateBlock(std::span<double const> const variables) const
+    -> std::optional<std::vector<double>>
+{
+    if (!valid())
+    {
+        return std::nullopt;
+    }
+
+    if (empty())
+    {
+        return std::vector<double>(variables.size(), 0.0);
+    }
+
+    auto memo{newMemo<std::vector<double>>()};
+    return evaluateBlock(root(), variables, memo);
+}
+
+auto Expression::folded() const -> Expression
+{
+    Expression result{*this};
+    if (!valid() || empty())
+    {
+        return result;
+    }
+
+    // Children precede their parents, so one pass finds every node that
+    // depends on the variable.
+    std::vector<bool> variable(m_nodes.size(), false);
+    for (size_t index = 0; index < m_nodes.size(); index++)
+    {
+        Node const& node{m_nodes[index]};
+        if (node.kind == NodeKind::Variable)
+        {
+            variable[index] = true;
+        }
+        else if (node.kind != NodeKind::Literal)
+        {
+            variable[index] = std::ranges::any_of(
+                operands(node),
+                [&](Operand const& operand) { return variable[operand.node]; }
+            );
+        }
+    }
+
+    // Then walking back from the root, only the outermost constant groups are
+    // folded and everything within them is skipped.
+    std::vector<bool> reached(m_nodes.size(), false);
+    reached[root()] = true;
+    auto memo{newMemo<Scalar>()};
+    for (size_t index = m_nodes.size(); index-- > 0;)
+    {
+        Node const& node{m_nodes[index]};
+        if (!reached[index])
+        {
+            continue;
+        }
+
+        if ((node.kind == NodeKind::Sum || node.kind == NodeKind::Call)
+            && !variable[index])
+        {
+            auto value{
+                evaluateNode(static_cast<uint32_t>(index), Scalar{}, memo)
+            };
+            if (value.has_value())
+            {
+                result.m_nodes[index].folded =
+                    static_cast<uint32_t>(result.m_literals.size());
+                result.m_literals.push_back(std::move(value).value());
+                continue;
+            }
+        }
+
+        if (node.kind == NodeKind::Literal || node.kind == NodeKind::Variable)
+        {
+            continue;
+        }
+
+        // Calls prepare what they can from a constant first argument, which
+        // is then no longer evaluated.
+        auto arguments{operands(node)};
+        NaryFunction::Partial const partial{
+            node.kind == NodeKind::Call ? naryFunction(node.function).partial
+                                        : NaryFunction::Partial{}
+        };
+        if (partial.prepare != nullptr && !variable[arguments.front().node])
+        {
+            auto const first{
+                evaluateNode(arguments.front().node, Scalar{}, memo)
+            };
+            if (first.has_value())
+            {
+                Scalar prepared{0.0, first->precision()};
+                partial.prepare(prepared, *first, MathContext::current());
+                result.m_nodes[index].partial =
+                    static_cast<uint32_t>(result.m_literals.size());
+                result.m_literals.push_back(std::move(prepared));
+                arguments = arguments.subspan(1);
+            }
+        }
+
+        for (auto const& operand : arguments)
+        {
+            reached[operand.node] = true;
+        }
+    }
+
+    result.m_foldContext = MathContext::current();
+    return result;
+}
+
+/*
+ * Copies an expression node by node, applying the rewrites of
+ * Expression::simplified on the way. Every decision is made on the source, so
+ * nothing is written to the result only to be dropped.
+ */
+class Simplifier
 {
-    using Ts::operator()...;
+public:
+    explicit Simplifier(Expression const& source)
+        : m_source(source)
+    {
+    }
+
+    auto simplify() -> Expression;
+
+private:
+    using Node = Expression::Node;
+    using NodeKind = Expression::NodeKind;
+    using Operand = Expression::Operand;
+
+    auto term(uint32_t index) -> uint32_t;
+    // A group negated once more than it is in the source.
+    auto group(uint32_t index, bool negate) -> uint32_t;
+    auto product(uint32_t index) -> uint32_t;
+    // Copies a subtree verbatim, except for negating its root once more.
+    auto copy(uint32_t index, bool negate) -> uint32_t;
+
+    auto literal(Scalar value) -> uint32_t;
+    auto emit(Node node, std::span<Operand const> operands) -> uint32_t;
+
+    [[nodiscard]] auto isLiteral(uint32_t index, double value) const -> bool;
+    [[nodiscard]] auto functionName(Node const& node) const -> std::string_view;
+    // The only term of a group with a single summand that is not a product.
+    [[nodiscard]] auto singleTerm(Node const& node) const
+        -> std::optional<uint32_t>;
+    // The exact reciprocal of a literal, if it has one.
+    [[nodiscard]] auto reciprocal(uint32_t index) const
+        -> std::optional<Scalar>;
+
+    Expression const& m_source;
+    Expression m_result;
+    Expression::InternTable m_interned;
 };
 
-namespace calqmath
-{
-auto Expression::operator=(Expression const& other) -> Expression&
-{
-    m_terms.clear();
+namespace
+{
+// Functions whose results are integers, so that applying any of them again
+// changes nothing.
+auto isRounding(std::string_view const name) -> bool
+{
+    return name == "ceil" || name == "floor" || name == "round"
+        || name == "roundeven" || name == "trunc";
+}
+} // namespace
+
+auto Simplifier::simplify() -> Expression
+{
+    uint32_t const root{group(m_source.root(), false)};
+    if (m_result.m_nodes[root].kind != NodeKind::Sum)
+    {
+        // The root is always a group, so the term is wrapped back into one.
+        Operand const operand{.node = root};
+        emit({.kind = NodeKind::Sum}, std::span{&operand, 1});
+    }
+
+    m_result.m_hasVariable = m_source.m_hasVariable;
+    m_result.m_foldContext = m_source.m_foldContext;
+
+    m_result.markShared();
+    return std::move(m_result);
+}
+
+auto Simplifier::term(uint32_t const index) -> uint32_t
+{
+    Node const& node{m_source.m_nodes[index]};
+
+    switch (node.kind)
+    {
+    case NodeKind::Literal:
+        return literal(m_source.m_literals[node.begin]);
+    case NodeKind::Variable:
+        return m_result.intern({.kind = NodeKind::Variable}, m_interned);
+    case NodeKind::Sum:
+        return group(index, false);
+    case NodeKind::Product:
+        return product(index);
+    case NodeKind::Square:
+    {
+        Operand const operand{
+            .node = term(m_source.operands(node).front().node)
+        };
+        return emit(node, std::span{&operand, 1});
+    }
+    case NodeKind::Call:
+    {
+        if (node.folded != Expression::NOT_FOLDED)
+        {
+            return copy(index, false);
+        }
+
+        // Arguments are never products, and neither are their rewrites.
+        std::vector<Operand> arguments{};
+        for (auto const& argument : m_source.operands(node))
+        {
+            arguments.push_back({.node = term(argument.node)});
+        }
+
+        Node call{
+            .kind = NodeKind::Call,
+            .negate = node.negate,
+            .function = node.function,
+        };
+        if (node.partial != Expression::NOT_FOLDED)
+        {
+            call.partial = static_cast<uint32_t>(m_result.m_literals.size());
+            m_result.m_literals.push_back(m_source.m_literals[node.partial]);
+        }
+        return emit(call, arguments);
+    }
+    }
+
+    assert(false);
+    return 0;
+}
+
+auto Simplifier::group(uint32_t const index, bool negate) -> uint32_t
+{
+    Node const& node{m_source.m_nodes[index]};
+    negate = negate != node.negate;
+
+    if (node.folded != Expression::NOT_FOLDED)
+    {
+        return copy(index, negate != node.negate);
+    }
+
+    std::string_view name{functionName(node)};
+    if (name == "id")
+    {
+        name = {};
+    }
+
+    if (auto const single{singleTerm(node)}; single.has_value())
+    {
+        Node const& inner{m_source.m_nodes[single.value()]};
+        std::string_view const innerName{functionName(inner)};
+
+        if (name.empty() && inner.kind == NodeKind::Sum)
+        {
+            return group(single.value(), negate);
+        }
+        if (name.empty() && inner.kind == NodeKind::Literal)
+        {
+            Scalar const& value{m_source.m_literals[inner.begin]};
+            return literal(negate ? -value : value);
+        }
+        if (name.empty() && !negate)
+        {
+            return term(single.value());
+        }
+
+        // floor(-ceil(x)) is -ceil(x), while abs(-abs(x)) is abs(x).
+        if (isRounding(name) && isRounding(innerName))
+        {
+            return group(single.value(), negate);
+        }
+        if (name == "abs" && innerName == "abs")
+        {
+            return group(single.value(), negate != inner.negate);
+        }
+    }
+
+    auto const summands{m_source.operands(node)};
+
+    // Leading zeros can only go if an addition follows them.
+    size_t first{0};
+    while (first < summands.size() && isLiteral(summands[first].node, 0.0))
+    {
+        first++;
+    }
+    if (first == summands.size() || summands[first].invert)
+    {
+        first = 0;
+    }
+
+    std::vector<Operand> operands{};
+    for (auto const& summand : summands.subspan(first))
+    {
+        if (!operands.empty() && isLiteral(summand.node, 0.0))
+        {
+            continue;
+        }
+        operands.push_back({
+            .node = term(summand.node),
+            .invert = summand.invert,
+        });
+    }
+
+    Node result{.kind = NodeKind::Sum, .negate = negate};
+    if (!name.empty())
+    {
+        result.function = node.function;
+    }
+    return emit(result, operands);
+}
+
+auto Simplifier::product(uint32_t const index) -> uint32_t
+{
+    auto const factors{m_source.operands(m_source.m_nodes[index])};
+
+    // Leading ones can only go if a multiplication follows them.
+    size_t first{0};
+    while (first < factors.size() && isLiteral(factors[first].node, 1.0))
+    {
+        first++;
+    }
+    if (first == factors.size() || factors[first].invert)
+    {
+        first = 0;
+    }
+
+    std::vector<Operand> operands{};
+
+    size_t position{first};
+    if (position + 1 < factors.size() && !factors[position + 1].invert
+        && !isLiteral(factors[position].node, 1.0)
+        && m_source.equalNodes(
+            factors[position].node, factors[position + 1].node
+        ))
+    {
+        Operand const operand{.node = term(factors[position].node)};
+        operands.push_back({
+            .node = emit({.kind = NodeKind::Square}, std::span{&operand, 1}),
+        });
+        position += 2;
+    }
+
+    for (auto const& factor : factors.subspan(position))
+    {
+        if (!operands.empty() && isLiteral(factor.node, 1.0))
+        {
+            continue;
+        }
+
+        if (factor.invert)
+        {
+            if (auto inverse{reciprocal(factor.node)}; inverse.has_value())
+            {
+                operands.push_back({.node = literal(std::move(inverse).value())}
+                );
+                continue;
+            }
+        }
+
+        operands.push_back({
+            .node = term(factor.node),
+            .invert = factor.invert,
+        });
+    }
+
+    if (operands.size() == 1)
+    {
+        return operands.front().node;
+    }
+    return emit({.kind = NodeKind::Product}, operands);
+}
+
+auto Simplifier::copy(uint32_t const index, bool const negate) -> uint32_t
+{
+    Node node{m_source.m_nodes[index]};
+
+    if (node.kind == NodeKind::Literal || node.kind == NodeKind::Variable)
+    {
+        return term(index);
+    }
+
+    std::vector<Operand> operands{};
+    for (auto const& operand : m_source.operands(node))
+    {
+        operands.push_back({
+            .node = copy(operand.node, false),
+            .invert = operand.invert,
+        });
+    }
+
+    if (negate)
+    {
+        node.negate = !node.negate;
+    }
+    if (node.folded != Expression::NOT_FOLDED)
+    {
+        Scalar const& value{m_source.m_literals[node.folded]};
+        node.folded = static_cast<uint32_t>(m_result.m_literals.size());
+        m_result.m_literals.push_back(negate ? -value : value);
+    }
+
+    return emit(node, operands);
+}
+
+auto Simplifier::literal(Scalar value) -> uint32_t
+{
+    return m_result.internLiteral(std::move(value), m_interned);
+}
+
+auto Simplifier::emit(Node node, std::span<Operand const> const operands)
+    -> uint32_t
+{
+    node.begin = static_cast<uint32_t>(m_result.m_operands.size());
+    node.count = static_cast<uint32_t>(operands.size());
+    m_result.m_operands.insert(
+        m_result.m_operands.end(), operands.begin(), operands.end()
+    );
+    return m_result.intern(node, m_interned);
+}
+
+auto Simplifier::isLiteral(uint32_t const index, double const value) const
+    -> bool
+{
+    Node const& node{m_source.m_nodes[index]};
+    return node.kind == NodeKind::Literal
+        && m_source.m_literals[node.begin] == Scalar{value};
+}
+
+auto Simplifier::functionName(Node const& node) const -> std::string_view
+{
+    if (node.kind != NodeKind::Sum || node.function == NO_FUNCTION)
+    {
+        return {};
+    }
+    return unaryFunction(node.function).name;
+}
+
+auto Simplifier::singleTerm(Node const& node) const -> std::optional<uint32_t>
+{
+    auto const summands{m_source.operands(node)};
+    if (summands.size() != 1
+        || m_source.m_nodes[summands.front().node].kind == NodeKind::Product)
+    {
+        return std::nullopt;
+    }
+    return summands.front().node;
+}
+
+auto Simplifier::reciprocal(uint32_t const index) const
+    -> std::optional<Scalar>
+{
+    Node const& node{m_source.m_nodes[index]};
+    if (node.kind != NodeKind::Literal)
+    {
+        return std::nullopt;
+    }
+
+    // Only powers of two have reciprocals that round to themselves, which is
+    // checked by the fused residual being exactly zero.
+    Scalar const& divisor{m_source.m_literals[node.begin]};
+    Scalar const one{1.0, divisor.precision()};
+    Scalar inverse{one / divisor};
+    if (Functions::fms(inverse, divisor, one) != Scalar{0.0})
+    {
+        return std::nullopt;
+    }
+    return inverse;
+}
+
+auto Expression::simplified() const -> Simplification
+{
+    if (!valid() || empty())
+    {
+        return {.expression = *this, .removedNodes = 0};
+    }
+
+    Expression expression{Simplifier{*this}.simplify()};
+    assert(expression.m_nodes.size() <= m_nodes.size());
+
+    size_t const removed{m_nodes.size() - expression.m_nodes.size()};
+    return {.expression = std::move(expression), .removedNodes = removed};
+}
+
+auto Expression::termCount() const -> size_t
+{
+    if (empty())
+    {
+        return 0;
+    }
+
+    size_t count{0};
+    for (auto const& summand : operands(m_nodes[root()]))
+    {
+        count += factors(summand).size();
+    }
+    return count;
+}
+
+auto Expression::hasVariable() const -> bool { return m_hasVariable; }
+
+auto Expression::root() const -> uint32_t
+{
+    assert(!empty());
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+auto Expression::operands(Node const& node) const -> std::span<Operand const>
+{
+    return std::span{m_operands}.subspan(node.begin, node.count);
+}
+
+auto Expression::factors(Operand const& summand) const
+    -> std::span<Operand const>
+{
+    Node const& node{m_nodes[summand.node]};
+    if (node.kind == NodeKind::Product)
+    {
+        return operands(node);
+    }
+    return std::span{&summand, 1};
+}
+
+auto Expression::squareOperand(Operand const& summand) const
+    -> std::optional<uint32_t>
+{
+    Node const& node{m_nodes[summand.node]};
+    if (node.kind != NodeKind::Square)
+    {
+        return std::nullopt;
+    }
+    return operands(node).front().node;
+}
+
+auto Expression::equalNodes(uint32_t const lhs, uint32_t const rhs) const
+    -> bool
+{
+    if (lhs == rhs)
+    {
+        return true;
+    }
+
+    Node const& left{m_nodes[lhs]};
+    Node const& right{m_nodes[rhs]};
+    if (left.kind != right.kind || left.negate != right.negate
+        || left.count != right.count)
+    {
+        return false;
+    }
+
+    switch (left.kind)
+    {
+    case NodeKind::Literal:
+        return m_literals[left.begin] == m_literals[right.begin];
+    case NodeKind::Variable:
+        return true;
+    case NodeKind::Sum:
+    case NodeKind::Product:
+    case NodeKind::Square:
+    case NodeKind::Call:
+        break;
+    }
+
+    if (left.function != right.function)
+    {
+        return false;
+    }
+
+    return std::ranges::equal(
+        operands(left),
+        operands(right),
+        [&](Operand const& lhsOperand, Operand const& rhsOperand)
+    {
+        return lhsOperand.invert == rhsOperand.invert
+            && equalNodes(lhsOperand.node, rhsOperand.node);
+    }
+    );
+}
+
+namespace
+{
+auto combineHash(size_t const seed, size_t const value) -> size_t
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+auto hashLiteral(Scalar const& value) -> size_t
+{
+    return std::hash<uint64_t>{}(std::bit_cast<uint64_t>(value.toDouble()));
+}
+
+// Literals are interchangeable if they evaluate the same everywhere, which
+// includes the sign of a zero.
+auto sameLiteral(Scalar const& lhs, Scalar const& rhs) -> bool
+{
+    return lhs.precision() == rhs.precision() && lhs == rhs
+        && std::signbit(lhs.toDouble()) == std::signbit(rhs.toDouble());
+}
+} // namespace
+
+auto Expression::intern(Node const& node, InternTable& table) -> uint32_t
+{
+    size_t const hash{hashNode(node)};
+
+    auto const [first, last] = table.equal_range(hash);
+    for (auto const& [key, index] : std::ranges::subrange(first, last))
+    {
+        if (!sameNode(m_nodes[index], node))
+        {
+            continue;
+        }
+
+        m_operands.resize(m_operands.size() - node.count);
+        if (node.kind == NodeKind::Literal)
+        {
+            m_literals.pop_back();
+        }
+        if (node.folded != NOT_FOLDED)
+        {
+            m_literals.pop_back();
+        }
+        if (node.partial != NOT_FOLDED)
+        {
+            m_literals.pop_back();
+        }
+        return index;
+    }
+
+    auto const index{static_cast<uint32_t>(m_nodes.size())};
+    m_nodes.push_back(node);
+    table.emplace(hash, index);
+    return index;
+}
+
+auto Expression::internLiteral(Scalar value, InternTable& table) -> uint32_t
+{
+    auto const literal{static_cast<uint32_t>(m_literals.size())};
+    m_literals.push_back(std::move(value));
+    return intern({.kind = NodeKind::Literal, .begin = literal}, table);
+}
+
+auto Expression::sameNode(Node const& lhs, Node const& rhs) const -> bool
+{
+    if (lhs.kind != rhs.kind || lhs.negate != rhs.negate
+        || lhs.function != rhs.function || lhs.count != rhs.count
+        || (lhs.folded == NOT_FOLDED) != (rhs.folded == NOT_FOLDED)
+        || (lhs.partial == NOT_FOLDED) != (rhs.partial == NOT_FOLDED))
+    {
+        return false;
+    }
+
+    // Literals index m_literals rather than m_operands.
+    if (lhs.kind == NodeKind::Literal)
+    {
+        return sameLiteral(m_literals[lhs.begin], m_literals[rhs.begin]);
+    }
+    if (lhs.folded != NOT_FOLDED
+        && !sameLiteral(m_literals[lhs.folded], m_literals[rhs.folded]))
+    {
+        return false;
+    }
+    if (lhs.partial != NOT_FOLDED
+        && !sameLiteral(m_literals[lhs.partial], m_literals[rhs.partial]))
+    {
+        return false;
+    }
+
+    return std::ranges::equal(operands(lhs), operands(rhs));
+}
+
+auto Expression::hashNode(Node const& node) const -> size_t
+{
+    size_t hash{static_cast<size_t>(node.kind)};
+    hash = combineHash(hash, node.negate);
+    hash = combineHash(hash, node.function);
+
+    if (node.kind == NodeKind::Literal)
+    {
+        return combineHash(hash, hashLiteral(m_literals[node.begin]));
+    }
+    if (node.folded != NOT_FOLDED)
+    {
+        hash = combineHash(hash, hashLiteral(m_literals[node.folded]));
+    }
+    if (node.partial != NOT_FOLDED)
+    {
+        hash = combineHash(hash, hashLiteral(m_literals[node.partial]));
+    }
+
+    for (auto const& operand : operands(node))
+    {
+        hash = combineHash(hash, operand.node);
+        hash = combineHash(hash, operand.invert);
+    }
+    return hash;
+}
+
+void Expression::markShared()
+{
+    m_shared = false;
+    if (empty())
+    {
+        return;
+    }
+
+    /*
+     * Counts how often each node would be evaluated, walking back from the
+     * root. A shared node is evaluated once, and so are its operands, but a
+     * product is expanded into every sum that holds it.
+     */
+    std::vector<uint32_t> uses(m_nodes.size(), 0);
+    uses[root()] = 1;
+    for (size_t index = m_nodes.size(); index-- > 0;)
+    {
+        Node& node{m_nodes[index]};
+        if (node.kind == NodeKind::Literal || node.kind == NodeKind::Variable)
+        {
+            continue;
+        }
+
+        node.shared = node.kind != NodeKind::Product && uses[index] > 1;
+        m_shared = m_shared || node.shared;
+
+        uint32_t const evaluations{
+            node.kind == NodeKind::Product ? uses[index]
+                                           : std::min(uses[index], 1U)
+        };
+        for (auto const& operand : operands(node))
+        {
+            uses[operand.node] += evaluations;
+        }
+    }
+}
+
+auto Expression::foldedScalar(Node const& node) const -> Scalar const*
+{
+    if (node.folded == NOT_FOLDED || m_foldContext != MathContext::current())
+    {
+        return nullptr;
+    }
+    return &m_literals[node.folded];
+}
+
+auto Expression::foldedDouble(Node const& node) const -> std::optional<double>
+{
+    if (node.folded == NOT_FOLDED || !m_foldContext.has_value()
+        || m_foldContext->precision < std::numeric_limits<double>::digits)
+    {
+        return std::nullopt;
+    }
+    return m_literals[node.folded].toDouble();
+}
+
+auto Expression::partialScalar(Node const& node) const -> Scalar const*
+{
+    if (node.partial == NOT_FOLDED || m_foldContext != MathContext::current())
+    {
+        return nullptr;
+    }
+    return &m_literals[node.partial];
+}
+
+auto Expression::partialDouble(Node const& node) const
+    -> std::optional<double>
+{
+    if (node.partial == NOT_FOLDED || !m_foldContext.has_value()
+        || m_foldContext->precision < std::numeric_limits<double>::digits)
+    {
+        return std::nullopt;
+    }
+    return m_literals[node.partial].toDouble();
+}
+
+auto Expression::stringNode(uint32_t const index) const -> std::string
+{
+    Node const& node{m_nodes[index]};
+
+    // Groups are parenthesized wherever they are a factor.
+    auto const stringFactor = [&](uint32_t const factor)
+    {
+        if (m_nodes[factor].kind == NodeKind::Sum)
+        {
+            return "(" + stringNode(factor) + ")";
+        }
+        return stringNode(factor);
+    };
+
+    switch (node.kind)
+    {
+    case NodeKind::Literal:
+        return m_literals[node.begin].toString();
+    case NodeKind::Variable:
+        return InputVariable::RESERVED_NAME;
+    case NodeKind::Square:
+    {
+        std::string const operand{stringFactor(operands(node).front().node)};
+        return operand + ",*," + operand;
+    }
+    case NodeKind::Call:
+    {
+        // Arguments are separated like operators, by a comma token.
+        std::string output{naryFunction(node.function).name};
+        output += '(';
+        auto const arguments{operands(node)};
+        for (size_t position = 0; position < arguments.size(); position++)
+        {
+            if (position > 0)
+            {
+                output += ",,,";
+            }
+            output += stringNode(arguments[position].node);
+        }
+        return output + ")";
+    }
+    case NodeKind::Sum:
+    case NodeKind::Product:
+        break;
+    }
+
+    assert(node.kind == NodeKind::Sum);
+
+    std::string output{};
+
+    auto const summands{operands(node)};
+    for (size_t summand = 0; summand < summands.size(); summand++)
+    {
+        if (summand > 0)
+        {
+            output += ',';
+            output += mathOperatorToString(
+                summands[summand].invert ? BinaryOp::Minus : BinaryOp::Plus
+            );
+            output += ',';
+        }
+
+        auto const terms{factors(summands[summand])};
+        for (size_t factor = 0; factor < terms.size(); factor++)
+        {
+            if (factor > 0)
+            {
+                output += ',';
+                output += mathOperatorToString(
+                    terms[factor].invert ? BinaryOp::Divide
+                                         : BinaryOp::Multiply
+                );
+                output += ',';
+            }
+
+            output += stringFactor(terms[factor].node);
+        }
+    }
+
+    if (node.function != NO_FUNCTION)
+    {
+        return std::string{unaryFunction(node.function).name} + "(" + output
+             + ")";
+    }
+
+    return output;
+}
+
+auto Expression::evaluateNode(
+    uint32_t const index, Scalar const& variable, Memo<Scalar>& memo
+) const -> std::optional<Scalar>
+{
+    return memoized(
+        m_nodes[index].shared,
+        index,
+        memo,
+        [&]() { return computeNode(index, variable, memo); }
+    );
+}
+
+auto Expression::computeNode(
+    uint32_t const index, Scalar const& variable, Memo<Scalar>& memo
+) const -> std::optional<Scalar>
+{
+    Node const& node{m_nodes[index]};
+
+    switch (node.kind)
+    {
+    case NodeKind::Literal:
+        return Scalar{m_literals[node.begin], MathContext::current().precision};
+    case NodeKind::Variable:
+        return variable;
+    case NodeKind::Square:
+    {
+        auto const value{
+            evaluateNode(operands(node).front().node, variable, memo)
+        };
+        if (!value.has_value())
+        {
+            return std::nullopt;
+        }
+        return Functions::sqr(value.value());
+    }
+    case NodeKind::Sum:
+    case NodeKind::Product:
+    case NodeKind::Call:
+        break;
+    }
+
+    assert(node.kind == NodeKind::Sum || node.kind == NodeKind::Call);
+
+    if (Scalar const* const value{foldedScalar(node)}; value != nullptr)
+    {
+        return *value;
+    }
+
+    if (node.kind == NodeKind::Call)
+    {
+        // A prepared first argument stands in for it, see folded.
+        Scalar const* const prepared{partialScalar(node)};
+        CallArguments<Scalar> arguments{};
+        for (size_t position = 0; auto const& operand : operands(node))
+        {
+            arguments[position] =
+                position == 0 && prepared != nullptr
+                    ? std::optional{*prepared}
+                    : evaluateNode(operand.node, variable, memo);
+            if (!arguments[position].has_value())
+            {
+                return std::nullopt;
+            }
+            position++;
+        }
+
+        // In place over the first argument, which the function may alias.
+        auto const& function{naryFunction(node.function)};
+        auto const scalarFunction{
+            prepared != nullptr ? function.partial.function : function.function
+        };
+        Scalar& result{arguments.front().value()};
+        scalarFunction(
+            result,
+            argument(arguments, 0),
+            argument(arguments, 1),
+            argument(arguments, 2),
+            MathContext::current()
+        );
+        if (node.negate)
+        {
+            Functions::negate(result, result);
+        }
+        return std::move(result);
+    }
+
+    /*
+     * Summands are folded left to right into a running sum, each product folded
+     * first. A product whose last step is a multiplication keeps its final
+     * factor aside, so that the addition consuming it can be fused into a
+     * single rounding. The very first product has no sum to fuse into yet, so
+     * it waits for the next one.
+     */
+    std::optional<Scalar> sum{};
+    std::optional<std::pair<Scalar, Scalar>> pendingProduct{};
+
+    auto const summands{operands(node)};
+    for (size_t position = 0; position < summands.size(); position++)
+    {
+        bool const subtract{summands[position].invert};
+        bool const last{position + 1 == summands.size()};
+        auto const terms{factors(summands[position])};
+        auto const square{squareOperand(summands[position])};
+
+        auto product{
+            evaluateNode(square.value_or(terms.front().node), variable, memo)
+        };
+        if (!product.has_value())
+        {
+            return std::nullopt;
+        }
+
+        std::optional<Scalar> factor{};
+        if (square.has_value())
+        {
+            factor = product;
+        }
+        for (auto const& next : terms | std::views::drop(1))
+        {
+            auto term{evaluateNode(next.node, variable, memo)};
+            if (!term.has_value())
+            {
+                return std::nullopt;
+            }
+
+            if (factor.has_value())
+            {
+                product.value() *= factor.value();
+                factor.reset();
+            }
+
+            if (!next.invert)
+            {
+                factor = std::move(term);
+            }
+            else
+            {
+                product.value() /= term.value();
+            }
+        }
+
+        if (!sum.has_value() && !pendingProduct.has_value()
+            && factor.has_value() && !last)
+        {
+            pendingProduct.emplace(
+                std::move(product).value(), std::move(factor).value()
+            );
+            continue;
+        }
+
+        if (!sum.has_value() && !pendingProduct.has_value())
+        {
+            if (factor.has_value())
+            {
+                product.value() *= factor.value();
+            }
+            sum = std::move(product);
+            continue;
+        }
+
+        if (pendingProduct.has_value())
+        {
+            // This product becomes the addend of the pending one
+            if (factor.has_value())
+            {
+                product.value() *= factor.value();
+            }
+            if (subtract)
+            {
+                product = -product.value();
+            }
+
+            auto const& [lhs, rhs] = pendingProduct.value();
+            Functions::fma(product.value(), lhs, rhs, product.value());
+            sum = std::move(product);
+            pendingProduct.reset();
+        }
+        else if (factor.has_value())
+        {
+            // Negating first, instead of the fused result, keeps directed
+            // rounding modes correct.
+            if (subtract)
+            {
+                product = -product.value();
+            }
+            Functions::fma(
+                sum.value(), product.value(), factor.value(), sum.value()
+            );
+        }
+        else if (subtract)
+        {
+            sum.value() -= product.value();
+        }
+        else
+        {
+            sum.value() += product.value();
+        }
+    }
+
+    assert(sum.has_value());
+    Scalar result = std::move(sum).value();
+
+    // Both in place, so the sum's storage becomes the result's.
+    if (node.function != NO_FUNCTION)
+    {
+        auto const& function{unaryFunction(node.function)};
+        assert(function.function != nullptr);
+
+        function.function(result, result, MathContext::current());
+    }
+
+    if (node.negate)
+    {
+        Functions::negate(result, result);
+    }
+
+    return result;
+}
+
+template <typename T>
+auto Expression::evaluateGeneric(
+    uint32_t const index, T const& variable, Memo<T>& memo
+) const -> std::optional<T>
+{
+    return memoized(
+        m_nodes[index].shared,
+        index,
+        memo,
+        [&]() { return computeGeneric(index, variable, memo); }
+    );
+}
+
+template <typename T>
+auto Expression::computeGeneric(
+    uint32_t const index, T const& variable, Memo<T>& memo
+) const -> std::optional<T>
+{
+    Node const& node{m_nodes[index]};
+
+    switch (node.kind)
+    {
+    case NodeKind::Literal:
+        if constexpr (std::is_same_v<T, double>)
+        {
+            return m_literals[node.begin].toDouble();
+        }
+        else if constexpr (std::is_same_v<T, Jet>)
+        {
+            return Jet{Scalar{
+                m_literals[node.begin], MathContext::current().precision
+            }};
+        }
+        else
+        {
+            return T{m_literals[node.begin]};
+        }
+    case NodeKind::Variable:
+        return variable;
+    case NodeKind::Square:
+    {
+        auto const value{
+            evaluateGeneric(operands(node).front().node, variable, memo)
+        };
+        if (!value.has_value())
+        {
+            return std::nullopt;
+        }
+        return value.value() * value.value();
+    }
+    case NodeKind::Sum:
+    case NodeKind::Product:
+    case NodeKind::Call:
+        break;
+    }
+
+    assert(node.kind == NodeKind::Sum || node.kind == NodeKind::Call);
+
+    if constexpr (std::is_same_v<T, double>)
+    {
+        if (auto const value{foldedDouble(node)}; value.has_value())
+        {
+            return value;
+        }
+    }
+    else if constexpr (std::is_same_v<T, Jet>)
+    {
+        if (Scalar const* const value{foldedScalar(node)}; value != nullptr)
+        {
+            return Jet{*value};
+        }
+    }
+
+    if (node.kind == NodeKind::Call)
+    {
+        // A prepared first argument stands in for it, see folded.
+        std::optional<T> prepared{};
+        if constexpr (std::is_same_v<T, double>)
+        {
+            prepared = partialDouble(node);
+        }
+
+        CallArguments<T> arguments{};
+        for (size_t position = 0; auto const& operand : operands(node))
+        {
+            arguments[position] =
+                position == 0 && prepared.has_value()
+                    ? prepared
+                    : evaluateGeneric(operand.node, variable, memo);
+            if (!arguments[position].has_value())
+            {
+                return std::nullopt;
+            }
+            position++;
+        }
+
+        auto const& function{naryFunction(node.function)};
+        T result{[&]
+        {
+            if constexpr (std::is_same_v<T, double>)
+            {
+                if (prepared.has_value())
+                {
+                    return applyGeneric(function.partial, arguments);
+                }
+            }
+            return applyGeneric(function, arguments);
+        }()};
+        if (node.negate)
+        {
+            result = -result;
+        }
+        return result;
+    }
 
-    for (auto const& term : other.m_terms)
+    // Same order as above, but without fusing since fma is not guaranteed to
+    // be a single instruction on the target.
+    std::optional<T> sum{};
+
+    for (auto const& summand : operands(node))
     {
-        m_terms.push_back(std::make_unique<Term>(*term));
+        auto const terms{factors(summand)};
+
+        auto product{evaluateGeneric(terms.front().node, variable, memo)};
+        if (!product.has_value())
+        {
+            return std::nullopt;
+        }
+
+        for (auto const& factor : terms | std::views::drop(1))
+        {
+            auto const term{evaluateGeneric(factor.node, variable, memo)};
+            if (!term.has_value())
+            {
+                return std::nullopt;
+            }
+
+            if (!factor.invert)
+            {
+                product.value() *= term.value();
+            }
+            else
+            {
+                product.value() /= term.value();
+            }
+        }
+
+        if (!sum.has_value())
+        {
+            sum = product;
+        }
+        else if (summand.invert)
+        {
+            sum.value() -= product.value();
+        }
+        else
+        {
+            sum.value() += product.value();
+        }
     }
-    m_operators = other.m_operators;
-    m_function = other.m_function;
-    m_hasVariableCached = other.m_hasVariableCached;
 
-    return *this;
-}
+    assert(sum.has_value());
+    T result = sum.value();
 
-Expression::Expression(Expression const& other) { *this = other; }
+    if (node.function != NO_FUNCTION)
+    {
+        result = applyGeneric(unaryFunction(node.function), result);
+    }
 
-auto Expression::operator=(Expression&& other) noexcept -> Expression&
-{
-    m_terms = std::move(other).m_terms;
-    m_operators = std::move(other).m_operators;
-    m_function = std::move(other).m_function;
-    m_hasVariableCached = other.m_hasVariableCached;
+    if (node.negate)
+    {
+        result = -result;
+    }
 
-    return *this;
+    return result;
 }
 
-Expression::Expression(Expression&& other) noexcept { *this = std::move(other); }
+auto Expression::evaluateBlock(
+    uint32_t const index,
+    ScalarVector const& variables,
+    Memo<ScalarVector>& memo
+) const -> std::optional<ScalarVector>
+{
+    return memoized(
+        m_nodes[index].shared,
+        index,
+        memo,
+        [&]() { return computeBlock(index, variables, memo); }
+    );
+}
 
-auto Expression::operator==(Expression const& rhs) const -> bool
+auto Expression::computeBlock(
+    uint32_t const index,
+    ScalarVector const& variables,
+    Memo<ScalarVector>& memo
+) const -> std::optional<ScalarVector>
 {
-    if (termCount() != rhs.termCount())
+    Node const& node{m_nodes[index]};
+
+    switch (node.kind)
     {
-        return false;
+    case NodeKind::Literal:
+    {
+        // Rounded to the context's precision first, as in evaluateNode.
+        ScalarVector literal{
+            variables.size(), MathContext::current().precision
+        };
+        literal.fill(m_literals[node.begin]);
+        return literal;
+    }
+    case NodeKind::Variable:
+        return variables;
+    case NodeKind::Square:
+    {
+        auto value{
+            evaluateBlock(operands(node).front().node, variables, memo)
+        };
+        if (value.has_value())
+        {
+            Functions::multiply(value.value(), value.value(), value.value());
+        }
+        return value;
+    }
+    case NodeKind::Sum:
+    case NodeKind::Product:
+    case NodeKind::Call:
+        break;
     }
 
-    if (m_operators != rhs.m_operators)
+    assert(node.kind == NodeKind::Sum || node.kind == NodeKind::Call);
+
+    if (Scalar const* const value{foldedScalar(node)}; value != nullptr)
     {
-        return false;
+        ScalarVector block{variables.size(), value->precision()};
+        block.fill(*value);
+        return block;
     }
 
-    for (size_t index = 0; index < termCount(); index++)
+    if (node.kind == NodeKind::Call)
     {
-        auto const& lhsTerm{m_terms[index]};
-        auto const& rhsTerm{rhs.m_terms[index]};
-        if (lhsTerm == nullptr && rhsTerm == nullptr)
+        // A prepared first argument stands in for it, see folded.
+        Scalar const* const prepared{partialScalar(node)};
+        CallArguments<ScalarVector> arguments{};
+        for (size_t position = 0; auto const& operand : operands(node))
         {
-            continue;
+            if (position == 0 && prepared != nullptr)
+            {
+                arguments[position].emplace(
+                    variables.size(), prepared->precision()
+                );
+                arguments[position]->fill(*prepared);
+            }
+            else
+            {
+                arguments[position] =
+                    evaluateBlock(operand.node, variables, memo);
+            }
+            if (!arguments[position].has_value())
+            {
+                return std::nullopt;
+            }
+            position++;
         }
-        if (lhsTerm == nullptr || rhsTerm == nullptr)
+
+        // Element by element through the Scalar variant, at the largest
+        // precision among the arguments and the context. That is usually the
+        // first argument's block, written once its element is read.
+        auto const& function{naryFunction(node.function)};
+        auto const& context{MathContext::current()};
+        size_t precision{context.precision};
+        for (auto const& block : arguments)
         {
-            return false;
+            if (block.has_value())
+            {
+                precision = std::max(precision, block->precision());
+            }
         }
 
-        if (*lhsTerm != *rhsTerm)
+        std::optional<ScalarVector> wider{};
+        if (arguments.front()->precision() != precision)
         {
-            return false;
+            wider.emplace(variables.size(), precision);
+        }
+        ScalarVector& result{
+            wider.has_value() ? wider.value() : arguments.front().value()
+        };
+        auto const scalarFunction{
+            prepared != nullptr ? function.partial.function : function.function
+        };
+        Scalar element{0.0, precision};
+        for (size_t index = 0; index < result.size(); index++)
+        {
+            scalarFunction(
+                element,
+                argument(arguments, 0).get(index),
+                argument(arguments, 1).get(index),
+                argument(arguments, 2).get(index),
+                context
+            );
+            if (node.negate)
+            {
+                Functions::negate(element, element);
+            }
+            result.set(index, element);
         }
+        return std::move(result);
     }
 
-    return m_function == rhs.m_function;
-}
+    // Elementwise, the same order and fusing as evaluateNode.
+    std::optional<ScalarVector> sum{};
+    std::optional<std::pair<ScalarVector, ScalarVector>> pendingProduct{};
 
-namespace
-{
-auto mathOperatorToString(BinaryOp const binaryOp) -> char const*
-{
-    switch (binaryOp)
+    auto const summands{operands(node)};
+    for (size_t position = 0; position < summands.size(); position++)
     {
-    case BinaryOp::Plus:
-        return "+";
-    case BinaryOp::Minus:
-        return "-";
-    case BinaryOp::Multiply:
-        return "*";
-    case BinaryOp::Divide:
-        return "/";
-    }
+        bool const subtract{summands[position].invert};
+        bool const last{position + 1 == summands.size()};
+        auto const terms{factors(summands[position])};
+        auto const square{squareOperand(summands[position])};
+
+        auto product{
+            evaluateBlock(
+                square.value_or(terms.front().node), variables, memo
+            )
+        };
+        if (!product.has_value())
+        {
+            return std::nullopt;
+        }
 
-    return "?";
-}
-} // namespace
+        std::optional<ScalarVector> factor{};
+        if (square.has_value())
+        {
+            factor.emplace(product.value());
+        }
+        for (auto const& next : terms | std::views::drop(1))
+        {
+            auto term{evaluateBlock(next.node, variables, memo)};
+            if (!term.has_value())
+            {
+                return std::nullopt;
+            }
+
+            if (factor.has_value())
+            {
+                Functions::multiply(
+                    product.value(), product.value(), factor.value()
+                );
+                factor.reset();
+            }
+
+            if (!next.invert)
+            {
+                factor.emplace(std::move(term).value());
+            }
+            else
+            {
+                Functions::divide(
+                    product.value(), product.value(), term.value()
+                );
+            }
+        }
 
-auto Expression::string() const -> std::string
-{
-    if (!valid())
-    {
-        return "Invalid";
-    }
+        if (!sum.has_value() && !pendingProduct.has_value()
+            && factor.has_value() && !last)
+        {
+            pendingProduct.emplace(
+                std::move(product).value(), std::move(factor).value()
+            );
+            continue;
+        }
 
-    if (empty())
-    {
-        return "Empty";
+        if (!sum.has_value() && !pendingProduct.has_value())
+        {
+            if (factor.has_value())
+            {
+                Functions::multiply(
+                    product.value(), product.value(), factor.value()
+                );
+            }
+            sum = std::move(product);
+            continue;
+        }
+
+        if (pendingProduct.has_value())
+        {
+            if (factor.has_value())
+            {
+                Functions::multiply(
+                    product.value(), product.value(), factor.value()
+                );
+            }
+            if (subtract)
+            {
+                Functions::negate(product.value(), product.value());
+            }
+
+            auto const& [lhs, rhs] = pendingProduct.value();
+            Functions::fma(product.value(), lhs, rhs, product.value());
+            sum = std::move(product);
+            pendingProduct.reset();
+        }
+        else if (factor.has_value())
+        {
+            if (subtract)
+            {
+                Functions::negate(product.value(), product.value());
+            }
+            Functions::fma(
+                sum.value(), product.value(), factor.value(), sum.value()
+            );
+        }
+        else if (subtract)
+        {
+            Functions::subtract(sum.value(), sum.value(), product.value());
+        }
+        else
+        {
+            Functions::add(sum.value(), sum.value(), product.value());
+        }
     }
 
-    std::string output{};
+    assert(sum.has_value());
 
-    output += stringTerm(0);
-    for (size_t i = 0; i < m_operators.size(); i++)
+    if (node.function != NO_FUNCTION)
     {
-        output += ',';
-        output += mathOperatorToString(m_operators[i]);
-        output += ',';
-        output += stringTerm(i + 1);
+        auto const& function{unaryFunction(node.function)};
+        assert(function.vectorFunction != nullptr);
+
+        function.vectorFunction(sum.value(), sum.value());
     }
 
-    if (m_function != nullptr)
+    if (node.negate)
     {
-        assert(m_function->function != nullptr);
-
-        return m_function->name + "(" + output + ")";
+        Functions::negate(sum.value(), sum.value());
     }
 
-    return output;
+    return sum;
 }
 
-auto Expression::evaluate(Scalar const& variable) const -> std::optional<Scalar>
+auto Expression::evaluateBlock(
+    uint32_t const index,
+    std::span<double const> const variables,
+    Memo<std::vector<double>>& memo
+) const -> std::optional<std::vector<double>>
 {
-    if (!valid())
+    return memoized(
+        m_nodes[index].shared,
+        index,
+        memo,
+        [&]() { return computeBlock(index, variables, memo); }
+    );
+}
+
+auto Expression::computeBlock(
+    uint32_t const index,
+    std::span<double const> const variables,
+    Memo<std::vector<double>>& memo
+) const -> std::optional<std::vector<double>>
+{
+    Node const& node{m_nodes[index]};
+
+    switch (node.kind)
     {
-        return std::nullopt;
+    case NodeKind::Literal:
+        return std::vector<double>(
+            variables.size(), m_literals[node.begin].toDouble()
+        );
+    case NodeKind::Variable:
+        return std::vector<double>(variables.begin(), variables.end());
+    case NodeKind::Square:
+    {
+        auto value{
+            evaluateBlock(operands(node).front().node, variables, memo)
+        };
+        if (value.has_value())
+        {
+            std::ranges::transform(
+                value.value(),
+                value->begin(),
+                [](double const operand) { return operand * operand; }
+            );
+        }
+        return value;
+    }
+    case NodeKind::Sum:
+    case NodeKind::Product:
+    case NodeKind::Call:
+        break;
     }
 
-    if (empty())
+    assert(node.kind == NodeKind::Sum || node.kind == NodeKind::Call);
+
+    if (auto const value{foldedDouble(node)}; value.has_value())
     {
-        return Scalar{"0.0"};
+        return std::vector<double>(variables.size(), value.value());
     }
 
-    std::deque<Scalar> terms{};
-    for (size_t termIndex = 0; termIndex < m_terms.size(); termIndex++)
+    if (node.kind == NodeKind::Call)
     {
-        auto const evaluateResult = evaluateTerm(termIndex, variable);
-        if (!evaluateResult.has_value())
+        // A prepared first argument stands in for it, see folded.
+        auto const prepared{partialDouble(node)};
+        CallArguments<std::vector<double>> arguments{};
+        for (size_t position = 0; auto const& operand : operands(node))
         {
-            return std::nullopt;
+            arguments[position] =
+                position == 0 && prepared.has_value()
+                    ? std::vector<double>(variables.size(), prepared.value())
+                    : evaluateBlock(operand.node, variables, memo);
+            if (!arguments[position].has_value())
+            {
+                return std::nullopt;
+            }
+            position++;
+        }
+
+        // There are no batched kernels for these, so each element is a call.
+        auto const& function{naryFunction(node.function)};
+        auto const doubleFunction{
+            prepared.has_value() ? function.partial.doubleFunction
+                                 : function.doubleFunction
+        };
+        std::vector<double>& result{arguments.front().value()};
+        for (size_t index = 0; index < result.size(); index++)
+        {
+            result[index] = doubleFunction(
+                argument(arguments, 0)[index],
+                argument(arguments, 1)[index],
+                argument(arguments, 2)[index]
+            );
+            if (node.negate)
+            {
+                result[index] = -result[index];
+            }
         }
-        terms.push_back(evaluateResult.value());
+        return std::move(result);
     }
 
-    std::deque<BinaryOp> operators{m_operators.begin(), m_operators.end()};
+    // The same order as evaluateGeneric, one operation at a time over the
+    // whole block so that the loops vectorize.
+    std::optional<std::vector<double>> sum{};
 
-    // Reduce while evaluating operators for adjacent terms.
-    // Multiplication and division first
-    size_t index = 0;
-    while (index < operators.size())
+    for (auto const& summand : operands(node))
     {
-        BinaryOp const mathOperator = operators[index];
-        if (mathOperator == BinaryOp::Plus || mathOperator == BinaryOp::Minus)
+        auto const terms{factors(summand)};
+
+        auto product{evaluateBlock(terms.front().node, variables, memo)};
+        if (!product.has_value())
         {
-            index++;
-            continue;
+            return std::nullopt;
         }
-        assert(
-            mathOperator == BinaryOp::Multiply
-            || mathOperator == BinaryOp::Divide
-        );
 
-        Scalar const firstTerm = terms[index];
-        Scalar const secondTerm = terms[index + 1];
-
-        terms.erase(terms.begin() + index);
-        operators.erase(operators.begin() + index);
+        for (auto const& factor : terms | std::views::drop(1))
+        {
+            auto const term{evaluateBlock(factor.node, variables, memo)};
+            if (!term.has_value())
+            {
+                return std::nullopt;
+            }
+
+            if (!factor.invert)
+            {
+                std::ranges::transform(
+                    product.value(),
+                    term.value(),
+                    product->begin(),
+                    std::multiplies{}
+                );
+            }
+            else
+            {
+                std::ranges::transform(
+                    product.value(),
+                    term.value(),
+                    product->begin(),
+                    std::divides{}
+                );
+            }
+        }
 
-        if (mathOperator == BinaryOp::Multiply)
+        if (!sum.has_value())
+        {
+            sum = std::move(product);
+        }
+        else if (summand.invert)
         {
-            terms.at(index) = firstTerm * secondTerm;
+            std::ranges::transform(
+                sum.value(), product.value(), sum->begin(), std::minus{}
+            );
         }
         else
         {
-            terms.at(index) = firstTerm / secondTerm;
+            std::ranges::transform(
+                sum.value(), product.value(), sum->begin(), std::plus{}
+            );
         }
     }
 
-    // Addition and subtraction next
-    while (!operators.empty())
-    {
-        BinaryOp const mathOperator = operators[0];
-        assert(
-            mathOperator == BinaryOp::Plus || mathOperator == BinaryOp::Minus
-        );
+    assert(sum.has_value());
 
-        Scalar const firstTerm = terms[0];
-        Scalar const secondTerm = terms[1];
+    if (node.function != NO_FUNCTION)
+    {
+        auto const& function{unaryFunction(node.function)};
+        assert(function.batchFunction != nullptr);
 
-        terms.pop_front();
-        operators.pop_front();
+        function.batchFunction(sum.value(), sum.value());
+    }
 
-        if (mathOperator == BinaryOp::Plus)
-        {
-            terms[0] = firstTerm + secondTerm;
-        }
-        else
-        {
-            terms[0] = firstTerm - secondTerm;
-        }
+    if (node.negate)
+    {
+        std::ranges::transform(sum.value(), sum->begin(), std::negate{});
     }
 
-    assert(terms.size() == 1);
-    Scalar result = std::move(terms)[0];
+    return sum;
+}
 
-    // Potentially lots of function overhead here
-    if (m_function != nullptr)
+auto Expression::valid() const -> bool
+{
+    if (empty())
     {
-        assert(m_function->function != nullptr);
+        return true;
+    }
 
-        result = m_function->function(result);
+    if (m_nodes.back().kind != NodeKind::Sum)
+    {
+        return false;
     }
 
-    if (m_negate)
+    for (size_t index = 0; index < m_nodes.size(); index++)
     {
-        result = -result;
+        Node const& node{m_nodes[index]};
+
+        if (node.kind == NodeKind::Literal && node.begin >= m_literals.size())
+        {
+            return false;
+        }
+        if (node.kind == NodeKind::Literal || node.kind == NodeKind::Variable)
+        {
+            continue;
+        }
+
+        // Squares have one operand, and products more than one.
+        if ((node.kind == NodeKind::Square && node.count != 1)
+            || (node.kind == NodeKind::Product && node.count < 2))
+        {
+            return false;
+        }
+        if (node.count == 0
+            || size_t{node.begin} + node.count > m_operands.size())
+        {
+            return false;
+        }
+        if (node.kind == NodeKind::Call)
+        {
+            // Calls take exactly their arity in arguments.
+            if (!isNaryFunction(node.function)
+                || size_t{node.function} - FIRST_NARY_FUNCTION
+                       >= naryFunctions().size()
+                || node.count != naryFunction(node.function).arity
+                || std::ranges::any_of(operands(node), &Operand::invert))
+            {
+                return false;
+            }
+        }
+        else if (node.function != NO_FUNCTION
+                 && (node.kind != NodeKind::Sum
+                     || node.function >= unaryFunctions().size()))
+        {
+            return false;
+        }
+        if (node.folded != NOT_FOLDED
+            && ((node.kind != NodeKind::Sum && node.kind != NodeKind::Call)
+                || node.folded >= m_literals.size()))
+        {
+            return false;
+        }
+        if (node.partial != NOT_FOLDED
+            && (node.kind != NodeKind::Call
+                || naryFunction(node.function).partial.prepare == nullptr
+                || node.partial >= m_literals.size()))
+        {
+            return false;
+        }
+
+        if (operands(node).front().invert)
+        {
+            return false;
+        }
+
+        // Operands come earlier in the pool, and only sums hold products.
+        for (auto const& operand : operands(node))
+        {
+            if (operand.node >= index)
+            {
+                return false;
+            }
+            if (node.kind != NodeKind::Sum
+                && m_nodes[operand.node].kind == NodeKind::Product)
+            {
+                return false;
+            }
+        }
     }
 
-    return result;
+    return true;
 }
 
-auto Expression::termCount() const -> size_t { return m_terms.size(); }
+auto Expression::empty() const -> bool { return m_nodes.empty(); }
 
-auto Expression::hasVariable() const -> bool { return m_hasVariableCached; }
-
-void Expression::reset(Term&& initial)
+ExpressionBuilder::ExpressionBuilder()
+    : m_groups{OpenGroup{
+          .begin = 0,
+          .arguments = 0,
+          .mathOp = BinaryOp::Plus,
+          .negate = false,
+          .function = NO_FUNCTION,
+      }}
 {
-    m_terms.clear();
-    m_operators.clear();
+}
 
-    m_terms.push_back(std::make_unique<Term>(std::move(initial)));
+void ExpressionBuilder::literal(Scalar value)
+{
+    term(m_expression.internLiteral(std::move(value), m_interned));
 }
 
-auto Expression::reset(Expression&& initial) -> Expression&
+void ExpressionBuilder::variable()
 {
-    m_terms.clear();
-    m_operators.clear();
+    m_expression.m_hasVariable = true;
+    term(m_expression.intern(
+        {.kind = Expression::NodeKind::Variable}, m_interned
+    ));
+}
 
-    m_terms.push_back(std::make_unique<Term>(std::move(initial)));
+void ExpressionBuilder::binaryOperator(BinaryOp const mathOp)
+{
+    if (m_expectTerm)
+    {
+        m_malformed = true;
+        return;
+    }
 
-    return std::get<Expression>(*m_terms.back());
+    m_nextOperator = mathOp;
+    m_expectTerm = true;
 }
 
-void Expression::setNegate(bool negate) { m_negate = negate; }
+void ExpressionBuilder::openGroup(bool const negate, FunctionId const function)
+{
+    if (!m_expectTerm)
+    {
+        m_malformed = true;
+        return;
+    }
+
+    m_groups.push_back(OpenGroup{
+        .begin = m_pending.size(),
+        .arguments = m_arguments.size(),
+        .mathOp = m_nextOperator,
+        .negate = negate,
+        .function = function,
+    });
+}
 
-void Expression::setFunction(std::shared_ptr<UnaryFunction const> functionID)
+auto ExpressionBuilder::separator() -> bool
 {
-    m_function = std::move(functionID);
+    OpenGroup const& group{m_groups.back()};
+    if (m_expectTerm || !isNaryFunction(group.function)
+        || m_arguments.size() - group.arguments + 1
+               >= naryFunction(group.function).arity)
+    {
+        m_malformed = true;
+        return false;
+    }
+
+    closeArgument();
+    m_expectTerm = true;
+    return true;
 }
 
-auto Expression::backTerm() -> Term&
+auto ExpressionBuilder::closeGroup() -> bool
 {
-    if (empty())
+    if (m_groups.size() <= 1 || m_expectTerm)
+    {
+        m_malformed = true;
+        return false;
+    }
+
+    BinaryOp const mathOp{m_groups.back().mathOp};
+    auto const node{closeInnermost()};
+    if (!node.has_value())
     {
-        m_terms.push_back(std::make_unique<Term>());
+        m_malformed = true;
+        return false;
     }
 
-    assert(m_terms.size() == m_operators.size() + 1);
+    // The group is a term of its parent, joined by the operator before it.
+    m_nextOperator = mathOp;
+    m_expectTerm = true;
+    term(node.value());
 
-    return *m_terms.back();
+    return true;
 }
 
-auto Expression::append(BinaryOp mathOp) -> Term&
+auto ExpressionBuilder::finish() -> std::optional<Expression>
 {
-    m_terms.push_back(std::make_unique<Term>(Scalar{"0.0"}));
-    m_operators.push_back(mathOp);
+    if (m_malformed || m_groups.size() != 1 || m_expectTerm)
+    {
+        return std::nullopt;
+    }
+
+    closeInnermost();
+    m_groups.clear();
+    m_interned.clear();
 
-    return *m_terms.back();
+    m_expression.markShared();
+    return std::move(m_expression);
 }
 
-auto Expression::appendExpression(BinaryOp mathOp) -> Expression&
+void ExpressionBuilder::term(uint32_t const node)
 {
-    auto& term = append(mathOp);
-    term = Expression();
-    return std::get<Expression>(term);
+    if (!m_expectTerm)
+    {
+        m_malformed = true;
+        return;
+    }
+
+    bool const first{m_pending.size() == m_groups.back().begin};
+    m_pending.push_back(PendingTerm{
+        .node = node,
+        .mathOp = first ? BinaryOp::Plus : m_nextOperator,
+    });
+    m_expectTerm = false;
 }
 
-void Expression::cacheHasVariable()
+auto ExpressionBuilder::closeInnermost() -> std::optional<uint32_t>
 {
-    m_hasVariableCached = false;
-    for (auto& term : m_terms)
+    OpenGroup const group{m_groups.back()};
+    if (!isNaryFunction(group.function))
+    {
+        m_groups.pop_back();
+        return closeSum(group.begin, group.negate, group.function);
+    }
+
+    closeArgument();
+    m_groups.pop_back();
+
+    auto const arguments{std::span{m_arguments}.subspan(group.arguments)};
+    if (arguments.size() != naryFunction(group.function).arity)
+    {
+        m_arguments.resize(group.arguments);
+        return std::nullopt;
+    }
+
+    auto& operands{m_expression.m_operands};
+    auto const begin{static_cast<uint32_t>(operands.size())};
+
+    for (uint32_t const argument : arguments)
     {
-        std::visit(
-            overloads{
-                [](Scalar const&) {},
-                [&](Expression& expression)
+        operands.push_back({.node = argument});
+    }
+    uint32_t const node{m_expression.intern(
         {
-            expression.cacheHasVariable();
-            m_hasVariableCached |= expression.hasVariable();
+            .kind = Expression::NodeKind::Call,
+            .negate = group.negate,
+            .function = group.function,
+            .begin = begin,
+            .count = static_cast<uint32_t>(arguments.size()),
         },
-                [&](InputVariable const&) { m_hasVariableCached = true; }
-            },
-            *term
-        );
-    }
+        m_interned
+    )};
+
+    m_arguments.resize(group.arguments);
+    return node;
 }
 
-auto Expression::stringTerm(size_t index) const -> std::string
+void ExpressionBuilder::closeArgument()
 {
-    assert(index < m_terms.size() || m_terms[index] != nullptr);
+    OpenGroup const& group{m_groups.back()};
 
-    auto const visitor = overloads{
-        [](Scalar const& number) { return number.toString(); },
-        [&](Expression const& expression)
-    { return "(" + expression.string() + ")"; },
-        [](InputVariable const&)
-    { return std::string{InputVariable::RESERVED_NAME}; }
-    };
+    // A lone term needs no group of its own, unless it is a product.
+    if (m_pending.size() == group.begin + 1)
+    {
+        m_arguments.push_back(m_pending.back().node);
+        m_pending.pop_back();
+        return;
+    }
 
-    return std::visit(visitor, *m_terms[index]);
+    m_arguments.push_back(closeSum(group.begin, false, NO_FUNCTION));
 }
 
-auto Expression::evaluateTerm(size_t index, Scalar const& variable) const
-    -> std::optional<Scalar>
+auto ExpressionBuilder::closeSum(
+    size_t const groupBegin, bool const negate, FunctionId const function
+) -> uint32_t
 {
-    assert(index < m_terms.size() || m_terms[index] != nullptr);
+    auto& operands{m_expression.m_operands};
+
+    /*
+     * Runs of multiplication and division become products first, since the
+     * sum refers to them. Each summand is written back over the group's terms,
+     * which is safe since a summand never takes less than one term.
+     */
+    size_t summandEnd{groupBegin};
+    size_t start{groupBegin};
+    while (start < m_pending.size())
+    {
+        size_t end{start + 1};
+        while (end < m_pending.size()
+               && (m_pending[end].mathOp == BinaryOp::Multiply
+                   || m_pending[end].mathOp == BinaryOp::Divide))
+        {
+            end++;
+        }
 
-    auto const visitor = overloads{
-        [](Scalar const& number) { return std::optional{number}; },
-        [&](Expression const& expression)
-    { return expression.evaluate(variable); },
-        [&](InputVariable const&) { return std::optional{variable}; }
-    };
+        PendingTerm summand{m_pending[start]};
+        if (end - start > 1)
+        {
+            auto const begin{static_cast<uint32_t>(operands.size())};
+            for (size_t index = start; index < end; index++)
+            {
+                operands.push_back(Expression::Operand{
+                    .node = m_pending[index].node,
+                    .invert = index != start
+                           && m_pending[index].mathOp == BinaryOp::Divide,
+                });
+            }
+            summand.node = m_expression.intern(
+                {
+                    .kind = Expression::NodeKind::Product,
+                    .begin = begin,
+                    .count = static_cast<uint32_t>(end - start),
+                },
+                m_interned
+            );
+        }
 
-    return std::visit(visitor, *m_terms[index]);
-}
+        m_pending[summandEnd] = summand;
+        summandEnd++;
+        start = end;
+    }
 
-auto Expression::valid() const -> bool
-{
-    bool const completelyEmpty = m_terms.empty() && m_operators.empty();
-    bool const oneOpBetweenAllConsecutiveTerms =
-        m_operators.size() == m_terms.size() - 1;
-    bool const noNullChildren =
-        std::count(m_terms.begin(), m_terms.end(), nullptr) == 0;
+    auto const begin{static_cast<uint32_t>(operands.size())};
+    for (size_t index = groupBegin; index < summandEnd; index++)
+    {
+        operands.push_back(Expression::Operand{
+            .node = m_pending[index].node,
+            .invert = index != groupBegin
+                   && m_pending[index].mathOp == BinaryOp::Minus,
+        });
+    }
+    m_pending.resize(groupBegin);
 
-    return (
-        (completelyEmpty || oneOpBetweenAllConsecutiveTerms) && noNullChildren
+    return m_expression.intern(
+        {
+            .kind = Expression::NodeKind::Sum,
+            .negate = negate,
+            .function = function,
+            .begin = begin,
+            .count = static_cast<uint32_t>(summandEnd - groupBegin),
+        },
+        m_interned
     );
 }
-
-auto Expression::empty() const -> bool { return termCount() == 0; }
-
 } // namespace calqmath
@@ -5,9 +5,10 @@
 #include <cassert>
 #include <cstdint>
 #include <expected>
-#include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -28,14 +29,22 @@ struct InputVariable : std::monostate
     static constexpr char const* RESERVED_NAME = "x";
 };
 
-class Expression;
-using Term = std::variant<Expression, Scalar, InputVariable>;
+struct Simplification;
 
 /*
  * An AST of a mathematical expression, where the nodes are terms in
  * the mathematical sense.
  *
- * Can be written to, adding extra nodes/terms.
+ * Nodes live in one flat pool and refer to each other by 32-bit index, with
+ * literals in a side table, so a whole tree is a handful of allocations and
+ * copies are plain array copies. Children always come before their parents,
+ * and the root is the last node.
+ *
+ * Identical subtrees are stored once, so the tree is really a DAG. A subtree
+ * with several parents, such as sin(x) in sin(x) * sin(x) + cos(sin(x)), is
+ * evaluated once per evaluation and its value reused.
+ *
+ * Built by ExpressionBuilder.
  * Can be read from, evaluating the result of the calculation it represents.
  */
 class Expression
@@ -43,12 +52,6 @@ class Expression
 public:
     Expression() = default;
 
-    auto operator=(Expression const& other) -> Expression&;
-    Expression(Expression const& other);
-
-    auto operator=(Expression&& other) noexcept -> Expression&;
-    Expression(Expression&& other) noexcept;
-
     auto operator==(Expression const& rhs) const -> bool;
 
     /**
@@ -76,7 +79,8 @@ public:
      * @brief evaluate - Evaluates the result of the expression, combining all
      * terms.
      *
-     * No memoization, this calculation costs the same each time.
+     * Nothing is kept between calls, this calculation costs the same each
+     * time.
      *
      * @return The result of the evaluation. If the tree was invalid or some
      * other error occured, returns nullopt.
@@ -84,87 +88,420 @@ public:
     [[nodiscard]] auto evaluate(Scalar const& variable = Scalar::zero()) const
         -> std::optional<Scalar>;
 
-    [[nodiscard]] auto termCount() const -> size_t;
+    /**
+     * @brief evaluate - Evaluates the expression with the given context
+     * installed for the calling thread, see MathContextScope.
+     *
+     * Number literals are rounded to the context's precision, so the result
+     * precision is the larger of the context's and the variable's.
+     */
+    [[nodiscard]] auto
+    evaluate(Scalar const& variable, MathContext const& context) const
+        -> std::optional<Scalar>;
 
-    [[nodiscard]] auto hasVariable() const -> bool;
+    /**
+     * @brief evaluate - Evaluates the expression entirely in hardware doubles,
+     * for callers that need no more than about 53 bits.
+     *
+     * Much faster than multiple-precision evaluation, but literals are rounded
+     * to the nearest double and MathContext does not apply.
+     *
+     * @return The result, or nullopt if the tree was invalid.
+     */
+    [[nodiscard]] auto evaluate(double variable) const -> std::optional<double>;
 
     /**
-     * @brief reset - Clears this Expression and leaves in its place a single
-     * term.
-     * @param initial - The term to replace all original terms with.
+     * @brief evaluate - Evaluates the expression in double-double or
+     * quad-double arithmetic, for precisions of up to about 106 or 212 bits.
+     * See MultiDouble::serves.
+     *
+     * Literals keep the precision they were parsed with and MathContext does
+     * not apply.
+     *
+     * @return The result, or nullopt if the tree was invalid.
      */
-    void reset(Term&& initial);
+    [[nodiscard]] auto evaluate(DoubleDouble const& variable) const
+        -> std::optional<DoubleDouble>;
+    [[nodiscard]] auto evaluate(QuadDouble const& variable) const
+        -> std::optional<QuadDouble>;
 
     /**
-     * @brief reset - Clears this Expression and leaves in its place a single
-     * term of type Expression.
-     * @param initial - The expression to replace all original terms with.
+     * @brief evaluate - Evaluates the expression over every value of the
+     * variable in an interval at once.
+     *
+     * The result encloses the exact value of the expression, as written with
+     * its literals, for every such variable. Bounds are computed with directed
+     * rounding at the precision of the variable and the literals, and
+     * MathContext's rounding does not apply.
+     *
+     * @return The enclosure, or nullopt if the tree was invalid.
      */
-    auto reset(Expression&& initial) -> Expression&;
+    [[nodiscard]] auto evaluate(Interval const& variable) const
+        -> std::optional<Interval>;
 
     /**
-     * @brief setNegate - Set whether or not the expression is negated at the
-     * very end of evaluation.
+     * @brief evaluate - Evaluates the expression together with its first and
+     * second derivative, in one pass.
      *
-     * As an example, consider 1 + -(1 + 1). The term -(1 + 1) is an Expression
-     * with negation turned on.
+     * Passing Jet::variable(x) differentiates with respect to the variable at
+     * x. Literals are rounded to the context's precision as in
+     * evaluate(Scalar), but products are not fused, so the value may differ
+     * from it in the last place.
      *
-     * @param negate
+     * @return The value and derivatives, or nullopt if the tree was invalid.
      */
-    void setNegate(bool negate);
+    [[nodiscard]] auto evaluate(Jet const& variable) const
+        -> std::optional<Jet>;
 
     /**
-     * @brief setFunction - Sets the unary function that takes all terms as
-     * input.
+     * @brief evaluateMany - Evaluates the expression for every value of the
+     * variable, writing each result to the same index of results.
      *
-     * As an example, consider 1 + sin(1 + 1). The term sin(1 + 1) is an
-     * Expression whose function is `sine`.
+     * Equivalent to calling evaluate for each variable, but the tree is walked
+     * once per block of values rather than once per value, and intermediate
+     * values are kept in ScalarVectors. Every result takes the largest
+     * precision among the variables and the context.
      *
-     * Possible negation occurs after function evaluation, e.g. -sin(1) = -1 *
-     * sin(1).
+     * Results are per element: where the expression is undefined, such as at
+     * log(x) for negative x, that result is NaN and the others are unaffected.
      *
-     * @param function
+     * @return Whether results were written. False if the tree was invalid.
      */
-    void setFunction(std::shared_ptr<UnaryFunction const> function);
+    [[nodiscard]] auto evaluateMany(
+        std::span<Scalar const> variables, std::span<Scalar> results
+    ) const -> bool;
 
     /**
-     * @brief backTerm - Gets the last term in this expressions list of terms,
-     * for writing purposes.
+     * @brief evaluateMany - The hardware double variant of the above, with the
+     * same per element results.
+     *
+     * Functions are computed with the batched kernels in Functions, so results
+     * may differ from evaluate(double) by their documented error.
      */
-    auto backTerm() -> Term&;
+    [[nodiscard]] auto evaluateMany(
+        std::span<double const> variables, std::span<double> results
+    ) const -> bool;
 
     /**
-     * @brief append - Append a new term prepended by an operator
-     * @param mathOp - The binary operator that will come before the term.
-     * PEMDAS order applies to the overall expression.
+     * @brief folded - Copies the expression, precomputing every parenthesized
+     * group and function call that does not depend on the variable.
+     *
+     * Groups are evaluated once under the current MathContext, and only stand
+     * in for their subtrees when evaluating under that same context, so
+     * Scalar results are unchanged. Evaluation in doubles uses them too,
+     * rounded from the higher precision, while the other backends never do.
+     * The groups are kept for string().
+     *
+     * Calls that depend on the variable but have a constant first argument
+     * are prepared from it where their function allows, see
+     * NaryFunction::Partial. These may differ from unfolded evaluation in the
+     * last place, as logn(b, x) then multiplies by a cached reciprocal.
      */
-    auto append(BinaryOp mathOp) -> Term&;
+    [[nodiscard]] auto folded() const -> Expression;
 
     /**
-     * @brief appendExpression - Append a new expresion (as a term) prepended by
-     * an operator.
-     * @see Expression::append
+     * @brief simplified - Copies the expression, rewritten into a cheaper
+     * equivalent:
+     *
+     *   - Calls to id, and parentheses around a single term, are removed.
+     *   - Factors of 1 and summands of 0 are dropped.
+     *   - Double negation cancels, and a negated literal becomes a literal.
+     *   - A product starting with a term times itself squares it instead, so
+     *     the term is evaluated once.
+     *   - Division by a power of two multiplies by its reciprocal.
+     *   - A rounding function of a rounded value, such as floor(ceil(x)), is
+     *     the inner call, as is abs(abs(x)).
+     *
+     * Rewrites are exact, except that a dropped summand of 0 can flip the sign
+     * of a zero result, and a dropped factor of 1 can let a product fuse into
+     * its sum, rounding once instead of twice. Inverse pairs such as
+     * log(exp(x)) do not round back to x, so they are kept. Folded groups are
+     * copied as they are, and string() gives the rewritten expression.
      */
-    auto appendExpression(BinaryOp mathOp) -> Expression&;
+    [[nodiscard]] auto simplified() const -> Simplification;
+
+    [[nodiscard]] auto termCount() const -> size_t;
 
-    void cacheHasVariable();
+    [[nodiscard]] auto hasVariable() const -> bool;
 
 private:
-    [[nodiscard]] auto stringTerm(size_t index) const -> std::string;
-    [[nodiscard]] auto evaluateTerm(size_t index, Scalar const& variable) const
-        -> std::optional<Scalar>;
+    friend class ProgramCompiler;
+    friend class ExpressionBuilder;
+    friend class Simplifier;
+
+    enum class NodeKind : uint8_t
+    {
+        Literal,
+        Variable,
+        // A parenthesized group of summands, with an optional function and
+        // negation applied to their sum.
+        Sum,
+        // A summand made of more than one factor.
+        Product,
+        // A single operand multiplied by itself, evaluated once.
+        Square,
+        // A function of several arguments, which are its operands in order,
+        // with an optional negation applied to its result.
+        Call
+    };
+
+    struct Node
+    {
+        NodeKind kind;
+        // Sums and calls only, negates after the function.
+        bool negate{false};
+        // Sums and squares evaluated more than once per walk, whose values
+        // are kept after the first. See markShared.
+        bool shared{false};
+        // Sums index unaryFunctions() or are NO_FUNCTION, and calls index
+        // naryFunctions().
+        FunctionId function{NO_FUNCTION};
+        // Literals index m_literals. Other nodes with operands index
+        // m_operands, where their count operands are stored contiguously.
+        uint32_t begin{0};
+        uint32_t count{0};
+        // Sums and calls only, indexes m_literals for the precomputed value or
+        // is NOT_FOLDED. See folded.
+        uint32_t folded{NOT_FOLDED};
+        // Calls only, indexes m_literals for the value prepared from a
+        // constant first argument or is NOT_FOLDED. See NaryFunction::Partial.
+        uint32_t partial{NOT_FOLDED};
+
+        auto operator==(Node const& rhs) const -> bool = default;
+    };
+
+    struct Operand
+    {
+        uint32_t node;
+        // Subtracts from a sum, or divides a product. Never set on the first
+        // operand.
+        bool invert{false};
+
+        auto operator==(Operand const& rhs) const -> bool = default;
+    };
+
+    static uint32_t constexpr NOT_FOLDED = UINT32_MAX;
+
+    // Nodes by structural hash, for finding an existing copy of a new one.
+    using InternTable = std::unordered_multimap<size_t, uint32_t>;
+
+    // Per node values of one walk, only sized if some node is shared.
+    template <typename T>
+    using Memo = std::vector<std::optional<T>>;
+
+    [[nodiscard]] auto root() const -> uint32_t;
+    [[nodiscard]] auto operands(Node const& node) const
+        -> std::span<Operand const>;
+    // The factors of a summand, which is itself the only one unless it is a
+    // product.
+    [[nodiscard]] auto factors(Operand const& summand) const
+        -> std::span<Operand const>;
+    // The operand of a summand that is a lone square, which fuses into its sum
+    // like the product it stands for.
+    [[nodiscard]] auto squareOperand(Operand const& summand) const
+        -> std::optional<uint32_t>;
+
+    // Whether two subtrees compute the same value in the same way.
+    [[nodiscard]] auto equalNodes(uint32_t lhs, uint32_t rhs) const -> bool;
+
+    /**
+     * @brief intern - Appends a node, unless an identical one is already in
+     * the table, in which case that one is returned.
+     *
+     * The node's operands, and its literal, folded or prepared value, must be
+     * the last ones in their pools. They are dropped again if the node is not
+     * needed.
+     */
+    auto intern(Node const& node, InternTable& table) -> uint32_t;
+    auto internLiteral(Scalar value, InternTable& table) -> uint32_t;
+    // Equality of two nodes whose operands are already interned.
+    [[nodiscard]] auto sameNode(Node const& lhs, Node const& rhs) const
+        -> bool;
+    [[nodiscard]] auto hashNode(Node const& node) const -> size_t;
+    // Sets Node::shared, once the pool is complete.
+    void markShared();
+
+    template <typename T>
+    [[nodiscard]] auto newMemo() const -> Memo<T>
+    {
+        return Memo<T>(m_shared ? m_nodes.size() : 0);
+    }
+
+    // The precomputed value of a node, if it applies under the current
+    // context.
+    [[nodiscard]] auto foldedScalar(Node const& node) const -> Scalar const*;
+    [[nodiscard]] auto foldedDouble(Node const& node) const
+        -> std::optional<double>;
+    // The same for the prepared first argument of a call.
+    [[nodiscard]] auto partialScalar(Node const& node) const -> Scalar const*;
+    [[nodiscard]] auto partialDouble(Node const& node) const
+        -> std::optional<double>;
+
+    [[nodiscard]] auto stringNode(uint32_t index) const -> std::string;
+
+    // Each walker's evaluate looks a shared node up in the memo, and its
+    // compute does the work.
+    [[nodiscard]] auto evaluateNode(
+        uint32_t index, Scalar const& variable, Memo<Scalar>& memo
+    ) const -> std::optional<Scalar>;
+    [[nodiscard]] auto computeNode(
+        uint32_t index, Scalar const& variable, Memo<Scalar>& memo
+    ) const -> std::optional<Scalar>;
+
+    // Evaluation of one block of evaluateMany.
+    [[nodiscard]] auto evaluateBlock(ScalarVector const& variables) const
+        -> std::optional<ScalarVector>;
+    [[nodiscard]] auto evaluateBlock(std::span<double const> variables) const
+        -> std::optional<std::vector<double>>;
+    [[nodiscard]] auto evaluateBlock(
+        uint32_t index,
+        ScalarVector const& variables,
+        Memo<ScalarVector>& memo
+    ) const -> std::optional<ScalarVector>;
+    [[nodiscard]] auto computeBlock(
+        uint32_t index,
+        ScalarVector const& variables,
+        Memo<ScalarVector>& memo
+    ) const -> std::optional<ScalarVector>;
+    [[nodiscard]] auto evaluateBlock(
+        uint32_t index,
+        std::span<double const> variables,
+        Memo<std::vector<double>>& memo
+    ) const -> std::optional<std::vector<double>>;
+    [[nodiscard]] auto computeBlock(
+        uint32_t index,
+        std::span<double const> variables,
+        Memo<std::vector<double>>& memo
+    ) const -> std::optional<std::vector<double>>;
+
+    // Evaluation for the backends other than Scalar, which share one
+    // implementation.
+    template <typename T>
+    [[nodiscard]] auto evaluateGeneric(T const& variable) const
+        -> std::optional<T>;
+    template <typename T>
+    [[nodiscard]] auto
+    evaluateGeneric(uint32_t index, T const& variable, Memo<T>& memo) const
+        -> std::optional<T>;
+    template <typename T>
+    [[nodiscard]] auto
+    computeGeneric(uint32_t index, T const& variable, Memo<T>& memo) const
+        -> std::optional<T>;
+
+    std::vector<Node> m_nodes;
+    std::vector<Operand> m_operands;
+    std::vector<Scalar> m_literals;
+    bool m_hasVariable{false};
+    // Whether any node is shared.
+    bool m_shared{false};
+
+    // The context folded values were computed under, if any.
+    std::optional<MathContext> m_foldContext;
+};
+
+/**
+ * @brief The result of Expression::simplified.
+ */
+struct Simplification
+{
+    Expression expression;
+    // How many fewer nodes the rewritten expression has.
+    size_t removedNodes;
+};
+
+/**
+ * @brief Builds an Expression from terms and operators in source order.
+ *
+ * PEMDAS order is resolved as each group closes: runs of multiplication and
+ * division become products, and addition and subtraction join those into the
+ * group's sum. A group's nodes are written to the pool only then, so every
+ * node's operands are contiguous. Nodes identical to one already written are
+ * not written again, and the existing one is used instead.
+ *
+ * Callers are expected to alternate terms and operators, starting and ending
+ * with a term within every group. finish reports streams that do not.
+ */
+class ExpressionBuilder
+{
+public:
+    ExpressionBuilder();
+
+    // Appends a term to the innermost group.
+    void literal(Scalar value);
+    void variable();
+
+    // Appends the operator between the previous term and the next.
+    void binaryOperator(BinaryOp mathOp);
+
+    /**
+     * @brief openGroup - Starts a parenthesized term, whose value is its
+     * summands with function applied and then negated.
+     *
+     * As an example, consider 1 + -sin(1 + 1). The term -sin(1 + 1) is a group
+     * with negation turned on, whose function is `sine`. The function is
+     * NO_FUNCTION for plain parentheses.
+     *
+     * A function of several arguments takes one sum per argument, separated
+     * by separator.
+     */
+    void openGroup(bool negate, FunctionId function);
+
+    // Ends an argument of the innermost group and starts the next. Returns
+    // false unless the group is a call with another argument left.
+    auto separator() -> bool;
+
+    // Closes the innermost group, appending it as a term to its parent.
+    // Returns false if there was no open group, it had no terms, or it was a
+    // call missing arguments.
+    auto closeGroup() -> bool;
+
+    /**
+     * @brief finish - Closes the outermost group.
+     * @return The expression, or nullopt if the stream was malformed.
+     */
+    auto finish() -> std::optional<Expression>;
+
+private:
+    struct PendingTerm
+    {
+        uint32_t node;
+        // Joined to the previous term by the operator.
+        BinaryOp mathOp;
+    };
+
+    struct OpenGroup
+    {
+        // Where the group's terms start in m_pending.
+        size_t begin;
+        // Where a call's finished arguments start in m_arguments.
+        size_t arguments;
+        // The operator before the group, restored once it closes.
+        BinaryOp mathOp;
+        bool negate;
+        FunctionId function;
+    };
+
+    void term(uint32_t node);
+    // Writes the innermost group's nodes and returns its sum or call, or
+    // nullopt if a call has the wrong number of arguments.
+    auto closeInnermost() -> std::optional<uint32_t>;
+    // Writes the terms of the innermost group from begin on as a sum.
+    auto closeSum(size_t begin, bool negate, FunctionId function) -> uint32_t;
+    // Ends the innermost call's current argument.
+    void closeArgument();
 
-    // Negate the expression's evaluated value as the final step.
-    bool m_negate{false};
+    Expression m_expression;
+    Expression::InternTable m_interned;
 
-    // A function that is run as the expressions final result. nullptr indicates
-    // the identity function, aka no-op.
-    std::shared_ptr<UnaryFunction const> m_function;
+    // Terms of every open group, innermost last. The outermost group is open
+    // until finish.
+    std::vector<PendingTerm> m_pending;
+    std::vector<OpenGroup> m_groups;
+    // Finished arguments of every open call, innermost last.
+    std::vector<uint32_t> m_arguments;
 
-    // A valid expression interleaves terms and operators, or is completely
-    // empty
-    std::vector<std::unique_ptr<Term>> m_terms;
-    std::vector<BinaryOp> m_operators;
-    bool m_hasVariableCached{false};
+    BinaryOp m_nextOperator{BinaryOp::Plus};
+    bool m_expectTerm{true};
+    bool m_malformed{false};
 };
 } // namespace calqmath
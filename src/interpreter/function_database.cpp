@@ -1,59 +1,724 @@
 #include "function_database.h"
 
 #include "math/functions.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <limits>
+#include <optional>
+#include <type_traits>
 
-[[maybe_unused]]
-constexpr char const* RESERVED_FUNCTION_NAME = "x"; // Identifier for variable
+// Identifier for the variable
+constexpr std::string_view RESERVED_FUNCTION_NAME{"x"};
+
+// Picks out the overload of a function for each backend
+#define UNARY_FUNCTION(func)                                                   \
+    UnaryFunction                                                              \
+    {                                                                          \
+        .name = #func,                                                         \
+        .function = static_cast<UnaryFunction::ScalarFunction>(               \
+            Functions::func                                                    \
+        ),                                                                     \
+        .doubleFunction = static_cast<double (*)(double)>(Functions::func),    \
+        .doubleDoubleFunction =                                                \
+            static_cast<DoubleDouble (*)(DoubleDouble const&)>(                \
+                Functions::func                                                \
+            ),                                                                 \
+        .quadDoubleFunction =                                                  \
+            static_cast<QuadDouble (*)(QuadDouble const&)>(Functions::func),   \
+        .intervalFunction =                                                    \
+            static_cast<Interval (*)(Interval const&)>(Functions::func),       \
+        .batchFunction =                                                       \
+            static_cast<void (*)(std::span<double const>, std::span<double>)>( \
+                Functions::func                                                \
+            ),                                                                 \
+        .vectorFunction =                                                      \
+            static_cast<void (*)(ScalarVector const&, ScalarVector&)>(         \
+                Functions::func                                                \
+            ),                                                                 \
+        .jetFunction = static_cast<Jet (*)(Jet const&)>(Functions::func),      \
+    }
+
+// Picks out the variants of a multi-argument function in nary
+#define NARY_FUNCTION(func, count)                                             \
+    NaryFunction                                                               \
+    {                                                                          \
+        .name = #func,                                                         \
+        .arity = (count),                                                      \
+        .function = static_cast<NaryFunction::ScalarFunction>(nary::func),     \
+        .doubleFunction =                                                      \
+            static_cast<double (*)(double, double, double)>(nary::func),       \
+        .doubleDoubleFunction = nary::func<DoubleDouble>,                      \
+        .quadDoubleFunction = nary::func<QuadDouble>,                          \
+        .intervalFunction = nary::func<Interval>,                              \
+        .jetFunction = nary::func<Jet>,                                        \
+        .partial = nary::partial(#func),                                       \
+    }
 
 namespace calqmath
 {
-FunctionDatabase::FunctionDatabase() = default;
-
-auto FunctionDatabase::createWithDefaults() -> FunctionDatabase
-{
-    FunctionDatabase result{};
-
-    std::initializer_list<UnaryFunction> const functions = {
-        {"id", Functions::id},       {"abs", Functions::abs},
-        {"ceil", Functions::ceil},   {"floor", Functions::floor},
-        {"round", Functions::round}, {"roundeven", Functions::roundeven},
-        {"trunc", Functions::trunc}, {"sqrt", Functions::sqrt},
-        {"cbrt", Functions::cbrt},   {"exp", Functions::exp},
-        {"log", Functions::log},     {"log2", Functions::log2},
-        {"erf", Functions::erf},     {"erfc", Functions::erfc},
-        {"gamma", Functions::gamma}, {"sin", Functions::sin},
-        {"csc", Functions::csc},     {"asin", Functions::asin},
-        {"cos", Functions::cos},     {"sec", Functions::sec},
-        {"acos", Functions::acos},   {"tan", Functions::tan},
-        {"cot", Functions::cot},     {"atan", Functions::atan},
-        {"sinh", Functions::sinh},   {"cosh", Functions::cosh},
-        {"tanh", Functions::tanh},   {"asinh", Functions::asinh},
-        {"acosh", Functions::acosh}, {"atanh", Functions::atanh},
+namespace
+{
+/*
+ * The variants of each multi-argument function, padded to MAX_ARITY
+ * arguments. Scalars and doubles go to Functions, and the other backends are
+ * composed from their unary functions.
+ */
+namespace nary
+{
+template <typename T> auto isNegative(T const& value) -> bool
+{
+    if constexpr (std::is_same_v<T, Jet>)
+    {
+        return value.value() < Scalar{0.0};
+    }
+    else
+    {
+        return value < T{0.0};
+    }
+}
+
+void pow(
+    Scalar& result,
+    Scalar const& base,
+    Scalar const& exponent,
+    Scalar const& /*unused*/,
+    MathContext const& context
+)
+{
+    Functions::pow(result, base, exponent, context);
+}
+
+auto pow(double const base, double const exponent, double /*unused*/)
+    -> double
+{
+    return Functions::pow(base, exponent);
+}
+
+// Whether an integer is odd, or nullopt if the value is not an integer.
+template <typename T> auto oddInteger(T const& value) -> std::optional<bool>
+{
+    if (Functions::floor(value) != value)
+    {
+        return std::nullopt;
+    }
+    T const half{value * T{0.5}};
+    return Functions::floor(half) != half;
+}
+
+// base^exponent over a nonnegative interval of bases, for an integer exponent.
+auto powMagnitude(
+    Scalar const& lower, Scalar const& upper, Scalar const& exponent
+) -> Interval
+{
+    auto const bound{[&](Scalar const& value, RoundingMode const rounding)
+                     {
+                         Scalar result{0.0, value.precision()};
+                         Functions::pow(
+                             result,
+                             value,
+                             exponent,
+                             MathContext{.rounding = rounding}
+                         );
+                         return result;
+                     }};
+    if (exponent > Scalar{0.0})
+    {
+        return {
+            bound(lower, RoundingMode::TOWARD_NEGATIVE),
+            bound(upper, RoundingMode::TOWARD_POSITIVE)
+        };
+    }
+    // Decreasing, with a pole at zero.
+    return {
+        bound(upper, RoundingMode::TOWARD_NEGATIVE),
+        bound(lower, RoundingMode::TOWARD_POSITIVE),
+        lower > Scalar{0.0}
+    };
+}
+
+// Integer exponents are defined for negative bases, and the image is that of
+// |base| on either side of zero, mirrored for odd ones. Continuity is only
+// that of the power itself.
+auto powInterval(Interval const& base, Interval const& exponent) -> Interval
+{
+    auto const odd{
+        exponent.lower() == exponent.upper() ? oddInteger(exponent.lower())
+                                             : std::nullopt
+    };
+    if (!odd.has_value() || base.isEmpty())
+    {
+        return Functions::exp(exponent * Functions::log(base));
+    }
+
+    Scalar const& n{exponent.lower()};
+    if (n == Scalar{0.0})
+    {
+        return Interval{1.0, base.precision()};
+    }
+    if (base.lower() >= Scalar{0.0})
+    {
+        return powMagnitude(base.lower(), base.upper(), n);
+    }
+    if (base.upper() <= Scalar{0.0})
+    {
+        auto const magnitude{powMagnitude(-base.upper(), -base.lower(), n)};
+        return odd.value() ? -magnitude : magnitude;
+    }
+
+    // Straddling zero, split there.
+    auto const left{powMagnitude(Scalar{0.0}, -base.lower(), n)};
+    auto const right{powMagnitude(Scalar{0.0}, base.upper(), n)};
+    bool const continuous{left.continuous() && right.continuous()};
+    if (odd.value())
+    {
+        return {-left.upper(), right.upper(), continuous};
+    }
+    return {
+        std::min(left.lower(), right.lower()),
+        std::max(left.upper(), right.upper()),
+        continuous
     };
+}
+
+template <typename T>
+auto pow(T const& base, T const& exponent, T const& /*unused*/) -> T
+{
+    if constexpr (std::is_same_v<T, Interval>)
+    {
+        auto const result{powInterval(base, exponent)};
+        return {
+            result.lower(),
+            result.upper(),
+            result.continuous() && base.continuous() && exponent.continuous()
+        };
+    }
+    else if constexpr (std::is_same_v<T, Jet>)
+    {
+        // The power rule for a constant exponent, which leaves the sign of
+        // negative bases to the Scalar pow.
+        if (exponent.first() != Scalar{0.0}
+            || exponent.second() != Scalar{0.0})
+        {
+            return Functions::exp(exponent * Functions::log(base));
+        }
+
+        Scalar const& n{exponent.value()};
+        Scalar const& x{base.value()};
+        Scalar const one{1.0};
+        Scalar const slope{n * Functions::pow(x, n - one)};
+        Scalar const coefficient{n * (n - one)};
+        Scalar const curvature{
+            coefficient == Scalar{0.0}
+                ? coefficient
+                : coefficient * Functions::pow(x, n - one - one)
+        };
+        return {
+            Functions::pow(x, n),
+            slope * base.first(),
+            curvature * base.first() * base.first() + slope * base.second()
+        };
+    }
+    else
+    {
+        auto const odd{oddInteger(exponent)};
+        if (!odd.has_value())
+        {
+            return Functions::exp(exponent * Functions::log(base));
+        }
+        if (exponent == T{0.0})
+        {
+            return T{1.0};
+        }
+
+        // From |base|, negated again for odd exponents.
+        T const magnitude{
+            Functions::exp(exponent * Functions::log(Functions::abs(base)))
+        };
+        return odd.value() && isNegative(base) ? -magnitude : magnitude;
+    }
+}
+
+void logn(
+    Scalar& result,
+    Scalar const& base,
+    Scalar const& argument,
+    Scalar const& /*unused*/,
+    MathContext const& context
+)
+{
+    Functions::logn(result, base, argument, context);
+}
+
+auto logn(double const base, double const argument, double /*unused*/)
+    -> double
+{
+    return Functions::logn(base, argument);
+}
+
+template <typename T>
+auto logn(T const& base, T const& argument, T const& /*unused*/) -> T
+{
+    return Functions::log(argument) / Functions::log(base);
+}
+
+// The reciprocal of the logarithm of a base.
+void prepareLogn(
+    Scalar& result, Scalar const& base, MathContext const& context
+)
+{
+    Scalar logarithm{0.0, base.precision()};
+    Functions::log(logarithm, base, context);
+    Functions::divide(result, Scalar{1.0, base.precision()}, logarithm);
+}
+
+void partialLogn(
+    Scalar& result,
+    Scalar const& reciprocal,
+    Scalar const& argument,
+    Scalar const& /*unused*/,
+    MathContext const& context
+)
+{
+    // Taken before writing, since the result may alias either.
+    Scalar logarithm{0.0, argument.precision()};
+    Functions::log(logarithm, argument, context);
+    Functions::multiply(result, logarithm, reciprocal);
+}
+
+auto partialLogn(
+    double const reciprocal, double const argument, double /*unused*/
+) -> double
+{
+    return Functions::log(argument) * reciprocal;
+}
+
+void atan2(
+    Scalar& result,
+    Scalar const& y,
+    Scalar const& x,
+    Scalar const& /*unused*/,
+    MathContext const& context
+)
+{
+    Functions::atan2(result, y, x, context);
+}
+
+auto atan2(double const y, double const x, double /*unused*/) -> double
+{
+    return Functions::atan2(y, x);
+}
+
+template <typename T>
+auto atan2(T const& y, T const& x, T const& /*unused*/) -> T
+{
+    if constexpr (std::is_same_v<T, Interval>)
+    {
+        size_t const precision{std::max(y.precision(), x.precision())};
+        if (y.isEmpty() || x.isEmpty())
+        {
+            return Interval::empty(precision);
+        }
+
+        // Each half plane has a continuous form, and only boxes crossing the
+        // cut along the negative x axis, or touching the origin, have none.
+        Interval const quarter{Functions::atan(Interval{1.0, precision})};
+        Interval const two{2.0, precision};
+        if (x.lower() > Scalar{0.0})
+        {
+            return Functions::atan(y / x);
+        }
+        if (y.lower() > Scalar{0.0})
+        {
+            return quarter * two - Functions::atan(x / y);
+        }
+        if (y.upper() < Scalar{0.0})
+        {
+            return -(quarter * two) - Functions::atan(x / y);
+        }
+        if (x.upper() < Scalar{0.0} && y.lower() == Scalar{0.0})
+        {
+            // Zero is on the upper side of the cut.
+            return Functions::atan(y / x) + quarter * two * two;
+        }
+        return Interval::entire(false, precision);
+    }
+    else if constexpr (std::is_same_v<T, Jet>)
+    {
+        // With r = x² + y², the angle's derivative is n / r for
+        // n = xy' - yx', whose own derivative is xy'' - yx''. Not
+        // differentiable at the origin, where r is zero.
+        Scalar const r{x.value() * x.value() + y.value() * y.value()};
+        Scalar const n{x.value() * y.first() - y.value() * x.first()};
+        Scalar const first{n / r};
+        Scalar const two{2.0};
+        Scalar const growth{
+            two * (x.value() * x.first() + y.value() * y.first())
+        };
+        Scalar const second{
+            (x.value() * y.second() - y.value() * x.second() - first * growth)
+            / r
+        };
+        return {Functions::atan2(y.value(), x.value()), first, second};
+    }
+    else
+    {
+        T const pi{Functions::atan(T{1.0}) * T{4.0}};
+
+        // On the y axis y / x has no angle, so it is a quarter turn either
+        // way, or zero at the origin as for doubles.
+        if (x == T{0.0})
+        {
+            if (y == T{0.0})
+            {
+                return y;
+            }
+            T const quarter{pi * T{0.5}};
+            return isNegative(y) ? -quarter : quarter;
+        }
+
+        // Left of the y axis, atan(y / x) is off by half a turn.
+        T angle{Functions::atan(y / x)};
+        if (isNegative(x))
+        {
+            angle = isNegative(y) ? angle - pi : angle + pi;
+        }
+        return angle;
+    }
+}
+
+void hypot(
+    Scalar& result,
+    Scalar const& x,
+    Scalar const& y,
+    Scalar const& /*unused*/,
+    MathContext const& context
+)
+{
+    Functions::hypot(result, x, y, context);
+}
+
+auto hypot(double const x, double const y, double /*unused*/) -> double
+{
+    return Functions::hypot(x, y);
+}
+
+template <typename T>
+auto hypot(T const& x, T const& y, T const& /*unused*/) -> T
+{
+    // Squaring the absolute values keeps an interval's squares nonnegative.
+    T const width{Functions::abs(x)};
+    T const height{Functions::abs(y)};
+    return Functions::sqrt(width * width + height * height);
+}
+
+void min(
+    Scalar& result,
+    Scalar const& lhs,
+    Scalar const& rhs,
+    Scalar const& /*unused*/,
+    MathContext const& context
+)
+{
+    Functions::min(result, lhs, rhs, context);
+}
+
+auto min(double const lhs, double const rhs, double /*unused*/) -> double
+{
+    return Functions::min(lhs, rhs);
+}
+
+template <typename T>
+auto min(T const& lhs, T const& rhs, T const& /*unused*/) -> T
+{
+    if constexpr (std::is_same_v<T, Interval>)
+    {
+        // An empty operand is skipped as the Scalar variant skips NaN,
+        // whichever side it is on.
+        if (lhs.isEmpty())
+        {
+            return rhs;
+        }
+        if (rhs.isEmpty())
+        {
+            return lhs;
+        }
+        return {
+            std::min(lhs.lower(), rhs.lower()),
+            std::min(lhs.upper(), rhs.upper()),
+            lhs.continuous() && rhs.continuous()
+        };
+    }
+    else if constexpr (std::is_same_v<T, Jet>)
+    {
+        return rhs.value() < lhs.value() ? rhs : lhs;
+    }
+    else
+    {
+        return rhs < lhs || lhs.isNaN() ? rhs : lhs;
+    }
+}
+
+void max(
+    Scalar& result,
+    Scalar const& lhs,
+    Scalar const& rhs,
+    Scalar const& /*unused*/,
+    MathContext const& context
+)
+{
+    Functions::max(result, lhs, rhs, context);
+}
+
+auto max(double const lhs, double const rhs, double /*unused*/) -> double
+{
+    return Functions::max(lhs, rhs);
+}
+
+template <typename T>
+auto max(T const& lhs, T const& rhs, T const& /*unused*/) -> T
+{
+    if constexpr (std::is_same_v<T, Interval>)
+    {
+        // An empty operand is skipped, as for min.
+        if (lhs.isEmpty())
+        {
+            return rhs;
+        }
+        if (rhs.isEmpty())
+        {
+            return lhs;
+        }
+        return {
+            std::max(lhs.lower(), rhs.lower()),
+            std::max(lhs.upper(), rhs.upper()),
+            lhs.continuous() && rhs.continuous()
+        };
+    }
+    else if constexpr (std::is_same_v<T, Jet>)
+    {
+        return lhs.value() < rhs.value() ? rhs : lhs;
+    }
+    else
+    {
+        return lhs < rhs || lhs.isNaN() ? rhs : lhs;
+    }
+}
+
+void fma(
+    Scalar& result,
+    Scalar const& lhs,
+    Scalar const& rhs,
+    Scalar const& addend,
+    MathContext const& /*context*/
+)
+{
+    // The context is the current one, which Functions::fma rounds with.
+    Functions::fma(result, lhs, rhs, addend);
+}
+
+auto fma(double const lhs, double const rhs, double const addend) -> double
+{
+    return Functions::fma(lhs, rhs, addend);
+}
+
+// Rounded twice, since these backends have no fused operation.
+template <typename T>
+auto fma(T const& lhs, T const& rhs, T const& addend) -> T
+{
+    return lhs * rhs + addend;
+}
+
+// Picks out the partial evaluation of a function, if it has one.
+constexpr auto partial(std::string_view const name) -> NaryFunction::Partial
+{
+    if (name == "logn")
+    {
+        return {
+            .prepare = prepareLogn,
+            .function = partialLogn,
+            .doubleFunction = partialLogn,
+        };
+    }
+    return {};
+}
+} // namespace nary
+
+#define DEFAULT_UNARY_FUNCTION(func) UNARY_FUNCTION(func),
+constexpr std::array UNARY_FUNCTIONS{
+    CALQ_DEFAULT_UNARY_FUNCTIONS(DEFAULT_UNARY_FUNCTION)
+};
+#undef DEFAULT_UNARY_FUNCTION
 
-    result.m_unaryFunctions =
-        std::map<std::string, std::shared_ptr<UnaryFunction const>>();
+#define DEFAULT_NARY_FUNCTION(func, count) NARY_FUNCTION(func, count),
+constexpr std::array NARY_FUNCTIONS{
+    CALQ_DEFAULT_NARY_FUNCTIONS(DEFAULT_NARY_FUNCTION)
+};
+#undef DEFAULT_NARY_FUNCTION
 
-    for (UnaryFunction const& function : functions)
+static_assert(UNARY_FUNCTIONS.size() <= FIRST_NARY_FUNCTION);
+static_assert(NARY_FUNCTIONS.size() < NO_FUNCTION - FIRST_NARY_FUNCTION);
+static_assert(std::ranges::all_of(
+    NARY_FUNCTIONS,
+    [](NaryFunction const& function)
+    { return function.arity <= NaryFunction::MAX_ARITY; }
+));
+
+// The name of any function, unary or not.
+constexpr auto functionName(FunctionId const id) -> std::string_view
+{
+    if (isNaryFunction(id))
     {
-        assert(function.name != RESERVED_FUNCTION_NAME);
+        return NARY_FUNCTIONS[id - FIRST_NARY_FUNCTION].name;
+    }
+    return UNARY_FUNCTIONS[id].name;
+}
 
-        result.m_unaryFunctions[function.name] =
-            std::make_shared<UnaryFunction const>(function);
+size_t constexpr FUNCTION_COUNT{
+    UNARY_FUNCTIONS.size() + NARY_FUNCTIONS.size()
+};
+
+// Every FunctionId there is.
+constexpr auto functionIds() -> std::array<FunctionId, FUNCTION_COUNT>
+{
+    std::array<FunctionId, FUNCTION_COUNT> ids{};
+    for (size_t index{0}; index < ids.size(); index++)
+    {
+        ids[index] = static_cast<FunctionId>(
+            index < UNARY_FUNCTIONS.size()
+                ? index
+                : FIRST_NARY_FUNCTION + index - UNARY_FUNCTIONS.size()
+        );
     }
+    return ids;
+}
+
+constexpr auto FUNCTION_IDS{functionIds()};
+
+// A power of two at least four times the function count, so a seed without
+// collisions turns up after a few dozen tries.
+size_t constexpr NAME_SLOTS{256};
+static_assert(NAME_SLOTS >= 4 * FUNCTION_IDS.size());
+
+// FNV-1a, with the seed mixed into its offset basis.
+constexpr auto hashName(std::string_view const name, uint32_t const seed)
+    -> size_t
+{
+    uint32_t hash{2166136261U ^ seed};
+    for (char const character : name)
+    {
+        hash ^= static_cast<uint8_t>(character);
+        hash *= 16777619U;
+    }
+    hash ^= hash >> 16U;
+    return hash & (NAME_SLOTS - 1);
+}
+
+struct NameTable
+{
+    uint32_t seed;
+    // The function whose name hashes to each slot, or NO_FUNCTION.
+    std::array<FunctionId, NAME_SLOTS> slots;
+};
+
+// Tries seeds in order until every name hashes to a slot of its own.
+constexpr auto buildNameTable() -> NameTable
+{
+    for (uint32_t seed{0};; seed++)
+    {
+        NameTable table{.seed = seed, .slots = {}};
+        table.slots.fill(NO_FUNCTION);
+
+        bool collided{false};
+        for (FunctionId const id : FUNCTION_IDS)
+        {
+            auto& slot{table.slots[hashName(functionName(id), seed)]};
+            collided = collided || slot != NO_FUNCTION;
+            slot = id;
+        }
+
+        if (!collided)
+        {
+            return table;
+        }
+    }
+}
+
+constexpr NameTable NAME_TABLE{buildNameTable()};
 
+static_assert(std::ranges::none_of(
+    FUNCTION_IDS,
+    [](FunctionId const id)
+    { return functionName(id) == RESERVED_FUNCTION_NAME; }
+));
+} // namespace
+
+auto unaryFunctions() -> std::span<UnaryFunction const>
+{
+    return UNARY_FUNCTIONS;
+}
+
+auto applyFunction(UnaryFunction const& function, Scalar const& argument)
+    -> Scalar
+{
+    assert(function.function != nullptr);
+    Scalar result{0.0, argument.precision()};
+    function.function(result, argument, MathContext::current());
+    return result;
+}
+
+auto naryFunctions() -> std::span<NaryFunction const>
+{
+    return NARY_FUNCTIONS;
+}
+
+auto applyFunction(
+    NaryFunction const& function, std::span<Scalar const> const arguments
+) -> Scalar
+{
+    assert(function.function != nullptr);
+    assert(arguments.size() == function.arity);
+
+    // Arguments past the arity are ignored, so any will do.
+    auto const argument = [&](size_t const index) -> Scalar const&
+    { return arguments[index < arguments.size() ? index : 0]; };
+
+    Scalar result{0.0, arguments.front().precision()};
+    function.function(
+        result, argument(0), argument(1), argument(2), MathContext::current()
+    );
     return result;
 }
 
-auto FunctionDatabase::lookup(std::string const& identifier) const
-    -> std::optional<std::shared_ptr<UnaryFunction const>>
+auto FunctionDatabase::defaults() -> FunctionDatabase const&
+{
+    // Constant initialized, so there is no guard to check on each call.
+    static constinit FunctionDatabase const database{};
+    return database;
+}
+
+auto FunctionDatabase::lookup(std::string_view const identifier) const
+    -> std::optional<FunctionId>
 {
-    if (!m_unaryFunctions.contains(identifier))
+    FunctionId const id{
+        NAME_TABLE.slots[hashName(identifier, NAME_TABLE.seed)]
+    };
+    if (id == NO_FUNCTION || functionName(id) != identifier)
     {
         return std::nullopt;
     }
 
-    return m_unaryFunctions.at(identifier);
+    return id;
+}
+
+auto FunctionDatabase::unaryFunctions() const
+    -> std::span<UnaryFunction const>
+{
+    return UNARY_FUNCTIONS;
+}
+
+auto FunctionDatabase::naryFunctions() const -> std::span<NaryFunction const>
+{
+    return NARY_FUNCTIONS;
 }
 } // namespace calqmath
@@ -1,36 +1,205 @@
 #pragma once
 
+#include "math/interval.h"
+#include "math/jet.h"
+#include "math/multidouble.h"
 #include "math/number.h"
-#include <functional>
-#include <map>
+#include "math/scalarvector.h"
+#include <cassert>
+#include <cstdint>
 #include <optional>
-#include <ranges>
-#include <string>
+#include <span>
+#include <string_view>
+
+// Calls X(func) for every function loaded by default, each of which has an
+// overload in Functions for every backend.
+#define CALQ_DEFAULT_UNARY_FUNCTIONS(X)                                        \
+    X(id)                                                                      \
+    X(abs)                                                                     \
+    X(ceil)                                                                    \
+    X(floor)                                                                   \
+    X(round)                                                                   \
+    X(roundeven)                                                               \
+    X(trunc)                                                                   \
+    X(sqrt)                                                                    \
+    X(cbrt)                                                                    \
+    X(exp)                                                                     \
+    X(log)                                                                     \
+    X(log2)                                                                    \
+    X(erf)                                                                     \
+    X(erfc)                                                                    \
+    X(gamma)                                                                   \
+    X(sin)                                                                     \
+    X(csc)                                                                     \
+    X(asin)                                                                    \
+    X(cos)                                                                     \
+    X(sec)                                                                     \
+    X(acos)                                                                    \
+    X(tan)                                                                     \
+    X(cot)                                                                     \
+    X(atan)                                                                    \
+    X(sinh)                                                                    \
+    X(cosh)                                                                    \
+    X(tanh)                                                                    \
+    X(asinh)                                                                   \
+    X(acosh)                                                                   \
+    X(atanh)
+
+// Calls X(func, arity) for every function of more than one argument loaded by
+// default.
+#define CALQ_DEFAULT_NARY_FUNCTIONS(X)                                         \
+    X(pow, 2)                                                                  \
+    X(logn, 2)                                                                 \
+    X(atan2, 2)                                                                \
+    X(hypot, 2)                                                                \
+    X(min, 2)                                                                  \
+    X(max, 2)                                                                  \
+    X(fma, 3)
 
 namespace calqmath
 {
+// Indexes unaryFunctions(), or naryFunctions() from FIRST_NARY_FUNCTION on.
+// Small, so expression nodes stay compact.
+using FunctionId = uint8_t;
+// Stands for no function at all, such as on plain parentheses.
+inline constexpr FunctionId NO_FUNCTION{UINT8_MAX};
+inline constexpr FunctionId FIRST_NARY_FUNCTION{128};
+
+constexpr auto isNaryFunction(FunctionId const id) -> bool
+{
+    return id >= FIRST_NARY_FUNCTION && id != NO_FUNCTION;
+}
+
+/**
+ * @brief One function over every backend, as plain function pointers.
+ *
+ * Instances only live in the process-wide table, so expressions refer to them
+ * by FunctionId, and calling one is an indexed load and an indirect call.
+ */
 struct UnaryFunction
 {
-    UnaryFunction(std::string name, std::function<Scalar(Scalar)> function)
-        : name(std::move(name))
-        , function(std::move(function))
+    // Writes the result in place, which may alias the argument, so evaluators
+    // can reuse a Scalar's storage.
+    using ScalarFunction = void (*)(
+        Scalar& result, Scalar const& argument, MathContext const& context
+    );
+
+    std::string_view name;
+    ScalarFunction function;
+    // The same function on hardware doubles, for low precision evaluation.
+    double (*doubleFunction)(double);
+    // And for the extended precision hardware backends.
+    DoubleDouble (*doubleDoubleFunction)(DoubleDouble const&);
+    QuadDouble (*quadDoubleFunction)(QuadDouble const&);
+    // The range over an interval, for certified evaluation.
+    Interval (*intervalFunction)(Interval const&);
+    // Hardware doubles again, over many arguments at once.
+    void (*batchFunction)(std::span<double const>, std::span<double>);
+    // And Scalars, over a whole ScalarVector.
+    void (*vectorFunction)(ScalarVector const&, ScalarVector&);
+    // The value with its first two derivatives, for differentiation.
+    Jet (*jetFunction)(Jet const&);
+};
+
+// Every function there is, indexed by FunctionId.
+auto unaryFunctions() -> std::span<UnaryFunction const>;
+
+inline auto unaryFunction(FunctionId const id) -> UnaryFunction const&
+{
+    auto const functions{unaryFunctions()};
+    assert(id < functions.size());
+    return functions[id];
+}
+
+// Applies a function's Scalar variant under the current context.
+auto applyFunction(UnaryFunction const& function, Scalar const& argument)
+    -> Scalar;
+
+/**
+ * @brief A function of a fixed number of arguments over every backend, such
+ * as pow or fma.
+ *
+ * Every variant takes MAX_ARITY arguments so that callers need no dispatch on
+ * the arity, and those past the function's arity are ignored. Scalars and
+ * doubles are computed by Functions. The other backends are composed from
+ * their unary functions and arithmetic, pow as exp(exponent * log(base)) for
+ * example, with negative bases only defined for integer exponents.
+ */
+struct NaryFunction
+{
+    static size_t constexpr MAX_ARITY{3};
+
+    // Writes the result in place, which may alias any argument.
+    using ScalarFunction = void (*)(
+        Scalar& result,
+        Scalar const& first,
+        Scalar const& second,
+        Scalar const& third,
+        MathContext const& context
+    );
+    template <typename T> using Function = T (*)(T const&, T const&, T const&);
+
+    /**
+     * @brief Evaluation with a constant first argument, from a value prepared
+     * once in its place. logn prepares the reciprocal of the logarithm of its
+     * base, so that each call is one logarithm and one multiplication.
+     *
+     * Every member is null for functions that gain nothing from it.
+     */
+    struct Partial
     {
-    }
+        // Writes the prepared value of a first argument.
+        void (*prepare)(
+            Scalar& result, Scalar const& first, MathContext const& context
+        );
+        // The variants taking the prepared value as their first argument.
+        ScalarFunction function;
+        double (*doubleFunction)(double, double, double);
+    };
 
-    std::string name; // NOLINT(misc-non-private-member-variables-in-classes)
-    std::function<Scalar(Scalar)>
-        function; // NOLINT(misc-non-private-member-variables-in-classes)
+    std::string_view name;
+    uint8_t arity;
+    ScalarFunction function;
+    double (*doubleFunction)(double, double, double);
+    Function<DoubleDouble> doubleDoubleFunction;
+    Function<QuadDouble> quadDoubleFunction;
+    Function<Interval> intervalFunction;
+    Function<Jet> jetFunction;
+    Partial partial;
 };
 
+// Every function of more than one argument, indexed by FunctionId less
+// FIRST_NARY_FUNCTION.
+auto naryFunctions() -> std::span<NaryFunction const>;
+
+inline auto naryFunction(FunctionId const id) -> NaryFunction const&
+{
+    auto const functions{naryFunctions()};
+    auto const index{static_cast<size_t>(id - FIRST_NARY_FUNCTION)};
+    assert(isNaryFunction(id) && index < functions.size());
+    return functions[index];
+}
+
+// Applies a function's Scalar variant under the current context. There must be
+// as many arguments as its arity.
+auto applyFunction(
+    NaryFunction const& function, std::span<Scalar const> arguments
+) -> Scalar;
+
 /**
  * @brief The FunctionDatabase class stores loaded functions for easy lookup by
  * the interpreter.
+ *
+ * The built in functions and their name table are computed at compile time,
+ * so the database is immutable and a single instance is shared by the whole
+ * process. Names are placed by a perfect hash, and lookup is one probe and one
+ * string compare.
  */
 class FunctionDatabase
 {
 public:
-    // Creates the database loading every function possible, for normal use.
-    static auto createWithDefaults() -> FunctionDatabase;
+    // Every function there is, for normal use.
+    static auto defaults() -> FunctionDatabase const&;
 
     /**
      * @brief lookup - Potentially many-to-one lookup by a string.
@@ -38,20 +207,25 @@ public:
      * For example, the string "sin" will return the trigonometric sine
      * function alongside its canonical name.
      *
-     * @return Returns the function, or null if no function by that name exists.
+     * @return Returns the function, which is a NaryFunction if
+     * isNaryFunction, or nullopt if no function by that name exists.
      */
-    [[nodiscard]] auto lookup(std::string const&) const
-        -> std::optional<std::shared_ptr<UnaryFunction const>>;
+    [[nodiscard]] auto lookup(std::string_view) const
+        -> std::optional<FunctionId>;
 
-    [[nodiscard]] auto unaryNames() const
-    {
-        return std::views::values(m_unaryFunctions);
-    }
+    // Every function in the database, as in the free functions of the same
+    // name.
+    [[nodiscard]] auto unaryFunctions() const
+        -> std::span<UnaryFunction const>;
+    [[nodiscard]] auto naryFunctions() const -> std::span<NaryFunction const>;
 
-private:
-    FunctionDatabase();
+    FunctionDatabase(FunctionDatabase const&) = delete;
+    FunctionDatabase(FunctionDatabase&&) = delete;
+    auto operator=(FunctionDatabase const&) -> FunctionDatabase& = delete;
+    auto operator=(FunctionDatabase&&) -> FunctionDatabase& = delete;
+    ~FunctionDatabase() = default;
 
-    std::map<std::string, std::shared_ptr<UnaryFunction const>>
-        m_unaryFunctions;
+private:
+    constexpr FunctionDatabase() = default;
 };
 } // namespace calqmath
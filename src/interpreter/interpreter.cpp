@@ -12,12 +12,25 @@ namespace
 {
 // TODO: rewrite this and support locales
 
-auto trim(std::string const& rawInput) -> std::string
+// Runs of whitespace become one space, and leading or trailing runs go.
+auto collapseWhitespace(std::string const& rawInput) -> std::string
 {
-    std::string output = rawInput;
-    std::erase_if(
-        output, [](unsigned char character) { return std::isspace(character); }
-    );
+    std::string output{};
+    bool pending{false};
+    for (unsigned char const character : rawInput)
+    {
+        if (std::isspace(character))
+        {
+            pending = !output.empty();
+            continue;
+        }
+        if (pending)
+        {
+            output += ' ';
+            pending = false;
+        }
+        output += static_cast<char>(character);
+    }
     return output;
 }
 } // namespace
@@ -25,16 +38,13 @@ auto trim(std::string const& rawInput) -> std::string
 namespace calqmath
 {
 Interpreter::Interpreter()
-    : m_functions{FunctionDatabase::createWithDefaults()}
+    : m_functions{&FunctionDatabase::defaults()}
 {
-    // TODO: hoist this somewhere more reasonable, for now interpreter acts as
-    // the library frontend.
-    calqmath::initBignumBackend();
 }
 
 auto Interpreter::prettify(std::string const& rawInput) -> std::string
 {
-    return trim(rawInput);
+    return collapseWhitespace(rawInput);
 }
 
 auto Interpreter::expression(std::string const& rawInput) const
@@ -46,12 +56,13 @@ auto Interpreter::expression(std::string const& rawInput) const
         return std::unexpected(InterpretError::LexError);
     }
 
-    auto const expression = Parser::parse(m_functions, tokens.value());
+    auto const expression =
+        Parser::parse(*m_functions, rawInput, tokens.value());
     if (!expression.has_value())
     {
         return std::unexpected(InterpretError::ParseError);
     }
 
-    return expression.value();
+    return expression->folded();
 }
 } // namespace calqmath
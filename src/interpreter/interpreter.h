@@ -28,9 +28,16 @@ enum class InterpretError : uint8_t
  *     number     ::= ( {digit} ["."] {digit} ) - "."
  *
  *     term       ::= number | expression
- *     expression ::= ["-"] [function] "(" term {operator term} ")"
+ *     sum        ::= term {operator term}
+ *     expression ::= ["-"] [function] "(" sum {"," sum} ")"
+ *
+ * Plain parentheses hold a single sum, and a function takes as many comma
+ * separated sums as it has arguments, such as pow(x, 2).
+ *
+ * Whitespace separates tokens and is otherwise ignored, so it may surround
+ * any token but not split one: "1 2" is two numbers and a parse error, not
+ * 12.
  *
- * Whitespace is eliminated and has no impact on the parsing or evaluation.
  * Mathematical evaluation uses standard BEDMAS/PEMDAS order. Thus
  * evaluation is depth first, with nesting indicated by parenthesis.
  *
@@ -50,7 +57,8 @@ public:
      * standardized form.
      *
      * @param rawInput - The string to prettify.
-     * @return Returns the string, with whitespace removed.
+     * @return Returns the string, with each run of whitespace collapsed to a
+     * single space and none at either end, so that it reads as it is parsed.
      */
     static auto prettify(std::string const& rawInput) -> std::string;
 
@@ -58,12 +66,15 @@ public:
      * @brief interpret - Parses user input as a mathematical expression and
      * returns the evaluated answer.
      *
+     * Constant groups are folded under the current MathContext, see
+     * Expression::folded.
+     *
      * @param rawInput - The stringified input.
      */
     [[nodiscard]] auto expression(std::string const& rawInput) const
         -> std::expected<Expression, InterpretError>;
 
 private:
-    FunctionDatabase m_functions;
+    FunctionDatabase const* m_functions;
 };
 } // namespace calqmath
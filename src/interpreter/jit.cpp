@@ -0,0 +1,453 @@
+#include "jit.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define CALQ_NATIVE_CODE 1
+#include <sys/mman.h>
+#else
+#define CALQ_NATIVE_CODE 0
+#endif
+
+namespace calqmath
+{
+/*
+ * The mapped code, along with the constants it points to. Constants are
+ * addressed by an absolute pointer baked into the code, so they live here
+ * rather than in the function. Functions are called at their fixed addresses.
+ */
+struct NativeFunction::Image
+{
+    Image() = default;
+    Image(Image const&) = delete;
+    Image(Image&&) = delete;
+    auto operator=(Image const&) -> Image& = delete;
+    auto operator=(Image&&) -> Image& = delete;
+
+    ~Image()
+    {
+#if CALQ_NATIVE_CODE
+        if (code != nullptr)
+        {
+            munmap(code, size);
+        }
+#endif
+    }
+
+    std::vector<double> constants;
+    void* code{nullptr};
+    size_t size{0};
+};
+
+#if CALQ_NATIVE_CODE
+namespace
+{
+enum class Base : uint8_t
+{
+    // The stack frame, holding the variable and then the registers.
+    Frame = 5, // rbp
+    // The constant pool, holding the constants and then a sign mask.
+    Pool = 3, // rbx
+};
+
+// The scalar double operations of SSE2, by their opcode after F2 0F.
+enum class Sse : uint8_t
+{
+    Load = 0x10,
+    Store = 0x11,
+    Add = 0x58,
+    Multiply = 0x59,
+    Subtract = 0x5C,
+    Divide = 0x5E,
+};
+
+/*
+ * Emits x86-64 machine code for a program, instruction by instruction.
+ *
+ * Every value lives in its slot in memory, xmm0 is the accumulator, and xmm1
+ * and xmm2 are scratch or the further arguments of a call. The last value
+ * stored is still in xmm0, so it is not loaded again if the next instruction
+ * consumes it first.
+ *
+ * The frame and pool bases are callee saved, so calls need not preserve
+ * anything. The batched entry keeps its arguments in r12, r14 and r15, which
+ * are callee saved too.
+ */
+class Emitter
+{
+public:
+    Emitter(Program const& program, double const* const pool)
+        : m_program(program)
+        , m_pool(pool)
+    {
+    }
+
+    // double f(double variable), returns its offset.
+    auto single() -> size_t;
+    // void f(double const* variables, double* results, size_t count).
+    auto batch() -> size_t;
+
+    [[nodiscard]] auto code() const -> std::vector<uint8_t> const&
+    {
+        return m_code;
+    }
+
+private:
+    void prologue();
+    void epilogue();
+    void body();
+
+    void bytes(std::initializer_list<uint8_t> values);
+    void immediate32(uint32_t value);
+    void immediate64(uint64_t value);
+
+    // An SSE2 operation between xmm register and slot.
+    void sse(Sse operation, uint8_t xmm, uint32_t slot);
+    void sse(Sse operation, uint8_t xmm, Base base, int32_t displacement);
+    void load(uint32_t slot);
+    void store(uint32_t slot);
+
+    void patch(size_t offset, size_t target);
+
+    [[nodiscard]] auto frameSize() const -> uint32_t;
+
+    Program const& m_program;
+    double const* m_pool;
+    std::vector<uint8_t> m_code;
+    std::optional<uint32_t> m_accumulator;
+};
+
+auto Emitter::single() -> size_t
+{
+    size_t const offset{m_code.size()};
+    prologue();
+    store(0);
+    body();
+    load(m_program.resultSlot());
+    epilogue();
+    return offset;
+}
+
+auto Emitter::batch() -> size_t
+{
+    size_t const offset{m_code.size()};
+    prologue();
+    bytes({0x49, 0x89, 0xFE}); // mov r14, rdi
+    bytes({0x49, 0x89, 0xF7}); // mov r15, rsi
+    bytes({0x49, 0x89, 0xD4}); // mov r12, rdx
+
+    size_t const loop{m_code.size()};
+    bytes({0x4D, 0x85, 0xE4}); // test r12, r12
+    bytes({0x0F, 0x84});       // jz done
+    size_t const exit{m_code.size()};
+    immediate32(0);
+
+    bytes({0xF2, 0x41, 0x0F, 0x10, 0x06}); // movsd xmm0, [r14]
+    m_accumulator.reset();
+    store(0);
+    body();
+    load(m_program.resultSlot());
+    bytes({0xF2, 0x41, 0x0F, 0x11, 0x07}); // movsd [r15], xmm0
+
+    bytes({0x49, 0x83, 0xC6, 0x08}); // add r14, 8
+    bytes({0x49, 0x83, 0xC7, 0x08}); // add r15, 8
+    bytes({0x49, 0xFF, 0xCC});       // dec r12
+    bytes({0xE9});                   // jmp loop
+    immediate32(0);
+    patch(m_code.size() - 4, loop);
+
+    patch(exit, m_code.size());
+    epilogue();
+    return offset;
+}
+
+void Emitter::prologue()
+{
+    bytes({0x55});       // push rbp
+    bytes({0x53});       // push rbx
+    bytes({0x41, 0x54}); // push r12
+    bytes({0x41, 0x56}); // push r14
+    bytes({0x41, 0x57}); // push r15
+
+    // Five pushes and the return address leave the stack 16 byte aligned,
+    // and the frame keeps it so for calls.
+    bytes({0x48, 0x81, 0xEC}); // sub rsp, frame
+    immediate32(frameSize());
+    bytes({0x48, 0x89, 0xE5}); // mov rbp, rsp
+    bytes({0x48, 0xBB});       // mov rbx, pool
+    immediate64(std::bit_cast<uint64_t>(m_pool));
+}
+
+void Emitter::epilogue()
+{
+    bytes({0x48, 0x81, 0xC4}); // add rsp, frame
+    immediate32(frameSize());
+    bytes({0x41, 0x5F}); // pop r15
+    bytes({0x41, 0x5E}); // pop r14
+    bytes({0x41, 0x5C}); // pop r12
+    bytes({0x5B});       // pop rbx
+    bytes({0x5D});       // pop rbp
+    bytes({0xC3});       // ret
+}
+
+void Emitter::body()
+{
+    // The variable was just stored from xmm0.
+    m_accumulator = 0;
+
+    for (auto const& instruction : m_program.instructions())
+    {
+        auto const& [first, second, third] = instruction.operands;
+
+        load(first);
+        switch (instruction.code)
+        {
+        case OpCode::Add:
+            sse(Sse::Add, 0, second);
+            break;
+        case OpCode::Subtract:
+            sse(Sse::Subtract, 0, second);
+            break;
+        case OpCode::Multiply:
+            sse(Sse::Multiply, 0, second);
+            break;
+        case OpCode::Divide:
+            sse(Sse::Divide, 0, second);
+            break;
+        case OpCode::MultiplyAdd:
+            // Rounded twice, as VirtualMachine::run(double) does.
+            sse(Sse::Multiply, 0, second);
+            sse(Sse::Add, 0, third);
+            break;
+        case OpCode::Negate:
+        {
+            auto const sign{m_program.constantCount()};
+            sse(Sse::Load, 1, Base::Pool, static_cast<int32_t>(8 * sign));
+            bytes({0x66, 0x0F, 0x57, 0xC1}); // xorpd xmm0, xmm1
+            break;
+        }
+        case OpCode::Call:
+            // The argument is already in xmm0, where the result comes back.
+            bytes({0x48, 0xB8}); // mov rax, function
+            immediate64(std::bit_cast<uint64_t>(
+                unaryFunction(instruction.function).doubleFunction
+            ));
+            bytes({0xFF, 0xD0}); // call rax
+            break;
+        case OpCode::CallNary:
+        case OpCode::CallPartial:
+        {
+            // The rest of the arguments go in xmm1 and xmm2, all three passed
+            // whatever the arity.
+            auto const& function{naryFunction(instruction.function)};
+            sse(Sse::Load, 1, second);
+            sse(Sse::Load, 2, third);
+            bytes({0x48, 0xB8}); // mov rax, function
+            immediate64(std::bit_cast<uint64_t>(
+                instruction.code == OpCode::CallPartial
+                    ? function.partial.doubleFunction
+                    : function.doubleFunction
+            ));
+            bytes({0xFF, 0xD0}); // call rax
+            break;
+        }
+        }
+        store(instruction.result);
+    }
+}
+
+void Emitter::bytes(std::initializer_list<uint8_t> const values)
+{
+    m_code.insert(m_code.end(), values);
+}
+
+void Emitter::immediate32(uint32_t const value)
+{
+    for (size_t index = 0; index < 4; index++)
+    {
+        m_code.push_back(static_cast<uint8_t>(value >> (8 * index)));
+    }
+}
+
+void Emitter::immediate64(uint64_t const value)
+{
+    immediate32(static_cast<uint32_t>(value));
+    immediate32(static_cast<uint32_t>(value >> 32U));
+}
+
+void Emitter::sse(Sse const operation, uint8_t const xmm, uint32_t const slot)
+{
+    auto const constants{static_cast<uint32_t>(m_program.constantCount())};
+    if (slot >= 1 && slot <= constants)
+    {
+        sse(operation, xmm, Base::Pool, static_cast<int32_t>(8 * (slot - 1)));
+        return;
+    }
+
+    // The variable and then the registers, skipping the constants.
+    uint32_t const frameSlot{slot == 0 ? 0 : slot - constants};
+    sse(operation, xmm, Base::Frame, static_cast<int32_t>(8 * frameSlot));
+}
+
+void Emitter::sse(
+    Sse const operation,
+    uint8_t const xmm,
+    Base const base,
+    int32_t const displacement
+)
+{
+    bool const shortDisplacement{displacement >= -128 && displacement < 128};
+    uint8_t const mode{shortDisplacement ? uint8_t{0x40} : uint8_t{0x80}};
+
+    bytes({
+        0xF2,
+        0x0F,
+        static_cast<uint8_t>(operation),
+        static_cast<uint8_t>(mode | (xmm << 3U) | static_cast<uint8_t>(base)),
+    });
+    if (shortDisplacement)
+    {
+        m_code.push_back(static_cast<uint8_t>(displacement));
+    }
+    else
+    {
+        immediate32(static_cast<uint32_t>(displacement));
+    }
+}
+
+void Emitter::load(uint32_t const slot)
+{
+    if (m_accumulator == slot)
+    {
+        return;
+    }
+    sse(Sse::Load, 0, slot);
+    m_accumulator = slot;
+}
+
+void Emitter::store(uint32_t const slot)
+{
+    sse(Sse::Store, 0, slot);
+    m_accumulator = slot;
+}
+
+void Emitter::patch(size_t const offset, size_t const target)
+{
+    // Relative to the end of the four byte displacement being patched.
+    auto const relative{static_cast<uint32_t>(
+        static_cast<int64_t>(target) - static_cast<int64_t>(offset + 4)
+    )};
+    for (size_t index = 0; index < 4; index++)
+    {
+        m_code[offset + index] = static_cast<uint8_t>(relative >> (8 * index));
+    }
+}
+
+auto Emitter::frameSize() const -> uint32_t
+{
+    size_t const slots{1 + m_program.registerCount()};
+    return static_cast<uint32_t>((8 * slots + 15) & ~size_t{15});
+}
+} // namespace
+#endif
+
+NativeFunction::NativeFunction(
+    std::shared_ptr<Image const> image, size_t const single, size_t const batch
+)
+    : m_image(std::move(image))
+{
+    auto const* const code{static_cast<uint8_t const*>(m_image->code)};
+    m_single = std::bit_cast<Single>(code + single);
+    m_batch = std::bit_cast<Batch>(code + batch);
+}
+
+auto NativeFunction::supported() -> bool { return CALQ_NATIVE_CODE != 0; }
+
+auto NativeFunction::compile([[maybe_unused]] Program const& program)
+    -> std::optional<NativeFunction>
+{
+#if CALQ_NATIVE_CODE
+    auto image{std::make_shared<Image>()};
+    for (auto const& constant : program.constants())
+    {
+        image->constants.push_back(constant.toDouble());
+    }
+    image->constants.push_back(-0.0);
+
+    Emitter emitter{program, image->constants.data()};
+    size_t const single{emitter.single()};
+    size_t const batch{emitter.batch()};
+    auto const& code{emitter.code()};
+
+    // Written while writable, then made executable, never both at once.
+    void* const mapping{mmap(
+        nullptr,
+        code.size(),
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    )};
+    if (mapping == MAP_FAILED)
+    {
+        return std::nullopt;
+    }
+    image->code = mapping;
+    image->size = code.size();
+
+    std::memcpy(mapping, code.data(), code.size());
+    if (mprotect(mapping, code.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+        return std::nullopt;
+    }
+
+    return NativeFunction{std::move(image), single, batch};
+#else
+    return std::nullopt;
+#endif
+}
+
+auto NativeFunction::compile(Expression const& expression)
+    -> std::optional<NativeFunction>
+{
+    if (!supported())
+    {
+        return std::nullopt;
+    }
+
+    auto const program{Program::compile(expression)};
+    if (!program.has_value())
+    {
+        return std::nullopt;
+    }
+    return compile(program.value());
+}
+
+auto NativeFunction::operator()(double const variable) const -> double
+{
+    return m_single(variable);
+}
+
+auto NativeFunction::evaluateMany(
+    std::span<double const> const variables, std::span<double> const results
+) const -> bool
+{
+    if (variables.size() != results.size())
+    {
+        return false;
+    }
+
+    m_batch(variables.data(), results.data(), variables.size());
+    return true;
+}
+
+auto NativeFunction::single() const -> Single { return m_single; }
+
+auto NativeFunction::batch() const -> Batch { return m_batch; }
+} // namespace calqmath
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "bytecode.h"
+#include "expression.h"
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+
+namespace calqmath
+{
+/**
+ * @brief A Program translated to machine code for hardware doubles.
+ *
+ * Every instruction becomes a few SSE2 instructions over a stack frame laid
+ * out like the register file of a VirtualMachine, so there is no dispatch
+ * left, and results are identical to VirtualMachine::run(double). Functions
+ * are called directly through their doubleFunction.
+ *
+ * Code is only generated for x86-64 with the System V calling convention.
+ * Elsewhere compile returns nullopt, and callers keep using the interpreter.
+ *
+ * The generated code is immutable, so a function may be called from several
+ * threads at once, and copies share it. Functions must not throw.
+ */
+class NativeFunction
+{
+public:
+    using Single = double (*)(double variable);
+    using Batch = void (*)(double const* variables, double* results, size_t);
+
+    // Whether this build can generate code at all.
+    static auto supported() -> bool;
+
+    /**
+     * @brief compile - Generates code for a program.
+     * @return The function, or nullopt if code generation is not supported
+     * or the code could not be mapped.
+     */
+    static auto compile(Program const& program)
+        -> std::optional<NativeFunction>;
+    static auto compile(Expression const& expression)
+        -> std::optional<NativeFunction>;
+
+    auto operator()(double variable) const -> double;
+
+    /**
+     * @brief evaluateMany - Evaluates results[i] = f(variables[i]) in one
+     * call into the generated loop.
+     * @return Whether results were written. False if the sizes differ.
+     */
+    [[nodiscard]] auto evaluateMany(
+        std::span<double const> variables, std::span<double> results
+    ) const -> bool;
+
+    // Entry points, valid for as long as a copy of this function exists.
+    [[nodiscard]] auto single() const -> Single;
+    [[nodiscard]] auto batch() const -> Batch;
+
+private:
+    struct Image;
+
+    NativeFunction(
+        std::shared_ptr<Image const> image, size_t single, size_t batch
+    );
+
+    std::shared_ptr<Image const> m_image;
+    Single m_single{nullptr};
+    Batch m_batch{nullptr};
+};
+} // namespace calqmath
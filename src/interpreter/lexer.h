@@ -1,63 +1,59 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <optional>
-#include <string>
-#include <variant>
+#include <string_view>
 #include <vector>
 
 namespace calqmath
 {
-// Function name identifier. We have no general identifier type.
-struct TokenIdentifier
-{
-    std::string m_functionName;
-};
-
-/*
- * Number literal. The only literals right now are decimals of the form
- * "123.456", "-123.456", "123.", ".456", or "123".
- */
-struct TokenNumber
-{
-    std::string m_decimalRepresentation;
-};
-
-// Operators, of any n-nary-ness
-enum class TokenOperator : uint8_t
+enum class TokenKind : uint8_t
 {
+    // Function name identifier. We have no general identifier type.
+    Identifier,
+    /*
+     * Number literal. The only literals right now are decimals of the form
+     * "123.456", "123.", ".456", or "123". Signs are separate operators.
+     */
+    Number,
+    /*
+     * Split up the bracket types, since they are fundamentally different and
+     * not semantically interchangeable. This simplifies parsing.
+     */
+    OpenBracket,
+    ClosedBracket,
+    // Separates the arguments of a function call.
+    Comma,
+    // Operators, of any n-nary-ness
     Plus,
     Minus,
     Multiply,
     Divide
 };
 
-/*
- * Split up the bracket types, since they are fundamentally different and not
- * semantically interchangeable. This simplifies parsing.
+/**
+ * @brief A token as a slice of the source it was lexed from.
+ *
+ * Tokens own nothing, so the source must outlive them. They are small plain
+ * values, so a stream of them is one flat allocation.
  */
-
-struct TokenOpenBracket
+struct Token
 {
-};
+    TokenKind kind;
+    uint32_t offset;
+    uint32_t length;
 
-struct TokenClosedBracket
-{
-};
-
-using Token = std::variant<
-    TokenIdentifier,
-    TokenNumber,
-    TokenOpenBracket,
-    TokenClosedBracket,
-    TokenOperator>;
+    // The characters of the token, within the source it was lexed from.
+    [[nodiscard]] constexpr auto text(std::string_view const source) const
+        -> std::string_view
+    {
+        return source.substr(offset, length);
+    }
 
-auto operator==(TokenIdentifier const& lhs, TokenIdentifier const& rhs) -> bool;
-auto operator==(TokenNumber const& lhs, TokenNumber const& rhs) -> bool;
-auto operator==(TokenOpenBracket const& lhs, TokenOpenBracket const& rhs)
-    -> bool;
-auto operator==(TokenClosedBracket const& lhs, TokenClosedBracket const& rhs)
-    -> bool;
+    auto operator==(Token const& rhs) const -> bool = default;
+};
 
 /**
  * A lexer geared heavily towards the sort of input for a calculator, not a
@@ -67,16 +63,160 @@ auto operator==(TokenClosedBracket const& lhs, TokenClosedBracket const& rhs)
  * mathematical expression into an array of tokens.
  *
  * For example, "5.0+(7.0--5.0)" becomes ["5.0","+","(","7.0","-","-",
- * "5.0",")"]. This example uses strings, but the tokens are actual values,
- * see calqmath::Token.
+ * "5.0",")"]. This example uses strings, but the tokens are offsets into the
+ * input, see calqmath::Token.
+ *
+ * The input is scanned once and never copied. Whitespace separates tokens and
+ * is otherwise skipped.
  *
  * The grammar is not known at this stage, so incorrect streams may be
  * emitted. For example, several literals in a row with no operators.
+ *
+ * Lexing is constexpr, so that expressions fixed at compile time are read by
+ * the same code, see StaticExpression.
  */
 class Lexer
 {
 public:
-    static auto convert(std::string const& rawInput)
+    static constexpr auto convert(std::string_view source)
         -> std::optional<std::vector<Token>>;
+
+private:
+    /*
+     * Finds the end of the token starting at begin, or returns nullopt if no
+     * token starts there.
+     */
+    static constexpr auto
+    scanToken(std::string_view source, size_t begin, TokenKind& kind)
+        -> std::optional<size_t>;
+
+    // Character classes, for ASCII only regardless of locale.
+    static constexpr auto isAlpha(char character) -> bool;
+    static constexpr auto isDigit(char character) -> bool;
+    static constexpr auto isSpace(char character) -> bool;
 };
+
+constexpr auto Lexer::isAlpha(char const character) -> bool
+{
+    return (character >= 'a' && character <= 'z')
+        || (character >= 'A' && character <= 'Z');
+}
+
+constexpr auto Lexer::isDigit(char const character) -> bool
+{
+    return character >= '0' && character <= '9';
+}
+
+constexpr auto Lexer::isSpace(char const character) -> bool
+{
+    return character == ' ' || (character >= '\t' && character <= '\r');
+}
+
+constexpr auto Lexer::scanToken(
+    std::string_view const source, size_t const begin, TokenKind& kind
+) -> std::optional<size_t>
+{
+    char constexpr decimal{'.'};
+
+    char const character{source[begin]};
+    size_t end{begin + 1};
+
+    switch (character)
+    {
+    case '+':
+        kind = TokenKind::Plus;
+        return end;
+    case '-':
+        kind = TokenKind::Minus;
+        return end;
+    case '*':
+        kind = TokenKind::Multiply;
+        return end;
+    case '/':
+        kind = TokenKind::Divide;
+        return end;
+    case '(':
+        kind = TokenKind::OpenBracket;
+        return end;
+    case ')':
+        kind = TokenKind::ClosedBracket;
+        return end;
+    case ',':
+        kind = TokenKind::Comma;
+        return end;
+    default:
+        break;
+    }
+
+    if (isAlpha(character))
+    {
+        while (end < source.size()
+               && (isAlpha(source[end]) || isDigit(source[end])))
+        {
+            end++;
+        }
+        kind = TokenKind::Identifier;
+        return end;
+    }
+
+    if (isDigit(character) || character == decimal)
+    {
+        bool fractional{character == decimal};
+        while (end < source.size()
+               && (isDigit(source[end])
+                   || (source[end] == decimal && !fractional)))
+        {
+            fractional |= source[end] == decimal;
+            end++;
+        }
+
+        if (end - begin == 1 && character == decimal)
+        {
+            return std::nullopt;
+        }
+
+        kind = TokenKind::Number;
+        return end;
+    }
+
+    return std::nullopt;
+}
+
+constexpr auto Lexer::convert(std::string_view const source)
+    -> std::optional<std::vector<Token>>
+{
+    // Offsets are stored narrow to keep tokens small.
+    if (source.size() > std::numeric_limits<uint32_t>::max())
+    {
+        return std::nullopt;
+    }
+
+    std::vector<Token> tokens{};
+
+    size_t position{0};
+    while (position < source.size())
+    {
+        if (isSpace(source[position]))
+        {
+            position++;
+            continue;
+        }
+
+        TokenKind kind{};
+        auto const end{scanToken(source, position, kind)};
+        if (!end.has_value())
+        {
+            return std::nullopt;
+        }
+
+        tokens.push_back(Token{
+            .kind = kind,
+            .offset = static_cast<uint32_t>(position),
+            .length = static_cast<uint32_t>(end.value() - position),
+        });
+        position = end.value();
+    }
+
+    return tokens;
+}
 } // namespace calqmath
@@ -1,84 +1,44 @@
 #include "parser.h"
 
-#include <deque>
-#include <stack>
 #include <utility>
-#include <variant>
-
-template <class... Ts> struct overloads : Ts...
-{
-    using Ts::operator()...;
-};
 
 namespace
 {
-auto tokenToOperator(calqmath::TokenOperator const token) -> calqmath::BinaryOp
+auto tokenToOperator(calqmath::TokenKind const kind)
+    -> std::optional<calqmath::BinaryOp>
 {
-    switch (token)
+    switch (kind)
     {
-    case calqmath::TokenOperator::Plus:
+    case calqmath::TokenKind::Plus:
         return calqmath::BinaryOp::Plus;
-    case calqmath::TokenOperator::Minus:
+    case calqmath::TokenKind::Minus:
         return calqmath::BinaryOp::Minus;
-    case calqmath::TokenOperator::Multiply:
+    case calqmath::TokenKind::Multiply:
         return calqmath::BinaryOp::Multiply;
-    case calqmath::TokenOperator::Divide:
+    case calqmath::TokenKind::Divide:
         return calqmath::BinaryOp::Divide;
+    default:
+        return std::nullopt;
     }
-    std::unreachable();
-}
-
-auto tokenIsOperator(calqmath::Token const& token) -> bool
-{
-    auto const* const pOperator = std::get_if<calqmath::TokenOperator>(&token);
-    return pOperator != nullptr;
-}
-auto tokenIsMinus(calqmath::Token const& token) -> bool
-{
-    auto const* const pOperator = std::get_if<calqmath::TokenOperator>(&token);
-
-    return pOperator != nullptr
-        && (*pOperator) == calqmath::TokenOperator::Minus;
-}
-
-auto tokenIsIdentifier(calqmath::Token const& token) -> bool
-{
-    auto const* const pIdentifier =
-        std::get_if<calqmath::TokenIdentifier>(&token);
-    return pIdentifier != nullptr;
-}
-
-auto tokenIsOpenBracket(calqmath::Token const& token) -> bool
-{
-    auto const* const pOpenBracket =
-        std::get_if<calqmath::TokenOpenBracket>(&token);
-    return pOpenBracket != nullptr;
-}
-
-auto tokenIsClosedBracket(calqmath::Token const& token) -> bool
-{
-    auto const* const pClosedBracket =
-        std::get_if<calqmath::TokenClosedBracket>(&token);
-    return pClosedBracket != nullptr;
-}
-
-auto tokenIsNumber(calqmath::Token const& token) -> bool
-{
-    auto const* const pNumber = std::get_if<calqmath::TokenNumber>(&token);
-    return pNumber != nullptr;
 }
 } // namespace
 
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 auto calqmath::Parser::parse(
-    FunctionDatabase const& functions, std::span<Token const> const input
+    FunctionDatabase const& functions,
+    std::string_view const source,
+    std::span<Token const> const tokens
 ) -> std::optional<calqmath::Expression>
 {
-    std::optional<Expression> result{Expression{}};
+    ExpressionBuilder builder{};
 
-    std::stack<Expression*> depthStack{{&result.value()}};
+    // The number of groups open within the builder's outermost one.
+    size_t depth{0};
 
-    std::deque<Token> tokens{input.begin(), input.end()};
+    // Tokens are consumed from the front by advancing this cursor.
+    size_t next{0};
+    auto const nextIs = [&](TokenKind const kind)
+    { return next < tokens.size() && tokens[next].kind == kind; };
 
     /*
      * This flag controls whether or not the next token is expected to initiate
@@ -97,26 +57,25 @@ auto calqmath::Parser::parse(
      */
     bool expectNewTerm = true;
 
-    while (!tokens.empty())
+    while (next < tokens.size())
     {
         if (expectNewTerm)
         {
-            bool const negate{::tokenIsMinus(tokens.front())};
+            bool const negate{nextIs(TokenKind::Minus)};
             if (negate)
             {
-                tokens.pop_front();
+                next++;
             }
 
-            if (tokens.empty())
+            if (next == tokens.size())
             {
                 return std::nullopt;
             }
 
-            if (::tokenIsIdentifier(tokens.front())
-                && std::get<TokenIdentifier>(tokens.front()).m_functionName
-                       == InputVariable::RESERVED_NAME)
+            if (nextIs(TokenKind::Identifier)
+                && tokens[next].text(source) == InputVariable::RESERVED_NAME)
             {
-                tokens.pop_front();
+                next++;
 
                 // Variable 'x' appears where we expect a new term. E.g,
                 // semantically swap like 5+2 <-> 5+x.
@@ -124,41 +83,31 @@ auto calqmath::Parser::parse(
                 {
                     // Eventually this should not be an error, something like 5
                     // * -x should be allowed. But, we don't want to handle that
-                    // yet.                                        return
+                    // yet.
 
                     return std::nullopt;
                 }
 
-                depthStack.top()->backTerm() = InputVariable{};
+                builder.variable();
                 expectNewTerm = false;
             }
-            else if (::tokenIsIdentifier(tokens.front())
-                     || ::tokenIsOpenBracket(tokens.front()))
+            else if (nextIs(TokenKind::Identifier)
+                     || nextIs(TokenKind::OpenBracket))
             {
-                std::optional<std::string> functionName{};
-                if (::tokenIsIdentifier(tokens.front()))
+                std::optional<std::string_view> functionName{};
+                if (nextIs(TokenKind::Identifier))
                 {
-                    TokenIdentifier const token{
-                        std::get<TokenIdentifier>(tokens.front())
-                    };
-                    tokens.pop_front();
-
-                    functionName = token.m_functionName;
+                    functionName = tokens[next].text(source);
+                    next++;
                 }
 
-                if (tokens.empty() || !::tokenIsOpenBracket(tokens.front()))
+                if (!nextIs(TokenKind::OpenBracket))
                 {
                     return std::nullopt;
                 }
-                tokens.pop_front();
-
-                auto& newExpression = std::get<Expression>(
-                    depthStack.top()->backTerm() = Expression{}
-                );
-                depthStack.push(&newExpression);
-
-                newExpression.setNegate(negate);
+                next++;
 
+                FunctionId function{NO_FUNCTION};
                 if (functionName.has_value())
                 {
                     auto functionLookup{functions.lookup(functionName.value())};
@@ -167,27 +116,24 @@ auto calqmath::Parser::parse(
                         return std::nullopt;
                     }
 
-                    newExpression.setFunction(std::move(functionLookup).value()
-                    );
+                    function = functionLookup.value();
                 }
 
+                builder.openGroup(negate, function);
+                depth++;
+
                 expectNewTerm = true;
             }
-            else if (::tokenIsNumber(tokens.front()))
+            else if (nextIs(TokenKind::Number))
             {
-                TokenNumber const number{std::get<TokenNumber>(tokens.front())};
-                tokens.pop_front();
+                Scalar number{tokens[next].text(source)};
+                next++;
 
                 if (negate)
                 {
-                    depthStack.top()->backTerm() =
-                        -Scalar{number.m_decimalRepresentation};
-                }
-                else
-                {
-                    depthStack.top()->backTerm() =
-                        Scalar{number.m_decimalRepresentation};
+                    number = -number;
                 }
+                builder.literal(std::move(number));
 
                 expectNewTerm = false;
             }
@@ -199,44 +145,47 @@ auto calqmath::Parser::parse(
             continue;
         }
 
-        if (tokens.empty())
+        if (auto const mathOperator{::tokenToOperator(tokens[next].kind)};
+            mathOperator.has_value())
         {
-            return std::nullopt;
-        }
-
-        if (::tokenIsOperator(tokens.front()))
-        {
-            BinaryOp const mathOperator{
-                ::tokenToOperator(std::get<TokenOperator>(tokens.front()))
-            };
-            tokens.pop_front();
+            next++;
 
-            depthStack.top()->append(mathOperator);
+            builder.binaryOperator(mathOperator.value());
             expectNewTerm = true;
         }
-        else if (::tokenIsClosedBracket(tokens.front())
-                 && depthStack.size() > 1)
+        else if (nextIs(TokenKind::ClosedBracket) && depth > 0)
         {
-            tokens.pop_front();
+            next++;
 
-            depthStack.pop();
+            if (!builder.closeGroup())
+            {
+                return std::nullopt;
+            }
+            depth--;
             expectNewTerm = false;
         }
+        else if (nextIs(TokenKind::Comma) && depth > 0)
+        {
+            next++;
+
+            // The builder checks that the group is a call taking another
+            // argument.
+            if (!builder.separator())
+            {
+                return std::nullopt;
+            }
+            expectNewTerm = true;
+        }
         else
         {
             return std::nullopt;
         }
     }
 
-    if (expectNewTerm || depthStack.size() > 1)
+    if (expectNewTerm || depth > 0)
     {
         return std::nullopt;
     }
 
-    if (result.has_value())
-    {
-        result->cacheHasVariable();
-    }
-
-    return result;
+    return builder.finish();
 }
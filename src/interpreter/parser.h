@@ -3,6 +3,7 @@
 #include "expression.h"
 #include "lexer.h"
 #include <span>
+#include <string_view>
 
 namespace calqmath
 {
@@ -13,12 +14,17 @@ namespace calqmath
  * Converts a stream of mathematical tokens into an AST that can be evaluated to
  * result. A grammer is enforced, see calqmath::Interpreter for a specification
  * of the grammar.
+ *
+ * The tokens must have been lexed from source, which is where identifiers and
+ * literals are read from.
  */
 class Parser
 {
 public:
-    static auto
-    parse(FunctionDatabase const& functions, std::span<Token const> input)
-        -> std::optional<Expression>;
+    static auto parse(
+        FunctionDatabase const& functions,
+        std::string_view source,
+        std::span<Token const> tokens
+    ) -> std::optional<Expression>;
 };
 } // namespace calqmath
@@ -0,0 +1,785 @@
+#pragma once
+
+#include "expression.h"
+#include "function_database.h"
+#include "lexer.h"
+#include "math/functions.h"
+#include "math/number.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace calqmath
+{
+/**
+ * @brief A string literal that can be passed as a template argument.
+ */
+template <size_t N> struct FixedString
+{
+    // Implicit, so that a literal can be written where one is expected.
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    constexpr FixedString(char const (&source)[N])
+    {
+        std::copy_n(source, N, characters.begin());
+    }
+
+    [[nodiscard]] constexpr auto view() const -> std::string_view
+    {
+        return {characters.data(), N - 1};
+    }
+
+    std::array<char, N> characters{};
+};
+
+namespace detail
+{
+enum class StaticNodeKind : uint8_t
+{
+    Literal,
+    Variable,
+    // A bracketed group, a sum of products as in Expression.
+    Group,
+};
+
+uint8_t constexpr NO_STATIC_FUNCTION = 0xFF;
+uint32_t constexpr NO_STATIC_SLOT = 0xFFFFFFFF;
+
+/*
+ * A node of an expression parsed at compile time. Literals keep their range
+ * of the source, since they are only converted once a precision is known.
+ * Groups refer to a range of summands, and summands to a range of factors.
+ *
+ * A group with several parents has a slot, its value is computed once per
+ * evaluation into it.
+ */
+struct StaticNode
+{
+    StaticNodeKind kind{StaticNodeKind::Literal};
+    bool negate{false};
+    uint8_t function{NO_STATIC_FUNCTION};
+    uint32_t begin{0};
+    uint32_t count{0};
+    uint32_t slot{NO_STATIC_SLOT};
+};
+
+struct StaticSummand
+{
+    bool subtract{false};
+    uint32_t begin{0};
+    uint32_t count{0};
+};
+
+struct StaticFactor
+{
+    bool divide{false};
+    uint32_t node{0};
+};
+
+#define CALQ_STATIC_NAME(func) std::string_view{#func},
+#define CALQ_STATIC_SCALAR(func)                                               \
+    static_cast<UnaryFunction::ScalarFunction>(Functions::func),
+#define CALQ_STATIC_DOUBLE(func)                                               \
+    static_cast<double (*)(double)>(Functions::func),
+
+// The default unary functions of FunctionDatabase, indexed by FunctionId.
+inline constexpr std::array STATIC_FUNCTION_NAMES{
+    CALQ_DEFAULT_UNARY_FUNCTIONS(CALQ_STATIC_NAME)
+};
+inline constexpr std::array STATIC_SCALAR_FUNCTIONS{
+    CALQ_DEFAULT_UNARY_FUNCTIONS(CALQ_STATIC_SCALAR)
+};
+inline constexpr std::array STATIC_DOUBLE_FUNCTIONS{
+    CALQ_DEFAULT_UNARY_FUNCTIONS(CALQ_STATIC_DOUBLE)
+};
+
+#undef CALQ_STATIC_NAME
+#undef CALQ_STATIC_SCALAR
+#undef CALQ_STATIC_DOUBLE
+
+/*
+ * An expression parsed at compile time, in arrays sized for the worst case of
+ * one node per character. Children come before their parents, and the root is
+ * the last node. Identical subtrees are stored once, as in Expression.
+ */
+template <size_t Capacity> struct StaticTree
+{
+    std::array<StaticNode, Capacity> nodes{};
+    std::array<StaticSummand, Capacity> summands{};
+    std::array<StaticFactor, Capacity> factors{};
+    // The node of every slot, in the order they are computed.
+    std::array<uint32_t, Capacity> shared{};
+    uint32_t nodeCount{0};
+    uint32_t summandCount{0};
+    uint32_t factorCount{0};
+    uint32_t sharedCount{0};
+    bool valid{false};
+
+    [[nodiscard]] constexpr auto root() const -> uint32_t
+    {
+        return nodeCount - 1;
+    }
+};
+
+/*
+ * Recursive descent over the grammar of Parser, see Interpreter, accepting
+ * exactly the inputs it accepts and grouping them the same way. Every group
+ * is a sum of products, with the first term of each never inverted.
+ */
+template <size_t Capacity> class StaticParser
+{
+public:
+    constexpr StaticParser(
+        std::string_view const source, std::vector<Token> const& tokens
+    )
+        : m_source(source)
+        , m_tokens(tokens)
+    {
+    }
+
+    constexpr auto parse() -> StaticTree<Capacity>
+    {
+        m_tree.valid = group(false, false, NO_STATIC_FUNCTION).has_value()
+                    && m_next == m_tokens.size();
+        if (m_tree.valid)
+        {
+            assignSlots();
+        }
+        return m_tree;
+    }
+
+private:
+    [[nodiscard]] constexpr auto nextIs(TokenKind const kind) const -> bool
+    {
+        return m_next < m_tokens.size() && m_tokens[m_next].kind == kind;
+    }
+
+    // Adds a node, or finds an identical one and drops this one's operands.
+    constexpr auto node(StaticNode const& node) -> uint32_t
+    {
+        for (uint32_t index = 0; index < m_tree.nodeCount; index++)
+        {
+            if (!sameNode(m_tree.nodes[index], node))
+            {
+                continue;
+            }
+            if (node.kind == StaticNodeKind::Group)
+            {
+                m_tree.factorCount = m_tree.summands[node.begin].begin;
+                m_tree.summandCount = node.begin;
+            }
+            return index;
+        }
+
+        m_tree.nodes[m_tree.nodeCount] = node;
+        return m_tree.nodeCount++;
+    }
+
+    // Operands are compared by index, since they were found the same way.
+    [[nodiscard]] constexpr auto
+    sameNode(StaticNode const& lhs, StaticNode const& rhs) const -> bool
+    {
+        if (lhs.kind != rhs.kind || lhs.negate != rhs.negate
+            || lhs.function != rhs.function || lhs.count != rhs.count)
+        {
+            return false;
+        }
+
+        switch (lhs.kind)
+        {
+        case StaticNodeKind::Variable:
+            return true;
+        case StaticNodeKind::Literal:
+            return m_source.substr(lhs.begin, lhs.count)
+                == m_source.substr(rhs.begin, rhs.count);
+        case StaticNodeKind::Group:
+            break;
+        }
+
+        for (uint32_t index = 0; index < lhs.count; index++)
+        {
+            StaticSummand const& left{m_tree.summands[lhs.begin + index]};
+            StaticSummand const& right{m_tree.summands[rhs.begin + index]};
+            if (left.subtract != right.subtract || left.count != right.count)
+            {
+                return false;
+            }
+            for (uint32_t factor = 0; factor < left.count; factor++)
+            {
+                StaticFactor const& a{m_tree.factors[left.begin + factor]};
+                StaticFactor const& b{m_tree.factors[right.begin + factor]};
+                if (a.divide != b.divide || a.node != b.node)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Gives every group used more than once a slot, children first.
+    constexpr void assignSlots()
+    {
+        std::array<uint32_t, Capacity> uses{};
+        for (uint32_t index = 0; index < m_tree.factorCount; index++)
+        {
+            uses[m_tree.factors[index].node]++;
+        }
+
+        for (uint32_t index = 0; index < m_tree.nodeCount; index++)
+        {
+            StaticNode& node{m_tree.nodes[index]};
+            if (node.kind == StaticNodeKind::Group && uses[index] > 1)
+            {
+                node.slot = m_tree.sharedCount;
+                m_tree.shared[m_tree.sharedCount++] = index;
+            }
+        }
+    }
+
+    // The terms of a group up to its closing bracket, or the end if it is the
+    // outermost one.
+    constexpr auto group(bool nested, bool negate, uint8_t function)
+        -> std::optional<uint32_t>
+    {
+        // Summands, each a list of factors, as they are read.
+        std::vector<std::pair<bool, std::vector<StaticFactor>>> summands{};
+        summands.emplace_back(false, std::vector<StaticFactor>{});
+
+        bool divide{false};
+        while (true)
+        {
+            auto const operand{term()};
+            if (!operand.has_value())
+            {
+                return std::nullopt;
+            }
+            summands.back().second.push_back(StaticFactor{
+                .divide = divide,
+                .node = operand.value(),
+            });
+
+            if (m_next == m_tokens.size())
+            {
+                if (nested)
+                {
+                    return std::nullopt;
+                }
+                break;
+            }
+            if (nextIs(TokenKind::ClosedBracket))
+            {
+                if (!nested)
+                {
+                    return std::nullopt;
+                }
+                m_next++;
+                break;
+            }
+
+            TokenKind const mathOperator{m_tokens[m_next].kind};
+            m_next++;
+            divide = mathOperator == TokenKind::Divide;
+            if (mathOperator == TokenKind::Plus
+                || mathOperator == TokenKind::Minus)
+            {
+                summands.emplace_back(
+                    mathOperator == TokenKind::Minus,
+                    std::vector<StaticFactor>{}
+                );
+            }
+            else if (mathOperator != TokenKind::Multiply && !divide)
+            {
+                return std::nullopt;
+            }
+        }
+
+        auto const begin{m_tree.summandCount};
+        for (auto const& [subtract, factors] : summands)
+        {
+            m_tree.summands[m_tree.summandCount++] = StaticSummand{
+                .subtract = subtract,
+                .begin = m_tree.factorCount,
+                .count = static_cast<uint32_t>(factors.size()),
+            };
+            for (auto const& factor : factors)
+            {
+                m_tree.factors[m_tree.factorCount++] = factor;
+            }
+        }
+
+        return node(StaticNode{
+            .kind = StaticNodeKind::Group,
+            .negate = negate,
+            .function = function,
+            .begin = begin,
+            .count = static_cast<uint32_t>(summands.size()),
+        });
+    }
+
+    constexpr auto term() -> std::optional<uint32_t>
+    {
+        bool const negate{nextIs(TokenKind::Minus)};
+        if (negate)
+        {
+            m_next++;
+        }
+
+        if (nextIs(TokenKind::Identifier)
+            && m_tokens[m_next].text(m_source)
+                   == InputVariable::RESERVED_NAME)
+        {
+            m_next++;
+            if (negate)
+            {
+                return std::nullopt;
+            }
+            return node(StaticNode{.kind = StaticNodeKind::Variable});
+        }
+
+        if (nextIs(TokenKind::Identifier) || nextIs(TokenKind::OpenBracket))
+        {
+            uint8_t function{NO_STATIC_FUNCTION};
+            if (nextIs(TokenKind::Identifier))
+            {
+                auto const name{m_tokens[m_next].text(m_source)};
+                auto const found{std::ranges::find(STATIC_FUNCTION_NAMES, name)
+                };
+                if (found == STATIC_FUNCTION_NAMES.end())
+                {
+                    return std::nullopt;
+                }
+                function = static_cast<uint8_t>(
+                    found - STATIC_FUNCTION_NAMES.begin()
+                );
+                m_next++;
+            }
+
+            if (!nextIs(TokenKind::OpenBracket))
+            {
+                return std::nullopt;
+            }
+            m_next++;
+
+            return group(true, negate, function);
+        }
+
+        if (nextIs(TokenKind::Number))
+        {
+            Token const& token{m_tokens[m_next]};
+            m_next++;
+            return node(StaticNode{
+                .kind = StaticNodeKind::Literal,
+                .negate = negate,
+                .begin = token.offset,
+                .count = token.length,
+            });
+        }
+
+        return std::nullopt;
+    }
+
+    std::string_view m_source;
+    std::vector<Token> const& m_tokens;
+    size_t m_next{0};
+    StaticTree<Capacity> m_tree{};
+};
+
+template <size_t Capacity>
+constexpr auto parseStatic(std::string_view const source)
+    -> StaticTree<Capacity>
+{
+    auto const tokens{Lexer::convert(source)};
+    if (!tokens.has_value())
+    {
+        return {};
+    }
+    return StaticParser<Capacity>{source, tokens.value()}.parse();
+}
+
+/*
+ * The nearest double to a decimal literal, when a single rounding suffices:
+ * the significant digits fit a double exactly, and so does the power of ten
+ * they are scaled by. Otherwise nullopt.
+ */
+constexpr auto staticDouble(std::string_view const text)
+    -> std::optional<double>
+{
+    uint64_t constexpr EXACT_LIMIT{uint64_t{1} << 53U};
+    int constexpr EXACT_POWERS{22};
+
+    uint64_t significand{0};
+    int exponent{0};
+    bool fractional{false};
+    for (char const character : text)
+    {
+        if (character == '.')
+        {
+            fractional = true;
+            continue;
+        }
+        if (significand >= EXACT_LIMIT / 10)
+        {
+            return std::nullopt;
+        }
+        significand = 10 * significand + uint64_t(character - '0');
+        exponent -= fractional ? 1 : 0;
+    }
+
+    if (exponent < -EXACT_POWERS)
+    {
+        return std::nullopt;
+    }
+
+    double power{1.0};
+    for (int index = 0; index < -exponent; index++)
+    {
+        power *= 10.0;
+    }
+    return static_cast<double>(significand) / power;
+}
+} // namespace detail
+
+/**
+ * @brief An expression parsed entirely at compile time, evaluated by code
+ * specialized to it.
+ *
+ * The source is read by the same Lexer and accepted by the same grammar as
+ * Parser, and an invalid source fails to compile. Evaluation is a chain of
+ * direct calls with no tree to walk, so the compiler can inline and schedule
+ * it like hand written code. Functions are the unary defaults of
+ * FunctionDatabase, so sources calling pow and the other functions of several
+ * arguments fail to compile. Shared subexpressions are computed once per
+ * evaluation, as in Expression.
+ *
+ * Scalar evaluation orders and fuses operations exactly as
+ * Expression::evaluate does. Literals are parsed at the working precision the
+ * first time it is seen on each thread, and constant groups are evaluated
+ * rather than folded in advance.
+ *
+ * Double evaluation matches Expression::evaluate(double) except in constant
+ * groups, which Expression folds at working precision before rounding.
+ * Literals are converted at compile time where a single rounding suffices,
+ * and once at first use otherwise.
+ */
+template <FixedString Source> class StaticExpression
+{
+public:
+    auto operator()(double const variable) const -> double
+    {
+        return evaluate(variable);
+    }
+
+    auto operator()(Scalar const& variable) const -> Scalar
+    {
+        return evaluate(variable);
+    }
+
+private:
+    static constexpr auto TREE{
+        detail::parseStatic<Source.view().size() + 1>(Source.view())
+    };
+    static_assert(TREE.valid, "Not a valid expression");
+
+    // The values of shared groups, by slot.
+    template <typename T> using Values = std::array<T, TREE.sharedCount>;
+
+    template <typename T> static auto evaluate(T const& variable) -> T
+    {
+        // Shared groups first, each after the shared groups within it.
+        Values<T> values;
+        [&]<uint32_t... Slot>(std::integer_sequence<uint32_t, Slot...>)
+        {
+            ((values[Slot] = compute<TREE.shared[Slot]>(variable, values)),
+             ...);
+        }(std::make_integer_sequence<uint32_t, TREE.sharedCount>{});
+
+        return node<TREE.root()>(variable, values);
+    }
+
+    template <uint32_t Index, typename T>
+    static auto node(T const& variable, Values<T> const& values) -> T
+    {
+        constexpr uint32_t SLOT{TREE.nodes[Index].slot};
+        if constexpr (SLOT != detail::NO_STATIC_SLOT)
+        {
+            return values[SLOT];
+        }
+        else
+        {
+            return compute<Index>(variable, values);
+        }
+    }
+
+    template <uint32_t Index, typename T>
+    static auto compute(T const& variable, Values<T> const& values) -> T
+    {
+        constexpr detail::StaticNode NODE{TREE.nodes[Index]};
+
+        if constexpr (NODE.kind == detail::StaticNodeKind::Variable)
+        {
+            return variable;
+        }
+        else if constexpr (NODE.kind == detail::StaticNodeKind::Literal)
+        {
+            return literal<Index>(variable);
+        }
+        else
+        {
+            T result{sum<Index>(variable, values)};
+            if constexpr (NODE.function != detail::NO_STATIC_FUNCTION)
+            {
+                if constexpr (std::is_same_v<T, double>)
+                {
+                    result = detail::STATIC_DOUBLE_FUNCTIONS[NODE.function](
+                        result
+                    );
+                }
+                else
+                {
+                    detail::STATIC_SCALAR_FUNCTIONS[NODE.function](
+                        result, result, MathContext::current()
+                    );
+                }
+            }
+            if constexpr (NODE.negate && std::is_same_v<T, double>)
+            {
+                result = -result;
+            }
+            else if constexpr (NODE.negate)
+            {
+                Functions::negate(result, result);
+            }
+            return result;
+        }
+    }
+
+    template <uint32_t Index> static auto literal(double /*variable*/) -> double
+    {
+        constexpr detail::StaticNode NODE{TREE.nodes[Index]};
+        constexpr auto TEXT{Source.view().substr(NODE.begin, NODE.count)};
+        constexpr auto VALUE{detail::staticDouble(TEXT)};
+
+        double result{0.0};
+        if constexpr (VALUE.has_value())
+        {
+            result = VALUE.value();
+        }
+        else
+        {
+            static double const parsed{Scalar{TEXT}.toDouble()};
+            result = parsed;
+        }
+        return NODE.negate ? -result : result;
+    }
+
+    template <uint32_t Index>
+    static auto literal(Scalar const& /*variable*/) -> Scalar
+    {
+        constexpr detail::StaticNode NODE{TREE.nodes[Index]};
+        constexpr auto TEXT{Source.view().substr(NODE.begin, NODE.count)};
+
+        // Only inline limbs are cached, since wider ones may come from an
+        // EvaluationArena scope and must not outlive it.
+        size_t const precision{MathContext::current().precision};
+        if (precision > INLINE_BASE_2_PRECISION)
+        {
+            Scalar const value{TEXT, precision};
+            return NODE.negate ? -value : value;
+        }
+
+        thread_local std::optional<Scalar> parsed{};
+        if (!parsed.has_value() || parsed->precision() != precision)
+        {
+            parsed.emplace(TEXT, precision);
+            if constexpr (NODE.negate)
+            {
+                parsed = -parsed.value();
+            }
+        }
+        return parsed.value();
+    }
+
+    // The factors of a summand before the given one, left to right.
+    template <uint32_t Summand, uint32_t Count, typename T>
+    static auto product(T const& variable, Values<T> const& values) -> T
+    {
+        constexpr detail::StaticSummand SUMMAND{TREE.summands[Summand]};
+
+        T result{node<TREE.factors[SUMMAND.begin].node>(variable, values)};
+        [&]<uint32_t... Position>(std::integer_sequence<uint32_t, Position...>)
+        {
+            (
+                [&]()
+                {
+                    constexpr detail::StaticFactor FACTOR{
+                        TREE.factors[SUMMAND.begin + 1 + Position]
+                    };
+                    if constexpr (FACTOR.divide)
+                    {
+                        result /= node<FACTOR.node>(variable, values);
+                    }
+                    else
+                    {
+                        result *= node<FACTOR.node>(variable, values);
+                    }
+                }(),
+                ...
+            );
+        }(std::make_integer_sequence<uint32_t, Count - 1>{});
+        return result;
+    }
+
+    // Whether the last step of a summand is a multiplication, which the
+    // Scalar path fuses with the addition consuming it.
+    template <uint32_t Summand> static consteval auto fusable() -> bool
+    {
+        constexpr detail::StaticSummand SUMMAND{TREE.summands[Summand]};
+        return SUMMAND.count > 1
+            && !TREE.factors[SUMMAND.begin + SUMMAND.count - 1].divide;
+    }
+
+    template <uint32_t Summand, typename T>
+    static auto lastFactor(T const& variable, Values<T> const& values) -> T
+    {
+        constexpr detail::StaticSummand SUMMAND{TREE.summands[Summand]};
+        return node<TREE.factors[SUMMAND.begin + SUMMAND.count - 1].node>(
+            variable, values
+        );
+    }
+
+    template <uint32_t Index>
+    static auto sum(double const variable, Values<double> const& values)
+        -> double
+    {
+        constexpr detail::StaticNode NODE{TREE.nodes[Index]};
+        constexpr uint32_t FIRST{NODE.begin};
+
+        // Same order as the Scalar path, but without fusing, as
+        // Expression::evaluate(double) does.
+        double result{
+            product<FIRST, TREE.summands[FIRST].count>(variable, values)
+        };
+        [&]<uint32_t... Position>(std::integer_sequence<uint32_t, Position...>)
+        {
+            (
+                [&]()
+                {
+                    constexpr uint32_t SUMMAND{FIRST + 1 + Position};
+                    constexpr uint32_t COUNT{TREE.summands[SUMMAND].count};
+                    double const term{
+                        product<SUMMAND, COUNT>(variable, values)
+                    };
+                    if constexpr (TREE.summands[SUMMAND].subtract)
+                    {
+                        result -= term;
+                    }
+                    else
+                    {
+                        result += term;
+                    }
+                }(),
+                ...
+            );
+        }(std::make_integer_sequence<uint32_t, NODE.count - 1>{});
+        return result;
+    }
+
+    // Mirrors Expression::computeNode, with every decision it makes on the
+    // shape of the group taken at compile time.
+    template <uint32_t Index>
+    static auto sum(Scalar const& variable, Values<Scalar> const& values)
+        -> Scalar
+    {
+        constexpr detail::StaticNode NODE{TREE.nodes[Index]};
+        constexpr uint32_t FIRST{NODE.begin};
+
+        // A first product ending in a multiplication waits for the second
+        // summand, so that the two are fused.
+        constexpr bool PENDING{NODE.count > 1 && fusable<FIRST>()};
+
+        Scalar result{};
+        if constexpr (PENDING)
+        {
+            constexpr uint32_t SECOND{FIRST + 1};
+            constexpr uint32_t COUNT{TREE.summands[FIRST].count};
+
+            Scalar const lhs{product<FIRST, COUNT - 1>(variable, values)};
+            Scalar const rhs{lastFactor<FIRST>(variable, values)};
+            Scalar addend{
+                product<SECOND, TREE.summands[SECOND].count>(variable, values)
+            };
+            if constexpr (TREE.summands[SECOND].subtract)
+            {
+                addend = -addend;
+            }
+            Functions::fma(addend, lhs, rhs, addend);
+            result = std::move(addend);
+        }
+        else
+        {
+            constexpr uint32_t COUNT{TREE.summands[FIRST].count};
+            result = product<FIRST, COUNT>(variable, values);
+        }
+
+        constexpr uint32_t DONE{PENDING ? 2 : 1};
+        [&]<uint32_t... Position>(std::integer_sequence<uint32_t, Position...>)
+        {
+            (
+                [&]()
+                {
+                    constexpr uint32_t SUMMAND{FIRST + DONE + Position};
+                    constexpr detail::StaticSummand STATIC_SUMMAND{
+                        TREE.summands[SUMMAND]
+                    };
+
+                    if constexpr (fusable<SUMMAND>())
+                    {
+                        constexpr uint32_t COUNT{STATIC_SUMMAND.count - 1};
+                        Scalar term{product<SUMMAND, COUNT>(variable, values)};
+                        if constexpr (STATIC_SUMMAND.subtract)
+                        {
+                            term = -term;
+                        }
+                        Functions::fma(
+                            result,
+                            term,
+                            lastFactor<SUMMAND>(variable, values),
+                            result
+                        );
+                    }
+                    else if constexpr (STATIC_SUMMAND.subtract)
+                    {
+                        result -= product<SUMMAND, STATIC_SUMMAND.count>(
+                            variable, values
+                        );
+                    }
+                    else
+                    {
+                        result += product<SUMMAND, STATIC_SUMMAND.count>(
+                            variable, values
+                        );
+                    }
+                }(),
+                ...
+            );
+        }(std::make_integer_sequence<uint32_t, NODE.count - DONE>{});
+        return result;
+    }
+};
+
+/**
+ * @brief compile - Parses an expression at compile time, for example
+ * compile<"erf(x) * 2 + 1">(). See StaticExpression.
+ */
+template <FixedString Source>
+constexpr auto compile() -> StaticExpression<Source>
+{
+    return {};
+}
+} // namespace calqmath
@@ -0,0 +1,260 @@
+#include "arena.h"
+
+#include "gmp.h"
+#include "mpfr.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+size_t constexpr ARENA_ALIGNMENT = alignof(std::max_align_t);
+size_t constexpr ARENA_CHUNK_SIZE = size_t{64} * 1024;
+
+auto alignUp(size_t const size) -> size_t
+{
+    return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+struct ArenaChunk
+{
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+
+    [[nodiscard]] auto contains(void const* pointer) const -> bool
+    {
+        auto const* const bytes{static_cast<std::byte const*>(pointer)};
+        return bytes >= data.get() && bytes < data.get() + size;
+    }
+};
+
+/*
+ * Chunks are kept between scopes so that steady-state evaluation does not
+ * touch the system allocator at all. Only chunks up to and including
+ * m_activeChunk hold live allocations.
+ */
+class Arena
+{
+public:
+    auto allocate(size_t const size) -> void*
+    {
+        size_t const alignedSize{alignUp(std::max(size, size_t{1}))};
+
+        while (m_activeChunk < m_chunks.size()
+               && m_offset + alignedSize > m_chunks[m_activeChunk].size)
+        {
+            m_activeChunk++;
+            m_offset = 0;
+        }
+
+        if (m_activeChunk == m_chunks.size())
+        {
+            size_t const chunkSize{std::max(ARENA_CHUNK_SIZE, alignedSize)};
+            m_chunks.emplace_back(
+                std::make_unique_for_overwrite<std::byte[]>(chunkSize),
+                chunkSize
+            );
+        }
+
+        auto* const result{m_chunks[m_activeChunk].data.get() + m_offset};
+        m_offset += alignedSize;
+        m_bytesInUse += alignedSize;
+        m_lastAllocation = result;
+
+        return result;
+    }
+
+    auto reallocate(
+        void* const pointer, size_t const oldSize, size_t const newSize
+    ) -> void*
+    {
+        if (pointer == m_lastAllocation)
+        {
+            // Grow or shrink the most recent allocation in place if it fits.
+            size_t const oldAligned{alignUp(std::max(oldSize, size_t{1}))};
+            size_t const newAligned{alignUp(std::max(newSize, size_t{1}))};
+            size_t const start{m_offset - oldAligned};
+
+            if (start + newAligned <= m_chunks[m_activeChunk].size)
+            {
+                m_offset = start + newAligned;
+                m_bytesInUse = m_bytesInUse - oldAligned + newAligned;
+                return pointer;
+            }
+        }
+
+        void* const result{allocate(newSize)};
+        std::memcpy(result, pointer, std::min(oldSize, newSize));
+        return result;
+    }
+
+    void deallocate(void* const pointer, size_t const size)
+    {
+        // Only the most recent allocation can be reclaimed early, which
+        // covers the stack-like temporaries the backend creates.
+        if (pointer != m_lastAllocation)
+        {
+            return;
+        }
+
+        size_t const alignedSize{alignUp(std::max(size, size_t{1}))};
+        m_offset -= alignedSize;
+        m_bytesInUse -= alignedSize;
+        m_lastAllocation = nullptr;
+    }
+
+    [[nodiscard]] auto owns(void const* const pointer) const -> bool
+    {
+        for (size_t index = 0;
+             index <= m_activeChunk && index < m_chunks.size();
+             index++)
+        {
+            if (m_chunks[index].contains(pointer))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void reset()
+    {
+        m_activeChunk = 0;
+        m_offset = 0;
+        m_bytesInUse = 0;
+        m_lastAllocation = nullptr;
+    }
+
+    [[nodiscard]] auto bytesInUse() const -> size_t { return m_bytesInUse; }
+
+private:
+    std::vector<ArenaChunk> m_chunks;
+    size_t m_activeChunk{0};
+    size_t m_offset{0};
+    size_t m_bytesInUse{0};
+    void* m_lastAllocation{nullptr};
+};
+
+// Kept separate from the arena so threads that never open a scope only pay
+// for reading a counter.
+thread_local size_t t_arenaDepth{0};
+
+auto threadArena() -> Arena&
+{
+    thread_local Arena arena{};
+    return arena;
+}
+
+auto checkedSystemAllocation(void* const pointer) -> void*
+{
+    // Matches the default GMP behaviour, which has no way to report failure.
+    if (pointer == nullptr)
+    {
+        std::abort();
+    }
+    return pointer;
+}
+
+auto arenaAllocate(size_t const size) -> void*
+{
+    if (t_arenaDepth > 0)
+    {
+        return threadArena().allocate(size);
+    }
+
+    return checkedSystemAllocation(std::malloc(size));
+}
+
+auto arenaReallocate(
+    void* const pointer, size_t const oldSize, size_t const newSize
+) -> void*
+{
+    if (t_arenaDepth > 0)
+    {
+        auto& arena{threadArena()};
+        if (arena.owns(pointer))
+        {
+            return arena.reallocate(pointer, oldSize, newSize);
+        }
+
+        // Memory from outside the scope stays with the system allocator.
+    }
+
+    return checkedSystemAllocation(std::realloc(pointer, newSize));
+}
+
+void arenaDeallocate(void* const pointer, size_t const size)
+{
+    if (t_arenaDepth > 0)
+    {
+        auto& arena{threadArena()};
+        if (arena.owns(pointer))
+        {
+            arena.deallocate(pointer, size);
+            return;
+        }
+    }
+
+    std::free(pointer);
+}
+
+// Set once by EvaluationArena::install, which happens before any scope.
+std::atomic<bool> g_installed{false};
+} // namespace
+
+namespace calqmath
+{
+void EvaluationArena::install()
+{
+    static std::once_flag installed{};
+    std::call_once(
+        installed,
+        []()
+    {
+        // MPFR requires its caches be freed before the allocator changes.
+        mpfr_mp_memory_cleanup();
+        mp_set_memory_functions(
+            arenaAllocate, arenaReallocate, arenaDeallocate
+        );
+        g_installed.store(true, std::memory_order_release);
+    }
+    );
+}
+
+EvaluationArena::EvaluationArena()
+{
+    assert(g_installed.load(std::memory_order_acquire));
+    t_arenaDepth++;
+}
+
+EvaluationArena::~EvaluationArena()
+{
+    assert(t_arenaDepth > 0);
+
+    if (t_arenaDepth == 1)
+    {
+        // The backend caches constants and temporaries per thread, which may
+        // live in the arena. Release them while frees still go to the arena.
+        mpfr_mp_memory_cleanup();
+        threadArena().reset();
+    }
+
+    t_arenaDepth--;
+}
+
+auto EvaluationArena::bytesInUse() -> size_t
+{
+    if (t_arenaDepth == 0)
+    {
+        return 0;
+    }
+
+    return threadArena().bytesInUse();
+}
+} // namespace calqmath
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+namespace calqmath
+{
+/**
+ * @brief An opt-in scope that serves the bignum backend's heap allocations on
+ * the calling thread from a thread-local bump arena.
+ *
+ * While at least one EvaluationArena is alive on a thread, limb allocations
+ * made by that thread are carved out of large reusable chunks and individual
+ * frees are no-ops. When the outermost scope ends, everything allocated within
+ * it is released at once. Other threads, and this thread outside of any scope,
+ * use the system allocator as usual.
+ *
+ * Scalars whose limbs were allocated inside the scope must be destroyed before
+ * the scope ends, and must not be handed to another thread. Scalars at or below
+ * INLINE_BASE_2_PRECISION never allocate, so only the backend's temporaries
+ * and higher precision values are affected.
+ *
+ * Scopes may nest, only the outermost one releases memory.
+ *
+ * The backend's allocation hooks are process wide, so they are installed by
+ * install() rather than by the first scope. Call it once at startup, before
+ * any thread uses the backend.
+ */
+class EvaluationArena
+{
+public:
+    /**
+     * @brief install - Routes the backend's allocations through the arena
+     * hooks, which use the system allocator outside of any scope.
+     *
+     * Must be called before any scope is created, and before threads other
+     * than the caller use the backend, such as first thing in main. Only the
+     * calling thread's backend caches are freed when the hooks change. Later
+     * calls do nothing.
+     */
+    static void install();
+
+    // Requires install() to have been called.
+    EvaluationArena();
+    ~EvaluationArena();
+
+    EvaluationArena(EvaluationArena const&) = delete;
+    EvaluationArena(EvaluationArena&&) = delete;
+    auto operator=(EvaluationArena const&) -> EvaluationArena& = delete;
+    auto operator=(EvaluationArena&&) -> EvaluationArena& = delete;
+
+    /**
+     * @brief bytesInUse - Counts the bytes handed out by the calling thread's
+     * arena since its outermost scope began.
+     * @return The byte count, or zero if no scope is active on this thread.
+     */
+    static auto bytesInUse() -> size_t;
+};
+} // namespace calqmath
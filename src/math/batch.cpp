@@ -0,0 +1,893 @@
+#include "functions.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+/*
+ * Batched double kernels.
+ *
+ * Each kernel is straight line code for a single lane: selects instead of
+ * branches, polynomials instead of tables and integer work confined to 64 bit
+ * lanes through bit casts. This lets the loops in the WRAP_BATCH macros
+ * compile to packed SSE2 with no intrinsics, and to AVX2 through a second
+ * clone where the toolchain can dispatch on the running CPU. Only arguments of
+ * the trigonometric functions too large for the vectorized reduction go
+ * through the C library, in a scalar pass after each block.
+ *
+ * Coefficients are from fdlibm where named so, and otherwise Chebyshev
+ * interpolants fitted at 160 digits.
+ */
+
+#if defined(__GNUC__)
+#define LANE [[gnu::always_inline]] inline
+#elif defined(_MSC_VER)
+#define LANE __forceinline
+#else
+#define LANE inline
+#endif
+
+// Inner loops have a fixed trip count, and must be flattened for the outer
+// loop over elements to vectorize.
+#if defined(__clang__)
+#define VECTORIZE_LOOP _Pragma("clang loop vectorize(enable)")
+#define UNROLL_LOOP _Pragma("clang loop unroll(full)")
+#elif defined(__GNUC__)
+#define VECTORIZE_LOOP _Pragma("GCC ivdep")
+#define UNROLL_LOOP _Pragma("GCC unroll 256")
+#else
+#define VECTORIZE_LOOP
+#define UNROLL_LOOP
+#endif
+
+// Function multiversioning needs ifunc support from the loader.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__)
+#define TARGET_CLONES [[gnu::target_clones("avx2", "default")]]
+#else
+#define TARGET_CLONES
+#endif
+
+#define WRAP_BATCH(func, lane)                                                 \
+    TARGET_CLONES void Functions::func(                                        \
+        std::span<double const> arguments, std::span<double> results           \
+    )                                                                          \
+    {                                                                          \
+        assert(arguments.size() == results.size());                            \
+        double const* const in = arguments.data();                             \
+        double* const out = results.data();                                    \
+        size_t const size = arguments.size();                                  \
+        VECTORIZE_LOOP                                                         \
+        for (size_t i = 0; i < size; i++)                                      \
+        {                                                                      \
+            out[i] = lane(in[i]);                                              \
+        }                                                                      \
+    }
+
+/*
+ * As above, then recomputes lanes whose argument is beyond REDUCTION_LIMIT with
+ * the C library. Works in blocks so that the arguments are still available
+ * when results overwrite them in place.
+ */
+#define WRAP_BATCH_REDUCED(func, lane)                                         \
+    TARGET_CLONES void Functions::func(                                        \
+        std::span<double const> radians, std::span<double> results             \
+    )                                                                          \
+    {                                                                          \
+        assert(radians.size() == results.size());                              \
+        std::array<double, BLOCK_SIZE> block;                                  \
+        for (size_t start = 0; start < radians.size(); start += BLOCK_SIZE)    \
+        {                                                                      \
+            size_t const size =                                                \
+                std::min(BLOCK_SIZE, radians.size() - start);                  \
+            double* const out = results.data() + start;                        \
+            std::copy_n(radians.data() + start, size, block.data());           \
+            VECTORIZE_LOOP                                                     \
+            for (size_t i = 0; i < size; i++)                                  \
+            {                                                                  \
+                out[i] = lane(block[i]);                                       \
+            }                                                                  \
+            for (size_t i = 0; i < size; i++)                                  \
+            {                                                                  \
+                if (std::abs(block[i]) > REDUCTION_LIMIT)                      \
+                {                                                              \
+                    out[i] = Functions::func(block[i]);                        \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+    }
+
+namespace calqmath
+{
+namespace
+{
+double constexpr INF = std::numeric_limits<double>::infinity();
+double constexpr NOT_A_NUMBER = std::numeric_limits<double>::quiet_NaN();
+double constexpr SMALLEST_NORMAL = std::numeric_limits<double>::min();
+
+size_t constexpr BLOCK_SIZE{256};
+
+// Adding and removing this rounds to an integer, ties to even, for magnitudes
+// below 2^51. The integer then sits in the low bits of the sum.
+double constexpr SHIFTER = 0x1.8p52;
+
+double constexpr LOG2E = 0x1.71547652b82fep+0;
+double constexpr LN2 = 0x1.62e42fefa39efp-1;
+// ln(2) split so that multiples up to 2^20 of the high part are exact.
+double constexpr LN2_HI = 0x1.62e42fee00000p-1;
+double constexpr LN2_LO = 0x1.a39ef35793c76p-33;
+
+double constexpr PI = 0x1.921fb54442d18p+1;
+double constexpr TWO_OVER_PI = 0x1.45f306dc9c883p-1;
+// pi / 2 split so that multiples up to 2^20 of the first three are exact.
+double constexpr PIO2_1 = 0x1.921fb54400000p+0;
+double constexpr PIO2_2 = 0x1.0b4611a600000p-34;
+double constexpr PIO2_3 = 0x1.3198a2e000000p-69;
+double constexpr PIO2_3T = 0x1.b839a252049c1p-104;
+// Arguments beyond this fall back to the C library's reduction.
+double constexpr REDUCTION_LIMIT = 0x1p20;
+
+LANE auto toBits(double const value) -> uint64_t
+{
+    return std::bit_cast<uint64_t>(value);
+}
+
+LANE auto fromBits(uint64_t const bits) -> double
+{
+    return std::bit_cast<double>(bits);
+}
+
+LANE auto select(bool const condition, double const lhs, double const rhs)
+    -> double
+{
+    return condition ? lhs : rhs;
+}
+
+LANE auto nearestInteger(double const x) -> double
+{
+    return (x + SHIFTER) - SHIFTER;
+}
+
+// The integer in the low bits of a shifted value, modulo 2^64.
+LANE auto shiftedInteger(double const shifted) -> uint64_t
+{
+    return toBits(shifted) - toBits(SHIFTER);
+}
+
+// 2^n for an integer n in [-1022, 1023].
+LANE auto powerOfTwo(double const n) -> double
+{
+    return fromBits((shiftedInteger(n + SHIFTER) + 1023) << 52);
+}
+
+// The unbiased exponent field of a positive normal number.
+LANE auto exponentOf(uint64_t const bits) -> double
+{
+    return fromBits((bits >> 52) | toBits(0x1p52)) - (0x1p52 + 1023.0);
+}
+
+template <size_t N>
+LANE auto horner(std::array<double, N> const& coefficients, double const x)
+    -> double
+{
+    double result = coefficients[N - 1];
+    UNROLL_LOOP
+    for (size_t i = N - 1; i > 0; i--)
+    {
+        result = result * x + coefficients[i - 1];
+    }
+    return result;
+}
+
+// Sum of coefficients[k] T_k(t), for t in [-1, 1].
+template <size_t N>
+LANE auto clenshaw(std::array<double, N> const& coefficients, double const t)
+    -> double
+{
+    double next = 0.0;
+    double afterNext = 0.0;
+    UNROLL_LOOP
+    for (size_t k = N - 1; k > 0; k--)
+    {
+        double const current = 2.0 * t * next - afterNext + coefficients[k];
+        afterNext = next;
+        next = current;
+    }
+    return t * next - afterNext + coefficients[0];
+}
+
+template <size_t N>
+constexpr auto inverseFactorials(size_t const first, size_t const stride)
+    -> std::array<double, N>
+{
+    std::array<double, N> result{};
+    double factorial = 1.0;
+    size_t n = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+        for (; n < first + i * stride; factorial *= static_cast<double>(++n))
+        {
+        }
+        result[i] = 1.0 / factorial;
+    }
+    return result;
+}
+
+/*
+ * Rounding
+ */
+
+LANE auto roundevenLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    // Shifting by 2^52 leaves no fraction bits for anything non-negative, and
+    // anything larger is already an integer.
+    double const nearest = (magnitude + 0x1p52) - 0x1p52;
+    return select(magnitude < 0x1p52, std::copysign(nearest, x), x);
+}
+
+LANE auto floorLane(double const x) -> double
+{
+    double const nearest = roundevenLane(x);
+    return select(nearest > x, nearest - 1.0, nearest);
+}
+
+LANE auto ceilLane(double const x) -> double { return -floorLane(-x); }
+
+LANE auto truncLane(double const x) -> double
+{
+    return std::copysign(floorLane(std::abs(x)), x);
+}
+
+LANE auto roundLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const below = floorLane(magnitude);
+    // The fraction is exact, unlike adding a half before flooring.
+    return std::copysign(
+        select(magnitude - below >= 0.5, below + 1.0, below), x
+    );
+}
+
+LANE auto idLane(double const x) -> double { return x; }
+
+LANE auto absLane(double const x) -> double { return std::abs(x); }
+
+LANE auto sqrtLane(double const x) -> double { return std::sqrt(x); }
+
+/*
+ * Exponentials and logarithms
+ */
+
+auto constexpr EXP_COEFFICIENTS = inverseFactorials<14>(0, 1);
+
+LANE auto expLane(double x) -> double
+{
+    // Past these the result is 0 or infinite anyway. NaN passes through.
+    x = select(x < -746.0, -746.0, x);
+    x = select(x > 710.0, 710.0, x);
+    double const n = nearestInteger(x * LOG2E);
+    double const reduced = (x - n * LN2_HI) - n * LN2_LO;
+    double const value = horner(EXP_COEFFICIENTS, reduced);
+    // Scaling in two steps keeps both factors normal, and rounds a subnormal
+    // result only once.
+    double const half = nearestInteger(0.5 * n);
+    return value * powerOfTwo(half) * powerOfTwo(n - half);
+}
+
+/*
+ * Splits x into 2^exponent * (1 + fraction), with 1 + fraction in
+ * [sqrt(2)/2, sqrt(2)). Only meaningful for finite positive x.
+ */
+LANE auto splitLogArgument(double const x, double& exponent) -> double
+{
+    bool const subnormal = x < SMALLEST_NORMAL;
+    uint64_t const bits = toBits(select(subnormal, x * 0x1p54, x)) +
+                          (0x3ff0000000000000 - 0x3fe6a09e667f3bcd);
+    exponent = exponentOf(bits) - select(subnormal, 54.0, 0.0);
+    return fromBits((bits & 0x000fffffffffffff) + 0x3fe6a09e667f3bcd) - 1.0;
+}
+
+LANE auto logSpecialCases(double const x, double const result) -> double
+{
+    double const special =
+        select(x == 0.0, -INF, select(x == INF, INF, NOT_A_NUMBER));
+    return select(x > 0.0 && x < INF, result, special);
+}
+
+/*
+ * The fdlibm decomposition log(1 + f) = f - f^2/2 + s (f^2/2 + R(s^2)), with
+ * s = f / (2 + f). Both parts are returned, so callers can add their own
+ * scaling with the least rounding.
+ */
+LANE auto logFraction(double const f, double& halfSquare) -> double
+{
+    double const s = f / (2.0 + f);
+    double const z = s * s;
+    double const w = z * z;
+    double const even =
+        w * (3.999999999940941908e-01 +
+             w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+    double const odd =
+        z * (6.666666666666735130e-01 +
+             w * (2.857142874366239149e-01 +
+                  w * (1.818357216161805012e-01 +
+                       w * 1.479819860511658591e-01)));
+    halfSquare = 0.5 * f * f;
+    return s * (halfSquare + even + odd);
+}
+
+LANE auto logLane(double const x) -> double
+{
+    double k = 0.0;
+    double const f = splitLogArgument(x, k);
+    double halfSquare = 0.0;
+    double const correction = logFraction(f, halfSquare);
+    double const result =
+        k * LN2_HI - ((halfSquare - (correction + k * LN2_LO)) - f);
+    return logSpecialCases(x, result);
+}
+
+LANE auto log2Lane(double const x) -> double
+{
+    double k = 0.0;
+    double const f = splitLogArgument(x, k);
+    double halfSquare = 0.0;
+    double const correction = logFraction(f, halfSquare);
+    // Exact for powers of two.
+    double const result = k + (f - (halfSquare - correction)) * LOG2E;
+    return logSpecialCases(x, result);
+}
+
+// log(1 + y), with the rounding of 1 + y corrected to first order.
+LANE auto log1pLane(double const y) -> double
+{
+    double const u = 1.0 + y;
+    double const correction = select(u < INF, ((u - 1.0) - y) / u, 0.0);
+    return select(u == 1.0, y, logLane(u) - correction);
+}
+
+/*
+ * Trigonometric functions, reduced by multiples of pi/2 to [-pi/4, pi/4].
+ */
+
+// Returns the quadrant, with the reduced argument in reduced.
+LANE auto reduceQuadrant(double const x, double& reduced) -> uint64_t
+{
+    double const shifted = x * TWO_OVER_PI + SHIFTER;
+    double const n = shifted - SHIFTER;
+    reduced = (((x - n * PIO2_1) - n * PIO2_2) - n * PIO2_3) - n * PIO2_3T;
+    return shiftedInteger(shifted) & 3;
+}
+
+// fdlibm's __kernel_sin, for |x| <= pi/4.
+LANE auto sinKernel(double const x) -> double
+{
+    double const z = x * x;
+    double const r =
+        8.33333333332248946124e-03 +
+        z * (-1.98412698298579493134e-04 +
+             z * (2.75573137070700676789e-06 +
+                  z * (-2.50507602534068634195e-08 +
+                       z * 1.58969099521155010221e-10)));
+    // The sign keeps sin(-0) = -0.
+    return std::copysign(
+        x + z * x * (-1.66666666666666324348e-01 + z * r), x
+    );
+}
+
+// fdlibm's __kernel_cos, for |x| <= pi/4.
+LANE auto cosKernel(double const x) -> double
+{
+    double const z = x * x;
+    double const w = z * z;
+    double const r =
+        z * (4.16666666666666019037e-02 +
+             z * (-1.38888888888741095749e-03 + z * 2.48015872894767294178e-05)
+        ) +
+        w * w *
+            (-2.75573143513906633035e-07 +
+             z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)
+            );
+    double const halfSquare = 0.5 * z;
+    double const rest = 1.0 - halfSquare;
+    return rest + (((1.0 - rest) - halfSquare) + z * r);
+}
+
+LANE auto sinLane(double const x) -> double
+{
+    double r = 0.0;
+    uint64_t const quadrant = reduceQuadrant(x, r);
+    double const value =
+        select((quadrant & 1) != 0, cosKernel(r), sinKernel(r));
+    return select((quadrant & 2) != 0, -value, value);
+}
+
+LANE auto cosLane(double const x) -> double
+{
+    double r = 0.0;
+    uint64_t const quadrant = reduceQuadrant(x, r);
+    double const value =
+        select((quadrant & 1) != 0, sinKernel(r), cosKernel(r));
+    return select(((quadrant + 1) & 2) != 0, -value, value);
+}
+
+LANE auto tanLane(double const x) -> double
+{
+    double r = 0.0;
+    uint64_t const quadrant = reduceQuadrant(x, r);
+    double const sine = sinKernel(r);
+    double const cosine = cosKernel(r);
+    return select((quadrant & 1) != 0, -cosine / sine, sine / cosine);
+}
+
+LANE auto cotLane(double const x) -> double
+{
+    double r = 0.0;
+    uint64_t const quadrant = reduceQuadrant(x, r);
+    double const sine = sinKernel(r);
+    double const cosine = cosKernel(r);
+    return select((quadrant & 1) != 0, -sine / cosine, cosine / sine);
+}
+
+LANE auto cscLane(double const x) -> double { return 1.0 / sinLane(x); }
+
+LANE auto secLane(double const x) -> double { return 1.0 / cosLane(x); }
+
+/*
+ * fdlibm's atan, with its four reductions (a x - b) / (c + d x) picked by
+ * select rather than by branch.
+ */
+LANE auto atanLane(double const x) -> double
+{
+    // atan is pi/2 to double precision past 2^66, and clamping keeps infinity
+    // out of the reduction.
+    double const a = std::min(std::abs(x), 0x1p66);
+    bool const first = a >= 0.4375;
+    bool const second = a >= 0.6875;
+    bool const third = a >= 1.1875;
+    bool const fourth = a >= 2.4375;
+    // The reduction is (scale a - offset) / (scale + offset a).
+    double const scale =
+        select(fourth, 0.0, select(second, 1.0, select(first, 2.0, 1.0)));
+    double const offset =
+        select(fourth, 1.0, select(third, 1.5, select(first, 1.0, 0.0)));
+    double const high = select(
+        fourth,
+        1.57079632679489655800e+00,
+        select(
+            third,
+            9.82793723247329054082e-01,
+            select(
+                second,
+                7.85398163397448278999e-01,
+                select(first, 4.63647609000806093515e-01, 0.0)
+            )
+        )
+    );
+    double const low = select(
+        fourth,
+        6.12323399573676603587e-17,
+        select(
+            third,
+            1.39033110312309984516e-17,
+            select(
+                second,
+                3.06161699786838301793e-17,
+                select(first, 2.26987774529616870924e-17, 0.0)
+            )
+        )
+    );
+    double const t = (a * scale - offset) / (scale + offset * a);
+    double const z = t * t;
+    double const w = z * z;
+    double const odd =
+        z * (3.33333333333329318027e-01 +
+             w * (1.42857142725034663711e-01 +
+                  w * (9.09088713343650656196e-02 +
+                       w * (6.66107313738753120669e-02 +
+                            w * (4.97687799461593236017e-02 +
+                                 w * 1.62858201153657823623e-02)))));
+    double const even =
+        w * (-1.99999999998764832476e-01 +
+             w * (-1.11111104054623557880e-01 +
+                  w * (-7.69187620504482999495e-02 +
+                       w * (-5.83357013379057348645e-02 +
+                            w * -3.65315727442169155270e-02))));
+    double const result = high - ((t * (odd + even) - low) - t);
+    return std::copysign(result, x);
+}
+
+LANE auto asinLane(double const x) -> double
+{
+    return atanLane(x / std::sqrt((1.0 - x) * (1.0 + x)));
+}
+
+LANE auto acosLane(double const x) -> double
+{
+    return 2.0 * atanLane(std::sqrt((1.0 - x) / (1.0 + x)));
+}
+
+/*
+ * Hyperbolic functions
+ */
+
+auto constexpr SINH_COEFFICIENTS = inverseFactorials<9>(3, 2);
+
+// sinh for |x| < 1, from its Taylor series.
+LANE auto sinhSmall(double const x) -> double
+{
+    double const z = x * x;
+    return x + x * z * horner(SINH_COEFFICIENTS, z);
+}
+
+// exp(|x|), or exp(|x| / 2) where exp(|x|) would overflow, see largeHalf.
+LANE auto expOfMagnitude(double const magnitude) -> double
+{
+    return expLane(select(magnitude > 709.0, 0.5 * magnitude, magnitude));
+}
+
+// e^|x| / 2 from the result of expOfMagnitude, without overflowing early.
+LANE auto largeHalf(double const magnitude, double const exponential) -> double
+{
+    return select(
+        magnitude > 709.0, 0.5 * exponential * exponential, 0.5 * exponential
+    );
+}
+
+LANE auto sinhLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const exponential = expOfMagnitude(magnitude);
+    double const large =
+        largeHalf(magnitude, exponential) - 0.5 / exponential;
+    return std::copysign(
+        select(magnitude < 1.0, sinhSmall(magnitude), large), x
+    );
+}
+
+LANE auto coshLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const exponential = expOfMagnitude(magnitude);
+    return largeHalf(magnitude, exponential) + 0.5 / exponential;
+}
+
+LANE auto tanhLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const sinh = sinhSmall(magnitude);
+    double const small = sinh / std::sqrt(1.0 + sinh * sinh);
+    // tanh rounds to 1 well before 22.
+    double const exponential =
+        expLane(2.0 * select(magnitude > 22.0, 22.0, magnitude));
+    double const large = 1.0 - 2.0 / (exponential + 1.0);
+    return std::copysign(select(magnitude < 0.625, small, large), x);
+}
+
+// Beyond this the square root in asinh and acosh is the argument itself.
+double constexpr HYPERBOLIC_LARGE = 0x1p28;
+
+LANE auto asinhLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const square = magnitude * magnitude;
+    double const argument =
+        magnitude + square / (1.0 + std::sqrt(1.0 + square));
+    double const result = select(
+        magnitude > HYPERBOLIC_LARGE,
+        logLane(magnitude) + LN2,
+        log1pLane(argument)
+    );
+    return std::copysign(result, x);
+}
+
+LANE auto acoshLane(double const x) -> double
+{
+    double const above = x - 1.0;
+    double const argument = above + std::sqrt(above * (above + 2.0));
+    double const result = select(
+        x > HYPERBOLIC_LARGE, logLane(x) + LN2, log1pLane(argument)
+    );
+    return select(x >= 1.0, result, NOT_A_NUMBER);
+}
+
+LANE auto atanhLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const result =
+        0.5 * log1pLane(2.0 * magnitude / (1.0 - magnitude));
+    return std::copysign(result, x);
+}
+
+/*
+ * Roots
+ */
+
+LANE auto cbrtLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    bool const subnormal = magnitude < SMALLEST_NORMAL;
+    // 2^54 keeps the exponent a multiple of three apart.
+    uint64_t const bits =
+        toBits(select(subnormal, magnitude * 0x1p54, magnitude));
+    double const exponent = exponentOf(bits);
+    double const mantissa =
+        fromBits((bits & 0x000fffffffffffff) | toBits(1.0));
+    double const third = nearestInteger((exponent - 1.0) * (1.0 / 3.0));
+    double const remainder = exponent - 3.0 * third;
+    // Quadratic through 1, 1.5 and 2, within 3e-3 of the root on [1, 2].
+    double root = 0x1.3e7d3be487ff2p-1 +
+                  mantissa * (0x1.bf73ed20b9b14p-2 +
+                              mantissa * -0x1.e373274e4d7c0p-5);
+    UNROLL_LOOP
+    for (int i = 0; i < 3; i++)
+    {
+        root += (mantissa / (root * root) - root) * (1.0 / 3.0);
+    }
+    root *= select(
+        remainder == 0.0,
+        1.0,
+        select(remainder == 1.0, 0x1.428a2f98d728bp+0, 0x1.965fea53d6e3dp+0)
+    );
+    double const result =
+        root * powerOfTwo(third - select(subnormal, 18.0, 0.0));
+    return select(
+        magnitude > 0.0 && magnitude < INF, std::copysign(result, x), x
+    );
+}
+
+/*
+ * Error functions
+ */
+
+// 2/sqrt(pi) (-1)^n / (n! (2n + 1)), the Maclaurin series of erf(x) / x.
+std::array<double, 13> constexpr ERF_COEFFICIENTS{
+    0x1.20dd750429b6dp+0,
+    -0x1.812746b0379e7p-2,
+    0x1.ce2f21a042be2p-4,
+    -0x1.b82ce31288b51p-6,
+    0x1.565bcd0e6a53fp-8,
+    -0x1.c02db40040b86p-11,
+    0x1.f9a326f9b89b7p-14,
+    -0x1.f4d25c3e0c2ebp-17,
+    0x1.b9e6c9dc651a3p-20,
+    -0x1.5f742ec43e71ap-23,
+    0x1.fcc5720624c1cp-27,
+    -0x1.51d7181c5d36dp-30,
+    0x1.9e6ad5e55a730p-34
+};
+
+/*
+ * The scaled complementary error function erfcx(x) = e^(x^2) erfc(x) for
+ * x >= 0.25, times x + 2 as a function of (x - 2.5) / (x + 2). The map takes
+ * [0.25, inf) onto [-1, 1) and leaves a function smooth enough at infinity for
+ * a single interpolant, so lanes need not select between tables. Starting
+ * below 0.5 keeps the arguments used away from the less accurate end.
+ */
+std::array<double, 27> constexpr ERFCX_COEFFICIENTS{
+    0x1.0cc456797ae11p+0, -0x1.27fd199acee87p-1, 0x1.99b786ee55b74p-4,
+    -0x1.b4cf107735b62p-8, -0x1.377f9ce822909p-10, 0x1.e23b5cbc9021dp-13,
+    0x1.99a945977ccefp-16, -0x1.e2d51250bffd2p-18, -0x1.ffec50170ebf2p-21,
+    0x1.ebd87f1023a99p-23, 0x1.b8cdf53f51945p-25, -0x1.917ee40c9eba6p-28,
+    -0x1.87d4ede5b5f04p-29, -0x1.fbbcfe9bedc09p-36, 0x1.3019bf605676ap-33,
+    0x1.61ee1ca20e04bp-36, -0x1.3d48debbebde9p-38, -0x1.0344627b5fe26p-39,
+    -0x1.d127d7ff9a845p-45, 0x1.c5e80523f190bp-44, 0x1.92ae979e69d18p-46,
+    -0x1.137d9a25ebe50p-49, -0x1.0abd20df4e599p-49, -0x1.3d93ef24a4518p-52,
+    0x1.265f09b67f3a5p-54, 0x1.3b49083522a21p-55, 0x1.42cbae7a1580cp-58
+};
+
+// erfcx(x) for x >= 0.5, finite.
+LANE auto erfcxLane(double const x) -> double
+{
+    double const shifted = x + 2.0;
+    return clenshaw(ERFCX_COEFFICIENTS, (x - 2.5) / shifted) / shifted;
+}
+
+/*
+ * e^(-x^2), for x >= 0. Squaring x directly would lose its rounding error
+ * times x^2 in the exponent, so x is split into a high part with an exact
+ * square and a small remainder.
+ */
+LANE auto expOfNegativeSquare(double const x) -> double
+{
+    double const high = fromBits(toBits(x) & 0xfffffffff8000000);
+    double const low = x - high;
+    // Below 2^-15 in magnitude for x up to 28, where four terms of its series
+    // are enough.
+    double const tail = -low * (x + high);
+    double const scale = expLane(-high * high);
+    return scale +
+           scale * (tail * (1.0 + tail * (0.5 + tail * (1.0 / 6.0))));
+}
+
+// erfc(x) for x >= 0.5, underflowing to zero past 27.3.
+LANE auto erfcTail(double x) -> double
+{
+    x = select(x > 28.0, 28.0, x);
+    return erfcxLane(x) * expOfNegativeSquare(x);
+}
+
+LANE auto erfLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const small =
+        magnitude * horner(ERF_COEFFICIENTS, magnitude * magnitude);
+    double const result =
+        select(magnitude < 0.5, small, 1.0 - erfcTail(magnitude));
+    return std::copysign(result, x);
+}
+
+LANE auto erfcLane(double const x) -> double
+{
+    double const magnitude = std::abs(x);
+    double const small =
+        x * horner(ERF_COEFFICIENTS, magnitude * magnitude);
+    double const tail = erfcTail(magnitude);
+    return select(
+        magnitude < 0.5, 1.0 - small, select(x < 0.0, 2.0 - tail, tail)
+    );
+}
+
+/*
+ * Gamma
+ */
+
+// Gamma on [1, 2] as a function of 2x - 3.
+std::array<double, 23> constexpr GAMMA_COEFFICIENTS{
+    0x1.e231b8ccc03c3p-1,  0x1.215dce63ba49bp-8,  0x1.d1b801dc6a8dbp-5,
+    -0x1.148d1705a9b75p-8, 0x1.5bd096fc4923fp-10, -0x1.8cfefb06f916ep-13,
+    0x1.2e9221b0b1686p-15, -0x1.96766090001cep-18, 0x1.1b6c0dcf4b317p-20,
+    -0x1.851df599cfb44p-23, 0x1.0bcf7f3c965fbp-25, -0x1.6ff06d9236cfbp-28,
+    0x1.f967d9c3b28c0p-31, -0x1.5afe32702a038p-33, 0x1.dc649af141532p-36,
+    -0x1.46fda49db269ap-38, 0x1.c0dc161470796p-41, -0x1.341056dfe0617p-43,
+    0x1.a6db008ea74c7p-46, -0x1.2234f682ca690p-48, 0x1.8e53c37ba94c7p-51,
+    -0x1.1123e91f561a5p-53, 0x1.6c3032e6c6f68p-56
+};
+
+// Gamma overflows a double past 171.6.
+double constexpr GAMMA_OVERFLOW = 172.0;
+
+/*
+ * Gamma for every x follows from gamma on some y >= 1, which the recurrence
+ * gamma(y) = (y - 1) gamma(y - 1) takes down to [1, 2). Each factor y - k is
+ * exact, so the error grows only with the number of products.
+ */
+
+// Below -2^51 every double is an even integer.
+LANE auto gammaClamped(double const x) -> double
+{
+    return select(x < -0x1p51, -0x1p51, x);
+}
+
+LANE auto gammaReduced(double const x) -> double
+{
+    // Reflecting through gamma(1 - x) = -x gamma(-x) rather than rounding
+    // 1 - x, which is amplified by the steepness of gamma.
+    double const reduced = select(
+        x >= 1.0,
+        x,
+        select(x > 0.0, x + 1.0, select(x <= -1.0, -gammaClamped(x), 1.0 - x))
+    );
+    return select(reduced > GAMMA_OVERFLOW, GAMMA_OVERFLOW, reduced);
+}
+
+// sin(pi x), exact at integers.
+LANE auto sinPi(double const x) -> double
+{
+    double const shifted = x + SHIFTER;
+    double const fraction = x - (shifted - SHIFTER);
+    double const magnitude = std::abs(fraction);
+    double const value = select(
+        magnitude <= 0.25,
+        sinKernel(PI * magnitude),
+        cosKernel(PI * (0.5 - magnitude))
+    );
+    double const sign = select((shiftedInteger(shifted) & 1) != 0, -1.0, 1.0);
+    return sign * std::copysign(value, fraction);
+}
+
+// Gamma given the reduced argument and the product of its recurrence steps.
+LANE auto gammaLane(
+    double const x, double const reduced, double const steps,
+    double const product
+) -> double
+{
+    double const positive =
+        product * clenshaw(GAMMA_COEFFICIENTS, 2.0 * (reduced - steps) - 3.0);
+    double const clamped = gammaClamped(x);
+    bool const belowMinusOne = x <= -1.0;
+    double const sine =
+        sinPi(clamped) * select(belowMinusOne, -clamped, 1.0);
+    double const reflected = select(
+        x == 0.0,
+        std::copysign(INF, x),
+        select(sine == 0.0, NOT_A_NUMBER, PI / (sine * positive))
+    );
+    return select(
+        x >= 1.0, positive, select(x > 0.0, positive / x, reflected)
+    );
+}
+} // namespace
+
+WRAP_BATCH(id, idLane);
+WRAP_BATCH(abs, absLane);
+WRAP_BATCH(ceil, ceilLane);
+WRAP_BATCH(floor, floorLane);
+WRAP_BATCH(round, roundLane);
+WRAP_BATCH(roundeven, roundevenLane);
+WRAP_BATCH(trunc, truncLane);
+WRAP_BATCH(sqrt, sqrtLane);
+WRAP_BATCH(cbrt, cbrtLane);
+WRAP_BATCH(exp, expLane);
+WRAP_BATCH(log, logLane);
+WRAP_BATCH(log2, log2Lane);
+WRAP_BATCH(erf, erfLane);
+WRAP_BATCH(erfc, erfcLane);
+WRAP_BATCH_REDUCED(sin, sinLane);
+WRAP_BATCH_REDUCED(csc, cscLane);
+WRAP_BATCH(asin, asinLane);
+WRAP_BATCH_REDUCED(cos, cosLane);
+WRAP_BATCH_REDUCED(sec, secLane);
+WRAP_BATCH(acos, acosLane);
+WRAP_BATCH_REDUCED(tan, tanLane);
+WRAP_BATCH_REDUCED(cot, cotLane);
+WRAP_BATCH(atan, atanLane);
+WRAP_BATCH(sinh, sinhLane);
+WRAP_BATCH(cosh, coshLane);
+WRAP_BATCH(tanh, tanhLane);
+WRAP_BATCH(asinh, asinhLane);
+WRAP_BATCH(acosh, acoshLane);
+WRAP_BATCH(atanh, atanhLane);
+
+/*
+ * Gamma needs as many recurrence steps as its largest argument, so it works a
+ * block at a time with the loop over steps outside the loop over lanes. A
+ * block of small arguments then takes only a few passes.
+ */
+TARGET_CLONES void Functions::gamma(
+    std::span<double const> arguments, std::span<double> results
+)
+{
+    assert(arguments.size() == results.size());
+    std::array<double, BLOCK_SIZE> reduced;
+    std::array<double, BLOCK_SIZE> steps;
+    std::array<double, BLOCK_SIZE> products;
+    for (size_t start = 0; start < arguments.size(); start += BLOCK_SIZE)
+    {
+        size_t const size = std::min(BLOCK_SIZE, arguments.size() - start);
+        double const* const in = arguments.data() + start;
+        double* const out = results.data() + start;
+        VECTORIZE_LOOP
+        for (size_t i = 0; i < size; i++)
+        {
+            reduced[i] = gammaReduced(in[i]);
+            steps[i] = floorLane(reduced[i]) - 1.0;
+            products[i] = 1.0;
+        }
+        // Skips NaN steps.
+        double mostSteps = 0.0;
+        for (size_t i = 0; i < size; i++)
+        {
+            mostSteps = std::max(mostSteps, steps[i]);
+        }
+        for (double k = 1.0; k <= mostSteps; k++)
+        {
+            VECTORIZE_LOOP
+            for (size_t i = 0; i < size; i++)
+            {
+                products[i] *= select(k <= steps[i], reduced[i] - k, 1.0);
+            }
+        }
+        VECTORIZE_LOOP
+        for (size_t i = 0; i < size; i++)
+        {
+            out[i] = gammaLane(in[i], reduced[i], steps[i], products[i]);
+        }
+    }
+}
+} // namespace calqmath
@@ -1,36 +1,90 @@
 #include "functions.h"
 
 #include "numberimpl.h"
+#include <algorithm>
+#include <cmath>
 
 #define WRAP_UNARY_SCALAR(func, arg1)                                          \
-    auto Functions::func(Scalar const& arg1) -> Scalar                         \
+    void Functions::func(                                                      \
+        Scalar& result, Scalar const& arg1, MathContext const& context         \
+    )                                                                          \
     {                                                                          \
-        Scalar result{                                                         \
-            Scalar::no_set{},                                                  \
-            static_cast<size_t>(mpfr_get_prec(arg1.p_impl.get()))              \
-        };                                                                     \
+        setPrecision(result, arg1.precision());                                \
         mpfr_##func(                                                           \
-            result.p_impl.get(),                                               \
-            arg1.p_impl.get(),                                                 \
-            mpfr_get_default_rounding_mode()                                   \
+            result.impl(),                                                     \
+            arg1.impl(),                                                       \
+            detail::roundingForMPFR(context.rounding)                          \
         );                                                                     \
+    }                                                                          \
+                                                                               \
+    auto Functions::func(Scalar const& arg1) -> Scalar                         \
+    {                                                                          \
+        Scalar result{Scalar::no_set{}, arg1.precision()};                     \
+        func(result, arg1, MathContext::current());                            \
         return result;                                                         \
     }
 
 #define WRAP_UNARY_SCALAR_NO_ROUND(func, arg1)                                 \
+    void Functions::func(                                                      \
+        Scalar& result, Scalar const& arg1, MathContext const& /*context*/     \
+    )                                                                          \
+    {                                                                          \
+        setPrecision(result, arg1.precision());                                \
+        mpfr_##func(result.impl(), arg1.impl());                               \
+    }                                                                          \
+                                                                               \
     auto Functions::func(Scalar const& arg1) -> Scalar                         \
+    {                                                                          \
+        Scalar result{Scalar::no_set{}, arg1.precision()};                     \
+        func(result, arg1, MathContext::current());                            \
+        return result;                                                         \
+    }
+
+#define WRAP_BINARY_SCALAR(func, arg1, arg2)                                   \
+    void Functions::func(                                                      \
+        Scalar& result,                                                        \
+        Scalar const& arg1,                                                    \
+        Scalar const& arg2,                                                    \
+        MathContext const& context                                             \
+    )                                                                          \
+    {                                                                          \
+        result.widen(std::max(arg1.precision(), arg2.precision()));            \
+        mpfr_##func(                                                           \
+            result.impl(),                                                     \
+            arg1.impl(),                                                       \
+            arg2.impl(),                                                       \
+            detail::roundingForMPFR(context.rounding)                          \
+        );                                                                     \
+    }                                                                          \
+                                                                               \
+    auto Functions::func(Scalar const& arg1, Scalar const& arg2) -> Scalar     \
     {                                                                          \
         Scalar result{                                                         \
-            Scalar::no_set{},                                                  \
-            static_cast<size_t>(mpfr_get_prec(arg1.p_impl.get()))              \
+            Scalar::no_set{}, std::max(arg1.precision(), arg2.precision())     \
         };                                                                     \
-        mpfr_##func(result.p_impl.get(), arg1.p_impl.get());                   \
+        func(result, arg1, arg2, MathContext::current());                      \
         return result;                                                         \
     }
 
 namespace calqmath
 {
+void Functions::setPrecision(Scalar& result, size_t const precision)
+{
+    if (result.precision() != precision)
+    {
+        result = Scalar{Scalar::no_set{}, precision};
+    }
+}
+
 auto Functions::id(Scalar const& number) -> Scalar { return number; }
+
+void Functions::id(
+    Scalar& result, Scalar const& argument, MathContext const& /*context*/
+)
+{
+    setPrecision(result, argument.precision());
+    mpfr_set(result.impl(), argument.impl(), MPFR_RNDN);
+}
 WRAP_UNARY_SCALAR(abs, argument);
 
 /**
@@ -45,46 +99,159 @@ WRAP_UNARY_SCALAR_NO_ROUND(floor, argument);
 WRAP_UNARY_SCALAR_NO_ROUND(round, argument);
 auto Functions::roundeven(Scalar const& argument) -> Scalar
 {
-    Scalar result{
-        Scalar::no_set{},
-        static_cast<size_t>(mpfr_get_prec(argument.p_impl.get()))
-    };
-    mpfr_rint(result.p_impl.get(), argument.p_impl.get(), MPFR_RNDN);
+    Scalar result{Scalar::no_set{}, argument.precision()};
+    roundeven(result, argument, MathContext::current());
     return result;
 }
+
+void Functions::roundeven(
+    Scalar& result, Scalar const& argument, MathContext const& /*context*/
+)
+{
+    setPrecision(result, argument.precision());
+    mpfr_rint(result.impl(), argument.impl(), MPFR_RNDN);
+}
 WRAP_UNARY_SCALAR_NO_ROUND(trunc, argument);
 
 WRAP_UNARY_SCALAR(sqrt, argument);
 WRAP_UNARY_SCALAR(cbrt, argument);
 
+#define WRAP_BINARY_IN_PLACE(func, mpfrFunc)                                   \
+    void Functions::func(Scalar& result, Scalar const& lhs, Scalar const& rhs) \
+    {                                                                          \
+        result.widen(std::max(lhs.precision(), rhs.precision()));              \
+        mpfrFunc(                                                              \
+            result.impl(),                                                     \
+            lhs.impl(),                                                        \
+            rhs.impl(),                                                        \
+            detail::currentRoundingForMPFR()                                   \
+        );                                                                     \
+    }
+
+WRAP_BINARY_IN_PLACE(add, mpfr_add);
+WRAP_BINARY_IN_PLACE(subtract, mpfr_sub);
+WRAP_BINARY_IN_PLACE(multiply, mpfr_mul);
+WRAP_BINARY_IN_PLACE(divide, mpfr_div);
+
+void Functions::negate(Scalar& result, Scalar const& argument)
+{
+    result.widen(argument.precision());
+    mpfr_neg(result.impl(), argument.impl(), detail::currentRoundingForMPFR());
+}
+
+WRAP_UNARY_SCALAR(sqr, argument);
+
+void Functions::sqr(Scalar& result, Scalar const& argument)
+{
+    result.widen(argument.precision());
+    mpfr_sqr(result.impl(), argument.impl(), detail::currentRoundingForMPFR());
+}
+
+auto Functions::fma(
+    Scalar const& lhs, Scalar const& rhs, Scalar const& addend
+) -> Scalar
+{
+    Scalar result{
+        Scalar::no_set{},
+        std::max({lhs.precision(), rhs.precision(), addend.precision()})
+    };
+    fma(result, lhs, rhs, addend);
+    return result;
+}
+
+void Functions::fma(
+    Scalar& result, Scalar const& lhs, Scalar const& rhs, Scalar const& addend
+)
+{
+    result.widen(
+        std::max({lhs.precision(), rhs.precision(), addend.precision()})
+    );
+    mpfr_fma(
+        result.impl(),
+        lhs.impl(),
+        rhs.impl(),
+        addend.impl(),
+        detail::currentRoundingForMPFR()
+    );
+}
+
+auto Functions::fms(
+    Scalar const& lhs, Scalar const& rhs, Scalar const& subtrahend
+) -> Scalar
+{
+    Scalar result{
+        Scalar::no_set{},
+        std::max({lhs.precision(), rhs.precision(), subtrahend.precision()})
+    };
+    fms(result, lhs, rhs, subtrahend);
+    return result;
+}
+
+void Functions::fms(
+    Scalar& result,
+    Scalar const& lhs,
+    Scalar const& rhs,
+    Scalar const& subtrahend
+)
+{
+    result.widen(
+        std::max({lhs.precision(), rhs.precision(), subtrahend.precision()})
+    );
+    mpfr_fms(
+        result.impl(),
+        lhs.impl(),
+        rhs.impl(),
+        subtrahend.impl(),
+        detail::currentRoundingForMPFR()
+    );
+}
+
 WRAP_UNARY_SCALAR(exp, exponent);
 
 WRAP_UNARY_SCALAR(log, argument);
 WRAP_UNARY_SCALAR(log2, argument);
 
+WRAP_BINARY_SCALAR(pow, base, exponent);
+
 auto Functions::logn(Scalar const& base, Scalar const& argument) -> Scalar
 {
-    auto const precision{std::max(
-        mpfr_get_prec(base.p_impl.get()), mpfr_get_prec(argument.p_impl.get())
-    )};
-    Scalar result{Scalar::no_set{}, static_cast<size_t>(precision)};
+    Scalar result{
+        Scalar::no_set{}, std::max(base.precision(), argument.precision())
+    };
+    logn(result, base, argument, MathContext::current());
+    return result;
+}
 
-    auto numerator = log(argument);
-    auto denominator = log(base);
+void Functions::logn(
+    Scalar& result,
+    Scalar const& base,
+    Scalar const& argument,
+    MathContext const& context
+)
+{
+    // Both are taken before writing, since the result may alias either.
+    Scalar numerator{Scalar::no_set{}, argument.precision()};
+    log(numerator, argument, context);
+    Scalar denominator{Scalar::no_set{}, base.precision()};
+    log(denominator, base, context);
 
+    result.widen(std::max(base.precision(), argument.precision()));
     mpfr_div(
-        result.p_impl.get(),
-        numerator.p_impl.get(),
-        denominator.p_impl.get(),
-        mpfr_get_default_rounding_mode()
+        result.impl(),
+        numerator.impl(),
+        denominator.impl(),
+        detail::roundingForMPFR(context.rounding)
     );
-
-    return result;
 }
 
+WRAP_BINARY_SCALAR(hypot, x, y);
+WRAP_BINARY_SCALAR(min, lhs, rhs);
+WRAP_BINARY_SCALAR(max, lhs, rhs);
+
 WRAP_UNARY_SCALAR(erf, argument);
 WRAP_UNARY_SCALAR(erfc, argument);
 WRAP_UNARY_SCALAR(gamma, argument);
+WRAP_UNARY_SCALAR(digamma, argument);
 
 WRAP_UNARY_SCALAR(sin, radians);
 WRAP_UNARY_SCALAR(csc, radians);
@@ -95,6 +262,7 @@ WRAP_UNARY_SCALAR(acos, argument);
 WRAP_UNARY_SCALAR(tan, radians);
 WRAP_UNARY_SCALAR(cot, radians);
 WRAP_UNARY_SCALAR(atan, argument);
+WRAP_BINARY_SCALAR(atan2, y, x);
 
 WRAP_UNARY_SCALAR(sinh, argument);
 WRAP_UNARY_SCALAR(cosh, argument);
@@ -103,4 +271,80 @@ WRAP_UNARY_SCALAR(asinh, argument);
 WRAP_UNARY_SCALAR(acosh, argument);
 WRAP_UNARY_SCALAR(atanh, argument);
 
+#define WRAP_UNARY_DOUBLE(func, arg1, expression)                              \
+    auto Functions::func(double arg1) -> double { return expression; }
+
+WRAP_UNARY_DOUBLE(id, number, number);
+WRAP_UNARY_DOUBLE(abs, argument, std::fabs(argument));
+WRAP_UNARY_DOUBLE(ceil, argument, std::ceil(argument));
+WRAP_UNARY_DOUBLE(floor, argument, std::floor(argument));
+WRAP_UNARY_DOUBLE(round, argument, std::round(argument));
+// The default floating point environment rounds to nearest, ties to even
+WRAP_UNARY_DOUBLE(roundeven, argument, std::nearbyint(argument));
+WRAP_UNARY_DOUBLE(trunc, argument, std::trunc(argument));
+
+WRAP_UNARY_DOUBLE(sqrt, argument, std::sqrt(argument));
+WRAP_UNARY_DOUBLE(cbrt, argument, std::cbrt(argument));
+
+WRAP_UNARY_DOUBLE(exp, exponent, std::exp(exponent));
+WRAP_UNARY_DOUBLE(log, argument, std::log(argument));
+WRAP_UNARY_DOUBLE(log2, argument, std::log2(argument));
+
+WRAP_UNARY_DOUBLE(erf, argument, std::erf(argument));
+WRAP_UNARY_DOUBLE(erfc, argument, std::erfc(argument));
+WRAP_UNARY_DOUBLE(gamma, argument, std::tgamma(argument));
+
+WRAP_UNARY_DOUBLE(sin, radians, std::sin(radians));
+WRAP_UNARY_DOUBLE(csc, radians, 1.0 / std::sin(radians));
+WRAP_UNARY_DOUBLE(asin, argument, std::asin(argument));
+WRAP_UNARY_DOUBLE(cos, radians, std::cos(radians));
+WRAP_UNARY_DOUBLE(sec, radians, 1.0 / std::cos(radians));
+WRAP_UNARY_DOUBLE(acos, argument, std::acos(argument));
+WRAP_UNARY_DOUBLE(tan, radians, std::tan(radians));
+WRAP_UNARY_DOUBLE(cot, radians, 1.0 / std::tan(radians));
+WRAP_UNARY_DOUBLE(atan, argument, std::atan(argument));
+
+WRAP_UNARY_DOUBLE(sinh, argument, std::sinh(argument));
+WRAP_UNARY_DOUBLE(cosh, argument, std::cosh(argument));
+WRAP_UNARY_DOUBLE(tanh, argument, std::tanh(argument));
+WRAP_UNARY_DOUBLE(asinh, argument, std::asinh(argument));
+WRAP_UNARY_DOUBLE(acosh, argument, std::acosh(argument));
+WRAP_UNARY_DOUBLE(atanh, argument, std::atanh(argument));
+
+auto Functions::pow(double const base, double const exponent) -> double
+{
+    return std::pow(base, exponent);
+}
+
+auto Functions::logn(double const base, double const argument) -> double
+{
+    return std::log(argument) / std::log(base);
+}
+
+auto Functions::atan2(double const y, double const x) -> double
+{
+    return std::atan2(y, x);
+}
+
+auto Functions::hypot(double const x, double const y) -> double
+{
+    return std::hypot(x, y);
+}
+
+auto Functions::min(double const lhs, double const rhs) -> double
+{
+    return std::fmin(lhs, rhs);
+}
+
+auto Functions::max(double const lhs, double const rhs) -> double
+{
+    return std::fmax(lhs, rhs);
+}
+
+auto Functions::fma(double const lhs, double const rhs, double const addend)
+    -> double
+{
+    return std::fma(lhs, rhs, addend);
+}
+
 } // namespace calqmath
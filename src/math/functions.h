@@ -1,6 +1,12 @@
 #pragma once
 
+#include "interval.h"
+#include "jet.h"
+#include "multidouble.h"
 #include "number.h"
+#include "scalarvector.h"
+#include <cstddef>
+#include <span>
 
 namespace calqmath
 {
@@ -32,6 +38,45 @@ public:
     static auto sqrt(Scalar const& argument) -> Scalar;
     // Cube root.
     static auto cbrt(Scalar const& argument) -> Scalar;
+    /*
+     * In place arithmetic, writing into an existing result which may alias
+     * either argument. The result's precision grows to the largest argument
+     * precision if needed, so reusing a result avoids reallocating it.
+     */
+    static void add(Scalar& result, Scalar const& lhs, Scalar const& rhs);
+    static void subtract(Scalar& result, Scalar const& lhs, Scalar const& rhs);
+    static void multiply(Scalar& result, Scalar const& lhs, Scalar const& rhs);
+    static void divide(Scalar& result, Scalar const& lhs, Scalar const& rhs);
+    static void negate(Scalar& result, Scalar const& argument);
+
+    // Square, cheaper than multiplying a value by itself.
+    static auto sqr(Scalar const& argument) -> Scalar;
+    // Fused multiply-add, computing lhs * rhs + addend with a single rounding.
+    static auto fma(Scalar const& lhs, Scalar const& rhs, Scalar const& addend)
+        -> Scalar;
+    // Fused multiply-subtract, computing lhs * rhs - subtrahend with a single
+    // rounding.
+    static auto
+    fms(Scalar const& lhs, Scalar const& rhs, Scalar const& subtrahend)
+        -> Scalar;
+    /*
+     * In place variants of the above, which write into an existing result.
+     * The result may alias any argument, and its precision grows to the
+     * largest argument precision if needed.
+     */
+    static void sqr(Scalar& result, Scalar const& argument);
+    static void fma(
+        Scalar& result,
+        Scalar const& lhs,
+        Scalar const& rhs,
+        Scalar const& addend
+    );
+    static void fms(
+        Scalar& result,
+        Scalar const& lhs,
+        Scalar const& rhs,
+        Scalar const& subtrahend
+    );
     // Natural exponentation, of Euler's constant raised to exponent.
     static auto exp(Scalar const& exponent) -> Scalar;
     // Exponentation of arbitrary base.
@@ -42,12 +87,19 @@ public:
     static auto log2(Scalar const& argument) -> Scalar;
     // Logarithm of arbitrary base.
     static auto logn(Scalar const& base, Scalar const& argument) -> Scalar;
+    // Euclidean norm of (x, y), without overflowing in between.
+    static auto hypot(Scalar const& x, Scalar const& y) -> Scalar;
+    // The smaller and the larger argument. A NaN argument gives the other one.
+    static auto min(Scalar const& lhs, Scalar const& rhs) -> Scalar;
+    static auto max(Scalar const& lhs, Scalar const& rhs) -> Scalar;
     // Error function.
     static auto erf(Scalar const& argument) -> Scalar;
     // Complementary error function, equal to 1 - erf.
     static auto erfc(Scalar const& argument) -> Scalar;
     // Gamma function, the analytic continuation of factorial.
     static auto gamma(Scalar const& argument) -> Scalar;
+    // Digamma function, the logarithmic derivative of gamma.
+    static auto digamma(Scalar const& argument) -> Scalar;
 
     // Trigonometric sine.
     static auto sin(Scalar const& radians) -> Scalar;
@@ -67,6 +119,8 @@ public:
     static auto cot(Scalar const& radians) -> Scalar;
     // Trigonometric arctan, with result in the range [-pi/2, pi/2].
     static auto atan(Scalar const& argument) -> Scalar;
+    // Angle of the point (x, y) from the positive x axis, in [-pi, pi].
+    static auto atan2(Scalar const& y, Scalar const& x) -> Scalar;
     // Hyperbolic sine.
     static auto sinh(Scalar const& argument) -> Scalar;
     // Hyperbolic cosine.
@@ -79,5 +133,454 @@ public:
     static auto acosh(Scalar const& argument) -> Scalar;
     // Hyperbolic tangent inverse.
     static auto atanh(Scalar const& argument) -> Scalar;
+
+    /*
+     * In place variants of the unary functions above, for evaluators. The
+     * result takes the argument's precision, keeping its storage if it already
+     * has it, and may alias the argument. Rounding follows context, which must
+     * be the calling thread's current one, since the exponent range is taken
+     * from there.
+     */
+    static void
+    id(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    abs(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    ceil(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    floor(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    round(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void roundeven(
+        Scalar& result, Scalar const& argument, MathContext const& context
+    );
+    static void
+    trunc(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    sqrt(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    cbrt(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    sqr(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    exp(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    log(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    log2(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    erf(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    erfc(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    gamma(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    digamma(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    sin(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    csc(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    asin(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    cos(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    sec(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    acos(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    tan(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    cot(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    atan(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    sinh(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    cosh(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    tanh(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    asinh(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    acosh(Scalar& result, Scalar const& argument, MathContext const& context);
+    static void
+    atanh(Scalar& result, Scalar const& argument, MathContext const& context);
+
+    /*
+     * In place variants of the functions of two arguments. As with the
+     * arithmetic, the result may alias either argument and its precision grows
+     * to the largest argument precision if needed. Rounding follows context,
+     * as above.
+     */
+    static void pow(
+        Scalar& result,
+        Scalar const& base,
+        Scalar const& exponent,
+        MathContext const& context
+    );
+    static void logn(
+        Scalar& result,
+        Scalar const& base,
+        Scalar const& argument,
+        MathContext const& context
+    );
+    static void atan2(
+        Scalar& result,
+        Scalar const& y,
+        Scalar const& x,
+        MathContext const& context
+    );
+    static void hypot(
+        Scalar& result,
+        Scalar const& x,
+        Scalar const& y,
+        MathContext const& context
+    );
+    static void min(
+        Scalar& result,
+        Scalar const& lhs,
+        Scalar const& rhs,
+        MathContext const& context
+    );
+    static void max(
+        Scalar& result,
+        Scalar const& lhs,
+        Scalar const& rhs,
+        MathContext const& context
+    );
+
+    /*
+     * Hardware double precision variants of the functions above, for
+     * callers that only need about 53 bits. These go through the C library,
+     * so accuracy is whatever the platform provides and MathContext does not
+     * apply.
+     */
+    static auto id(double number) -> double;
+    static auto abs(double argument) -> double;
+    static auto ceil(double argument) -> double;
+    static auto floor(double argument) -> double;
+    static auto round(double argument) -> double;
+    static auto roundeven(double argument) -> double;
+    static auto trunc(double argument) -> double;
+    static auto sqrt(double argument) -> double;
+    static auto cbrt(double argument) -> double;
+    static auto exp(double exponent) -> double;
+    static auto log(double argument) -> double;
+    static auto log2(double argument) -> double;
+    static auto erf(double argument) -> double;
+    static auto erfc(double argument) -> double;
+    static auto gamma(double argument) -> double;
+    static auto sin(double radians) -> double;
+    static auto csc(double radians) -> double;
+    static auto asin(double argument) -> double;
+    static auto cos(double radians) -> double;
+    static auto sec(double radians) -> double;
+    static auto acos(double argument) -> double;
+    static auto tan(double radians) -> double;
+    static auto cot(double radians) -> double;
+    static auto atan(double argument) -> double;
+    static auto sinh(double argument) -> double;
+    static auto cosh(double argument) -> double;
+    static auto tanh(double argument) -> double;
+    static auto asinh(double argument) -> double;
+    static auto acosh(double argument) -> double;
+    static auto atanh(double argument) -> double;
+    static auto pow(double base, double exponent) -> double;
+    static auto logn(double base, double argument) -> double;
+    static auto atan2(double y, double x) -> double;
+    static auto hypot(double x, double y) -> double;
+    static auto min(double lhs, double rhs) -> double;
+    static auto max(double lhs, double rhs) -> double;
+    static auto fma(double lhs, double rhs, double addend) -> double;
+
+    /*
+     * Batched hardware double variants, writing each function of
+     * arguments[i] into results[i]. The spans must have the same size, and may
+     * be the same span. Unlike the double overloads these do not go through
+     * the C library, the kernels are written for the compiler to vectorize.
+     *
+     * Maximum errors in units in the last place, measured against MPFR:
+     *   1      abs, ceil, floor, id, round, roundeven, sqrt, trunc are exact
+     *   2      exp, log, log2, atan, acos, erf
+     *   3      cbrt, sin, cos, csc, sec, asin, sinh, cosh, tanh, asinh, acosh,
+     *          atanh
+     *   4      tan, cot
+     *   5      erfc
+     *   20     gamma, growing with the argument as the recurrence lengthens
+     * Sine family arguments beyond 2^20 are reduced by the C library, and
+     * results that are subnormal may lose further bits.
+     */
+    static void id(std::span<double const> numbers, std::span<double> results);
+    static void
+    abs(std::span<double const> arguments, std::span<double> results);
+    static void
+    ceil(std::span<double const> arguments, std::span<double> results);
+    static void
+    floor(std::span<double const> arguments, std::span<double> results);
+    static void
+    round(std::span<double const> arguments, std::span<double> results);
+    static void
+    roundeven(std::span<double const> arguments, std::span<double> results);
+    static void
+    trunc(std::span<double const> arguments, std::span<double> results);
+    static void
+    sqrt(std::span<double const> arguments, std::span<double> results);
+    static void
+    cbrt(std::span<double const> arguments, std::span<double> results);
+    static void
+    exp(std::span<double const> exponents, std::span<double> results);
+    static void
+    log(std::span<double const> arguments, std::span<double> results);
+    static void
+    log2(std::span<double const> arguments, std::span<double> results);
+    static void
+    erf(std::span<double const> arguments, std::span<double> results);
+    static void
+    erfc(std::span<double const> arguments, std::span<double> results);
+    static void
+    gamma(std::span<double const> arguments, std::span<double> results);
+    static void sin(std::span<double const> radians, std::span<double> results);
+    static void csc(std::span<double const> radians, std::span<double> results);
+    static void
+    asin(std::span<double const> arguments, std::span<double> results);
+    static void cos(std::span<double const> radians, std::span<double> results);
+    static void sec(std::span<double const> radians, std::span<double> results);
+    static void
+    acos(std::span<double const> arguments, std::span<double> results);
+    static void tan(std::span<double const> radians, std::span<double> results);
+    static void cot(std::span<double const> radians, std::span<double> results);
+    static void
+    atan(std::span<double const> arguments, std::span<double> results);
+    static void
+    sinh(std::span<double const> arguments, std::span<double> results);
+    static void
+    cosh(std::span<double const> arguments, std::span<double> results);
+    static void
+    tanh(std::span<double const> arguments, std::span<double> results);
+    static void
+    asinh(std::span<double const> arguments, std::span<double> results);
+    static void
+    acosh(std::span<double const> arguments, std::span<double> results);
+    static void
+    atanh(std::span<double const> arguments, std::span<double> results);
+
+    /*
+     * Elementwise variants over ScalarVector, writing into an existing results
+     * vector of the same size, which may be the argument itself. The results'
+     * precision grows to the argument's if needed, so reused results are not
+     * reallocated.
+     */
+    static void id(ScalarVector const& numbers, ScalarVector& results);
+    static void abs(ScalarVector const& argument, ScalarVector& results);
+    static void ceil(ScalarVector const& argument, ScalarVector& results);
+    static void floor(ScalarVector const& argument, ScalarVector& results);
+    static void round(ScalarVector const& argument, ScalarVector& results);
+    static void roundeven(ScalarVector const& argument, ScalarVector& results);
+    static void trunc(ScalarVector const& argument, ScalarVector& results);
+    static void sqrt(ScalarVector const& argument, ScalarVector& results);
+    static void cbrt(ScalarVector const& argument, ScalarVector& results);
+    static void exp(ScalarVector const& exponent, ScalarVector& results);
+    static void log(ScalarVector const& argument, ScalarVector& results);
+    static void log2(ScalarVector const& argument, ScalarVector& results);
+    static void erf(ScalarVector const& argument, ScalarVector& results);
+    static void erfc(ScalarVector const& argument, ScalarVector& results);
+    static void gamma(ScalarVector const& argument, ScalarVector& results);
+    static void sin(ScalarVector const& radians, ScalarVector& results);
+    static void csc(ScalarVector const& radians, ScalarVector& results);
+    static void asin(ScalarVector const& argument, ScalarVector& results);
+    static void cos(ScalarVector const& radians, ScalarVector& results);
+    static void sec(ScalarVector const& radians, ScalarVector& results);
+    static void acos(ScalarVector const& argument, ScalarVector& results);
+    static void tan(ScalarVector const& radians, ScalarVector& results);
+    static void cot(ScalarVector const& radians, ScalarVector& results);
+    static void atan(ScalarVector const& argument, ScalarVector& results);
+    static void sinh(ScalarVector const& argument, ScalarVector& results);
+    static void cosh(ScalarVector const& argument, ScalarVector& results);
+    static void tanh(ScalarVector const& argument, ScalarVector& results);
+    static void asinh(ScalarVector const& argument, ScalarVector& results);
+    static void acosh(ScalarVector const& argument, ScalarVector& results);
+    static void atanh(ScalarVector const& argument, ScalarVector& results);
+    /*
+     * Elementwise arithmetic into an existing result, which may alias any
+     * argument. A Scalar argument is used for every element.
+     */
+    static void
+    add(ScalarVector& result, ScalarVector const& lhs, ScalarVector const& rhs);
+    static void
+    add(ScalarVector& result, ScalarVector const& lhs, Scalar const& rhs);
+    static void
+    add(ScalarVector& result, Scalar const& lhs, ScalarVector const& rhs);
+    static void subtract(
+        ScalarVector& result, ScalarVector const& lhs, ScalarVector const& rhs
+    );
+    static void
+    subtract(ScalarVector& result, ScalarVector const& lhs, Scalar const& rhs);
+    static void
+    subtract(ScalarVector& result, Scalar const& lhs, ScalarVector const& rhs);
+    static void multiply(
+        ScalarVector& result, ScalarVector const& lhs, ScalarVector const& rhs
+    );
+    static void
+    multiply(ScalarVector& result, ScalarVector const& lhs, Scalar const& rhs);
+    static void
+    multiply(ScalarVector& result, Scalar const& lhs, ScalarVector const& rhs);
+    static void divide(
+        ScalarVector& result, ScalarVector const& lhs, ScalarVector const& rhs
+    );
+    static void
+    divide(ScalarVector& result, ScalarVector const& lhs, Scalar const& rhs);
+    static void
+    divide(ScalarVector& result, Scalar const& lhs, ScalarVector const& rhs);
+    static void negate(ScalarVector& result, ScalarVector const& argument);
+    static void sqr(ScalarVector& result, ScalarVector const& argument);
+    static void fma(
+        ScalarVector& result,
+        ScalarVector const& lhs,
+        ScalarVector const& rhs,
+        ScalarVector const& addend
+    );
+
+    /*
+     * Interval variants of the unary functions above, enclosing the image of
+     * the whole argument. Poles inside the argument give the entire line and
+     * mark the result discontinuous, see Interval::continuous.
+     */
+    static auto id(Interval const& number) -> Interval;
+    static auto abs(Interval const& argument) -> Interval;
+    static auto ceil(Interval const& argument) -> Interval;
+    static auto floor(Interval const& argument) -> Interval;
+    static auto round(Interval const& argument) -> Interval;
+    static auto roundeven(Interval const& argument) -> Interval;
+    static auto trunc(Interval const& argument) -> Interval;
+    static auto sqrt(Interval const& argument) -> Interval;
+    static auto cbrt(Interval const& argument) -> Interval;
+    static auto exp(Interval const& exponent) -> Interval;
+    static auto log(Interval const& argument) -> Interval;
+    static auto log2(Interval const& argument) -> Interval;
+    static auto erf(Interval const& argument) -> Interval;
+    static auto erfc(Interval const& argument) -> Interval;
+    static auto gamma(Interval const& argument) -> Interval;
+    static auto sin(Interval const& radians) -> Interval;
+    static auto csc(Interval const& radians) -> Interval;
+    static auto asin(Interval const& argument) -> Interval;
+    static auto cos(Interval const& radians) -> Interval;
+    static auto sec(Interval const& radians) -> Interval;
+    static auto acos(Interval const& argument) -> Interval;
+    static auto tan(Interval const& radians) -> Interval;
+    static auto cot(Interval const& radians) -> Interval;
+    static auto atan(Interval const& argument) -> Interval;
+    static auto sinh(Interval const& argument) -> Interval;
+    static auto cosh(Interval const& argument) -> Interval;
+    static auto tanh(Interval const& argument) -> Interval;
+    static auto asinh(Interval const& argument) -> Interval;
+    static auto acosh(Interval const& argument) -> Interval;
+    static auto atanh(Interval const& argument) -> Interval;
+
+    /*
+     * Jet variants of the unary functions above, carrying the first two
+     * derivatives through the chain rule, see Jet.
+     */
+    static auto id(Jet const& number) -> Jet;
+    static auto abs(Jet const& argument) -> Jet;
+    static auto ceil(Jet const& argument) -> Jet;
+    static auto floor(Jet const& argument) -> Jet;
+    static auto round(Jet const& argument) -> Jet;
+    static auto roundeven(Jet const& argument) -> Jet;
+    static auto trunc(Jet const& argument) -> Jet;
+    static auto sqrt(Jet const& argument) -> Jet;
+    static auto cbrt(Jet const& argument) -> Jet;
+    static auto exp(Jet const& exponent) -> Jet;
+    static auto log(Jet const& argument) -> Jet;
+    static auto log2(Jet const& argument) -> Jet;
+    static auto erf(Jet const& argument) -> Jet;
+    static auto erfc(Jet const& argument) -> Jet;
+    static auto gamma(Jet const& argument) -> Jet;
+    static auto sin(Jet const& radians) -> Jet;
+    static auto csc(Jet const& radians) -> Jet;
+    static auto asin(Jet const& argument) -> Jet;
+    static auto cos(Jet const& radians) -> Jet;
+    static auto sec(Jet const& radians) -> Jet;
+    static auto acos(Jet const& argument) -> Jet;
+    static auto tan(Jet const& radians) -> Jet;
+    static auto cot(Jet const& radians) -> Jet;
+    static auto atan(Jet const& argument) -> Jet;
+    static auto sinh(Jet const& argument) -> Jet;
+    static auto cosh(Jet const& argument) -> Jet;
+    static auto tanh(Jet const& argument) -> Jet;
+    static auto asinh(Jet const& argument) -> Jet;
+    static auto acosh(Jet const& argument) -> Jet;
+    static auto atanh(Jet const& argument) -> Jet;
+
+    /*
+     * Extended precision variants for the DoubleDouble and QuadDouble
+     * backends. These are computed in MultiDouble arithmetic, except for erf,
+     * erfc and gamma which round trip through Scalar. Trigonometric arguments
+     * are reduced with an N-double pi, so accuracy drops for huge arguments.
+     */
+    template <size_t N>
+    static auto id(MultiDouble<N> const& number) -> MultiDouble<N>;
+    template <size_t N>
+    static auto abs(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto ceil(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto floor(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto round(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto roundeven(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto trunc(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto sqrt(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto cbrt(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto exp(MultiDouble<N> const& exponent) -> MultiDouble<N>;
+    template <size_t N>
+    static auto log(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto log2(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto erf(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto erfc(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto gamma(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto sin(MultiDouble<N> const& radians) -> MultiDouble<N>;
+    template <size_t N>
+    static auto csc(MultiDouble<N> const& radians) -> MultiDouble<N>;
+    template <size_t N>
+    static auto asin(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto cos(MultiDouble<N> const& radians) -> MultiDouble<N>;
+    template <size_t N>
+    static auto sec(MultiDouble<N> const& radians) -> MultiDouble<N>;
+    template <size_t N>
+    static auto acos(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto tan(MultiDouble<N> const& radians) -> MultiDouble<N>;
+    template <size_t N>
+    static auto cot(MultiDouble<N> const& radians) -> MultiDouble<N>;
+    template <size_t N>
+    static auto atan(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto sinh(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto cosh(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto tanh(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto asinh(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto acosh(MultiDouble<N> const& argument) -> MultiDouble<N>;
+    template <size_t N>
+    static auto atanh(MultiDouble<N> const& argument) -> MultiDouble<N>;
+
+private:
+    // Gives result the precision, discarding its value if that changes it.
+    static void setPrecision(Scalar& result, size_t precision);
 };
 } // namespace calqmath
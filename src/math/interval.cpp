@@ -0,0 +1,601 @@
+#include "interval.h"
+
+#include "functions.h"
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace calqmath
+{
+namespace
+{
+double constexpr INFINITY_DOUBLE = std::numeric_limits<double>::infinity();
+
+/*
+ * Evaluates a bound with the calling thread's rounding replaced. Outward
+ * rounding is what makes the enclosure hold regardless of precision.
+ */
+template <typename Function>
+auto rounded(RoundingMode const rounding, Function const& function) -> Scalar
+{
+    MathContext context{MathContext::current()};
+    context.rounding = rounding;
+    MathContextScope const scope{context};
+    return function();
+}
+
+template <typename Function> auto roundedDown(Function const& function)
+{
+    return rounded(RoundingMode::TOWARD_NEGATIVE, function);
+}
+
+template <typename Function> auto roundedUp(Function const& function)
+{
+    return rounded(RoundingMode::TOWARD_POSITIVE, function);
+}
+
+auto minimum(Scalar const& lhs, Scalar const& rhs) -> Scalar const&
+{
+    return rhs < lhs ? rhs : lhs;
+}
+
+auto maximum(Scalar const& lhs, Scalar const& rhs) -> Scalar const&
+{
+    return rhs > lhs ? rhs : lhs;
+}
+
+// Bound products take 0 * inf to be 0, since an infinite bound is never
+// attained.
+auto boundProduct(Scalar const& lhs, Scalar const& rhs) -> Scalar
+{
+    if (lhs.sign() == Sign::ZERO || rhs.sign() == Sign::ZERO)
+    {
+        return Scalar{0.0, std::max(lhs.precision(), rhs.precision())};
+    }
+    return lhs * rhs;
+}
+
+// Where an elementary function is defined.
+struct Domain
+{
+    double lower;
+    double upper;
+    // Whether finite endpoints are poles, rather than part of the domain.
+    bool open;
+};
+
+Domain constexpr REAL_LINE{-INFINITY_DOUBLE, INFINITY_DOUBLE, false};
+
+/*
+ * Restricts x to a domain. The result is only continuous if nothing had to be
+ * cut off and no pole was touched.
+ */
+auto clip(Interval const& x, Domain const& domain) -> Interval
+{
+    if (x.isEmpty())
+    {
+        return x;
+    }
+
+    size_t const precision{x.precision()};
+    Scalar const domainLower{domain.lower, precision};
+    Scalar const domainUpper{domain.upper, precision};
+
+    Scalar const& lower{maximum(x.lower(), domainLower)};
+    Scalar const& upper{minimum(x.upper(), domainUpper)};
+    if (lower > upper)
+    {
+        return Interval::empty(precision);
+    }
+
+    bool const inside{x.lower() >= domainLower && x.upper() <= domainUpper};
+    bool const touchesPole{
+        domain.open
+        && ((std::isfinite(domain.lower) && lower == domainLower)
+            || (std::isfinite(domain.upper) && upper == domainUpper))
+    };
+
+    return {lower, upper, x.continuous() && inside && !touchesPole};
+}
+
+enum class Monotonicity : uint8_t
+{
+    INCREASING,
+    DECREASING,
+};
+
+// The image of x under a function that is monotonic over its whole domain.
+auto monotonic(
+    Interval const& x,
+    Scalar (*function)(Scalar const&),
+    Monotonicity const monotonicity,
+    Domain const& domain = REAL_LINE
+) -> Interval
+{
+    auto const clipped{clip(x, domain)};
+    if (clipped.isEmpty())
+    {
+        return clipped;
+    }
+
+    bool const increasing{monotonicity == Monotonicity::INCREASING};
+    auto const& first{increasing ? clipped.lower() : clipped.upper()};
+    auto const& last{increasing ? clipped.upper() : clipped.lower()};
+    return {
+        roundedDown([&] { return function(first); }),
+        roundedUp([&] { return function(last); }),
+        clipped.continuous()
+    };
+}
+
+// Like monotonic, for the rounding functions which jump at every integer.
+auto step(Interval const& x, Scalar (*function)(Scalar const&)) -> Interval
+{
+    if (x.isEmpty())
+    {
+        return x;
+    }
+
+    // Rounding to an integer is exact, no outward rounding needed
+    auto lower{function(x.lower())};
+    auto upper{function(x.upper())};
+    bool const constant{lower == upper};
+    return {std::move(lower), std::move(upper), x.continuous() && constant};
+}
+
+auto pi(size_t const precision) -> Interval
+{
+    auto const function = [precision]
+    { return Functions::acos(Scalar{-1.0, precision}); };
+    return {roundedDown(function), roundedUp(function)};
+}
+
+/*
+ * Whether x may contain a point (offset + k * period) * pi for some integer k.
+ * Used to find the extrema and poles of the trigonometric functions, erring
+ * on the side of yes.
+ */
+auto mayContainMultiple(
+    Interval const& x, double const offset, double const period
+) -> bool
+{
+    size_t const precision{x.precision()};
+    auto const turns{
+        (x / pi(precision) - Interval{offset, precision})
+        / Interval{period, precision}
+    };
+    return Functions::floor(turns.upper()) >= turns.lower();
+}
+
+// The image of x under a function with a pole at every (offset + k) * pi,
+// and which is monotonic between them.
+auto periodicPoles(
+    Interval const& x,
+    Scalar (*function)(Scalar const&),
+    Monotonicity const monotonicity,
+    double const offset
+) -> Interval
+{
+    if (x.isEmpty())
+    {
+        return x;
+    }
+    if (mayContainMultiple(x, offset, 1.0))
+    {
+        return Interval::entire(false, x.precision());
+    }
+    return monotonic(x, function, monotonicity);
+}
+
+/*
+ * The image of x under sine or cosine, given where their maxima lie. Between
+ * an extremum and the next, both are monotonic.
+ */
+auto sinusoid(
+    Interval const& x,
+    Scalar (*function)(Scalar const&),
+    double const maximumOffset
+) -> Interval
+{
+    if (x.isEmpty())
+    {
+        return x;
+    }
+
+    size_t const precision{x.precision()};
+    double constexpr PERIOD{2.0};
+
+    Scalar lower{-1.0, precision};
+    if (!mayContainMultiple(x, maximumOffset + 1.0, PERIOD))
+    {
+        lower = roundedDown(
+            [&] { return minimum(function(x.lower()), function(x.upper())); }
+        );
+    }
+
+    Scalar upper{1.0, precision};
+    if (!mayContainMultiple(x, maximumOffset, PERIOD))
+    {
+        upper = roundedUp(
+            [&] { return maximum(function(x.lower()), function(x.upper())); }
+        );
+    }
+
+    return {std::move(lower), std::move(upper), x.continuous()};
+}
+
+auto absolute(Interval const& x) -> Interval
+{
+    if (x.isEmpty() || x.lower().sign() != Sign::NEGATIVE)
+    {
+        return x;
+    }
+    if (x.upper().sign() != Sign::POSITIVE)
+    {
+        return -x;
+    }
+
+    return {
+        Scalar{0.0, x.precision()},
+        maximum(-x.lower(), x.upper()),
+        x.continuous()
+    };
+}
+
+/*
+ * Gamma has poles at the non-positive integers. On the positive axis it has a
+ * single minimum, bracketed below, and between poles on the negative axis its
+ * magnitude is log-convex, so it is largest at the ends.
+ */
+double constexpr GAMMA_MINIMUM_ARGUMENT_LOWER = 1.4616321449683;
+double constexpr GAMMA_MINIMUM_ARGUMENT_UPPER = 1.4616321449684;
+double constexpr GAMMA_MINIMUM_LOWER = 0.88560319441088;
+
+auto gammaInterval(Interval const& x) -> Interval
+{
+    if (x.isEmpty())
+    {
+        return x;
+    }
+
+    size_t const precision{x.precision()};
+    auto const& lower{x.lower()};
+    auto const& upper{x.upper()};
+
+    if (lower.sign() != Sign::POSITIVE)
+    {
+        Scalar const highestPole{
+            Functions::floor(minimum(upper, Scalar{0.0, precision}))
+        };
+        if (highestPole >= lower)
+        {
+            return Interval::entire(false, precision);
+        }
+
+        // Between two poles, with a sign that alternates from one to the next
+        if (Functions::gamma(lower).sign() == Sign::POSITIVE)
+        {
+            return {
+                Scalar{0.0, precision},
+                roundedUp(
+                    [&]
+                {
+                    return maximum(
+                        Functions::gamma(lower), Functions::gamma(upper)
+                    );
+                }
+                ),
+                x.continuous()
+            };
+        }
+        return {
+            roundedDown(
+                [&]
+            {
+                return minimum(
+                    Functions::gamma(lower), Functions::gamma(upper)
+                );
+            }
+            ),
+            Scalar{0.0, precision},
+            x.continuous()
+        };
+    }
+
+    if (upper <= Scalar{GAMMA_MINIMUM_ARGUMENT_LOWER, precision})
+    {
+        return monotonic(x, Functions::gamma, Monotonicity::DECREASING);
+    }
+    if (lower >= Scalar{GAMMA_MINIMUM_ARGUMENT_UPPER, precision})
+    {
+        return monotonic(x, Functions::gamma, Monotonicity::INCREASING);
+    }
+
+    return {
+        Scalar{GAMMA_MINIMUM_LOWER, precision},
+        roundedUp(
+            [&]
+        { return maximum(Functions::gamma(lower), Functions::gamma(upper)); }
+        ),
+        x.continuous()
+    };
+}
+} // namespace
+
+Interval::Interval(double const point, size_t const precision)
+    : m_lower{point, precision}
+    , m_upper{point, precision}
+{
+}
+
+Interval::Interval(Scalar const& point)
+    : m_lower{point}
+    , m_upper{point}
+{
+}
+
+Interval::Interval(Scalar lower, Scalar upper, bool const continuous)
+    : m_lower{std::move(lower)}
+    , m_upper{std::move(upper)}
+    , m_continuous{continuous}
+{
+    assert(m_lower <= m_upper || (m_lower.isNaN() && m_upper.isNaN()));
+}
+
+auto Interval::entire(bool const continuous, size_t const precision)
+    -> Interval
+{
+    return {
+        Scalar{-INFINITY_DOUBLE, precision},
+        Scalar{INFINITY_DOUBLE, precision},
+        continuous
+    };
+}
+
+auto Interval::empty(size_t const precision) -> Interval
+{
+    double constexpr NAN_DOUBLE{std::numeric_limits<double>::quiet_NaN()};
+    return {
+        Scalar{NAN_DOUBLE, precision}, Scalar{NAN_DOUBLE, precision}, false
+    };
+}
+
+auto Interval::lower() const -> Scalar const& { return m_lower; }
+
+auto Interval::upper() const -> Scalar const& { return m_upper; }
+
+auto Interval::precision() const -> size_t
+{
+    return std::max(m_lower.precision(), m_upper.precision());
+}
+
+auto Interval::isEmpty() const -> bool { return m_lower.isNaN(); }
+
+auto Interval::contains(Scalar const& value) const -> bool
+{
+    return m_lower <= value && value <= m_upper;
+}
+
+auto Interval::continuous() const -> bool { return m_continuous; }
+
+auto Interval::operator==(Interval const& rhs) const -> bool
+{
+    if (isEmpty() || rhs.isEmpty())
+    {
+        return isEmpty() && rhs.isEmpty();
+    }
+    return m_lower == rhs.m_lower && m_upper == rhs.m_upper
+        && m_continuous == rhs.m_continuous;
+}
+
+auto Interval::operator+(Interval const& rhs) const -> Interval
+{
+    if (isEmpty() || rhs.isEmpty())
+    {
+        return empty(std::max(precision(), rhs.precision()));
+    }
+
+    return {
+        roundedDown([&] { return m_lower + rhs.m_lower; }),
+        roundedUp([&] { return m_upper + rhs.m_upper; }),
+        m_continuous && rhs.m_continuous
+    };
+}
+
+auto Interval::operator-(Interval const& rhs) const -> Interval
+{
+    return *this + -rhs;
+}
+
+auto Interval::operator*(Interval const& rhs) const -> Interval
+{
+    if (isEmpty() || rhs.isEmpty())
+    {
+        return empty(std::max(precision(), rhs.precision()));
+    }
+
+    // The extremes are among the products of the bounds
+    auto const products = [&]
+    {
+        return std::array{
+            boundProduct(m_lower, rhs.m_lower),
+            boundProduct(m_lower, rhs.m_upper),
+            boundProduct(m_upper, rhs.m_lower),
+            boundProduct(m_upper, rhs.m_upper)
+        };
+    };
+
+    return {
+        roundedDown(
+            [&]
+        {
+            auto const bounds{products()};
+            return minimum(
+                minimum(bounds[0], bounds[1]), minimum(bounds[2], bounds[3])
+            );
+        }
+        ),
+        roundedUp(
+            [&]
+        {
+            auto const bounds{products()};
+            return maximum(
+                maximum(bounds[0], bounds[1]), maximum(bounds[2], bounds[3])
+            );
+        }
+        ),
+        m_continuous && rhs.m_continuous
+    };
+}
+
+auto Interval::operator/(Interval const& rhs) const -> Interval
+{
+    size_t const resultPrecision{std::max(precision(), rhs.precision())};
+    if (isEmpty() || rhs.isEmpty())
+    {
+        return empty(resultPrecision);
+    }
+
+    if (rhs.contains(Scalar{0.0, resultPrecision}))
+    {
+        if (rhs.m_lower == rhs.m_upper)
+        {
+            return empty(resultPrecision);
+        }
+        return entire(false, resultPrecision);
+    }
+
+    // Both bounds of rhs have the same sign, so the reciprocal is monotonic
+    Scalar const one{1.0, resultPrecision};
+    Interval const reciprocal{
+        roundedDown([&] { return one / rhs.m_upper; }),
+        roundedUp([&] { return one / rhs.m_lower; }),
+        rhs.m_continuous
+    };
+    return *this * reciprocal;
+}
+
+auto Interval::operator-() const -> Interval
+{
+    if (isEmpty())
+    {
+        return *this;
+    }
+    return {-m_upper, -m_lower, m_continuous};
+}
+
+auto Interval::operator+=(Interval const& rhs) -> Interval&
+{
+    return *this = *this + rhs;
+}
+
+auto Interval::operator-=(Interval const& rhs) -> Interval&
+{
+    return *this = *this - rhs;
+}
+
+auto Interval::operator*=(Interval const& rhs) -> Interval&
+{
+    return *this = *this * rhs;
+}
+
+auto Interval::operator/=(Interval const& rhs) -> Interval&
+{
+    return *this = *this / rhs;
+}
+
+#define WRAP_UNARY_INTERVAL(func, arg1, expression)                            \
+    auto Functions::func(Interval const& arg1) -> Interval                     \
+    {                                                                          \
+        return expression;                                                     \
+    }
+
+#define WRAP_UNARY_INTERVAL_MONOTONIC(func, arg1, monotonicity, ...)           \
+    WRAP_UNARY_INTERVAL(                                                       \
+        func,                                                                  \
+        arg1,                                                                  \
+        monotonic(                                                             \
+            arg1,                                                              \
+            static_cast<Scalar (*)(Scalar const&)>(Functions::func),           \
+            Monotonicity::monotonicity __VA_OPT__(, ) __VA_ARGS__              \
+        )                                                                      \
+    )
+
+#define WRAP_UNARY_INTERVAL_STEP(func, arg1)                                   \
+    WRAP_UNARY_INTERVAL(                                                       \
+        func,                                                                  \
+        arg1,                                                                  \
+        step(arg1, static_cast<Scalar (*)(Scalar const&)>(Functions::func))    \
+    )
+
+WRAP_UNARY_INTERVAL(id, number, number);
+WRAP_UNARY_INTERVAL(abs, argument, absolute(argument));
+
+WRAP_UNARY_INTERVAL_STEP(ceil, argument);
+WRAP_UNARY_INTERVAL_STEP(floor, argument);
+WRAP_UNARY_INTERVAL_STEP(round, argument);
+WRAP_UNARY_INTERVAL_STEP(roundeven, argument);
+WRAP_UNARY_INTERVAL_STEP(trunc, argument);
+
+WRAP_UNARY_INTERVAL_MONOTONIC(
+    sqrt, argument, INCREASING, Domain{0.0, INFINITY_DOUBLE, false}
+);
+WRAP_UNARY_INTERVAL_MONOTONIC(cbrt, argument, INCREASING);
+
+WRAP_UNARY_INTERVAL_MONOTONIC(exp, exponent, INCREASING);
+WRAP_UNARY_INTERVAL_MONOTONIC(
+    log, argument, INCREASING, Domain{0.0, INFINITY_DOUBLE, true}
+);
+WRAP_UNARY_INTERVAL_MONOTONIC(
+    log2, argument, INCREASING, Domain{0.0, INFINITY_DOUBLE, true}
+);
+
+WRAP_UNARY_INTERVAL_MONOTONIC(erf, argument, INCREASING);
+WRAP_UNARY_INTERVAL_MONOTONIC(erfc, argument, DECREASING);
+WRAP_UNARY_INTERVAL(gamma, argument, gammaInterval(argument));
+
+WRAP_UNARY_INTERVAL(sin, radians, sinusoid(radians, Functions::sin, 0.5));
+WRAP_UNARY_INTERVAL(
+    csc, radians, Interval(1.0, radians.precision()) / sin(radians)
+);
+WRAP_UNARY_INTERVAL_MONOTONIC(
+    asin, argument, INCREASING, Domain{-1.0, 1.0, false}
+);
+WRAP_UNARY_INTERVAL(cos, radians, sinusoid(radians, Functions::cos, 0.0));
+WRAP_UNARY_INTERVAL(
+    sec, radians, Interval(1.0, radians.precision()) / cos(radians)
+);
+WRAP_UNARY_INTERVAL_MONOTONIC(
+    acos, argument, DECREASING, Domain{-1.0, 1.0, false}
+);
+WRAP_UNARY_INTERVAL(
+    tan,
+    radians,
+    periodicPoles(radians, Functions::tan, Monotonicity::INCREASING, 0.5)
+);
+WRAP_UNARY_INTERVAL(
+    cot,
+    radians,
+    periodicPoles(radians, Functions::cot, Monotonicity::DECREASING, 0.0)
+);
+WRAP_UNARY_INTERVAL_MONOTONIC(atan, argument, INCREASING);
+
+WRAP_UNARY_INTERVAL_MONOTONIC(sinh, argument, INCREASING);
+WRAP_UNARY_INTERVAL(
+    cosh,
+    argument,
+    monotonic(absolute(argument), Functions::cosh, Monotonicity::INCREASING)
+);
+WRAP_UNARY_INTERVAL_MONOTONIC(tanh, argument, INCREASING);
+WRAP_UNARY_INTERVAL_MONOTONIC(asinh, argument, INCREASING);
+WRAP_UNARY_INTERVAL_MONOTONIC(
+    acosh, argument, INCREASING, Domain{1.0, INFINITY_DOUBLE, false}
+);
+WRAP_UNARY_INTERVAL_MONOTONIC(
+    atanh, argument, INCREASING, Domain{-1.0, 1.0, true}
+);
+} // namespace calqmath
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "number.h"
+#include <cstddef>
+
+namespace calqmath
+{
+/**
+ * @brief A closed range [lower, upper] of real numbers, guaranteed to contain
+ * every exact result of the operations that produced it.
+ *
+ * Bounds are rounded outward with the backend's directed rounding, so the
+ * guarantee holds at any precision, only the width of the range depends on it.
+ * Bounds may be infinite. The empty interval, produced by operations defined
+ * nowhere on their input, has NaN bounds.
+ *
+ * Alongside the range, an interval tracks whether every operation producing it
+ * was defined and continuous over the whole of its input. Without that a
+ * steep but continuous function cannot be told apart from a pole or a jump.
+ *
+ * The elementary functions are overloads in Functions.
+ */
+class Interval
+{
+public:
+    // The single point, exactly.
+    explicit Interval(
+        double point = 0.0, size_t precision = MathContext::current().precision
+    );
+    explicit Interval(Scalar const& point);
+
+    // Bounds must be ordered, or both NaN for the empty interval.
+    Interval(Scalar lower, Scalar upper, bool continuous = true);
+
+    // The whole real line, the range of a function with a pole in its input.
+    static auto entire(
+        bool continuous, size_t precision = MathContext::current().precision
+    ) -> Interval;
+    static auto empty(size_t precision = MathContext::current().precision)
+        -> Interval;
+
+    [[nodiscard]] auto lower() const -> Scalar const&;
+    [[nodiscard]] auto upper() const -> Scalar const&;
+
+    // The larger precision of the two bounds.
+    [[nodiscard]] auto precision() const -> size_t;
+
+    [[nodiscard]] auto isEmpty() const -> bool;
+    [[nodiscard]] auto contains(Scalar const& value) const -> bool;
+
+    /**
+     * @brief continuous - Whether the operations producing this interval were
+     * all defined and continuous over their whole input. False for the empty
+     * interval.
+     */
+    [[nodiscard]] auto continuous() const -> bool;
+
+    auto operator==(Interval const& rhs) const -> bool;
+
+    auto operator+(Interval const& rhs) const -> Interval;
+    auto operator-(Interval const& rhs) const -> Interval;
+    auto operator*(Interval const& rhs) const -> Interval;
+    // Division by an interval containing zero gives the entire line, marked
+    // as discontinuous.
+    auto operator/(Interval const& rhs) const -> Interval;
+
+    auto operator-() const -> Interval;
+
+    auto operator+=(Interval const& rhs) -> Interval&;
+    auto operator-=(Interval const& rhs) -> Interval&;
+    auto operator*=(Interval const& rhs) -> Interval&;
+    auto operator/=(Interval const& rhs) -> Interval&;
+
+private:
+    Scalar m_lower;
+    Scalar m_upper;
+    bool m_continuous{true};
+};
+} // namespace calqmath
@@ -0,0 +1,377 @@
+#include "jet.h"
+
+#include "functions.h"
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace calqmath
+{
+namespace
+{
+auto constant(double const value, Scalar const& like) -> Scalar
+{
+    return Scalar{value, like.precision()};
+}
+
+/*
+ * f(u) for an inner jet u, given f and its first two derivatives at the value
+ * of u: (f o u)' = f'(u) u' and (f o u)'' = f''(u) u'^2 + f'(u) u''.
+ */
+auto chain(
+    Jet const& inner, Scalar value, Scalar const& first, Scalar const& second
+) -> Jet
+{
+    Scalar slope{first * inner.first()};
+    Scalar curvature{second * Functions::sqr(inner.first())};
+    Functions::fma(curvature, first, inner.second(), curvature);
+    return {std::move(value), std::move(slope), std::move(curvature)};
+}
+
+auto notDifferentiable(Scalar value) -> Jet
+{
+    Scalar const nan{
+        std::numeric_limits<double>::quiet_NaN(), value.precision()
+    };
+    return {std::move(value), nan, nan};
+}
+
+/*
+ * MPFR has no trigamma, so it is the central difference of digamma. At twice
+ * the precision, a step of half the working precision loses neither to
+ * truncation nor to cancellation.
+ */
+auto trigamma(Scalar const& argument) -> Scalar
+{
+    size_t const precision{argument.precision()};
+    Scalar const x{argument, 2 * precision};
+    Scalar const step{Functions::exp(
+        constant(-static_cast<double>(precision / 2 + 1), x)
+        * Functions::log(constant(2.0, x))
+    )};
+
+    Scalar const difference{
+        Functions::digamma(x + step) - Functions::digamma(x - step)
+    };
+    return Scalar{difference / (constant(2.0, x) * step), precision};
+}
+} // namespace
+
+Jet::Jet(double const value, size_t const precision)
+    : m_value{value, precision}
+    , m_first{0.0, precision}
+    , m_second{0.0, precision}
+{
+}
+
+Jet::Jet(Scalar const& value)
+    : m_value{value}
+    , m_first{0.0, value.precision()}
+    , m_second{0.0, value.precision()}
+{
+}
+
+Jet::Jet(Scalar value, Scalar first, Scalar second)
+    : m_value{std::move(value)}
+    , m_first{std::move(first)}
+    , m_second{std::move(second)}
+{
+}
+
+auto Jet::variable(Scalar const& value) -> Jet
+{
+    return {value, constant(1.0, value), constant(0.0, value)};
+}
+
+auto Jet::value() const -> Scalar const& { return m_value; }
+
+auto Jet::first() const -> Scalar const& { return m_first; }
+
+auto Jet::second() const -> Scalar const& { return m_second; }
+
+auto Jet::operator==(Jet const& rhs) const -> bool
+{
+    return m_value == rhs.m_value && m_first == rhs.m_first
+        && m_second == rhs.m_second;
+}
+
+auto Jet::operator+(Jet const& rhs) const -> Jet
+{
+    return {
+        m_value + rhs.m_value, m_first + rhs.m_first, m_second + rhs.m_second
+    };
+}
+
+auto Jet::operator-(Jet const& rhs) const -> Jet
+{
+    return {
+        m_value - rhs.m_value, m_first - rhs.m_first, m_second - rhs.m_second
+    };
+}
+
+auto Jet::operator*(Jet const& rhs) const -> Jet
+{
+    // (uv)' = u'v + uv' and (uv)'' = u''v + 2u'v' + uv''
+    Scalar first{m_first * rhs.m_value};
+    Functions::fma(first, m_value, rhs.m_first, first);
+
+    Scalar second{m_second * rhs.m_value};
+    Functions::fma(second, m_value, rhs.m_second, second);
+    Functions::fma(second, m_first + m_first, rhs.m_first, second);
+
+    return {m_value * rhs.m_value, std::move(first), std::move(second)};
+}
+
+auto Jet::operator/(Jet const& rhs) const -> Jet
+{
+    // With q = u / v, q' = (u' - qv') / v and q'' = (u'' - 2q'v' - qv'') / v
+    Scalar value{m_value / rhs.m_value};
+
+    Scalar first{m_first};
+    Functions::fma(first, -value, rhs.m_first, first);
+    first /= rhs.m_value;
+
+    Scalar second{m_second};
+    Functions::fma(second, -value, rhs.m_second, second);
+    Functions::fma(second, -(first + first), rhs.m_first, second);
+    second /= rhs.m_value;
+
+    return {std::move(value), std::move(first), std::move(second)};
+}
+
+auto Jet::operator-() const -> Jet { return {-m_value, -m_first, -m_second}; }
+
+auto Jet::operator+=(Jet const& rhs) -> Jet& { return *this = *this + rhs; }
+
+auto Jet::operator-=(Jet const& rhs) -> Jet& { return *this = *this - rhs; }
+
+auto Jet::operator*=(Jet const& rhs) -> Jet& { return *this = *this * rhs; }
+
+auto Jet::operator/=(Jet const& rhs) -> Jet& { return *this = *this / rhs; }
+
+/*
+ * Each function computes its value and derivatives at the inner value, and
+ * chain applies them. Derivatives are written in terms of the value where that
+ * saves evaluating another function.
+ */
+auto Functions::id(Jet const& number) -> Jet { return number; }
+
+auto Functions::abs(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    if (x.sign() == Sign::POSITIVE)
+    {
+        return argument;
+    }
+    if (x.sign() == Sign::NEGATIVE)
+    {
+        return -argument;
+    }
+    return notDifferentiable(abs(x));
+}
+
+// The rounding functions are flat between their jumps.
+#define WRAP_UNARY_JET_STEP(func, arg1)                                        \
+    auto Functions::func(Jet const& arg1) -> Jet                               \
+    {                                                                          \
+        Scalar const& x{arg1.value()};                                         \
+        return chain(arg1, func(x), constant(0.0, x), constant(0.0, x));       \
+    }
+
+WRAP_UNARY_JET_STEP(ceil, argument);
+WRAP_UNARY_JET_STEP(floor, argument);
+WRAP_UNARY_JET_STEP(round, argument);
+WRAP_UNARY_JET_STEP(roundeven, argument);
+WRAP_UNARY_JET_STEP(trunc, argument);
+
+auto Functions::sqrt(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar value{sqrt(x)};
+    Scalar const first{constant(0.5, x) / value};
+    return chain(argument, std::move(value), first, -first / (x + x));
+}
+
+auto Functions::cbrt(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar value{cbrt(x)};
+    Scalar const first{constant(1.0, x) / (constant(3.0, x) * sqr(value))};
+    Scalar const second{constant(-2.0, x) * first / (constant(3.0, x) * x)};
+    return chain(argument, std::move(value), first, second);
+}
+
+auto Functions::exp(Jet const& exponent) -> Jet
+{
+    Scalar const& x{exponent.value()};
+    Scalar const value{exp(x)};
+    return chain(exponent, value, value, value);
+}
+
+auto Functions::log(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{constant(1.0, x) / x};
+    return chain(argument, log(x), first, -sqr(first));
+}
+
+auto Functions::log2(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{constant(1.0, x) / (x * log(constant(2.0, x)))};
+    return chain(argument, log2(x), first, -first / x);
+}
+
+auto Functions::erf(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{
+        constant(2.0, x) * exp(-sqr(x)) / sqrt(acos(constant(-1.0, x)))
+    };
+    return chain(argument, erf(x), first, constant(-2.0, x) * x * first);
+}
+
+auto Functions::erfc(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{
+        constant(-2.0, x) * exp(-sqr(x)) / sqrt(acos(constant(-1.0, x)))
+    };
+    return chain(argument, erfc(x), first, constant(-2.0, x) * x * first);
+}
+
+auto Functions::gamma(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    // Gamma' = Gamma digamma, and Gamma'' = Gamma (digamma^2 + trigamma)
+    Scalar value{gamma(x)};
+    Scalar const polygamma{digamma(x)};
+    Scalar const first{value * polygamma};
+    Scalar const second{value * fma(polygamma, polygamma, trigamma(x))};
+    return chain(argument, std::move(value), first, second);
+}
+
+auto Functions::sin(Jet const& radians) -> Jet
+{
+    Scalar const& x{radians.value()};
+    Scalar const value{sin(x)};
+    return chain(radians, value, cos(x), -value);
+}
+
+auto Functions::csc(Jet const& radians) -> Jet
+{
+    Scalar const& x{radians.value()};
+    // csc' = -csc cot, and csc'' = csc (cot^2 + csc^2)
+    Scalar value{csc(x)};
+    Scalar const cotangent{cot(x)};
+    Scalar const first{-value * cotangent};
+    Scalar const second{value * fma(cotangent, cotangent, sqr(value))};
+    return chain(radians, std::move(value), first, second);
+}
+
+auto Functions::asin(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{
+        constant(1.0, x) / sqrt(constant(1.0, x) - sqr(x))
+    };
+    return chain(argument, asin(x), first, x * first * sqr(first));
+}
+
+auto Functions::cos(Jet const& radians) -> Jet
+{
+    Scalar const& x{radians.value()};
+    Scalar const value{cos(x)};
+    return chain(radians, value, -sin(x), -value);
+}
+
+auto Functions::sec(Jet const& radians) -> Jet
+{
+    Scalar const& x{radians.value()};
+    // sec' = sec tan, and sec'' = sec (tan^2 + sec^2)
+    Scalar value{sec(x)};
+    Scalar const tangent{tan(x)};
+    Scalar const first{value * tangent};
+    Scalar const second{value * fma(tangent, tangent, sqr(value))};
+    return chain(radians, std::move(value), first, second);
+}
+
+auto Functions::acos(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{
+        constant(-1.0, x) / sqrt(constant(1.0, x) - sqr(x))
+    };
+    return chain(argument, acos(x), first, x * first * sqr(first));
+}
+
+auto Functions::tan(Jet const& radians) -> Jet
+{
+    Scalar const& x{radians.value()};
+    Scalar value{tan(x)};
+    Scalar const first{fma(value, value, constant(1.0, x))};
+    Scalar const second{constant(2.0, x) * value * first};
+    return chain(radians, std::move(value), first, second);
+}
+
+auto Functions::cot(Jet const& radians) -> Jet
+{
+    Scalar const& x{radians.value()};
+    Scalar value{cot(x)};
+    Scalar const first{-fma(value, value, constant(1.0, x))};
+    Scalar const second{constant(-2.0, x) * value * first};
+    return chain(radians, std::move(value), first, second);
+}
+
+auto Functions::atan(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{constant(1.0, x) / fma(x, x, constant(1.0, x))};
+    return chain(argument, atan(x), first, constant(-2.0, x) * x * sqr(first));
+}
+
+auto Functions::sinh(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const value{sinh(x)};
+    return chain(argument, value, cosh(x), value);
+}
+
+auto Functions::cosh(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const value{cosh(x)};
+    return chain(argument, value, sinh(x), value);
+}
+
+auto Functions::tanh(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar value{tanh(x)};
+    Scalar const first{constant(1.0, x) - sqr(value)};
+    Scalar const second{constant(-2.0, x) * value * first};
+    return chain(argument, std::move(value), first, second);
+}
+
+auto Functions::asinh(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{constant(1.0, x) / sqrt(fma(x, x, constant(1.0, x)))};
+    return chain(argument, asinh(x), first, -x * first * sqr(first));
+}
+
+auto Functions::acosh(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{constant(1.0, x) / sqrt(fms(x, x, constant(1.0, x)))};
+    return chain(argument, acosh(x), first, -x * first * sqr(first));
+}
+
+auto Functions::atanh(Jet const& argument) -> Jet
+{
+    Scalar const& x{argument.value()};
+    Scalar const first{constant(1.0, x) / (constant(1.0, x) - sqr(x))};
+    return chain(argument, atanh(x), first, constant(2.0, x) * x * sqr(first));
+}
+
+} // namespace calqmath
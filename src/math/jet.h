@@ -0,0 +1,57 @@
+#pragma once
+
+#include "number.h"
+#include <cstddef>
+
+namespace calqmath
+{
+/**
+ * @brief A value with its first and second derivative with respect to one
+ * variable, that is a Taylor series truncated after the quadratic term.
+ *
+ * Arithmetic applies the sum, product and quotient rules, and the elementary
+ * functions in Functions the chain rule. Evaluating an expression over
+ * Jet::variable(x) therefore gives f(x), f'(x) and f''(x) in one pass, each at
+ * the working precision rather than through a finite difference.
+ *
+ * Where a function is not differentiable the derivatives are NaN, except for
+ * the rounding functions, whose derivatives are zero even at their jumps.
+ */
+class Jet
+{
+public:
+    // A constant, whose derivatives are zero.
+    explicit Jet(
+        double value = 0.0, size_t precision = MathContext::current().precision
+    );
+    explicit Jet(Scalar const& value);
+
+    Jet(Scalar value, Scalar first, Scalar second);
+
+    // The variable itself, whose first derivative is one.
+    static auto variable(Scalar const& value) -> Jet;
+
+    [[nodiscard]] auto value() const -> Scalar const&;
+    [[nodiscard]] auto first() const -> Scalar const&;
+    [[nodiscard]] auto second() const -> Scalar const&;
+
+    auto operator==(Jet const& rhs) const -> bool;
+
+    auto operator+(Jet const& rhs) const -> Jet;
+    auto operator-(Jet const& rhs) const -> Jet;
+    auto operator*(Jet const& rhs) const -> Jet;
+    auto operator/(Jet const& rhs) const -> Jet;
+
+    auto operator-() const -> Jet;
+
+    auto operator+=(Jet const& rhs) -> Jet&;
+    auto operator-=(Jet const& rhs) -> Jet&;
+    auto operator*=(Jet const& rhs) -> Jet&;
+    auto operator/=(Jet const& rhs) -> Jet&;
+
+private:
+    Scalar m_value;
+    Scalar m_first;
+    Scalar m_second;
+};
+} // namespace calqmath
@@ -0,0 +1,1127 @@
+#include "multidouble.h"
+
+#include "functions.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <utility>
+
+namespace calqmath
+{
+namespace
+{
+/*
+ * Error-free transformations. Each returns the rounded result of an operation
+ * and stores its exact rounding error, so that result + error is exact.
+ */
+
+auto twoSum(double const lhs, double const rhs, double& error) -> double
+{
+    double const sum{lhs + rhs};
+    double const rhsVirtual{sum - lhs};
+    error = (lhs - (sum - rhsVirtual)) + (rhs - rhsVirtual);
+    return sum;
+}
+
+auto twoProduct(double const lhs, double const rhs, double& error) -> double
+{
+    double const product{lhs * rhs};
+#ifdef FP_FAST_FMA
+    error = std::fma(lhs, rhs, -product);
+#else
+    // Dekker's product, splitting each factor into halves whose products are
+    // exact.
+    auto const split = [](double const value, double& high, double& low)
+    {
+        double constexpr SPLITTER{134217729.0}; // 2^27 + 1
+        double const scaled{SPLITTER * value};
+        high = scaled - (scaled - value);
+        low = value - high;
+    };
+
+    double lhsHigh{};
+    double lhsLow{};
+    double rhsHigh{};
+    double rhsLow{};
+    split(lhs, lhsHigh, lhsLow);
+    split(rhs, rhsHigh, rhsLow);
+
+    error = (((lhsHigh * rhsHigh) - product) + (lhsHigh * rhsLow)
+             + (lhsLow * rhsHigh))
+          + (lhsLow * rhsLow);
+#endif
+    return product;
+}
+
+/*
+ * Compresses M terms, ideally ordered roughly by decreasing magnitude, into N
+ * non-overlapping ones. All but the terms beyond the N-th are summed exactly.
+ */
+template <size_t N, size_t M>
+auto renormalize(std::array<double, M> terms) -> std::array<double, N>
+{
+    static_assert(M >= N);
+
+    std::array<double, N> result{};
+
+    // Bottom up, gathering the sum into the leading term with the errors
+    // left below it.
+    for (size_t index = M - 1; index > 0; index--)
+    {
+        terms[index - 1] = twoSum(terms[index - 1], terms[index], terms[index]);
+    }
+
+    // The errors of an overflowing sum are meaningless
+    if (!std::isfinite(terms[0]))
+    {
+        result[0] = terms[0];
+        return result;
+    }
+
+    // Top down, emitting a component whenever a sum is no longer exact.
+    size_t count{0};
+    double sum{terms[0]};
+    size_t index{1};
+    for (; index < M && count + 1 < N; index++)
+    {
+        double error{};
+        sum = twoSum(sum, terms[index], error);
+        if (error != 0.0)
+        {
+            result[count] = sum;
+            count++;
+            sum = error;
+        }
+    }
+    for (; index < M; index++)
+    {
+        sum += terms[index];
+    }
+    result[count] = sum;
+
+    return result;
+}
+
+template <size_t N>
+auto scaleTerms(std::array<double, N> const& terms, double const factor)
+    -> std::array<double, N>
+{
+    // Products in order of magnitude, each followed by its error
+    std::array<double, 2 * N> products{};
+    std::array<double, N> errors{};
+    for (size_t index = 0; index < N; index++)
+    {
+        products[2 * index] = twoProduct(terms[index], factor, errors[index]);
+    }
+    for (size_t index = 0; index < N; index++)
+    {
+        products[(2 * index) + 1] = errors[index];
+    }
+
+    return renormalize<N>(products);
+}
+
+/*
+ * Computes remainder - divisor * quotient for a step of long division, with
+ * the products kept exact.
+ */
+template <size_t N, size_t D>
+auto subtractMultiple(
+    std::array<double, N> const& remainder,
+    std::array<double, D> const& divisor,
+    double const quotient
+) -> std::array<double, N>
+{
+    static_assert(D <= N);
+
+    std::array<double, N + (2 * D)> terms{};
+    size_t count{0};
+    for (size_t index = 0; index < N; index++)
+    {
+        terms[count] = remainder[index];
+        count++;
+        if (index < D)
+        {
+            terms[count] = twoProduct(
+                divisor[index], -quotient, terms[count + 1]
+            );
+            count += 2;
+        }
+    }
+    return renormalize<N>(terms);
+}
+
+template <size_t N>
+auto ldexp(MultiDouble<N> const& value, int const exponent) -> MultiDouble<N>
+{
+    auto terms{value.terms()};
+    for (auto& term : terms)
+    {
+        term = std::ldexp(term, exponent);
+    }
+    return MultiDouble<N>::fromTerms(terms);
+}
+
+template <size_t N> auto nan() -> MultiDouble<N>
+{
+    return MultiDouble<N>{std::numeric_limits<double>::quiet_NaN()};
+}
+
+template <size_t N> auto epsilon() -> double
+{
+    return std::ldexp(1.0, -static_cast<int>(MultiDouble<N>::PRECISION));
+}
+
+// Newton's method doubles the correct bits each step, starting from double.
+template <size_t N> size_t constexpr NEWTON_ITERATIONS = std::bit_width(N);
+
+size_t constexpr INVERSE_FACTORIAL_COUNT{64};
+
+// 1 / n!, the coefficients of every series below.
+template <size_t N> auto inverseFactorial(size_t const n) -> MultiDouble<N>
+{
+    static auto const table{[]
+    {
+        std::array<MultiDouble<N>, INVERSE_FACTORIAL_COUNT> result{};
+        size_t constexpr PRECISION{2 * MultiDouble<N>::PRECISION};
+        Scalar factorial{1.0, PRECISION};
+        for (size_t index = 0; index < result.size(); index++)
+        {
+            if (index > 0)
+            {
+                factorial *= Scalar{static_cast<double>(index), PRECISION};
+            }
+            result[index] = MultiDouble<N>{Scalar{1.0, PRECISION} / factorial};
+        }
+        return result;
+    }()};
+
+    assert(n < table.size());
+    return table[n];
+}
+
+/*
+ * The degree at which a series with coefficients 1 / (first + stride * k)!,
+ * evaluated at a variable of the given magnitude, has converged to the
+ * working precision relative to its constant term.
+ */
+template <size_t N>
+auto seriesDegree(double const magnitude, size_t first, size_t const stride)
+    -> size_t
+{
+    size_t degree{0};
+    double term{1.0};
+    while (term > epsilon<N>())
+    {
+        for (size_t step = 0; step < stride; step++)
+        {
+            first++;
+            term /= static_cast<double>(first);
+        }
+        term *= magnitude;
+        degree++;
+    }
+    return degree;
+}
+
+// Evaluates a polynomial by Horner's rule, which needs no divisions.
+template <size_t N, typename Coefficient>
+auto horner(
+    MultiDouble<N> const& x, size_t const degree, Coefficient const& coefficient
+) -> MultiDouble<N>
+{
+    MultiDouble<N> result{coefficient(degree)};
+    for (size_t k = degree; k > 0; k--)
+    {
+        result = result * x + coefficient(k - 1);
+    }
+    return result;
+}
+
+// A constant to twice the working precision, as the sum of two values.
+template <size_t N> struct SplitConstant
+{
+    MultiDouble<N> head;
+    MultiDouble<N> tail;
+};
+
+// Constants come from the bignum backend, with room to spare.
+template <size_t N> auto splitConstant(Scalar const& value) -> SplitConstant<N>
+{
+    MultiDouble<N> const head{value};
+    return {head, MultiDouble<N>{value - head.toScalar(value.precision())}};
+}
+
+template <size_t N> auto constantPi() -> SplitConstant<N> const&
+{
+    static SplitConstant<N> const pi{splitConstant<N>(
+        Functions::acos(Scalar{-1.0, 4 * MultiDouble<N>::PRECISION})
+    )};
+    return pi;
+}
+
+template <size_t N> auto constantLn2() -> SplitConstant<N> const&
+{
+    static SplitConstant<N> const ln2{splitConstant<N>(
+        Functions::log(Scalar{2.0, 4 * MultiDouble<N>::PRECISION})
+    )};
+    return ln2;
+}
+
+/*
+ * Computes x - multiple * constant for argument reduction. The products with
+ * the constant's head are kept exact, so cancellation against x still leaves
+ * a result accurate to the working precision.
+ */
+template <size_t N>
+auto reduce(
+    MultiDouble<N> const& x,
+    double const multiple,
+    SplitConstant<N> const& constant
+) -> MultiDouble<N>
+{
+    std::array<double, 4 * N> terms{};
+    auto const& head{constant.head.terms()};
+    auto const tail{(constant.tail * -multiple).terms()};
+    for (size_t index = 0; index < N; index++)
+    {
+        terms[index] = x.terms()[index];
+        terms[N + (2 * index)] = twoProduct(
+            head[index], -multiple, terms[N + (2 * index) + 1]
+        );
+        terms[(3 * N) + index] = tail[index];
+    }
+    return MultiDouble<N>::fromTerms(terms);
+}
+
+template <size_t N> auto absImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return std::signbit(x.toDouble()) ? -x : x;
+}
+
+template <size_t N> auto floorImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    // Below a fractional component, the smaller ones cannot reach an integer
+    std::array<double, N> result{};
+    for (size_t index = 0; index < N; index++)
+    {
+        result[index] = std::floor(x.terms()[index]);
+        if (result[index] != x.terms()[index])
+        {
+            break;
+        }
+    }
+    return MultiDouble<N>::fromTerms(result);
+}
+
+template <size_t N> auto ceilImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return -floorImpl(-x);
+}
+
+template <size_t N> auto truncImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return std::signbit(x.toDouble()) ? ceilImpl(x) : floorImpl(x);
+}
+
+template <size_t N> auto roundImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    if (std::signbit(x.toDouble()))
+    {
+        return -roundImpl(-x);
+    }
+
+    auto const result{floorImpl(x)};
+    return (x - result) >= MultiDouble<N>{0.5} ? result + 1.0 : result;
+}
+
+template <size_t N>
+auto roundevenImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    auto const result{floorImpl(x)};
+    auto const fraction{x - result};
+    bool const odd{floorImpl(result * 0.5) * 2.0 != result};
+
+    if (fraction > MultiDouble<N>{0.5}
+        || (fraction == MultiDouble<N>{0.5} && odd))
+    {
+        return result + 1.0;
+    }
+    return result;
+}
+
+template <size_t N> auto sqrtImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    double const leading{x.toDouble()};
+    if (leading < 0.0)
+    {
+        return nan<N>();
+    }
+    if (leading == 0.0 || !std::isfinite(leading))
+    {
+        return x;
+    }
+
+    // Newton's method on 1 / y^2 - x, which needs no division
+    MultiDouble<N> const one{1.0};
+    MultiDouble<N> inverse{1.0 / std::sqrt(leading)};
+    for (size_t step = 1; step < NEWTON_ITERATIONS<N>; step++)
+    {
+        inverse += inverse * (one - x * inverse * inverse) * 0.5;
+    }
+
+    // Karp and Markstein's last step, which doubles the accuracy of x * y
+    auto const result{x * inverse};
+    return result + (x - result * result) * inverse * 0.5;
+}
+
+template <size_t N> auto cbrtImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    double const leading{x.toDouble()};
+    if (leading == 0.0 || !std::isfinite(leading))
+    {
+        return x;
+    }
+    if (leading < 0.0)
+    {
+        return -cbrtImpl(-x);
+    }
+
+    MultiDouble<N> result{std::cbrt(leading)};
+    for (size_t step = 0; step < NEWTON_ITERATIONS<N>; step++)
+    {
+        result += (x / (result * result) - result) / 3.0;
+    }
+    return result;
+}
+
+template <size_t N> auto expImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    // Past these the result is not a finite, non-zero double
+    double constexpr LEADING_MAX{709.79};
+    double constexpr LEADING_MIN{-745.2};
+
+    double const leading{x.toDouble()};
+    if (std::isnan(leading))
+    {
+        return x;
+    }
+    if (leading > LEADING_MAX)
+    {
+        return MultiDouble<N>{std::numeric_limits<double>::infinity()};
+    }
+    if (leading < LEADING_MIN)
+    {
+        return MultiDouble<N>{0.0};
+    }
+
+    /*
+     * exp(x) = 2^k * exp(r)^(2^s) where r = (x - k * ln2) / 2^s. The series of
+     * exp(r) - 1 converges quickly for the small r, and keeping the leading 1
+     * out of the squarings preserves relative accuracy.
+     */
+    int constexpr SQUARINGS{10};
+
+    double const multiple{std::nearbyint(leading / std::numbers::ln2)};
+    auto const reduced{
+        ldexp(reduce(x, multiple, constantLn2<N>()), -SQUARINGS)
+    };
+
+    // exp(r) - 1 = r * sum(r^k / (k + 1)!)
+    size_t const degree{
+        seriesDegree<N>(std::abs(reduced.toDouble()), 1, 1)
+    };
+    auto const coefficient = [](size_t const k)
+    { return inverseFactorial<N>(k + 1); };
+    auto sum{reduced * horner(reduced, degree, coefficient)};
+
+    for (int squaring = 0; squaring < SQUARINGS; squaring++)
+    {
+        sum *= sum + 2.0;
+    }
+
+    return ldexp(sum + 1.0, static_cast<int>(multiple));
+}
+
+template <size_t N> auto atanhImpl(MultiDouble<N> const& x) -> MultiDouble<N>;
+
+template <size_t N> auto logImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    double const leading{x.toDouble()};
+    if (std::isnan(leading) || leading < 0.0)
+    {
+        return nan<N>();
+    }
+    if (leading == 0.0)
+    {
+        return MultiDouble<N>{-std::numeric_limits<double>::infinity()};
+    }
+    if (std::isinf(leading))
+    {
+        return x;
+    }
+
+    // Newton's method below is only accurate in absolute terms, which is not
+    // enough for the small results near 1.
+    double constexpr NEAR_ONE_DISTANCE{0.25};
+    if (std::abs(leading - 1.0) < NEAR_ONE_DISTANCE)
+    {
+        MultiDouble<N> const one{1.0};
+        return atanhImpl((x - one) / (x + one)) * 2.0;
+    }
+
+    // Newton's method on exp(y) - x
+    MultiDouble<N> result{std::log(leading)};
+    for (size_t step = 0; step < NEWTON_ITERATIONS<N>; step++)
+    {
+        result += x * expImpl(-result) - 1.0;
+    }
+    return result;
+}
+
+template <size_t N> auto log2Impl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return logImpl(x) / constantLn2<N>().head;
+}
+
+/*
+ * Reduces x to r = x - k * pi / 2 with |r| <= pi / 4, and computes the sine
+ * and cosine of r. The quadrant is k modulo 4.
+ */
+template <size_t N>
+auto reducedSinCos(
+    MultiDouble<N> const& x, MultiDouble<N>& sine, MultiDouble<N>& cosine
+) -> int
+{
+    double const multiple{
+        std::nearbyint(x.toDouble() / (std::numbers::pi / 2))
+    };
+    auto const reduced{reduce(x, multiple * 0.5, constantPi<N>())};
+
+    // sin(r) = r * sum((-r^2)^k / (2k + 1)!)
+    auto const squared{reduced * reduced};
+    size_t const degree{seriesDegree<N>(squared.toDouble(), 1, 2)};
+    auto const coefficient = [](size_t const k)
+    {
+        auto const inverse{inverseFactorial<N>((2 * k) + 1)};
+        return k % 2 == 0 ? inverse : -inverse;
+    };
+    sine = reduced * horner(squared, degree, coefficient);
+
+    // Cosine is at least 1 / sqrt(2) here, so this loses nothing
+    cosine = sqrtImpl(MultiDouble<N>{1.0} - sine * sine);
+
+    auto const quadrant{static_cast<int64_t>(std::fmod(multiple, 4.0))};
+    return static_cast<int>((quadrant + 4) % 4);
+}
+
+// Sine and cosine of x itself, sharing the work between them.
+template <size_t N>
+void sinCos(
+    MultiDouble<N> const& x, MultiDouble<N>& sine, MultiDouble<N>& cosine
+)
+{
+    switch (reducedSinCos(x, sine, cosine))
+    {
+    case 0:
+        break;
+    case 1:
+        sine = std::exchange(cosine, -sine);
+        break;
+    case 2:
+        sine = -sine;
+        cosine = -cosine;
+        break;
+    default:
+        sine = -std::exchange(cosine, sine);
+        break;
+    }
+}
+
+template <size_t N> auto sinImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    if (!std::isfinite(x.toDouble()))
+    {
+        return nan<N>();
+    }
+
+    MultiDouble<N> sine{};
+    MultiDouble<N> cosine{};
+    sinCos(x, sine, cosine);
+    return sine;
+}
+
+template <size_t N> auto cosImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    if (!std::isfinite(x.toDouble()))
+    {
+        return nan<N>();
+    }
+
+    MultiDouble<N> sine{};
+    MultiDouble<N> cosine{};
+    sinCos(x, sine, cosine);
+    return cosine;
+}
+
+template <size_t N> auto tanImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    if (!std::isfinite(x.toDouble()))
+    {
+        return nan<N>();
+    }
+
+    MultiDouble<N> sine{};
+    MultiDouble<N> cosine{};
+    if (reducedSinCos(x, sine, cosine) % 2 == 0)
+    {
+        return sine / cosine;
+    }
+    return -cosine / sine;
+}
+
+template <size_t N> auto cscImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return MultiDouble<N>{1.0} / sinImpl(x);
+}
+
+template <size_t N> auto secImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return MultiDouble<N>{1.0} / cosImpl(x);
+}
+
+template <size_t N> auto cotImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return MultiDouble<N>{1.0} / tanImpl(x);
+}
+
+template <size_t N> auto atanImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    double const leading{x.toDouble()};
+    if (std::isnan(leading))
+    {
+        return x;
+    }
+    if (std::isinf(leading))
+    {
+        auto const halfPi{constantPi<N>().head * 0.5};
+        return leading > 0.0 ? halfPi : -halfPi;
+    }
+
+    // Newton's method on tan(y) - x, scaled by cos(y)^2
+    MultiDouble<N> result{std::atan(leading)};
+    for (size_t step = 0; step < NEWTON_ITERATIONS<N>; step++)
+    {
+        MultiDouble<N> sine{};
+        MultiDouble<N> cosine{};
+        sinCos(result, sine, cosine);
+        result += (x * cosine - sine) * cosine;
+    }
+    return result;
+}
+
+template <size_t N> auto asinImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    MultiDouble<N> const one{1.0};
+    if (absImpl(x) > one)
+    {
+        return nan<N>();
+    }
+
+    // At +-1 this divides by zero, and atan handles the infinity
+    return atanImpl(x / sqrtImpl((one - x) * (one + x)));
+}
+
+template <size_t N> auto acosImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    MultiDouble<N> const one{1.0};
+    if (absImpl(x) > one)
+    {
+        return nan<N>();
+    }
+
+    // Avoids the cancellation of pi / 2 - asin(x) near 1
+    return atanImpl(sqrtImpl((one - x) / (one + x))) * 2.0;
+}
+
+template <size_t N> auto sinhImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    double const leading{x.toDouble()};
+    if (!std::isfinite(leading))
+    {
+        return x;
+    }
+
+    // Subtracting exponentials loses the relative accuracy of small results
+    double constexpr SERIES_ARGUMENT_MAX{0.5};
+    if (std::abs(leading) < SERIES_ARGUMENT_MAX)
+    {
+        // sinh(x) = x * sum(x^2k / (2k + 1)!)
+        auto const squared{x * x};
+        size_t const degree{seriesDegree<N>(squared.toDouble(), 1, 2)};
+        auto const coefficient = [](size_t const k)
+        { return inverseFactorial<N>((2 * k) + 1); };
+        return x * horner(squared, degree, coefficient);
+    }
+
+    auto const exponential{expImpl(x)};
+    return (exponential - MultiDouble<N>{1.0} / exponential) * 0.5;
+}
+
+template <size_t N> auto coshImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    if (x.isNaN())
+    {
+        return x;
+    }
+
+    auto const exponential{expImpl(absImpl(x))};
+    return (exponential + MultiDouble<N>{1.0} / exponential) * 0.5;
+}
+
+template <size_t N> auto tanhImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    double const leading{x.toDouble()};
+    if (std::isnan(leading))
+    {
+        return x;
+    }
+
+    MultiDouble<N> const one{1.0};
+
+    double constexpr SERIES_ARGUMENT_MAX{0.5};
+    if (std::abs(leading) < SERIES_ARGUMENT_MAX)
+    {
+        auto const sine{sinhImpl(x)};
+        return sine / sqrtImpl(one + sine * sine);
+    }
+
+    // Written in terms of exp(-2|x|), which cannot overflow
+    auto const exponential{expImpl(absImpl(x) * -2.0)};
+    auto const result{(one - exponential) / (one + exponential)};
+    return leading < 0.0 ? -result : result;
+}
+
+template <size_t N> auto asinhImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    double const leading{x.toDouble()};
+    if (!std::isfinite(leading))
+    {
+        return x;
+    }
+
+    // Newton's method on sinh(y) - x, with cosh(y) = sqrt(1 + sinh(y)^2)
+    MultiDouble<N> result{std::asinh(leading)};
+    for (size_t step = 0; step < NEWTON_ITERATIONS<N>; step++)
+    {
+        auto const sine{sinhImpl(result)};
+        result -= (sine - x) / sqrtImpl(MultiDouble<N>{1.0} + sine * sine);
+    }
+    return result;
+}
+
+template <size_t N> auto acoshImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    MultiDouble<N> const one{1.0};
+    if (x.isNaN() || x < one)
+    {
+        return nan<N>();
+    }
+
+    return logImpl(x + sqrtImpl((x - one) * (x + one)));
+}
+
+template <size_t N> auto atanhImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    MultiDouble<N> const one{1.0};
+    if (x.isNaN() || absImpl(x) > one)
+    {
+        return nan<N>();
+    }
+    if (absImpl(x) == one)
+    {
+        return MultiDouble<N>{std::copysign(
+            std::numeric_limits<double>::infinity(), x.toDouble()
+        )};
+    }
+
+    // Newton's method loses accuracy as tanh flattens out, where instead the
+    // logarithm's argument is well away from 1.
+    double constexpr SERIES_ARGUMENT_MAX{0.5};
+    if (std::abs(x.toDouble()) >= SERIES_ARGUMENT_MAX)
+    {
+        return logImpl((one + x) / (one - x)) * 0.5;
+    }
+
+    // Newton's method on tanh(y) - x, scaled by cosh(y)^2
+    MultiDouble<N> result{std::atanh(x.toDouble())};
+    for (size_t step = 0; step < NEWTON_ITERATIONS<N>; step++)
+    {
+        auto const sine{sinhImpl(result)};
+        auto const coshSquared{one + sine * sine};
+        result -= (sine / sqrtImpl(coshSquared) - x) * coshSquared;
+    }
+    return result;
+}
+
+// The special functions are left to the bignum backend.
+template <size_t N>
+auto viaScalar(MultiDouble<N> const& x, Scalar (*function)(Scalar const&))
+    -> MultiDouble<N>
+{
+    return MultiDouble<N>{function(x.toScalar(2 * MultiDouble<N>::PRECISION))};
+}
+
+template <size_t N> auto erfImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return viaScalar(x, Functions::erf);
+}
+
+template <size_t N> auto erfcImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return viaScalar(x, Functions::erfc);
+}
+
+template <size_t N> auto gammaImpl(MultiDouble<N> const& x) -> MultiDouble<N>
+{
+    return viaScalar(x, Functions::gamma);
+}
+} // namespace
+
+template <size_t N>
+MultiDouble<N>::MultiDouble(double const number)
+    : m_terms{number}
+{
+}
+
+template <size_t N>
+MultiDouble<N>::MultiDouble(Scalar const& other)
+{
+    // Peeling off the nearest double leaves an exactly representable remainder
+    Scalar remainder{other};
+    std::array<double, N> terms{};
+    for (auto& term : terms)
+    {
+        term = remainder.toDouble();
+        if (term == 0.0 || !std::isfinite(term))
+        {
+            break;
+        }
+        remainder -= Scalar{term, remainder.precision()};
+    }
+
+    m_terms = renormalize<N>(terms);
+}
+
+template <size_t N>
+MultiDouble<N>::MultiDouble(std::string const& representation)
+    : MultiDouble{Scalar{representation, 2 * PRECISION}}
+{
+}
+
+template <size_t N>
+template <size_t M>
+auto MultiDouble<N>::fromTerms(std::array<double, M> const& terms)
+    -> MultiDouble
+{
+    auto sorted{terms};
+    std::ranges::sort(
+        sorted,
+        [](double const lhs, double const rhs)
+    { return std::abs(lhs) > std::abs(rhs); }
+    );
+
+    MultiDouble result{};
+    result.m_terms = renormalize<N>(sorted);
+    return result;
+}
+
+template <size_t N>
+auto MultiDouble<N>::terms() const -> std::array<double, N> const&
+{
+    return m_terms;
+}
+
+template <size_t N> auto MultiDouble<N>::toDouble() const -> double
+{
+    return m_terms[0];
+}
+
+template <size_t N>
+auto MultiDouble<N>::toScalar(size_t const precision) const -> Scalar
+{
+    Scalar result{m_terms[0], precision};
+    for (size_t index = 1; index < N; index++)
+    {
+        result += Scalar{m_terms[index], precision};
+    }
+    return result;
+}
+
+template <size_t N> auto MultiDouble<N>::isNaN() const -> bool
+{
+    return std::isnan(m_terms[0]);
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator==(MultiDouble const& rhs) const -> bool
+{
+    return (*this <=> rhs) == std::partial_ordering::equivalent;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator<=>(MultiDouble const& rhs) const
+    -> std::partial_ordering
+{
+    // Components are not unique, so compare the difference instead
+    return (*this - rhs).m_terms[0] <=> 0.0;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator+(MultiDouble const& rhs) const -> MultiDouble
+{
+    // Merging by magnitude keeps the sum accurate under cancellation
+    std::array<double, 2 * N> merged{};
+    std::merge(
+        m_terms.begin(),
+        m_terms.end(),
+        rhs.m_terms.begin(),
+        rhs.m_terms.end(),
+        merged.begin(),
+        [](double const lhs, double const rhs)
+    { return std::abs(lhs) > std::abs(rhs); }
+    );
+
+    MultiDouble result{};
+    result.m_terms = renormalize<N>(merged);
+    return result;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator-(MultiDouble const& rhs) const -> MultiDouble
+{
+    return *this + -rhs;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator*(MultiDouble const& rhs) const -> MultiDouble
+{
+    double const leading{m_terms[0] * rhs.m_terms[0]};
+    if (!std::isfinite(leading))
+    {
+        return MultiDouble{leading};
+    }
+
+    if constexpr (N == 2)
+    {
+        // The usual double-double product, with the cross terms rounded
+        double error{};
+        double const product{twoProduct(m_terms[0], rhs.m_terms[0], error)};
+        error += (m_terms[0] * rhs.m_terms[1]) + (m_terms[1] * rhs.m_terms[0]);
+
+        MultiDouble result{};
+        result.m_terms[0] = product + error;
+        result.m_terms[1] = error - (result.m_terms[0] - product);
+        return result;
+    }
+
+    /*
+     * Partial products grouped by order of magnitude. Products of order k
+     * are exact up to order N, and their errors join the group after them.
+     * Products of order N only need to be rounded.
+     */
+    std::array<double, (N * (N + 1)) + N - 1> terms{};
+    std::array<std::array<double, N>, N> errors{};
+    size_t count{0};
+    for (size_t order = 0; order <= N; order++)
+    {
+        for (size_t lhsIndex = 0; lhsIndex <= order && lhsIndex < N;
+             lhsIndex++)
+        {
+            size_t const rhsIndex{order - lhsIndex};
+            if (rhsIndex >= N)
+            {
+                continue;
+            }
+
+            double const lhsTerm{m_terms[lhsIndex]};
+            double const rhsTerm{rhs.m_terms[rhsIndex]};
+            terms[count] = order < N
+                             ? twoProduct(
+                                   lhsTerm, rhsTerm, errors[lhsIndex][rhsIndex]
+                               )
+                             : lhsTerm * rhsTerm;
+            count++;
+        }
+
+        for (size_t lhsIndex = 0; lhsIndex < order; lhsIndex++)
+        {
+            terms[count] = errors[lhsIndex][order - 1 - lhsIndex];
+            count++;
+        }
+    }
+
+    MultiDouble result{};
+    result.m_terms = renormalize<N>(terms);
+    return result;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator/(MultiDouble const& rhs) const -> MultiDouble
+{
+    double const leading{m_terms[0] / rhs.m_terms[0]};
+    if (!std::isfinite(leading) || !std::isfinite(rhs.m_terms[0]))
+    {
+        return MultiDouble{leading};
+    }
+
+    // Long division, one double quotient digit at a time
+    std::array<double, N + 1> quotients{};
+    auto remainder{m_terms};
+    for (auto& quotient : quotients)
+    {
+        quotient = remainder[0] / rhs.m_terms[0];
+        remainder = subtractMultiple(remainder, rhs.m_terms, quotient);
+    }
+
+    MultiDouble result{};
+    result.m_terms = renormalize<N>(quotients);
+    return result;
+}
+
+template <size_t N> auto MultiDouble<N>::operator-() const -> MultiDouble
+{
+    MultiDouble result{*this};
+    for (auto& term : result.m_terms)
+    {
+        term = -term;
+    }
+    return result;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator*(double const rhs) const -> MultiDouble
+{
+    double const leading{m_terms[0] * rhs};
+    if (!std::isfinite(leading))
+    {
+        return MultiDouble{leading};
+    }
+
+    MultiDouble result{};
+    result.m_terms = scaleTerms(m_terms, rhs);
+    return result;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator/(double const rhs) const -> MultiDouble
+{
+    double const leading{m_terms[0] / rhs};
+    if (!std::isfinite(leading) || !std::isfinite(rhs))
+    {
+        return MultiDouble{leading};
+    }
+
+    std::array<double, N + 1> quotients{};
+    auto remainder{m_terms};
+    for (auto& quotient : quotients)
+    {
+        quotient = remainder[0] / rhs;
+        remainder = subtractMultiple(remainder, std::array{rhs}, quotient);
+    }
+
+    MultiDouble result{};
+    result.m_terms = renormalize<N>(quotients);
+    return result;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator+=(MultiDouble const& rhs) -> MultiDouble&
+{
+    return *this = *this + rhs;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator-=(MultiDouble const& rhs) -> MultiDouble&
+{
+    return *this = *this - rhs;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator*=(MultiDouble const& rhs) -> MultiDouble&
+{
+    return *this = *this * rhs;
+}
+
+template <size_t N>
+auto MultiDouble<N>::operator/=(MultiDouble const& rhs) -> MultiDouble&
+{
+    return *this = *this / rhs;
+}
+
+template class MultiDouble<2>;
+template class MultiDouble<4>;
+template auto DoubleDouble::fromTerms(std::array<double, 2> const&)
+    -> DoubleDouble;
+template auto QuadDouble::fromTerms(std::array<double, 4> const&)
+    -> QuadDouble;
+
+#define WRAP_UNARY_MULTI_DOUBLE(func, arg1)                                    \
+    template <size_t N>                                                        \
+    auto Functions::func(MultiDouble<N> const& arg1) -> MultiDouble<N>         \
+    {                                                                          \
+        return func##Impl(arg1);                                               \
+    }                                                                          \
+    template auto Functions::func(DoubleDouble const&) -> DoubleDouble;        \
+    template auto Functions::func(QuadDouble const&) -> QuadDouble
+
+template <size_t N>
+auto Functions::id(MultiDouble<N> const& number) -> MultiDouble<N>
+{
+    return number;
+}
+template auto Functions::id(DoubleDouble const&) -> DoubleDouble;
+template auto Functions::id(QuadDouble const&) -> QuadDouble;
+
+WRAP_UNARY_MULTI_DOUBLE(abs, argument);
+WRAP_UNARY_MULTI_DOUBLE(ceil, argument);
+WRAP_UNARY_MULTI_DOUBLE(floor, argument);
+WRAP_UNARY_MULTI_DOUBLE(round, argument);
+WRAP_UNARY_MULTI_DOUBLE(roundeven, argument);
+WRAP_UNARY_MULTI_DOUBLE(trunc, argument);
+
+WRAP_UNARY_MULTI_DOUBLE(sqrt, argument);
+WRAP_UNARY_MULTI_DOUBLE(cbrt, argument);
+
+WRAP_UNARY_MULTI_DOUBLE(exp, exponent);
+WRAP_UNARY_MULTI_DOUBLE(log, argument);
+WRAP_UNARY_MULTI_DOUBLE(log2, argument);
+
+WRAP_UNARY_MULTI_DOUBLE(erf, argument);
+WRAP_UNARY_MULTI_DOUBLE(erfc, argument);
+WRAP_UNARY_MULTI_DOUBLE(gamma, argument);
+
+WRAP_UNARY_MULTI_DOUBLE(sin, radians);
+WRAP_UNARY_MULTI_DOUBLE(csc, radians);
+WRAP_UNARY_MULTI_DOUBLE(asin, argument);
+WRAP_UNARY_MULTI_DOUBLE(cos, radians);
+WRAP_UNARY_MULTI_DOUBLE(sec, radians);
+WRAP_UNARY_MULTI_DOUBLE(acos, argument);
+WRAP_UNARY_MULTI_DOUBLE(tan, radians);
+WRAP_UNARY_MULTI_DOUBLE(cot, radians);
+WRAP_UNARY_MULTI_DOUBLE(atan, argument);
+
+WRAP_UNARY_MULTI_DOUBLE(sinh, argument);
+WRAP_UNARY_MULTI_DOUBLE(cosh, argument);
+WRAP_UNARY_MULTI_DOUBLE(tanh, argument);
+WRAP_UNARY_MULTI_DOUBLE(asinh, argument);
+WRAP_UNARY_MULTI_DOUBLE(acosh, argument);
+WRAP_UNARY_MULTI_DOUBLE(atanh, argument);
+} // namespace calqmath
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "number.h"
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <limits>
+#include <string>
+
+namespace calqmath
+{
+/**
+ * @brief An extended precision number stored as the unevaluated sum of N
+ * doubles, each no larger than half an ulp of the one before it.
+ *
+ * Arithmetic is built from error-free transformations on hardware doubles, so
+ * values never allocate and there are no limb loops. In exchange the exponent
+ * range is that of double, rounding is always to nearest and the last few bits
+ * are not correctly rounded. DoubleDouble and QuadDouble serve precisions of up
+ * to about 106 and 212 bits respectively.
+ *
+ * The elementary functions are overloads in Functions.
+ */
+template <size_t N> class MultiDouble
+{
+public:
+    static_assert(N >= 2);
+
+    static size_t constexpr PRECISION =
+        N * std::numeric_limits<double>::digits;
+
+    // Whether values of the given base-2 precision can be represented.
+    static constexpr auto serves(size_t const precision) -> bool
+    {
+        return precision <= PRECISION;
+    }
+
+    MultiDouble(double number = 0.0);
+
+    // Rounds other to the nearest representable value.
+    explicit MultiDouble(Scalar const& other);
+
+    // Parses with enough precision that every component is exact.
+    explicit MultiDouble(std::string const& representation);
+
+    /**
+     * @brief fromTerms - Builds a value from any number of components, in any
+     * order or overlap, normalizing them.
+     */
+    template <size_t M>
+    static auto fromTerms(std::array<double, M> const& terms) -> MultiDouble;
+
+    [[nodiscard]] auto terms() const -> std::array<double, N> const&;
+
+    [[nodiscard]] auto toDouble() const -> double;
+    [[nodiscard]] auto
+    toScalar(size_t precision = MathContext::current().precision) const
+        -> Scalar;
+
+    [[nodiscard]] auto isNaN() const -> bool;
+
+    auto operator==(MultiDouble const& rhs) const -> bool;
+    auto operator<=>(MultiDouble const& rhs) const -> std::partial_ordering;
+
+    auto operator+(MultiDouble const& rhs) const -> MultiDouble;
+    auto operator-(MultiDouble const& rhs) const -> MultiDouble;
+    auto operator*(MultiDouble const& rhs) const -> MultiDouble;
+    auto operator/(MultiDouble const& rhs) const -> MultiDouble;
+
+    auto operator-() const -> MultiDouble;
+
+    // Cheaper forms for a plain double operand.
+    auto operator*(double rhs) const -> MultiDouble;
+    auto operator/(double rhs) const -> MultiDouble;
+
+    auto operator+=(MultiDouble const& rhs) -> MultiDouble&;
+    auto operator-=(MultiDouble const& rhs) -> MultiDouble&;
+    auto operator*=(MultiDouble const& rhs) -> MultiDouble&;
+    auto operator/=(MultiDouble const& rhs) -> MultiDouble&;
+
+private:
+    std::array<double, N> m_terms{};
+};
+
+using DoubleDouble = MultiDouble<2>;
+using QuadDouble = MultiDouble<4>;
+
+extern template class MultiDouble<2>;
+extern template class MultiDouble<4>;
+} // namespace calqmath
@@ -2,26 +2,66 @@
 
 #include "mpfr.h"
 #include "numberimpl.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <climits>
+#include <compare>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <format>
+#include <new>
 #include <numbers>
 #include <optional>
 #include <utility>
 
 namespace calqmath
 {
-void initBignumBackend()
+namespace
+{
+thread_local MathContext t_context{};
+
+void applyExponentRange(MathContext const& context)
+{
+    auto const exponentMin{std::clamp<int64_t>(
+        context.exponentMin, mpfr_get_emin_min(), mpfr_get_emin_max()
+    )};
+    auto const exponentMax{std::clamp<int64_t>(
+        context.exponentMax, mpfr_get_emax_min(), mpfr_get_emax_max()
+    )};
+
+    [[maybe_unused]] auto const minError{
+        mpfr_set_emin(static_cast<mpfr_exp_t>(exponentMin))
+    };
+    [[maybe_unused]] auto const maxError{
+        mpfr_set_emax(static_cast<mpfr_exp_t>(exponentMax))
+    };
+    assert(minError == 0 && maxError == 0);
+}
+} // namespace
+
+auto MathContext::current() -> MathContext const& { return t_context; }
+
+MathContextScope::MathContextScope(MathContext const& context)
+    : m_previous{t_context}
 {
-    mpfr_set_default_prec(mpfr_prec_t{DEFAULT_BASE_2_PRECISION});
+    t_context = context;
+    applyExponentRange(t_context);
 }
 
+MathContextScope::~MathContextScope()
+{
+    t_context = m_previous;
+    applyExponentRange(t_context);
+}
+
+void releaseThreadCaches() { mpfr_free_cache(); }
+
 auto getBignumBackendPrecision(size_t const base) -> size_t
 {
     assert(base > 0);
-    auto const precision{detail::clampPrecisionFromMPFR(mpfr_get_default_prec())
-    };
+    auto const precision{MathContext::current().precision};
     return precision * std::numbers::ln2 / std::log(base);
 }
 
@@ -31,65 +71,177 @@ auto Scalar::precisionMax() -> size_t { return detail::MAX_PRECISION; }
 auto Scalar::baseMin() -> size_t { return detail::MIN_BASE; }
 auto Scalar::baseMax() -> size_t { return detail::MAX_BASE; }
 
-Scalar::Scalar(no_set, size_t const precision)
+void Scalar::init(size_t const precision)
+{
+    static_assert(sizeof(detail::ScalarImpl) <= IMPL_SIZE);
+    static_assert(alignof(detail::ScalarImpl) <= alignof(uint64_t));
+    static_assert(sizeof(mp_limb_t) * CHAR_BIT == LIMB_BITS);
+
+    auto* const impl{new (m_impl.data()) detail::ScalarImpl{}};
+    auto const mpfrPrecision{detail::clampPrecisionForMPFR(precision)};
+
+    if (mpfr_custom_get_size(mpfrPrecision) <= m_limbs.size())
+    {
+        mpfr_custom_init(m_limbs.data(), mpfrPrecision);
+        mpfr_custom_init_set(
+            impl, MPFR_NAN_KIND, 0, mpfrPrecision, m_limbs.data()
+        );
+    }
+    else
+    {
+        mpfr_init2(impl, mpfrPrecision);
+    }
+}
+
+void Scalar::clear()
 {
-    p_impl = std::make_unique<detail::ScalarImpl>();
-    mpfr_init2(p_impl.get(), detail::clampPrecisionForMPFR(precision));
+    // Inline limbs are released along with this object.
+    if (!isInline())
+    {
+        mpfr_clear(impl());
+    }
 }
 
+void Scalar::take(Scalar& other) noexcept
+{
+    auto* const impl{new (m_impl.data()) detail::ScalarImpl{*other.impl()}};
+
+    if (other.isInline())
+    {
+        std::memcpy(
+            m_limbs.data(),
+            other.m_limbs.data(),
+            mpfr_custom_get_size(mpfr_get_prec(impl))
+        );
+        mpfr_custom_move(impl, m_limbs.data());
+    }
+    else
+    {
+        // This now owns the heap limbs, so other must not free them.
+        other.init(detail::MIN_PRECISION);
+    }
+}
+
+void Scalar::widen(size_t const precision)
+{
+    if (precision <= this->precision())
+    {
+        return;
+    }
+
+    Scalar widened{no_set{}, precision};
+    // Exact, since the new precision is larger
+    mpfr_set(widened.impl(), impl(), MPFR_RNDN);
+    *this = std::move(widened);
+}
+
+auto Scalar::isInline() const -> bool
+{
+    return static_cast<void const*>(impl()->_mpfr_d) == m_limbs.data();
+}
+
+auto Scalar::impl() -> detail::ScalarImpl*
+{
+    return std::launder(reinterpret_cast<detail::ScalarImpl*>(m_impl.data()));
+}
+
+auto Scalar::impl() const -> detail::ScalarImpl const*
+{
+    return std::launder(
+        reinterpret_cast<detail::ScalarImpl const*>(m_impl.data())
+    );
+}
+
+Scalar::Scalar(no_set, size_t const precision) { init(precision); }
+
 Scalar::Scalar(double const number, size_t const precision)
 {
-    p_impl = std::make_unique<detail::ScalarImpl>();
-    mpfr_init2(p_impl.get(), detail::clampPrecisionForMPFR(precision));
+    init(precision);
 
-    mpfr_set_d(p_impl.get(), number, mpfr_get_default_rounding_mode());
+    mpfr_set_d(impl(), number, detail::currentRoundingForMPFR());
 }
 
 Scalar::Scalar(
-    std::string const& representation, size_t const precision, size_t const base
+    std::string_view const representation,
+    size_t const precision,
+    size_t const base
 )
 {
-    p_impl = std::make_unique<detail::ScalarImpl>();
-    mpfr_init2(p_impl.get(), detail::clampPrecisionForMPFR(precision));
+    init(precision);
+
+    /*
+     * The backend reads null-terminated strings. Representations short enough
+     * are terminated on the stack, so that literals sliced out of a larger
+     * input do not allocate.
+     */
+    static size_t constexpr INLINE_REPRESENTATION_SIZE = 64;
+    std::array<char, INLINE_REPRESENTATION_SIZE> inlineRepresentation{};
+    std::string heapRepresentation{};
+
+    char const* terminated{inlineRepresentation.data()};
+    if (representation.size() < inlineRepresentation.size())
+    {
+        std::ranges::copy(representation, inlineRepresentation.begin());
+    }
+    else
+    {
+        heapRepresentation = representation;
+        terminated = heapRepresentation.c_str();
+    }
 
     mpfr_set_str(
-        p_impl.get(),
-        representation.c_str(),
+        impl(),
+        terminated,
         detail::clampBaseForMPFR(base),
-        mpfr_get_default_rounding_mode()
+        detail::currentRoundingForMPFR()
     );
 }
 
 auto Scalar::operator=(Scalar&& other) noexcept -> Scalar&
 {
-    p_impl = std::exchange(other.p_impl, nullptr);
+    if (this != &other)
+    {
+        clear();
+        take(other);
+    }
     return *this;
 }
 auto Scalar::operator=(Scalar const& other) -> Scalar&
 {
-    *this = Scalar{};
+    if (this == &other)
+    {
+        return *this;
+    }
 
-    mpfr_set(
-        p_impl.get(), other.p_impl.get(), mpfr_get_default_rounding_mode()
-    );
+    if (mpfr_get_prec(impl()) != mpfr_get_prec(other.impl()))
+    {
+        clear();
+        init(other.precision());
+    }
+
+    mpfr_set(impl(), other.impl(), detail::currentRoundingForMPFR());
 
     return *this;
 }
 
-Scalar::Scalar(Scalar&& other) noexcept { *this = std::move(other); }
+Scalar::Scalar(Scalar const& other, size_t const precision)
+{
+    init(precision);
 
-Scalar::Scalar(Scalar const& other) { *this = other; }
+    mpfr_set(impl(), other.impl(), detail::currentRoundingForMPFR());
+}
+
+Scalar::Scalar(Scalar&& other) noexcept { take(other); }
 
-Scalar::~Scalar()
+Scalar::Scalar(Scalar const& other)
 {
-    // Support the C++ style move constructor by checking if this value was
-    // moved from.
-    if (p_impl != nullptr && p_impl->_mpfr_d != nullptr)
-    {
-        mpfr_clear(p_impl.get());
-    }
+    init(other.precision());
+
+    mpfr_set(impl(), other.impl(), detail::currentRoundingForMPFR());
 }
 
+Scalar::~Scalar() { clear(); }
+
 auto Scalar::toMantissaExponent() const -> std::tuple<std::string, ptrdiff_t>
 {
     std::tuple<std::string, ptrdiff_t> result{};
@@ -102,8 +254,8 @@ auto Scalar::toMantissaExponent() const -> std::tuple<std::string, ptrdiff_t>
         &exponent,
         DEFAULT_BASE,
         PRECISION_DIGITS,
-        p_impl.get(),
-        mpfr_get_default_rounding_mode()
+        impl(),
+        detail::currentRoundingForMPFR()
     );
 
     std::get<0>(result) = pMantissa;
@@ -121,28 +273,28 @@ auto Scalar::zero() -> Scalar
 {
     Scalar result{};
     // +1 indicates positive zero
-    mpfr_set_zero(result.p_impl.get(), 1);
+    mpfr_set_zero(result.impl(), 1);
     return result;
 }
 
 auto Scalar::nan() -> Scalar
 {
     Scalar result{};
-    mpfr_set_nan(result.p_impl.get());
+    mpfr_set_nan(result.impl());
     return result;
 }
 
 auto Scalar::positiveInf() -> Scalar
 {
     Scalar result{};
-    mpfr_set_inf(result.p_impl.get(), 1);
+    mpfr_set_inf(result.impl(), 1);
     return result;
 }
 
 auto Scalar::negativeInf() -> Scalar
 {
     Scalar result{};
-    mpfr_set_inf(result.p_impl.get(), -1);
+    mpfr_set_inf(result.impl(), -1);
     return result;
 }
 
@@ -276,12 +428,12 @@ auto format(ScalarStringDecomposition decomposition) -> std::string
 
 auto Scalar::toString() const -> std::string
 {
-    if (mpfr_nan_p(p_impl.get()) != 0)
+    if (mpfr_nan_p(impl()) != 0)
     {
         return NAN_REPRESENTATION;
     }
 
-    if (mpfr_inf_p(p_impl.get()) != 0)
+    if (mpfr_inf_p(impl()) != 0)
     {
         auto const sgn{sign()};
         assert(sgn == Sign::NEGATIVE || sgn == Sign::POSITIVE);
@@ -299,7 +451,7 @@ auto Scalar::toString() const -> std::string
 
 auto Scalar::sign() const -> Sign
 {
-    auto const sgn = mpfr_sgn(p_impl.get());
+    auto const sgn = mpfr_sgn(impl());
     if (sgn > 0)
     {
         return Sign::POSITIVE;
@@ -313,16 +465,21 @@ auto Scalar::sign() const -> Sign
     return Sign::NEGATIVE;
 }
 
-auto Scalar::isNaN() const -> bool { return mpfr_nan_p(p_impl.get()); }
+auto Scalar::precision() const -> size_t
+{
+    return detail::clampPrecisionFromMPFR(mpfr_get_prec(impl()));
+}
+
+auto Scalar::isNaN() const -> bool { return mpfr_nan_p(impl()); }
 
 auto Scalar::toDouble() const -> double
 {
-    return mpfr_get_d(p_impl.get(), mpfr_get_default_rounding_mode());
+    return mpfr_get_d(impl(), detail::currentRoundingForMPFR());
 }
 
 auto Scalar::operator==(Scalar const& rhs) const -> bool
 {
-    return mpfr_equal_p(p_impl.get(), rhs.p_impl.get()) != 0;
+    return mpfr_equal_p(impl(), rhs.impl()) != 0;
 }
 
 auto Scalar::operator!=(Scalar const& rhs) const -> bool
@@ -330,60 +487,95 @@ auto Scalar::operator!=(Scalar const& rhs) const -> bool
     return !(*this == rhs);
 }
 
+auto Scalar::operator<=>(Scalar const& rhs) const -> std::partial_ordering
+{
+    if (mpfr_unordered_p(impl(), rhs.impl()) != 0)
+    {
+        return std::partial_ordering::unordered;
+    }
+    return mpfr_cmp(impl(), rhs.impl()) <=> 0;
+}
+
 auto Scalar::operator+(Scalar const& rhs) const -> Scalar
 {
-    Scalar result{};
+    Scalar result{no_set{}, std::max(precision(), rhs.precision())};
     mpfr_add(
-        result.p_impl.get(),
-        p_impl.get(),
-        rhs.p_impl.get(),
-        mpfr_get_default_rounding_mode()
+        result.impl(),
+        impl(),
+        rhs.impl(),
+        detail::currentRoundingForMPFR()
     );
     return result;
 }
 
 auto Scalar::operator-(Scalar const& rhs) const -> Scalar
 {
-    Scalar result{};
+    Scalar result{no_set{}, std::max(precision(), rhs.precision())};
     mpfr_sub(
-        result.p_impl.get(),
-        p_impl.get(),
-        rhs.p_impl.get(),
-        mpfr_get_default_rounding_mode()
+        result.impl(),
+        impl(),
+        rhs.impl(),
+        detail::currentRoundingForMPFR()
     );
     return result;
 }
 
 auto Scalar::operator*(Scalar const& rhs) const -> Scalar
 {
-    Scalar result{};
+    Scalar result{no_set{}, std::max(precision(), rhs.precision())};
     mpfr_mul(
-        result.p_impl.get(),
-        p_impl.get(),
-        rhs.p_impl.get(),
-        mpfr_get_default_rounding_mode()
+        result.impl(),
+        impl(),
+        rhs.impl(),
+        detail::currentRoundingForMPFR()
     );
     return result;
 }
 auto Scalar::operator/(Scalar const& rhs) const -> Scalar
 {
-    Scalar result{};
+    Scalar result{no_set{}, std::max(precision(), rhs.precision())};
     mpfr_div(
-        result.p_impl.get(),
-        p_impl.get(),
-        rhs.p_impl.get(),
-        mpfr_get_default_rounding_mode()
+        result.impl(),
+        impl(),
+        rhs.impl(),
+        detail::currentRoundingForMPFR()
     );
     return result;
 }
 
 auto Scalar::operator-() const -> Scalar
 {
-    Scalar result{};
-    mpfr_neg(
-        result.p_impl.get(), p_impl.get(), mpfr_get_default_rounding_mode()
-    );
+    Scalar result{no_set{}, precision()};
+    mpfr_neg(result.impl(), impl(), detail::currentRoundingForMPFR());
     return result;
 }
 
+auto Scalar::operator+=(Scalar const& rhs) -> Scalar&
+{
+    widen(rhs.precision());
+    mpfr_add(impl(), impl(), rhs.impl(), detail::currentRoundingForMPFR());
+    return *this;
+}
+
+auto Scalar::operator-=(Scalar const& rhs) -> Scalar&
+{
+    widen(rhs.precision());
+    mpfr_sub(impl(), impl(), rhs.impl(), detail::currentRoundingForMPFR());
+    return *this;
+}
+
+auto Scalar::operator*=(Scalar const& rhs) -> Scalar&
+{
+    widen(rhs.precision());
+    mpfr_mul(impl(), impl(), rhs.impl(), detail::currentRoundingForMPFR());
+    return *this;
+}
+
+auto Scalar::operator/=(Scalar const& rhs) -> Scalar&
+{
+    widen(rhs.precision());
+    mpfr_div(impl(), impl(), rhs.impl(), detail::currentRoundingForMPFR());
+    return *this;
+}
+
 } // namespace calqmath
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
+#include <compare>
+#include <cstddef>
 #include <cstdint>
-#include <memory>
 #include <string>
+#include <string_view>
 
 namespace detail
 {
@@ -12,15 +15,87 @@ class ScalarImpl;
 namespace calqmath
 {
 class Functions;
+class ScalarVector;
 
 // Has a major, roughly linear, impact on performance
 size_t constexpr DEFAULT_BASE_2_PRECISION = 128;
 
+// Scalars at or below this precision store their limbs inline, so creating one
+// does not allocate. Larger precisions fall back to the backend's allocator.
+size_t constexpr INLINE_BASE_2_PRECISION = 256;
+
 // For string interpretation
 size_t constexpr DEFAULT_BASE = 10;
 
+// Binary exponent range of the backend's defaults
+int64_t constexpr DEFAULT_EXPONENT_MIN = 1 - (int64_t{1} << 30);
+int64_t constexpr DEFAULT_EXPONENT_MAX = (int64_t{1} << 30) - 1;
+
+enum class RoundingMode : uint8_t
+{
+    // Round to nearest, with ties going to the even mantissa.
+    NEAREST,
+    TOWARD_ZERO,
+    TOWARD_POSITIVE,
+    TOWARD_NEGATIVE,
+    AWAY_FROM_ZERO,
+};
+
+/**
+ * @brief The settings that Scalar arithmetic, Functions, and expression
+ * evaluation run under.
+ *
+ * Every thread has its own current context, which starts out with the defaults
+ * below and is changed with MathContextScope. Changes only affect the calling
+ * thread, so threads may evaluate with different settings concurrently. The
+ * exponent range relies on the backend keeping its exponent range per thread,
+ * which is the case for thread-safe MPFR builds such as the one vcpkg provides.
+ */
+struct MathContext
+{
+    // Precision of newly created values. Arithmetic on existing values uses
+    // the largest precision among the operands.
+    size_t precision{DEFAULT_BASE_2_PRECISION};
+    RoundingMode rounding{RoundingMode::NEAREST};
+
+    // Results with a binary exponent outside this range overflow to infinity
+    // or underflow to zero. Clamped to what the backend supports.
+    int64_t exponentMin{DEFAULT_EXPONENT_MIN};
+    int64_t exponentMax{DEFAULT_EXPONENT_MAX};
+
+    // The context in effect for the calling thread.
+    static auto current() -> MathContext const&;
+
+    auto operator==(MathContext const& rhs) const -> bool = default;
+};
+
+/**
+ * @brief Installs a MathContext for the calling thread, restoring the previous
+ * one when destroyed. Scopes must be destroyed in the reverse order they were
+ * created, which is natural when they live on the stack.
+ */
+class MathContextScope
+{
+public:
+    explicit MathContextScope(MathContext const& context);
+    ~MathContextScope();
+
+    MathContextScope(MathContextScope const&) = delete;
+    MathContextScope(MathContextScope&&) = delete;
+    auto operator=(MathContextScope const&) -> MathContextScope& = delete;
+    auto operator=(MathContextScope&&) -> MathContextScope& = delete;
+
+private:
+    MathContext m_previous;
+};
+
+// Frees the backend's caches for the calling thread, such as constants it has
+// computed. Threads other than the main one should call this before exiting.
+void releaseThreadCaches();
+
+// Number of digits in the given base that the current context's precision
+// can represent.
 auto getBignumBackendPrecision(size_t base = DEFAULT_BASE) -> size_t;
-void initBignumBackend();
 
 enum class Sign : uint8_t
 {
@@ -42,15 +117,18 @@ public:
      * Base gets clamped to the range returned by baseMax and baseMin.
      */
     explicit Scalar(
-        std::string const& representation,
-        size_t precision = DEFAULT_BASE_2_PRECISION,
+        std::string_view representation,
+        size_t precision = MathContext::current().precision,
         size_t base = DEFAULT_BASE
     );
 
     explicit Scalar(
-        double number = 0.0, size_t precision = DEFAULT_BASE_2_PRECISION
+        double number = 0.0, size_t precision = MathContext::current().precision
     );
 
+    // Rounds other to the given precision.
+    explicit Scalar(Scalar const& other, size_t precision);
+
     Scalar(Scalar&& other) noexcept;
     Scalar(Scalar const& other);
 
@@ -82,6 +160,14 @@ public:
 
     [[nodiscard]] auto toString() const -> std::string;
 
+    /**
+     * Arithmetic results take the largest precision of their operands, so
+     * low precision inputs stay cheap to compute with.
+     *
+     * @brief precision - The base-2 precision of this value's mantissa.
+     */
+    [[nodiscard]] auto precision() const -> size_t;
+
     [[nodiscard]] auto sign() const -> Sign;
     [[nodiscard]] auto isNaN() const -> bool;
 
@@ -89,6 +175,8 @@ public:
 
     auto operator==(Scalar const& rhs) const -> bool;
     auto operator!=(Scalar const& rhs) const -> bool;
+    // Unordered if either value is NaN.
+    auto operator<=>(Scalar const& rhs) const -> std::partial_ordering;
 
     auto operator+(Scalar const& rhs) const -> Scalar;
     auto operator-(Scalar const& rhs) const -> Scalar;
@@ -97,15 +185,55 @@ public:
 
     auto operator-() const -> Scalar;
 
+    /*
+     * In place variants, which reuse this value's storage instead of creating
+     * a temporary. This value's precision grows to rhs's if that is larger.
+     */
+
+    auto operator+=(Scalar const& rhs) -> Scalar&;
+    auto operator-=(Scalar const& rhs) -> Scalar&;
+    auto operator*=(Scalar const& rhs) -> Scalar&;
+    auto operator/=(Scalar const& rhs) -> Scalar&;
+
     friend Functions;
+    friend ScalarVector;
 
 private:
     struct no_set
     {
     };
 
-    explicit Scalar(no_set, size_t precision = DEFAULT_BASE_2_PRECISION);
+    explicit Scalar(
+        no_set, size_t precision = MathContext::current().precision
+    );
 
-    std::unique_ptr<detail::ScalarImpl> p_impl;
+    // Constructs the backend value in place, using the inline limbs when the
+    // precision allows it.
+    void init(size_t precision);
+    // Frees heap limbs, if there are any. The value must be re-initialized
+    // before use.
+    void clear();
+    // Moves the value of other into this uninitialized Scalar. other is left
+    // valid at the minimum precision.
+    void take(Scalar& other) noexcept;
+    // Raises the precision to at least the given one, keeping the value.
+    void widen(size_t precision);
+
+    [[nodiscard]] auto isInline() const -> bool;
+
+    [[nodiscard]] auto impl() -> detail::ScalarImpl*;
+    [[nodiscard]] auto impl() const -> detail::ScalarImpl const*;
+
+    static size_t constexpr LIMB_BITS = 64;
+
+    // Storage for detail::ScalarImpl, large enough for the backend's header on
+    // all supported platforms. Checked in the implementation.
+    static size_t constexpr IMPL_SIZE = 32;
+    static size_t constexpr INLINE_LIMBS_SIZE =
+        (INLINE_BASE_2_PRECISION + LIMB_BITS - 1) / LIMB_BITS
+        * sizeof(uint64_t);
+
+    alignas(uint64_t) std::array<std::byte, IMPL_SIZE> m_impl;
+    alignas(uint64_t) std::array<std::byte, INLINE_LIMBS_SIZE> m_limbs;
 };
 } // namespace calqmath
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mpfr.h"
+#include "number.h"
 #include <cassert>
 #include <utility>
 
@@ -76,4 +77,30 @@ inline auto clampBaseForMPFR(size_t const base) -> int
 
     return base;
 }
+
+inline auto roundingForMPFR(calqmath::RoundingMode const rounding)
+    -> mpfr_rnd_t
+{
+    switch (rounding)
+    {
+    case calqmath::RoundingMode::NEAREST:
+        return MPFR_RNDN;
+    case calqmath::RoundingMode::TOWARD_ZERO:
+        return MPFR_RNDZ;
+    case calqmath::RoundingMode::TOWARD_POSITIVE:
+        return MPFR_RNDU;
+    case calqmath::RoundingMode::TOWARD_NEGATIVE:
+        return MPFR_RNDD;
+    case calqmath::RoundingMode::AWAY_FROM_ZERO:
+        return MPFR_RNDA;
+    }
+
+    return MPFR_RNDN;
+}
+
+// Rounding mode of the calling thread's MathContext
+inline auto currentRoundingForMPFR() -> mpfr_rnd_t
+{
+    return roundingForMPFR(calqmath::MathContext::current().rounding);
+}
 } // namespace detail
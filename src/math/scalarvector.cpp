@@ -0,0 +1,340 @@
+#include "scalarvector.h"
+
+#include "functions.h"
+#include "mpfr.h"
+#include "numberimpl.h"
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace calqmath
+{
+ScalarVector::ScalarVector(size_t const size, size_t const precision)
+    : m_precision{
+          static_cast<size_t>(detail::clampPrecisionForMPFR(precision))
+      }
+    , m_limbsPerValue{
+          mpfr_custom_get_size(detail::clampPrecisionForMPFR(precision))
+          / sizeof(uint64_t)
+      }
+    , m_impls(size)
+    , m_limbs(size * m_limbsPerValue)
+{
+    static_assert(sizeof(detail::ScalarImpl) <= IMPL_SIZE);
+    static_assert(alignof(detail::ScalarImpl) <= alignof(ImplStorage));
+    static_assert(sizeof(mp_limb_t) == sizeof(uint64_t));
+
+    auto const mpfrPrecision{detail::clampPrecisionForMPFR(m_precision)};
+    for (size_t i = 0; i < size; i++)
+    {
+        auto* const impl{new (m_impls[i].bytes.data()) detail::ScalarImpl{}};
+        uint64_t* const limbs{m_limbs.data() + i * m_limbsPerValue};
+
+        mpfr_custom_init(limbs, mpfrPrecision);
+        // The sign of the kind gives positive zero.
+        mpfr_custom_init_set(impl, MPFR_ZERO_KIND, 0, mpfrPrecision, limbs);
+    }
+}
+
+ScalarVector::ScalarVector(
+    std::span<double const> const numbers, size_t const precision
+)
+    : ScalarVector(numbers.size(), precision)
+{
+    auto const rounding{detail::currentRoundingForMPFR()};
+    for (size_t i = 0; i < numbers.size(); i++)
+    {
+        mpfr_set_d(impl(i), numbers[i], rounding);
+    }
+}
+
+ScalarVector::ScalarVector(ScalarVector const& other)
+    : m_precision{other.m_precision}
+    , m_limbsPerValue{other.m_limbsPerValue}
+    , m_impls{other.m_impls}
+    , m_limbs{other.m_limbs}
+{
+    // The copied headers still point at other's limbs.
+    for (size_t i = 0; i < size(); i++)
+    {
+        mpfr_custom_move(impl(i), m_limbs.data() + i * m_limbsPerValue);
+    }
+}
+
+auto ScalarVector::operator=(ScalarVector const& other) -> ScalarVector&
+{
+    if (this != &other)
+    {
+        *this = ScalarVector{other};
+    }
+    return *this;
+}
+
+auto ScalarVector::size() const -> size_t { return m_impls.size(); }
+
+auto ScalarVector::empty() const -> bool { return m_impls.empty(); }
+
+auto ScalarVector::precision() const -> size_t { return m_precision; }
+
+auto ScalarVector::get(size_t const index) const -> Scalar
+{
+    assert(index < size());
+
+    Scalar result{Scalar::no_set{}, m_precision};
+    mpfr_set(result.impl(), impl(index), MPFR_RNDN);
+    return result;
+}
+
+void ScalarVector::set(size_t const index, Scalar const& value)
+{
+    assert(index < size());
+    mpfr_set(impl(index), value.impl(), detail::currentRoundingForMPFR());
+}
+
+void ScalarVector::set(size_t const index, double const value)
+{
+    assert(index < size());
+    mpfr_set_d(impl(index), value, detail::currentRoundingForMPFR());
+}
+
+void ScalarVector::fill(Scalar const& value)
+{
+    auto const rounding{detail::currentRoundingForMPFR()};
+    for (size_t i = 0; i < size(); i++)
+    {
+        mpfr_set(impl(i), value.impl(), rounding);
+    }
+}
+
+void ScalarVector::toDoubles(std::span<double> const results) const
+{
+    assert(results.size() == size());
+
+    auto const rounding{detail::currentRoundingForMPFR()};
+    for (size_t i = 0; i < size(); i++)
+    {
+        results[i] = mpfr_get_d(impl(i), rounding);
+    }
+}
+
+auto ScalarVector::operator==(ScalarVector const& rhs) const -> bool
+{
+    if (size() != rhs.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        if (mpfr_equal_p(impl(i), rhs.impl(i)) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ScalarVector::widen(size_t const precision)
+{
+    if (precision <= m_precision)
+    {
+        return;
+    }
+
+    ScalarVector widened{size(), precision};
+    for (size_t i = 0; i < size(); i++)
+    {
+        // Exact, since the new precision is larger
+        mpfr_set(widened.impl(i), impl(i), MPFR_RNDN);
+    }
+    *this = std::move(widened);
+}
+
+auto ScalarVector::impl(size_t const index) -> detail::ScalarImpl*
+{
+    return std::launder(
+        reinterpret_cast<detail::ScalarImpl*>(m_impls[index].bytes.data())
+    );
+}
+
+auto ScalarVector::impl(size_t const index) const
+    -> detail::ScalarImpl const*
+{
+    return std::launder(reinterpret_cast<detail::ScalarImpl const*>(
+        m_impls[index].bytes.data()
+    ));
+}
+
+#define WRAP_UNARY_VECTOR(func, arg1)                                          \
+    void Functions::func(ScalarVector const& arg1, ScalarVector& results)      \
+    {                                                                          \
+        assert(arg1.size() == results.size());                                 \
+        results.widen(arg1.precision());                                       \
+        auto const rounding{detail::currentRoundingForMPFR()};                 \
+        for (size_t i = 0; i < arg1.size(); i++)                               \
+        {                                                                      \
+            mpfr_##func(results.impl(i), arg1.impl(i), rounding);              \
+        }                                                                      \
+    }
+
+#define WRAP_UNARY_VECTOR_NO_ROUND(func, arg1)                                 \
+    void Functions::func(ScalarVector const& arg1, ScalarVector& results)      \
+    {                                                                          \
+        assert(arg1.size() == results.size());                                 \
+        results.widen(arg1.precision());                                       \
+        for (size_t i = 0; i < arg1.size(); i++)                               \
+        {                                                                      \
+            mpfr_##func(results.impl(i), arg1.impl(i));                        \
+        }                                                                      \
+    }
+
+namespace
+{
+// The number of elements an operand provides, where scalars broadcast to any.
+auto operandSize(ScalarVector const& vector, size_t /*broadcast*/) -> size_t
+{
+    return vector.size();
+}
+
+auto operandSize(Scalar const& /*scalar*/, size_t const broadcast) -> size_t
+{
+    return broadcast;
+}
+} // namespace
+
+/*
+ * Binary arithmetic, for every combination of vector and broadcast scalar
+ * operands. The operand expressions pick the element at index i.
+ */
+#define WRAP_BINARY_VECTOR(func, mpfrFunc, Lhs, Rhs, lhsElement, rhsElement)   \
+    void Functions::func(ScalarVector& result, Lhs const& lhs, Rhs const& rhs) \
+    {                                                                          \
+        assert(operandSize(lhs, result.size()) == result.size());              \
+        assert(operandSize(rhs, result.size()) == result.size());              \
+        result.widen(std::max(lhs.precision(), rhs.precision()));              \
+        auto const rounding{detail::currentRoundingForMPFR()};                 \
+        for (size_t i = 0; i < result.size(); i++)                             \
+        {                                                                      \
+            mpfrFunc(result.impl(i), lhsElement, rhsElement, rounding);        \
+        }                                                                      \
+    }
+
+#define WRAP_BINARY_VECTOR_ALL(func, mpfrFunc)                                 \
+    WRAP_BINARY_VECTOR(                                                        \
+        func, mpfrFunc, ScalarVector, ScalarVector, lhs.impl(i), rhs.impl(i)   \
+    )                                                                          \
+    WRAP_BINARY_VECTOR(                                                        \
+        func, mpfrFunc, ScalarVector, Scalar, lhs.impl(i), rhs.impl()          \
+    )                                                                          \
+    WRAP_BINARY_VECTOR(                                                        \
+        func, mpfrFunc, Scalar, ScalarVector, lhs.impl(), rhs.impl(i)          \
+    )
+
+WRAP_BINARY_VECTOR_ALL(add, mpfr_add);
+WRAP_BINARY_VECTOR_ALL(subtract, mpfr_sub);
+WRAP_BINARY_VECTOR_ALL(multiply, mpfr_mul);
+WRAP_BINARY_VECTOR_ALL(divide, mpfr_div);
+
+void Functions::negate(ScalarVector& result, ScalarVector const& argument)
+{
+    assert(result.size() == argument.size());
+    result.widen(argument.precision());
+    auto const rounding{detail::currentRoundingForMPFR()};
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        mpfr_neg(result.impl(i), argument.impl(i), rounding);
+    }
+}
+
+void Functions::sqr(ScalarVector& result, ScalarVector const& argument)
+{
+    assert(result.size() == argument.size());
+    result.widen(argument.precision());
+    auto const rounding{detail::currentRoundingForMPFR()};
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        mpfr_sqr(result.impl(i), argument.impl(i), rounding);
+    }
+}
+
+void Functions::fma(
+    ScalarVector& result,
+    ScalarVector const& lhs,
+    ScalarVector const& rhs,
+    ScalarVector const& addend
+)
+{
+    assert(lhs.size() == result.size());
+    assert(rhs.size() == result.size());
+    assert(addend.size() == result.size());
+    result.widen(
+        std::max({lhs.precision(), rhs.precision(), addend.precision()})
+    );
+    auto const rounding{detail::currentRoundingForMPFR()};
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        mpfr_fma(
+            result.impl(i), lhs.impl(i), rhs.impl(i), addend.impl(i), rounding
+        );
+    }
+}
+
+void Functions::id(ScalarVector const& numbers, ScalarVector& results)
+{
+    assert(numbers.size() == results.size());
+    if (&numbers == &results)
+    {
+        return;
+    }
+    results.widen(numbers.precision());
+    for (size_t i = 0; i < numbers.size(); i++)
+    {
+        // Exact, the results are at least as precise.
+        mpfr_set(results.impl(i), numbers.impl(i), MPFR_RNDN);
+    }
+}
+WRAP_UNARY_VECTOR(abs, argument);
+
+WRAP_UNARY_VECTOR_NO_ROUND(ceil, argument);
+WRAP_UNARY_VECTOR_NO_ROUND(floor, argument);
+WRAP_UNARY_VECTOR_NO_ROUND(round, argument);
+void Functions::roundeven(ScalarVector const& argument, ScalarVector& results)
+{
+    assert(argument.size() == results.size());
+    results.widen(argument.precision());
+    for (size_t i = 0; i < argument.size(); i++)
+    {
+        mpfr_rint(results.impl(i), argument.impl(i), MPFR_RNDN);
+    }
+}
+WRAP_UNARY_VECTOR_NO_ROUND(trunc, argument);
+
+WRAP_UNARY_VECTOR(sqrt, argument);
+WRAP_UNARY_VECTOR(cbrt, argument);
+
+WRAP_UNARY_VECTOR(exp, exponent);
+WRAP_UNARY_VECTOR(log, argument);
+WRAP_UNARY_VECTOR(log2, argument);
+
+WRAP_UNARY_VECTOR(erf, argument);
+WRAP_UNARY_VECTOR(erfc, argument);
+WRAP_UNARY_VECTOR(gamma, argument);
+
+WRAP_UNARY_VECTOR(sin, radians);
+WRAP_UNARY_VECTOR(csc, radians);
+WRAP_UNARY_VECTOR(asin, argument);
+WRAP_UNARY_VECTOR(cos, radians);
+WRAP_UNARY_VECTOR(sec, radians);
+WRAP_UNARY_VECTOR(acos, argument);
+WRAP_UNARY_VECTOR(tan, radians);
+WRAP_UNARY_VECTOR(cot, radians);
+WRAP_UNARY_VECTOR(atan, argument);
+
+WRAP_UNARY_VECTOR(sinh, argument);
+WRAP_UNARY_VECTOR(cosh, argument);
+WRAP_UNARY_VECTOR(tanh, argument);
+WRAP_UNARY_VECTOR(asinh, argument);
+WRAP_UNARY_VECTOR(acosh, argument);
+WRAP_UNARY_VECTOR(atanh, argument);
+} // namespace calqmath
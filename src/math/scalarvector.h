@@ -0,0 +1,93 @@
+#pragma once
+
+#include "number.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace detail
+{
+class ScalarImpl;
+} // namespace detail
+
+namespace calqmath
+{
+class Functions;
+
+/**
+ * @brief A fixed number of Scalars sharing one precision, stored as structure
+ * of arrays.
+ *
+ * The backend headers sit in one array and every value's limbs in a single
+ * contiguous buffer, so creating a vector allocates twice regardless of its
+ * size and elementwise loops walk memory in order. Values are never allocated
+ * by the backend, which keeps them out of EvaluationArena's way.
+ *
+ * Arithmetic and the unary functions are overloads in Functions, writing into
+ * an existing result vector.
+ */
+class ScalarVector
+{
+public:
+    // Zeroes.
+    explicit ScalarVector(
+        size_t size = 0, size_t precision = MathContext::current().precision
+    );
+    explicit ScalarVector(
+        std::span<double const> numbers,
+        size_t precision = MathContext::current().precision
+    );
+
+    ScalarVector(ScalarVector&& other) noexcept = default;
+    ScalarVector(ScalarVector const& other);
+
+    auto operator=(ScalarVector&& other) noexcept -> ScalarVector& = default;
+    auto operator=(ScalarVector const& other) -> ScalarVector&;
+
+    ~ScalarVector() = default;
+
+    [[nodiscard]] auto size() const -> size_t;
+    [[nodiscard]] auto empty() const -> bool;
+    // The base-2 precision shared by every value.
+    [[nodiscard]] auto precision() const -> size_t;
+
+    // Copies out a single value, at the vector's precision.
+    [[nodiscard]] auto get(size_t index) const -> Scalar;
+    // Rounds the value to the vector's precision.
+    void set(size_t index, Scalar const& value);
+    void set(size_t index, double value);
+    // Sets every value.
+    void fill(Scalar const& value);
+
+    // Rounds every value to a double. results must have the same size.
+    void toDoubles(std::span<double> results) const;
+
+    auto operator==(ScalarVector const& rhs) const -> bool;
+
+    friend Functions;
+
+private:
+    // Reallocates at the given precision, keeping the values, if that is
+    // larger than the current one.
+    void widen(size_t precision);
+
+    [[nodiscard]] auto impl(size_t index) -> detail::ScalarImpl*;
+    [[nodiscard]] auto impl(size_t index) const -> detail::ScalarImpl const*;
+
+    // Storage for detail::ScalarImpl, checked in the implementation.
+    static size_t constexpr IMPL_SIZE = 32;
+
+    struct alignas(uint64_t) ImplStorage
+    {
+        std::array<std::byte, IMPL_SIZE> bytes;
+    };
+
+    size_t m_precision;
+    // Limbs taken by each value, the stride of m_limbs.
+    size_t m_limbsPerValue;
+    std::vector<ImplStorage> m_impls;
+    std::vector<uint64_t> m_limbs;
+};
+} // namespace calqmath
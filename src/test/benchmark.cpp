@@ -1,7 +1,18 @@
+#include "interpreter/bytecode.h"
+#include "interpreter/executor.h"
+#include "interpreter/function_database.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/jit.h"
+#include "interpreter/lexer.h"
+#include "interpreter/parser.h"
+#include "interpreter/static_expression.h"
 
+#include "math/arena.h"
 #include "math/functions.h"
+#include "math/jet.h"
+#include "math/multidouble.h"
 #include "math/number.h"
+#include "math/scalarvector.h"
 
 #include <QByteArray>
 #include <QObject>
@@ -9,20 +20,223 @@
 #include <QTest>
 #include <QtLogging>
 
+#include <chrono>
 #include <expected>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 class CalQBenchmark : public QObject
 {
     Q_OBJECT
 private slots:
+    static void initTestCase();
+
+    static void benchmarkLexer_data();
+    static void benchmarkLexer();
+
+    static void benchmarkStartup();
+
+    static void benchmarkFunctionLookup_data();
+    static void benchmarkFunctionLookup();
+
     static void benchmarkEvaluation_data();
     static void benchmarkEvaluation();
 
+    static void benchmarkSimplified_data();
+    static void benchmarkSimplified();
+
+    static void benchmarkDerivatives_data();
+    static void benchmarkDerivatives();
+
+    static void benchmarkEvaluateMany_data();
+    static void benchmarkEvaluateMany();
+
+    static void benchmarkExecutor_data();
+    static void benchmarkExecutor();
+
+    static void benchmarkBytecode_data();
+    static void benchmarkBytecode();
+
+    static void benchmarkDoubleEvaluation_data();
+    static void benchmarkDoubleEvaluation();
+
+    static void benchmarkNativeFunction_data();
+    static void benchmarkNativeFunction();
+
+    static void benchmarkStaticExpression_data();
+    static void benchmarkStaticExpression();
+
     static void benchmarkScalarInit();
 
     static void benchmarkFunctions();
+
+    static void benchmarkPrecision_data();
+    static void benchmarkPrecision();
+
+    static void benchmarkArena_data();
+    static void benchmarkArena();
+
+    static void benchmarkMultiDouble_data();
+    static void benchmarkMultiDouble();
+
+    static void benchmarkBatchFunctions_data();
+    static void benchmarkBatchFunctions();
+
+    static void benchmarkScalarVector_data();
+    static void benchmarkScalarVector();
 };
 
+namespace
+{
+// The kernel of benchmarkPrecision, for any backend.
+template <typename T> void benchmarkKernel(auto const& makeInput)
+{
+    auto const count{10000};
+
+    T const one{makeInput(1.0)};
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            T const input{makeInput(i / double(count))};
+            auto const result{
+                calqmath::Functions::sin(input * input + one) / (input + one)
+            };
+            Q_UNUSED(result);
+        }
+    }
+}
+} // namespace
+
+// Runs before every benchmark, while this is the only thread.
+void CalQBenchmark::initTestCase() { calqmath::EvaluationArena::install(); }
+
+void CalQBenchmark::benchmarkLexer_data()
+{
+    QTest::addColumn<QString>("fragment");
+    QTest::addColumn<bool>("parse");
+    for (bool const parse : {false, true})
+    {
+        char const* const suffix{parse ? " and parse" : ""};
+        QTest::addRow("arithmetic%s", suffix)
+            << QString{"1.5 + 2.25 * (3 - 4) / 5 - "} << parse;
+        QTest::addRow("functions%s", suffix)
+            << QString{"sin(x) * erf(cos(x)) + "} << parse;
+        QTest::addRow("whitespace%s", suffix)
+            << QString{"    1    +    x    *    2    -    "} << parse;
+    }
+}
+
+void CalQBenchmark::benchmarkLexer()
+{
+    QFETCH(QString, fragment);
+    QFETCH(bool, parse);
+
+    // Large enough that the clock's resolution does not matter.
+    size_t constexpr SOURCE_SIZE{size_t{1} << 20U};
+    size_t constexpr REPETITIONS{20};
+
+    std::string source{};
+    while (source.size() < SOURCE_SIZE)
+    {
+        source += fragment.toStdString();
+    }
+    source += "0";
+
+    auto const& functions{calqmath::FunctionDatabase::defaults()};
+
+    // Throughput is reported instead of time, so inputs of any size compare.
+    auto const start{std::chrono::steady_clock::now()};
+    for (size_t i = 0; i < REPETITIONS; i++)
+    {
+        auto const tokens{calqmath::Lexer::convert(source)};
+        QVERIFY(tokens.has_value());
+
+        if (parse)
+        {
+            QVERIFY(calqmath::Parser::parse(functions, source, tokens.value())
+                        .has_value());
+        }
+    }
+    std::chrono::duration<double> const elapsed{
+        std::chrono::steady_clock::now() - start
+    };
+
+    double const bytesPerSecond{
+        static_cast<double>(source.size() * REPETITIONS) / elapsed.count()
+    };
+    qInfo("%.1f MB/s", bytesPerSecond / 1e6);
+    QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+}
+
+void CalQBenchmark::benchmarkStartup()
+{
+    auto const count{100000};
+
+    // Construction alone, and then with the first expression it parses.
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            calqmath::Interpreter const interpreter{};
+            Q_UNUSED(interpreter);
+        }
+    }
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            calqmath::Interpreter const interpreter{};
+            QVERIFY(interpreter.expression("sin(x)").has_value());
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkFunctionLookup_data()
+{
+    QTest::addColumn<bool>("found");
+    QTest::newRow("every function") << true;
+    QTest::newRow("misses") << false;
+}
+
+void CalQBenchmark::benchmarkFunctionLookup()
+{
+    QFETCH(bool, found);
+
+    auto const& functions{calqmath::FunctionDatabase::defaults()};
+
+    std::vector<std::string> names{};
+    for (auto const& function : functions.unaryFunctions())
+    {
+        // Misses of the same lengths, so only the outcome differs.
+        names.emplace_back(function.name);
+        if (!found)
+        {
+            names.back().back() = '_';
+        }
+    }
+
+    auto const count{10000};
+
+    QBENCHMARK
+    {
+        size_t hits{0};
+        for (size_t i = 0; i < count; i++)
+        {
+            for (auto const& name : names)
+            {
+                hits += functions.lookup(name).has_value() ? 1 : 0;
+            }
+        }
+        QCOMPARE(hits, found ? count * names.size() : 0);
+    }
+}
+
 void CalQBenchmark::benchmarkEvaluation_data()
 {
     QTest::addColumn<QString>("input");
@@ -39,6 +253,12 @@ void CalQBenchmark::benchmarkEvaluation_data()
         << "x * 1 * 1 * 1 * 1 * 1 * 1 * 1" << 100000ULL;
     QTest::newRow("deep arithmatic")
         << "1 + x * (1 + x * (1 + x * (1 + x * (1 + x))))" << 100000ULL;
+    QTest::newRow("constant coefficients")
+        << "sin(2) * x + exp(cos(3)) * x * x" << 100000ULL;
+    QTest::newRow("common subexpressions")
+        << "erf(x) * erf(x) + cos(erf(x))" << 10000ULL;
+    QTest::newRow("constant base") << "logn(10, x)" << 10000ULL;
+    QTest::newRow("power") << "pow(x, 1.5)" << 10000ULL;
 }
 
 void CalQBenchmark::benchmarkEvaluation()
@@ -65,6 +285,315 @@ void CalQBenchmark::benchmarkEvaluation()
     }
 }
 
+void CalQBenchmark::benchmarkSimplified_data() { benchmarkEvaluation_data(); }
+
+void CalQBenchmark::benchmarkSimplified()
+{
+    calqmath::Interpreter const interpreter{};
+
+    QFETCH(QString, input);
+    QFETCH(size_t, count);
+
+    auto const expressionResult{interpreter.expression(input.toStdString())};
+    QVERIFY(expressionResult.has_value());
+
+    auto const expression{expressionResult->simplified().expression};
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            auto const result{expression.evaluate(
+                calqmath::Scalar{i / static_cast<double>(count)}
+            )};
+            Q_UNUSED(result);
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkDerivatives_data() { benchmarkEvaluation_data(); }
+
+// The value with both derivatives, against the three evaluations of a second
+// central difference in benchmarkEvaluation.
+void CalQBenchmark::benchmarkDerivatives()
+{
+    calqmath::Interpreter const interpreter{};
+
+    QFETCH(QString, input);
+    QFETCH(size_t, count);
+
+    auto const expressionResult{interpreter.expression(input.toStdString())};
+    QVERIFY(expressionResult.has_value());
+
+    auto const& expression{expressionResult.value()};
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            auto const result{expression.evaluate(calqmath::Jet::variable(
+                calqmath::Scalar{i / static_cast<double>(count)}
+            ))};
+            Q_UNUSED(result);
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkEvaluateMany_data()
+{
+    benchmarkEvaluation_data();
+}
+
+void CalQBenchmark::benchmarkEvaluateMany()
+{
+    calqmath::Interpreter const interpreter{};
+
+    QFETCH(QString, input);
+    QFETCH(size_t, count);
+
+    auto const expressionResult{interpreter.expression(input.toStdString())};
+    QVERIFY(expressionResult.has_value());
+
+    auto const& expression{expressionResult.value()};
+
+    std::vector<calqmath::Scalar> variables{};
+    std::vector<double> doubleVariables{};
+    for (size_t i = 0; i < count; i++)
+    {
+        variables.emplace_back(i / static_cast<double>(count));
+        doubleVariables.push_back(i / static_cast<double>(count));
+    }
+    std::vector<calqmath::Scalar> results(count);
+    std::vector<double> doubleResults(count);
+
+    QBENCHMARK
+    {
+        QVERIFY(expression.evaluateMany(variables, results));
+    }
+
+    QBENCHMARK
+    {
+        QVERIFY(expression.evaluateMany(doubleVariables, doubleResults));
+    }
+}
+
+void CalQBenchmark::benchmarkExecutor_data()
+{
+    QTest::addColumn<size_t>("participants");
+    for (size_t participants = 1;
+         participants < std::thread::hardware_concurrency();
+         participants *= 2)
+    {
+        QTest::addRow("%zu threads", participants) << participants;
+    }
+    QTest::newRow("all threads") << size_t{0};
+}
+
+void CalQBenchmark::benchmarkExecutor()
+{
+    QFETCH(size_t, participants);
+
+    calqmath::Interpreter const interpreter{};
+    calqmath::Executor executor{participants};
+
+    // gamma and erf cost more for some arguments than others, which work
+    // stealing has to even out.
+    auto const expressionResult{interpreter.expression("gamma(x) + erf(x) * x")
+    };
+    QVERIFY(expressionResult.has_value());
+
+    auto const count{100000};
+    std::vector<calqmath::Scalar> variables{};
+    for (size_t i = 0; i < count; i++)
+    {
+        variables.emplace_back(20.0 * i / static_cast<double>(count) - 10.0);
+    }
+    std::vector<calqmath::Scalar> results(count);
+
+    QBENCHMARK
+    {
+        QVERIFY(executor.evaluateMany(
+            expressionResult.value(), variables, results
+        ));
+    }
+}
+
+void CalQBenchmark::benchmarkBytecode_data() { benchmarkEvaluation_data(); }
+
+void CalQBenchmark::benchmarkBytecode()
+{
+    calqmath::Interpreter const interpreter{};
+
+    QFETCH(QString, input);
+    QFETCH(size_t, count);
+
+    auto const expressionResult{interpreter.expression(input.toStdString())};
+    QVERIFY(expressionResult.has_value());
+
+    auto program{calqmath::Program::compile(expressionResult.value())};
+    QVERIFY(program.has_value());
+
+    calqmath::VirtualMachine machine{std::move(program).value()};
+    calqmath::Scalar variable{};
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            variable = calqmath::Scalar{i / static_cast<double>(count)};
+            auto const& result{machine.run(variable)};
+            Q_UNUSED(result);
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkDoubleEvaluation_data()
+{
+    benchmarkEvaluation_data();
+}
+
+void CalQBenchmark::benchmarkDoubleEvaluation()
+{
+    calqmath::Interpreter const interpreter{};
+
+    QFETCH(QString, input);
+    QFETCH(size_t, count);
+
+    auto const expressionResult{interpreter.expression(input.toStdString())};
+    QVERIFY(expressionResult.has_value());
+
+    auto const& expression{expressionResult.value()};
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            auto const result{
+                expression.evaluate(i / static_cast<double>(count))
+            };
+            Q_UNUSED(result);
+        }
+    }
+
+    auto program{calqmath::Program::compile(expression)};
+    QVERIFY(program.has_value());
+    calqmath::VirtualMachine machine{std::move(program).value()};
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            auto const result{machine.run(i / static_cast<double>(count))};
+            Q_UNUSED(result);
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkNativeFunction_data()
+{
+    benchmarkEvaluation_data();
+}
+
+// Against the tree walker in benchmarkDoubleEvaluation, one call at a time and
+// then the whole batch in one call.
+void CalQBenchmark::benchmarkNativeFunction()
+{
+    if (!calqmath::NativeFunction::supported())
+    {
+        QSKIP("No code generation for this architecture");
+    }
+
+    calqmath::Interpreter const interpreter{};
+
+    QFETCH(QString, input);
+    QFETCH(size_t, count);
+
+    auto const expressionResult{interpreter.expression(input.toStdString())};
+    QVERIFY(expressionResult.has_value());
+
+    auto const native{
+        calqmath::NativeFunction::compile(expressionResult.value())
+    };
+    QVERIFY(native.has_value());
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            auto const result{(*native)(i / static_cast<double>(count))};
+            Q_UNUSED(result);
+        }
+    }
+
+    std::vector<double> variables{};
+    for (size_t i = 0; i < count; i++)
+    {
+        variables.push_back(i / static_cast<double>(count));
+    }
+    std::vector<double> results(count);
+
+    QBENCHMARK
+    {
+        QVERIFY(native->evaluateMany(variables, results));
+    }
+}
+
+void CalQBenchmark::benchmarkStaticExpression_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<size_t>("count");
+    QTest::newRow("erf") << "erf(x)" << 10000ULL;
+    QTest::newRow("deep arithmatic")
+        << "1 + x * (1 + x * (1 + x * (1 + x * (1 + x))))" << 100000ULL;
+    QTest::newRow("common subexpressions")
+        << "erf(x) * erf(x) + cos(erf(x))" << 10000ULL;
+}
+
+// Rows of benchmarkEvaluation and benchmarkDoubleEvaluation, compiled at
+// compile time instead, in Scalars and then in doubles.
+void CalQBenchmark::benchmarkStaticExpression()
+{
+    QFETCH(QString, input);
+    QFETCH(size_t, count);
+
+    bool found{false};
+    auto const run = [&]<calqmath::FixedString Source>()
+    {
+        if (input.toStdString() != Source.view())
+        {
+            return;
+        }
+        found = true;
+
+        auto const compiled{calqmath::compile<Source>()};
+
+        QBENCHMARK
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                auto const result{
+                    compiled(calqmath::Scalar{i / static_cast<double>(count)})
+                };
+                Q_UNUSED(result);
+            }
+        }
+
+        QBENCHMARK
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                auto const result{compiled(i / static_cast<double>(count))};
+                Q_UNUSED(result);
+            }
+        }
+    };
+    run.template operator()<"erf(x)">();
+    run.template operator()<"1 + x * (1 + x * (1 + x * (1 + x * (1 + x))))">();
+    run.template operator()<"erf(x) * erf(x) + cos(erf(x))">();
+
+    QVERIFY(found);
+}
+
 void CalQBenchmark::benchmarkScalarInit()
 {
     auto const count{1000000};
@@ -102,5 +631,210 @@ void CalQBenchmark::benchmarkFunctions()
     }
 }
 
+void CalQBenchmark::benchmarkPrecision_data()
+{
+    QTest::addColumn<size_t>("precision");
+    QTest::newRow("32 bits") << 32ULL;
+    QTest::newRow("64 bits") << 64ULL;
+    QTest::newRow("128 bits") << 128ULL;
+    QTest::newRow("256 bits") << 256ULL;
+    QTest::newRow("1024 bits") << 1024ULL;
+    QTest::newRow("4096 bits") << 4096ULL;
+}
+
+void CalQBenchmark::benchmarkPrecision()
+{
+    QFETCH(size_t, precision);
+
+    auto const count{10000};
+
+    calqmath::Scalar const one{1.0, precision};
+
+    QBENCHMARK
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            calqmath::Scalar const input{i / double(count), precision};
+            auto const result{
+                calqmath::Functions::sin(input * input + one) / (input + one)
+            };
+            Q_UNUSED(result);
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkArena_data()
+{
+    QTest::addColumn<bool>("arena");
+    QTest::newRow("system allocator") << false;
+    QTest::newRow("evaluation arena") << true;
+}
+
+void CalQBenchmark::benchmarkArena()
+{
+    QFETCH(bool, arena);
+
+    auto const count{10000};
+    size_t constexpr HEAP_PRECISION{4 * calqmath::INLINE_BASE_2_PRECISION};
+
+    QBENCHMARK
+    {
+        std::optional<calqmath::EvaluationArena> scope{};
+        if (arena)
+        {
+            scope.emplace();
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            calqmath::Scalar const input{i / double(count), HEAP_PRECISION};
+            calqmath::Functions::erf(calqmath::Functions::sin(input));
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkMultiDouble_data()
+{
+    QTest::addColumn<size_t>("precision");
+    QTest::addColumn<bool>("multiDouble");
+    QTest::newRow("mpfr 106 bits") << 106ULL << false;
+    QTest::newRow("double-double") << 106ULL << true;
+    QTest::newRow("mpfr 212 bits") << 212ULL << false;
+    QTest::newRow("quad-double") << 212ULL << true;
+}
+
+void CalQBenchmark::benchmarkMultiDouble()
+{
+    QFETCH(size_t, precision);
+    QFETCH(bool, multiDouble);
+
+    if (!multiDouble)
+    {
+        benchmarkKernel<calqmath::Scalar>([&](double const value)
+        { return calqmath::Scalar{value, precision}; });
+    }
+    else if (calqmath::DoubleDouble::serves(precision))
+    {
+        benchmarkKernel<calqmath::DoubleDouble>([](double const value)
+        { return calqmath::DoubleDouble{value}; });
+    }
+    else
+    {
+        benchmarkKernel<calqmath::QuadDouble>([](double const value)
+        { return calqmath::QuadDouble{value}; });
+    }
+}
+
+void CalQBenchmark::benchmarkBatchFunctions_data()
+{
+    QTest::addColumn<QString>("function");
+    QTest::addColumn<bool>("batched");
+    for (char const* function : {"exp", "log", "sin", "atan", "erf", "gamma"})
+    {
+        QTest::addRow("%s per element", function) << function << false;
+        QTest::addRow("%s batched", function) << function << true;
+    }
+}
+
+void CalQBenchmark::benchmarkBatchFunctions()
+{
+    QFETCH(QString, function);
+    QFETCH(bool, batched);
+
+    auto const& functions{calqmath::FunctionDatabase::defaults()};
+    auto const id{functions.lookup(function.toStdString())};
+    QVERIFY(id.has_value());
+    auto const& unary{calqmath::unaryFunction(id.value())};
+
+    auto const count{100000};
+    std::vector<double> arguments(count);
+    std::vector<double> results(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        // Positive, so every function is defined
+        arguments[i] = 0.1 + 8.0 * i / double(count);
+    }
+
+    QBENCHMARK
+    {
+        if (batched)
+        {
+            unary.batchFunction(arguments, results);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                results[i] = unary.doubleFunction(arguments[i]);
+            }
+        }
+    }
+}
+
+void CalQBenchmark::benchmarkScalarVector_data()
+{
+    QTest::addColumn<size_t>("precision");
+    QTest::addColumn<bool>("vector");
+    QTest::newRow("scalars 128 bits") << 128ULL << false;
+    QTest::newRow("vector 128 bits") << 128ULL << true;
+    QTest::newRow("scalars 1024 bits") << 1024ULL << false;
+    QTest::newRow("vector 1024 bits") << 1024ULL << true;
+}
+
+void CalQBenchmark::benchmarkScalarVector()
+{
+    QFETCH(size_t, precision);
+    QFETCH(bool, vector);
+
+    using calqmath::Functions;
+
+    auto const count{10000};
+    std::vector<double> numbers(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        numbers[i] = i / double(count);
+    }
+
+    calqmath::Scalar const one{1.0, precision};
+
+    // The same kernel as benchmarkPrecision, sin(x * x + 1) / (x + 1)
+    if (vector)
+    {
+        calqmath::ScalarVector const inputs{numbers, precision};
+        calqmath::ScalarVector square{count, precision};
+        calqmath::ScalarVector results{count, precision};
+
+        QBENCHMARK
+        {
+            Functions::sqr(square, inputs);
+            Functions::add(square, square, one);
+            Functions::sin(square, square);
+            Functions::add(results, inputs, one);
+            Functions::divide(results, square, results);
+        }
+    }
+    else
+    {
+        std::vector<calqmath::Scalar> inputs{};
+        inputs.reserve(count);
+        for (double const number : numbers)
+        {
+            inputs.emplace_back(number, precision);
+        }
+        std::vector<calqmath::Scalar> results(count);
+
+        QBENCHMARK
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                results[i] = calqmath::Functions::sin(
+                                 inputs[i] * inputs[i] + one
+                             )
+                             / (inputs[i] + one);
+            }
+        }
+    }
+}
+
 QTEST_MAIN(CalQBenchmark)
 #include "benchmark.moc"
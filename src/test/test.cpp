@@ -1,8 +1,18 @@
+#include "interpreter/bytecode.h"
+#include "interpreter/executor.h"
 #include "interpreter/lexer.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/jit.h"
 #include "interpreter/parser.h"
+#include "interpreter/static_expression.h"
 
+#include "math/arena.h"
+#include "math/functions.h"
+#include "math/interval.h"
+#include "math/jet.h"
+#include "math/multidouble.h"
 #include "math/number.h"
+#include "math/scalarvector.h"
 
 #include <QByteArray>
 #include <QObject>
@@ -10,10 +20,20 @@
 #include <QTest>
 #include <QtLogging>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <expected>
+#include <limits>
+#include <map>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 /*
@@ -93,48 +113,64 @@ template <class... Ts> struct overloads : Ts...
     using Ts::operator()...;
 };
 
+/*
+ * Tokens point into the source they were lexed from, so tests compare them with
+ * their text resolved. Streams lexed from different inputs can then compare
+ * equal.
+ */
+struct LexedToken
+{
+    calqmath::TokenKind kind;
+    std::string text;
+
+    auto operator==(LexedToken const& rhs) const -> bool = default;
+};
+
+auto lex(std::string_view const source)
+    -> std::optional<std::vector<LexedToken>>
+{
+    auto const tokens{calqmath::Lexer::convert(source)};
+    if (!tokens.has_value())
+    {
+        return std::nullopt;
+    }
+
+    std::vector<LexedToken> lexed{};
+    for (auto const& token : tokens.value())
+    {
+        lexed.push_back({token.kind, std::string{token.text(source)}});
+    }
+    return lexed;
+}
+
 template <>
-auto QTest::toString(std::vector<calqmath::Token> const& tokens) -> char*
+auto QTest::toString(std::vector<LexedToken> const& tokens) -> char*
 {
     QString output{};
 
     for (size_t i = 0; i < tokens.size(); i++)
     {
-        auto const visitors{overloads{
-            [&](calqmath::TokenIdentifier const& name)
+        switch (tokens[i].kind)
         {
+        case calqmath::TokenKind::Identifier:
             output += "f'";
-            output += name.m_functionName;
-        },
-            [&](calqmath::TokenNumber const& name)
-        {
+            break;
+        case calqmath::TokenKind::Number:
             output += "n'";
-            output += name.m_decimalRepresentation;
-        },
-            [&](calqmath::TokenOpenBracket const&) { output += "("; },
-            [&](calqmath::TokenClosedBracket const&) { output += ")"; },
-            [&](calqmath::TokenOperator const& mathOperator)
-        {
+            break;
+        case calqmath::TokenKind::OpenBracket:
+        case calqmath::TokenKind::ClosedBracket:
+        case calqmath::TokenKind::Comma:
+            break;
+        case calqmath::TokenKind::Plus:
+        case calqmath::TokenKind::Minus:
+        case calqmath::TokenKind::Multiply:
+        case calqmath::TokenKind::Divide:
             output += "o'";
-            switch (mathOperator)
-            {
-            case calqmath::TokenOperator::Plus:
-                output += "+";
-                break;
-            case calqmath::TokenOperator::Minus:
-                output += "-";
-                break;
-            case calqmath::TokenOperator::Multiply:
-                output += "*";
-                break;
-            case calqmath::TokenOperator::Divide:
-                output += "/";
-                break;
-            }
+            break;
         }
-        }};
+        output += tokens[i].text;
 
-        std::visit(visitors, tokens[i]);
         if (i < tokens.size() - 1)
         {
             output += ",";
@@ -146,7 +182,7 @@ auto QTest::toString(std::vector<calqmath::Token> const& tokens) -> char*
 }
 
 template <>
-auto QTest::toString(std::optional<std::vector<calqmath::Token>> const& result)
+auto QTest::toString(std::optional<std::vector<LexedToken>> const& result)
     -> char*
 {
     QString output{};
@@ -220,6 +256,8 @@ void testInterpret(calqmath::Interpreter const& interpreter)
             {"1/2", calqmath::Scalar{"0.5"}},
             {"1/3", calqmath::Scalar{"1.0"} / calqmath::Scalar{"3.0"}},
             {"1*2*3*4*5", calqmath::Scalar{"120.0"}},
+            {"1 + -(2)", calqmath::Scalar{"-1.0"}},
+            {"2 * -id(3)", calqmath::Scalar{"-6.0"}},
         };
 
     for (auto const& [input, output] : successTestCases)
@@ -260,6 +298,51 @@ void testOrderOfOperators(calqmath::Interpreter const& interpreter)
     }
 }
 
+void testPrecedenceAtParse(calqmath::Interpreter const& interpreter)
+{
+    // Products are grouped as terms are parsed, string still gives them in
+    // source order.
+    auto const expression{interpreter.expression("x - x * x / x + x")};
+    QVERIFY(expression.has_value());
+    QCOMPARE(expression->string(), std::string{"x,-,x,*,x,/,x,+,x"});
+    QCOMPARE(expression->termCount(), size_t{5});
+
+    // Long chains evaluate in a single pass, x / x * x / x ... / x = 1
+    size_t constexpr CHAIN_LENGTH{10000};
+    std::string chain{"x"};
+    for (size_t i = 1; i < CHAIN_LENGTH; i++)
+    {
+        chain += i % 2 == 0 ? " * x" : " / x";
+    }
+    auto const chainExpression{interpreter.expression(chain)};
+    QVERIFY(chainExpression.has_value());
+    QCOMPARE(chainExpression->termCount(), CHAIN_LENGTH);
+    QCOMPARE(
+        chainExpression->evaluate(calqmath::Scalar{2.0}), calqmath::Scalar{1.0}
+    );
+    QCOMPARE(chainExpression->evaluate(2.0), std::optional{1.0});
+}
+
+void testExpressionCopy(calqmath::Interpreter const& interpreter)
+{
+    // Copies are independent of the original, and keep negation and functions
+    auto original{interpreter.expression("1 + -id(x * 2) / (3 - x)")};
+    QVERIFY(original.has_value());
+
+    calqmath::Expression const copy{original.value()};
+    QVERIFY(copy == original.value());
+    QCOMPARE(copy.string(), original->string());
+    QCOMPARE(
+        copy.evaluate(calqmath::Scalar{1.0}),
+        original->evaluate(calqmath::Scalar{1.0})
+    );
+
+    original = interpreter.expression("x");
+    QVERIFY(!(copy == original.value()));
+    QCOMPARE(copy.evaluate(calqmath::Scalar{1.0}), calqmath::Scalar{0.0});
+    QCOMPARE(copy.evaluate(1.0), std::optional{0.0});
+}
+
 void testFunctionParsing(calqmath::Interpreter const& interpreter)
 {
     std::vector<std::tuple<std::string, calqmath::Scalar>> const testCases{
@@ -283,15 +366,294 @@ void testAllFunctions(
     calqmath::Interpreter const& interpreter
 )
 {
-    for (auto const& function : functions.unaryNames())
+    for (auto const& function : functions.unaryFunctions())
     {
-        QVERIFY(function != nullptr);
-        QVERIFY(interpreter.expression(function->name + "(1.0)")
+        QVERIFY(interpreter.expression(std::string{function.name} + "(1.0)")
                     ->evaluate()
                     .has_value());
     }
 }
 
+void testMultiArgumentFunctions(
+    calqmath::FunctionDatabase const& functions,
+    calqmath::Interpreter const& interpreter
+)
+{
+    using calqmath::Functions;
+    using calqmath::Interval;
+    using calqmath::Jet;
+    using calqmath::OpCode;
+    using calqmath::Scalar;
+
+    auto const parse = [&](std::string const& input)
+    {
+        auto const tokens{calqmath::Lexer::convert(input)};
+        return calqmath::Parser::parse(functions, input, tokens.value());
+    };
+    auto const same = [](Scalar const& actual, Scalar const& expected)
+    { return actual == expected || (actual.isNaN() && expected.isNaN()); };
+
+    // Calls agree with the functions they name, with constant arguments folded
+    // or not.
+    std::vector<std::string> const texts{"0.3", "-0.75", "2.5"};
+    for (auto const& function : functions.naryFunctions())
+    {
+        std::vector<Scalar> arguments{};
+        std::string input{std::string{function.name} + "("};
+        for (size_t index = 0; index < function.arity; index++)
+        {
+            arguments.emplace_back(texts[index]);
+            input += index == 0 ? "x" : ", " + texts[index];
+        }
+        input += ")";
+
+        auto const expected{calqmath::applyFunction(function, arguments)};
+        auto const original{parse(input)};
+        QVERIFY(original.has_value());
+        QVERIFY(same(original->evaluate(arguments[0]).value(), expected));
+        QVERIFY(same(
+            original->folded().evaluate(arguments[0]).value(), expected
+        ));
+
+        auto const actualDouble{original->evaluate(arguments[0].toDouble())};
+        auto const expectedDouble{function.doubleFunction(
+            arguments[0].toDouble(),
+            arguments[1].toDouble(),
+            function.arity > 2 ? arguments[2].toDouble() : 0.0
+        )};
+        QVERIFY(
+            actualDouble == expectedDouble
+            || (std::isnan(*actualDouble) && std::isnan(expectedDouble))
+        );
+    }
+
+    Scalar const base{"10"};
+    Scalar const x{"2.5"};
+    QCOMPARE(
+        interpreter.expression("pow(x, 3)")->evaluate(x),
+        Functions::pow(x, Scalar{"3"})
+    );
+    // With the reciprocal of the base's logarithm prepared by folding.
+    Scalar reciprocal{};
+    Functions::divide(reciprocal, Scalar{"1"}, Functions::log(base));
+    QCOMPARE(
+        interpreter.expression("logn(10, x)")->evaluate(x),
+        Functions::log(x) * reciprocal
+    );
+    QCOMPARE(
+        interpreter.expression("logn(10, x)")->string(),
+        std::string{"logn(10,,,x)"}
+    );
+    QCOMPARE(
+        interpreter.expression("-atan2(x, -1)")->evaluate(x),
+        -Functions::atan2(x, Scalar{"-1"})
+    );
+    QCOMPARE(
+        interpreter.expression("max(min(x, 2), hypot(1, 1))")->evaluate(x),
+        Scalar{"2"}
+    );
+    QCOMPARE(
+        interpreter.expression("fma(x, 2, 3)")->evaluate(x), Scalar{"8"}
+    );
+    QCOMPARE(
+        interpreter.expression("pow(x + 1, 2 * x - 3)")->evaluate(x),
+        Functions::pow(Scalar{"3.5"}, Scalar{"2"})
+    );
+
+    // The logarithm of a constant base is computed once, leaving one
+    // logarithm and a multiplication per evaluation.
+    auto const program{calqmath::Program::compile(
+        interpreter.expression("logn(10, x)").value()
+    )};
+    QVERIFY(program.has_value());
+    auto const count = [&](OpCode const code)
+    {
+        return std::ranges::count(
+            program->instructions(), code, &calqmath::Instruction::code
+        );
+    };
+    QCOMPARE(count(OpCode::CallPartial), 1);
+    QCOMPARE(program->instructions().size(), size_t{1});
+
+    // Calls with only constant arguments fold entirely.
+    auto const constant{calqmath::Program::compile(
+        interpreter.expression("pow(2, 3) * x + fma(1, 2, 3)").value()
+    )};
+    QVERIFY(constant.has_value());
+    QVERIFY(std::ranges::none_of(
+        constant->instructions(),
+        [](calqmath::Instruction const& instruction)
+        { return instruction.code == OpCode::CallNary; }
+    ));
+    QCOMPARE(
+        interpreter.expression("pow(2, 3) * x + fma(1, 2, 3)")->evaluate(x),
+        Scalar{"25"}
+    );
+
+    // In place variants grow to the widest argument's precision and may alias.
+    Scalar const narrow{"0.3", 24};
+    Scalar const wide{"1.7", 200};
+    Scalar result{"7", 24};
+    Functions::pow(result, narrow, wide, calqmath::MathContext::current());
+    QCOMPARE(result.precision(), size_t{200});
+    QCOMPARE(result, Functions::pow(narrow, wide));
+    Scalar aliased{wide};
+    Functions::hypot(
+        aliased, aliased, narrow, calqmath::MathContext::current()
+    );
+    QCOMPARE(aliased, Functions::hypot(wide, narrow));
+
+    // The other backends, composed from their unary functions.
+    auto const near = [](double const actual, double const expected)
+    { return std::abs(actual - expected) <= 1e-14 * std::abs(expected); };
+    auto const jet{
+        interpreter.expression("pow(x, 3)")->evaluate(Jet::variable(x))
+    };
+    QVERIFY(jet.has_value());
+    QVERIFY(near(jet->value().toDouble(), 15.625));
+    QVERIFY(near(jet->first().toDouble(), 18.75));
+    QVERIFY(near(jet->second().toDouble(), 15.0));
+
+    // Integer powers of negative bases are real, down to the derivatives.
+    auto const square{interpreter.expression("pow(x, 2)")};
+    auto const cube{interpreter.expression("pow(x, 3)")};
+    auto const negative{Jet::variable(Scalar{-1.5})};
+    QCOMPARE(square->evaluate(negative)->value(), Scalar{2.25});
+    QCOMPARE(square->evaluate(negative)->first(), Scalar{-3.0});
+    QCOMPARE(square->evaluate(negative)->second(), Scalar{2.0});
+    QCOMPARE(cube->evaluate(negative)->value(), Scalar{-3.375});
+    QCOMPARE(cube->evaluate(negative)->first(), Scalar{6.75});
+    QCOMPARE(cube->evaluate(negative)->second(), Scalar{-9.0});
+    QCOMPARE(square->evaluate(Jet::variable(Scalar{0.0}))->first(), Scalar{});
+    QVERIFY(near(
+        cube->evaluate(calqmath::DoubleDouble{-1.5})->toDouble(), -3.375
+    ));
+    QVERIFY(interpreter.expression("pow(x, 0.5)")
+                ->evaluate(calqmath::DoubleDouble{-1.5})
+                ->isNaN());
+
+    auto const angle{interpreter.expression("atan2(1, x)")};
+    for (double const variable : {2.0, -2.0, 0.0})
+    {
+        auto const expected{std::atan2(1.0, variable)};
+        QVERIFY(near(
+            angle->evaluate(calqmath::DoubleDouble{variable})->toDouble(),
+            expected
+        ));
+        QVERIFY(near(
+            angle->evaluate(Jet::variable(Scalar{variable}))
+                ->value()
+                .toDouble(),
+            expected
+        ));
+    }
+
+    // On the y axis, where y / x has no angle.
+    auto const derivative{angle->evaluate(Jet::variable(Scalar{0.0}))};
+    QCOMPARE(derivative->first(), Scalar{-1.0});
+    QCOMPARE(derivative->second(), Scalar{0.0});
+    auto const axis{interpreter.expression("atan2(x, 0)")};
+    QCOMPARE(axis->evaluate(calqmath::DoubleDouble{0.0})->toDouble(), 0.0);
+    QCOMPARE(axis->evaluate(calqmath::QuadDouble{0.0})->toDouble(), 0.0);
+    QVERIFY(near(
+        axis->evaluate(calqmath::QuadDouble{-3.0})->toDouble(),
+        std::atan2(-3.0, 0.0)
+    ));
+
+    size_t constexpr PRECISION{64};
+    Interval const span{Scalar{"-1", PRECISION}, Scalar{"2", PRECISION}};
+    QCOMPARE(
+        interpreter.expression("min(x, 1)")->evaluate(span),
+        (Interval{Scalar{"-1", PRECISION}, Scalar{"1", PRECISION}})
+    );
+    QCOMPARE(
+        interpreter.expression("max(x, 1)")->evaluate(span),
+        (Interval{Scalar{"1", PRECISION}, Scalar{"2", PRECISION}})
+    );
+
+    // An empty argument is skipped on either side, as for Scalars.
+    Interval const below{Scalar{"-2", PRECISION}, Scalar{"-1", PRECISION}};
+    for (std::string const input :
+         {"min(sqrt(x), 1)", "min(1, sqrt(x))", "max(sqrt(x), 1)",
+          "max(1, sqrt(x))"})
+    {
+        auto const bounded{interpreter.expression(input)->evaluate(below)};
+        QVERIFY(bounded.has_value());
+        QCOMPARE(bounded->lower(), Scalar{"1"});
+        QCOMPARE(bounded->upper(), Scalar{"1"});
+    }
+    QVERIFY(interpreter.expression("min(sqrt(x), sqrt(x - 1))")
+                ->evaluate(below)
+                ->isEmpty());
+
+    auto const distance{
+        interpreter.expression("hypot(x, 1)")->evaluate(span)
+    };
+    QVERIFY(distance.has_value());
+    QVERIFY(distance->contains(Scalar{"1"}));
+    QVERIFY(distance->contains(Functions::hypot(Scalar{"2"}, Scalar{"1"})));
+
+    // Powers and angles enclose every point, left of zero included, and are
+    // only the whole line across a pole or the cut of atan2.
+    auto const interval = [](std::string const& lower, std::string const& upper)
+    { return Interval{Scalar{lower, PRECISION}, Scalar{upper, PRECISION}}; };
+    size_t constexpr SAMPLES{16};
+    for (std::string const input :
+         {"pow(x, 2)",
+          "pow(x, 3)",
+          "pow(x, -2)",
+          "pow(x, -1)",
+          "pow(x, 0.5)",
+          "atan2(1, x)",
+          "atan2(x, -1)",
+          "atan2(x - 1, x)"})
+    {
+        auto const expression{interpreter.expression(input)};
+        for (auto const& argument :
+             {interval("-2", "-1"),
+              interval("-1", "2"),
+              interval("0.5", "3"),
+              interval("-3", "-0.25")})
+        {
+            auto const result{expression->evaluate(argument)};
+            QVERIFY(result.has_value());
+            for (size_t sample = 0; sample <= SAMPLES; sample++)
+            {
+                Scalar const fraction{
+                    static_cast<double>(sample) / SAMPLES, PRECISION
+                };
+                auto const point{
+                    argument.lower()
+                    + (argument.upper() - argument.lower()) * fraction
+                };
+                auto const expected{expression->evaluate(point).value()};
+                if (!expected.isNaN())
+                {
+                    QVERIFY(result->contains(expected));
+                }
+            }
+        }
+    }
+
+    auto const left{interval("-2", "-1")};
+    QCOMPARE(square->evaluate(left), interval("1", "4"));
+    QCOMPARE(cube->evaluate(left), interval("-8", "-1"));
+    QCOMPARE(square->evaluate(span), interval("0", "4"));
+    QCOMPARE(cube->evaluate(span), interval("-1", "8"));
+    QVERIFY(square->evaluate(span)->continuous());
+    QVERIFY(!interpreter.expression("pow(x, -1)")
+                 ->evaluate(span)
+                 ->continuous());
+    QVERIFY(interpreter.expression("pow(x, 0.5)")->evaluate(left)->isEmpty());
+
+    QVERIFY(angle->evaluate(left)->continuous());
+    QVERIFY(angle->evaluate(span)->continuous());
+    auto const crossing{interpreter.expression("atan2(x, -1)")};
+    QVERIFY(crossing->evaluate(interval("0", "2"))->continuous());
+    QVERIFY(crossing->evaluate(left)->continuous());
+    QVERIFY(!crossing->evaluate(span)->continuous());
+}
+
 void testScalarStringify()
 {
     std::vector<std::tuple<std::string, std::string>> const signedCases{
@@ -351,197 +713,1824 @@ void testScalarOperators()
     QCOMPARE(one / two, oneHalf);
 }
 
-void testNonOrdinaryScalarStringify()
+void testScalarPrecision()
 {
-    QCOMPARE(
-        calqmath::Scalar::zero().toString(),
-        calqmath::Scalar::ZERO_REPRESENTATION
-    );
+    using calqmath::Functions;
+    using calqmath::Scalar;
 
-    QCOMPARE(
-        calqmath::Scalar::nan().toString(), calqmath::Scalar::NAN_REPRESENTATION
-    );
+    size_t constexpr LOW_PRECISION{32};
+    size_t constexpr HIGH_PRECISION{512};
 
-    QCOMPARE(
-        calqmath::Scalar::positiveInf().toString(),
-        calqmath::Scalar::POSITIVE_INFINITY_REPRESENTATION
-    );
+    Scalar const low{"1.1", LOW_PRECISION};
+    Scalar const high{"1.1", HIGH_PRECISION};
 
-    QCOMPARE(
-        calqmath::Scalar::negativeInf().toString(),
-        calqmath::Scalar::NEGATIVE_INFINITY_REPRESENTATION
-    );
+    QCOMPARE(low.precision(), LOW_PRECISION);
+    QCOMPARE(high.precision(), HIGH_PRECISION);
+
+    QCOMPARE((low + low).precision(), LOW_PRECISION);
+    QCOMPARE((low - low).precision(), LOW_PRECISION);
+    QCOMPARE((low * low).precision(), LOW_PRECISION);
+    QCOMPARE((low / low).precision(), LOW_PRECISION);
+    QCOMPARE((-low).precision(), LOW_PRECISION);
+    QCOMPARE(Functions::sin(low).precision(), LOW_PRECISION);
+
+    QCOMPARE((low + high).precision(), HIGH_PRECISION);
+    QCOMPARE((high * low).precision(), HIGH_PRECISION);
+
+    Scalar const copy{low};
+    QCOMPARE(copy.precision(), LOW_PRECISION);
+
+    Scalar assigned{};
+    assigned = high;
+    QCOMPARE(assigned.precision(), HIGH_PRECISION);
+    QCOMPARE(assigned, high);
 }
 
-void testMinimalPrecision(calqmath::Interpreter const& interpreter)
+void testScalarFusedOperators(calqmath::Interpreter const& interpreter)
 {
-    for (size_t i = 0; i < calqmath::getBignumBackendPrecision(); i++)
+    using calqmath::Functions;
+    using calqmath::Scalar;
+
+    Scalar const two{"2"};
+    Scalar const three{"3"};
+
+    Scalar value{"1"};
+    value += two;
+    QCOMPARE(value, three);
+    value -= two;
+    QCOMPARE(value, Scalar{"1"});
+    value *= three;
+    QCOMPARE(value, three);
+    value /= two;
+    QCOMPARE(value, Scalar{"1.5"});
+
+    Scalar lowPrecision{"1", 32};
+    lowPrecision += Scalar{"1", 64};
+    QCOMPARE(lowPrecision.precision(), size_t{64});
+
+    QCOMPARE(Functions::sqr(three), Scalar{"9"});
+    QCOMPARE(Functions::fma(two, three, two), Scalar{"8"});
+    QCOMPARE(Functions::fms(two, three, two), Scalar{"4"});
+
+    // (1 + 2^-100)^2 - (1 + 2^-99) is exactly 2^-200, but rounding the product
+    // first loses it entirely.
+    Scalar const epsilon{
+        Scalar{"1"} / Scalar{"1267650600228229401496703205376"}
+    };
+    Scalar const lhs{Scalar{"1"} + epsilon};
+    Scalar const subtrahend{Scalar{"1"} + two * epsilon};
+    Scalar const expected{epsilon * epsilon};
+
+    QCOMPARE(lhs * lhs - subtrahend, Scalar::zero());
+    QCOMPARE(Functions::fms(lhs, lhs, subtrahend), expected);
+
+    Scalar accumulator{subtrahend};
+    Functions::fms(accumulator, lhs, lhs, accumulator);
+    QCOMPARE(accumulator, expected);
+
+    // The evaluator fuses a product into the sum that consumes it
+    auto const fused{interpreter.expression("x * x - 1")};
+    QVERIFY(fused.has_value());
+    QCOMPARE(fused->evaluate(lhs), two * epsilon + expected);
+
+    std::vector<std::tuple<std::string, Scalar>> const chainedCases{
+        {"2 * 3 + 4 * 5 + 6", Scalar{"32"}},
+        {"2 * 3 - 4 * 5 - 6", Scalar{"-20"}},
+        {"1 - 2 * 3 * 4 / 8", Scalar{"-2"}},
+        {"2 * 3 / 4 * 5 + 1", Scalar{"8.5"}},
+    };
+    for (auto const& [input, output] : chainedCases)
     {
-        std::string const input{std::format("1{0}+1-1{0}", std::string(i, '0'))
-        };
-        QCOMPARE(
-            interpreter.expression(input)->evaluate(), calqmath::Scalar{"1"}
-        );
+        QCOMPARE(interpreter.expression(input)->evaluate(), output);
     }
 }
 
-void testLexerWhitespace()
+void testConstantFolding(calqmath::FunctionDatabase const& functions)
 {
-    using TestCase =
-        std::tuple<std::vector<std::string>, std::vector<calqmath::Token>>;
-    std::vector<TestCase> const cases{
-        {{" 0 - 1 + 2 / 3 * 4 ",
-          "   0   -  1  +  2  /  3  *  4  ",
-          "0-1  +2/3  *4",
-          "0  -1+2  /3*4",
-          "  0-1  +2/3*4",
-          "0  -1+2/3*4  "},
-         {calqmath::Lexer::convert("0-1+2/3*4").value()}}
+    using calqmath::Scalar;
+
+    auto const parse = [&](std::string const& input)
+    {
+        auto const tokens{calqmath::Lexer::convert(input)};
+        return calqmath::Parser::parse(functions, input, tokens.value());
     };
-    for (auto const& [inputs, output] : cases)
+
+    std::vector<std::string> const inputs{
+        "sin(2) * x",
+        "x + (1 + 2) * (3 - x)",
+        "-exp(1 / (2 + sqrt(3))) / x",
+        "cos(sin(1) + x) - (4)",
+        "2 * 3 + x",
+        "log(2)",
+    };
+    std::vector<Scalar> const variables{Scalar{"0.5"}, Scalar{"-1.25"}};
+
+    for (auto const& input : inputs)
     {
-        for (auto const& input : inputs)
+        auto const original{parse(input)};
+        QVERIFY(original.has_value());
+        auto const folded{original->folded()};
+
+        // Folding changes neither the output nor the text
+        QCOMPARE(folded.string(), original->string());
+        for (auto const& variable : variables)
         {
-            auto const actual = calqmath::Lexer::convert(input);
-            QCOMPARE(actual, output);
+            QCOMPARE(folded.evaluate(variable), original->evaluate(variable));
         }
+
+        // Folds computed at one precision are not used at another
+        calqmath::MathContext context{calqmath::MathContext::current()};
+        context.precision *= 4;
+        QCOMPARE(
+            folded.evaluate(variables.front(), context),
+            original->evaluate(variables.front(), context)
+        );
     }
+
+    // The folded groups become constants in the compiled program
+    auto const original{parse("sin(2) * x + cos(3)")};
+    QVERIFY(original.has_value());
+    auto const program{calqmath::Program::compile(original->folded())};
+    QVERIFY(program.has_value());
+    QCOMPARE(program->instructions().size(), size_t{1});
+    QCOMPARE(program->constantCount(), size_t{2});
+
+    auto const folded{original->folded()};
+    QCOMPARE(
+        folded.evaluate(2.0),
+        std::optional{(std::sin(2.0) * 2.0) + std::cos(3.0)}
+    );
 }
-void testLexerNumbers()
+
+void testCommonSubexpressions(calqmath::FunctionDatabase const& functions)
 {
-    using calqmath::TokenNumber;
-    using TestCase = std::tuple<std::string, std::vector<calqmath::Token>>;
-    std::vector<TestCase> const cases{
-        {"0.0", {TokenNumber{"0.0"}}},
-        {"1.0", {TokenNumber{"1.0"}}},
-        {"0.123", {TokenNumber{"0.123"}}},
-        {"123.0", {TokenNumber{"123.0"}}},
-        {".123", {TokenNumber{".123"}}},
-        {"123.", {TokenNumber{"123."}}},
-        {"123456789.0", {TokenNumber{"123456789.0"}}},
-        {"1.2.3", {TokenNumber{"1.2"}, TokenNumber{".3"}}},
-        {"123.456.789", {TokenNumber{"123.456"}, TokenNumber{".789"}}},
-        {"1.2.3.4.5.6.7.8.9",
-         {TokenNumber{"1.2"},
-          TokenNumber{".3"},
-          TokenNumber{".4"},
-          TokenNumber{".5"},
-          TokenNumber{".6"},
-          TokenNumber{".7"},
-          TokenNumber{".8"},
-          TokenNumber{".9"}}}
+    using calqmath::Functions;
+    using calqmath::Scalar;
+
+    auto const parse = [&](std::string const& input)
+    {
+        auto const tokens{calqmath::Lexer::convert(input)};
+        return calqmath::Parser::parse(functions, input, tokens.value());
     };
-    for (auto const& [input, output] : cases)
+
+    auto const expression{parse("sin(x) * sin(x) + cos(sin(x))")};
+    QVERIFY(expression.has_value());
+    QCOMPARE(
+        expression->string(), "(sin(x)),*,(sin(x)),+,(cos((sin(x))))"
+    );
+
+    // The three calls to sin share one node, which is called once
+    auto program{calqmath::Program::compile(expression.value())};
+    QVERIFY(program.has_value());
+    QCOMPARE(
+        std::ranges::count(
+            program->instructions(),
+            calqmath::OpCode::Call,
+            &calqmath::Instruction::code
+        ),
+        2
+    );
+    calqmath::VirtualMachine machine{std::move(program).value()};
+
+    std::vector<double> const variables{0.5, -1.25, 3.0};
+    std::vector<Scalar> scalars{};
+    for (double const variable : variables)
     {
-        auto const actual = calqmath::Lexer::convert(input);
-        QCOMPARE(actual, output);
+        Scalar const scalar{variable};
+        Scalar const sine{Functions::sin(scalar)};
+        QCOMPARE(
+            expression->evaluate(scalar),
+            std::optional{Functions::fma(sine, sine, Functions::cos(sine))}
+        );
+        QCOMPARE(machine.run(scalar), expression->evaluate(scalar).value());
+
+        double const doubleSine{Functions::sin(variable)};
+        QCOMPARE(
+            expression->evaluate(variable),
+            std::optional{
+                (doubleSine * doubleSine) + Functions::cos(doubleSine)
+            }
+        );
+        scalars.push_back(scalar);
     }
-}
-void testLexerFunctionsAndNumbers()
-{
-    using calqmath::TokenIdentifier;
-    using calqmath::TokenNumber;
-    using TestCase = std::tuple<std::string, std::vector<calqmath::Token>>;
-    std::vector<TestCase> const cases{
-        {"sin", {TokenIdentifier{"sin"}}},
-        {"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ",
-         {TokenIdentifier{"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
-         }}},
-        {"sin12345678901234567890", {TokenIdentifier{"sin12345678901234567890"}}
-        },
-        {"123sin", {TokenNumber{"123"}, TokenIdentifier{"sin"}}},
-        {"sin123", {TokenIdentifier{"sin123"}}},
-        {"sin123sin", {TokenIdentifier{"sin123sin"}}},
-        {"sin123.456", {TokenIdentifier{"sin123"}, TokenNumber{".456"}}},
-        {"0.0sin", {TokenNumber{"0.0"}, TokenIdentifier{"sin"}}},
-    };
-    for (auto const& [input, output] : cases)
+
+    std::vector<Scalar> results(scalars.size());
+    QVERIFY(expression->evaluateMany(scalars, results));
+    for (size_t index = 0; index < scalars.size(); index++)
     {
-        auto const actual = calqmath::Lexer::convert(input);
-        QCOMPARE(actual, output);
+        QCOMPARE(results[index], expression->evaluate(scalars[index]).value());
     }
-}
 
-void testLexerSingleCharacterTokens()
-{
-    using calqmath::TokenClosedBracket;
-    using calqmath::TokenOpenBracket;
-    using calqmath::TokenOperator;
-    auto const actual = calqmath::Lexer::convert("+-*/()");
-    std::vector<calqmath::Token> const expected{
-        TokenOperator::Plus,
-        TokenOperator::Minus,
-        TokenOperator::Multiply,
-        TokenOperator::Divide,
-        TokenOpenBracket{},
-        TokenClosedBracket{},
-    };
-    QCOMPARE(actual, expected);
+    // Groups differing only in sign stay apart
+    auto const negated{parse("sin(x) - -sin(x) + 2 * 2")};
+    QVERIFY(negated.has_value());
+    QCOMPARE(
+        negated->evaluate(0.5), std::optional{(2 * Functions::sin(0.5)) + 4}
+    );
+
+    // Copies and simplification keep the sharing
+    calqmath::Expression const copy{expression.value()};
+    QCOMPARE(copy, expression.value());
+    auto const [simplified, removedNodes]{expression->simplified()};
+    QCOMPARE(removedNodes, size_t{0});
+    QCOMPARE(simplified.evaluate(0.5), expression->evaluate(0.5));
 }
-void testLexerMisc()
+
+void testSimplify(calqmath::FunctionDatabase const& functions)
 {
-    // Valid token streams, but invalid when parsed to an expression
-    std::vector<std::string> const invalidTestCases{
-        "0..",
-        ".",
-        ".0.",
-        "..0",
-    };
+    using calqmath::Scalar;
 
-    for (auto const& input : invalidTestCases)
+    auto const parse = [&](std::string const& input)
     {
-        auto const tokens = calqmath::Lexer::convert(input);
-        QVERIFY(!tokens.has_value());
-    }
-}
-void testLexerVariable()
-{
-    calqmath::TokenIdentifier const variableToken{
-        .m_functionName = calqmath::InputVariable::RESERVED_NAME
+        auto const tokens{calqmath::Lexer::convert(input)};
+        return calqmath::Parser::parse(functions, input, tokens.value());
     };
 
-    using TestCase = std::pair<std::string, std::vector<calqmath::Token>>;
-    std::vector<TestCase> const testCases{
-        {"x", {variableToken}},
-        {"1+x",
-         {calqmath::TokenNumber{.m_decimalRepresentation = "1"},
-          calqmath::TokenOperator::Plus,
-          variableToken}},
+    // Input, simplified string, and nodes removed
+    std::vector<std::tuple<std::string, std::string, size_t>> const testCases{
+        // Identity calls and redundant parentheses
+        {"id(x)", "x", 1},
+        {"id(id(id(x)))", "x", 3},
+        {"((x)) + 1", "x,+,1", 2},
+        // Multiplication and division by one
+        {"x * 1", "x", 2},
+        {"1 * x * 1 / 1", "x", 2},
+        {"1 / x", "1,/,x", 0},
+        {"1 / 1 / x", "1,/,x", 0},
+        // Addition and subtraction of zero
+        {"x + 0", "x", 1},
+        {"0 + x - 0", "x", 1},
+        {"0 - x", "0,-,x", 0},
+        // Negation
+        {"-(-(x))", "x", 2},
+        {"-(-(sin(x)))", "sin(x)", 3},
+        {"x * -(2)", "x,*,-2", 1},
+        // Squares, printed as the product they stand for
+        {"x * x", "x,*,x", 0},
+        {"1 - (x + 1) * (x + 1) - 2", "1,-,(x,+,1),*,(x,+,1),-,2", 0},
+        {"x * 2 * x", "x,*,2,*,x", 0},
+        // Division by powers of two
+        {"x / 4", "x,*,0.25", 0},
+        {"x / 3", "x,/,3", 0},
+        // Rounding of rounded values
+        {"floor(ceil(x))", "ceil(x)", 2},
+        {"round(-trunc(x))", "trunc(x)", 2},
+        {"abs(-abs(x))", "abs(x)", 2},
+        {"log(exp(x))", "log((exp(x)))", 1},
     };
+    std::vector<double> const variables{0.5, -1.25, 3.0};
 
-    for (auto const& [input, expected] : testCases)
+    for (auto const& [input, output, removed] : testCases)
     {
-        auto const tokens = calqmath::Lexer::convert(input);
-        QCOMPARE(tokens, expected);
+        auto const original{parse(input)};
+        QVERIFY(original.has_value());
+
+        auto const [simplified, removedNodes]{original->simplified()};
+        QVERIFY(simplified.valid());
+        QCOMPARE(simplified.string(), output);
+        QCOMPARE(removedNodes, removed);
+
+        auto program{calqmath::Program::compile(simplified)};
+        QVERIFY(program.has_value());
+        calqmath::VirtualMachine machine{std::move(program).value()};
+
+        // Every rewrite here is exact
+        for (double const variable : variables)
+        {
+            Scalar const scalar{variable};
+            QCOMPARE(simplified.evaluate(scalar), original->evaluate(scalar));
+            QCOMPARE(
+                simplified.evaluate(variable), original->evaluate(variable)
+            );
+            QCOMPARE(machine.run(scalar), simplified.evaluate(scalar));
+        }
     }
+
+    // A squared call is only made once
+    auto const squared{parse("sin(x) * sin(x) + 1")->simplified()};
+    auto const program{calqmath::Program::compile(squared.expression)};
+    QVERIFY(program.has_value());
+    QCOMPARE(
+        std::ranges::count(
+            program->instructions(),
+            calqmath::OpCode::Call,
+            &calqmath::Instruction::code
+        ),
+        1
+    );
 }
 
-void testInterpretVariable(calqmath::FunctionDatabase const& functions)
+void testBytecode(calqmath::Interpreter const& interpreter)
 {
     using calqmath::Scalar;
 
-    Scalar const variable{"2.5"};
-
-    using TestCase = std::pair<std::string, calqmath::Scalar>;
-    std::vector<TestCase> const testCases{
-        {"x", Scalar{"2.5"}},
-        {"1+x", Scalar{"3.5"}},
-        {"x+1", Scalar{"3.5"}},
-        {"2 * x", Scalar{"5.0"}},
-        {"x / 2", Scalar{"1.25"}},
+    std::vector<std::string> const inputs{
+        "1",
+        "x",
+        "-(x)",
+        "1 + 2 * x - 3 / x",
+        "2 * 3 + 4 * 5 + 6",
+        "2 * 3 - 4 * 5 - 6",
+        "1 - 2 * 3 * 4 / 8",
+        "x * x - 1",
+        "-sin(x * 2) + cos(-(x - 1)) * x",
+        "1 + x * (1 + x * (1 + x * (1 + x * (1 + x))))",
+        "sqrt(x * x) / (x - 3)",
+    };
+    // A wider variable before narrower ones, whose runs must not keep its
+    // precision.
+    std::vector<Scalar> const variables{
+        Scalar{"0"},
+        Scalar{"0.7", 300},
+        Scalar{"0.5"},
+        Scalar{"-1.25"},
+        Scalar{"3"}
     };
 
-    for (auto const& [input, expected] : testCases)
+    for (auto const& input : inputs)
     {
-        auto const tokens = calqmath::Lexer::convert(input);
-        QVERIFY(tokens.has_value());
+        auto const expression{interpreter.expression(input)};
+        QVERIFY(expression.has_value());
 
-        auto const expression =
-            calqmath::Parser::parse(functions, tokens.value());
+        auto program{calqmath::Program::compile(expression.value())};
+        QVERIFY(program.has_value());
+        calqmath::VirtualMachine machine{std::move(program).value()};
+
+        // Repeated runs reuse registers, so check a few in a row
+        for (auto const& variable : variables)
+        {
+            auto const& actual{machine.run(variable)};
+            auto const expected{expression->evaluate(variable)};
+            QCOMPARE(actual, expected);
+            QCOMPARE(actual.precision(), expected->precision());
+        }
+    }
+
+    // One machine under two precisions, whose constants are rounded again and
+    // whose folds only apply under the context they were computed in.
+    for (std::string const input : {"1 / 3 * x + sin(2)", "logn(3, x) + 0.1"})
+    {
+        auto const expression{interpreter.expression(input)};
         QVERIFY(expression.has_value());
 
-        auto const result = expression.value().evaluate(variable);
-        QCOMPARE(result, expected);
+        auto program{calqmath::Program::compile(expression.value())};
+        QVERIFY(program.has_value());
+        calqmath::VirtualMachine machine{std::move(program).value()};
+
+        for (size_t const precision : {size_t{512}, size_t{128}, size_t{53}})
+        {
+            calqmath::MathContext context{calqmath::MathContext::current()};
+            context.precision = precision;
+            calqmath::MathContextScope const scope{context};
+
+            Scalar const variable{"0.7"};
+            auto const& actual{machine.run(variable)};
+            auto const expected{expression->evaluate(variable)};
+            QCOMPARE(actual, expected);
+            QCOMPARE(actual.precision(), expected->precision());
+        }
+        QCOMPARE(
+            machine.run(Scalar{"0.7"}), expression->evaluate(Scalar{"0.7"})
+        );
+    }
+
+    // Registers are recycled once consumed, rather than one per operation
+    auto const nested{
+        interpreter.expression("1 + x * (1 + x * (1 + x * (1 + x)))")
+    };
+    auto const program{calqmath::Program::compile(nested.value())};
+    QVERIFY(program.has_value());
+    QCOMPARE(program->registerCount(), size_t{1});
+    QCOMPARE(program->instructions().size(), size_t{4});
+
+    auto empty{calqmath::Program::compile(calqmath::Expression{})};
+    QVERIFY(empty.has_value());
+    QCOMPARE(
+        calqmath::VirtualMachine{std::move(empty).value()}.run(Scalar{"1"}),
+        Scalar::zero()
+    );
+}
+
+void testDoubleEvaluation(
+    calqmath::FunctionDatabase const& functions,
+    calqmath::Interpreter const& interpreter
+)
+{
+    // Both paths round differently, so only agreement to near double precision
+    // is expected.
+    double constexpr RELATIVE_TOLERANCE{1e-13};
+    auto const close = [&](double actual, double expected)
+    {
+        if (std::isnan(expected))
+        {
+            return std::isnan(actual);
+        }
+        if (std::isinf(expected))
+        {
+            return actual == expected;
+        }
+        return std::abs(actual - expected)
+            <= RELATIVE_TOLERANCE * std::max(1.0, std::abs(expected));
+    };
+
+    std::vector<std::string> inputs{
+        "1",
+        "x",
+        "-(x)",
+        "1 + 2 * x - 3 / x",
+        "2 * 3 - 4 * 5 - 6",
+        "-sin(x * 2) + cos(-(x - 1)) * x",
+        "1 + x * (1 + x * (1 + x * (1 + x * (1 + x))))",
+        "sqrt(x * x) / (x - 3)",
+    };
+    for (auto const& function : functions.unaryFunctions())
+    {
+        inputs.push_back(std::string{function.name} + "(x / 4)");
+    }
+    for (auto const& function : functions.naryFunctions())
+    {
+        inputs.push_back(
+            std::string{function.name}
+            + (function.arity == 2 ? "(x / 4, x - 1)" : "(x / 4, x - 1, x)")
+        );
+    }
+    inputs.emplace_back("-pow(x, 2) * hypot(x, 3) + logn(10, x)");
+
+    for (auto const& input : inputs)
+    {
+        auto const expression{interpreter.expression(input)};
+        QVERIFY(expression.has_value());
+
+        auto program{calqmath::Program::compile(expression.value())};
+        QVERIFY(program.has_value());
+        calqmath::VirtualMachine machine{std::move(program).value()};
+
+        for (double const variable : {0.0, 0.5, -1.25, 3.0})
+        {
+            auto const expected{
+                expression->evaluate(calqmath::Scalar{variable})->toDouble()
+            };
+            auto const actual{expression->evaluate(variable)};
+            QVERIFY(actual.has_value());
+            QVERIFY(close(actual.value(), expected));
+            QVERIFY(close(machine.run(variable), expected));
+        }
+    }
+
+    QCOMPARE(calqmath::Expression{}.evaluate(1.0), std::optional{0.0});
+}
+
+void testNativeFunction(
+    calqmath::FunctionDatabase const& functions,
+    calqmath::Interpreter const& interpreter
+)
+{
+    auto const same = [](double actual, double expected)
+    {
+        if (std::isnan(expected))
+        {
+            return std::isnan(actual);
+        }
+        return actual == expected
+            && std::signbit(actual) == std::signbit(expected);
+    };
+
+    if (!calqmath::NativeFunction::supported())
+    {
+        QVERIFY(!calqmath::NativeFunction::compile(calqmath::Expression{}));
+        return;
+    }
+
+    std::vector<std::string> inputs{
+        "1",
+        "x",
+        "-(x)",
+        "-(x - x)",
+        "1 + 2 * x - 3 / x",
+        "-sin(x * 2) + cos(-(x - 1)) * x",
+        "1 + x * (1 + x * (1 + x * (1 + x * (1 + x))))",
+        "sin(x) * sin(x) + cos(sin(x))",
+        "sin(2) * x + exp(cos(3)) * x * x",
+    };
+    for (auto const& function : functions.unaryFunctions())
+    {
+        inputs.push_back(std::string{function.name} + "(x / 4)");
+    }
+    for (auto const& function : functions.naryFunctions())
+    {
+        inputs.push_back(
+            std::string{function.name}
+            + (function.arity == 2 ? "(x / 4, x - 1)" : "(x / 4, x - 1, x)")
+        );
+    }
+    inputs.emplace_back("-pow(x, 2) * hypot(x, 3) + logn(10, x)");
+
+    std::vector<double> const variables{0.0, 0.5, -1.25, 3.0, -0.0, 1e300};
+    std::vector<double> results(variables.size());
+
+    for (auto const& input : inputs)
+    {
+        auto const expression{interpreter.expression(input)};
+        QVERIFY(expression.has_value());
+
+        auto program{calqmath::Program::compile(expression.value())};
+        QVERIFY(program.has_value());
+        auto const native{calqmath::NativeFunction::compile(program.value())};
+        QVERIFY(native.has_value());
+        calqmath::VirtualMachine machine{std::move(program).value()};
+
+        QVERIFY(native->evaluateMany(variables, results));
+        for (size_t index = 0; index < variables.size(); index++)
+        {
+            auto const expected{machine.run(variables[index])};
+            QVERIFY(same((*native)(variables[index]), expected));
+            QVERIFY(same(native->single()(variables[index]), expected));
+            QVERIFY(same(results[index], expected));
+        }
+    }
+
+    // The code outlives the function it was compiled from through copies.
+    std::optional<calqmath::NativeFunction> copy{};
+    {
+        auto const original{calqmath::NativeFunction::compile(
+            interpreter.expression("x * x + 1").value()
+        )};
+        QVERIFY(original.has_value());
+        copy = original;
+    }
+    QCOMPARE((*copy)(3.0), 10.0);
+
+    QVERIFY(copy->evaluateMany({}, {}));
+    QVERIFY(!copy->evaluateMany(variables, std::span{results}.first(1)));
+}
+
+void testStaticExpression(calqmath::Interpreter const& interpreter)
+{
+    using calqmath::Scalar;
+
+    // The lexer runs at compile time too.
+    static_assert(calqmath::Lexer::convert("sin(x) + 1.5")->size() == 6);
+    static_assert(!calqmath::Lexer::convert("1 + #").has_value());
+
+    // Accepts exactly what Parser accepts.
+    for (std::string const input : {
+             "1",
+             "x",
+             "-(x)",
+             "-x",
+             "x * -2",
+             "1 +",
+             "",
+             "()",
+             "(1",
+             "1)",
+             "1 2",
+             "2(x)",
+             "x(1)",
+             "sin x",
+             "sin(x)",
+             "nonexistent(x)",
+             "--1",
+             "1 - -1",
+             ".5 + 5.",
+         })
+    {
+        auto const tree{calqmath::detail::parseStatic<32>(input)};
+        QCOMPARE(tree.valid, interpreter.expression(input).has_value());
+    }
+
+    // Identical to evaluating the parsed expression, in both backends.
+    auto const check = [&]<calqmath::FixedString Source>()
+    {
+        auto const compiled{calqmath::compile<Source>()};
+        auto const expression{
+            interpreter.expression(std::string{Source.view()})
+        };
+        QVERIFY(expression.has_value());
+
+        for (double const variable : {0.0, 0.5, -1.25, 3.0})
+        {
+            Scalar const scalar{variable};
+            QCOMPARE(compiled(scalar), expression->evaluate(scalar).value());
+            QCOMPARE(
+                std::optional{compiled(variable)},
+                expression->evaluate(variable)
+            );
+        }
+    };
+    check.template operator()<"erf(x)*2+1">();
+    check.template operator()<"x">();
+    check.template operator()<"-(x - 0.1) / 3">();
+    check.template operator()<"1 - x * 3 * x + sin(x) / 2.5 - x * cos(x)">();
+    check.template operator()<"x * x + x * x - x * x">();
+    check.template operator()<"1 + x * (1 + x * (1 + x * (1 + x)))">();
+    check.template operator()<"-exp(0 - x) * x / 7 - -0.25 * tanh(x) * x">();
+    check.template operator()<"0.1 * x + 123456789012345678901234.5">();
+    check.template operator()<"sin(x) * sin(x) + cos(sin(x)) - 1 * 1">();
+
+    // Shared subexpressions are found too, and only groups get a slot.
+    auto const shared{calqmath::detail::parseStatic<64>(
+        "sin(x) * sin(x) + cos(sin(x)) + x * x"
+    )};
+    QCOMPARE(shared.sharedCount, 1U);
+    QCOMPARE(shared.nodeCount, 4U);
+
+    // Literals follow the working precision.
+    auto const third{calqmath::compile<"1 / 3 + x">()};
+    for (size_t const precision : {64, 256})
+    {
+        calqmath::MathContextScope const scope{{.precision = precision}};
+        auto const expected{
+            interpreter.expression("1 / 3 + x")->evaluate(Scalar{0.0})
+        };
+        QCOMPARE(third(Scalar{0.0}), expected.value());
+        QCOMPARE(third(Scalar{0.0}).precision(), precision);
+    }
+}
+
+void testEvaluateMany(
+    calqmath::FunctionDatabase const& functions,
+    calqmath::Interpreter const& interpreter
+)
+{
+    using calqmath::Scalar;
+
+    std::vector<std::string> inputs{
+        "1",
+        "x",
+        "-(x)",
+        "1 + 2 * x - 3 / x",
+        "2 * x * 3 - 4 * x * 5 - 6",
+        "x * x + x * 3 - 2",
+        "-sin(x * 2) + cos(-(x - 1)) * x",
+        "1 + x * (1 + x * (1 + x * (1 + x * (1 + x))))",
+        "log(x) * 2",
+    };
+    for (auto const& function : functions.unaryFunctions())
+    {
+        inputs.push_back(std::string{function.name} + "(x / 4)");
+    }
+    for (auto const& function : functions.naryFunctions())
+    {
+        inputs.push_back(
+            std::string{function.name}
+            + (function.arity == 2 ? "(x / 4, x - 1)" : "(x / 4, x - 1, x)")
+        );
+    }
+    inputs.emplace_back("-pow(x, 2) * hypot(x, 3) + logn(10, x)");
+
+    // More than one block, and a partial last block
+    size_t constexpr COUNT{601};
+    std::vector<Scalar> variables{};
+    std::vector<double> doubleVariables{};
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        double const variable{(static_cast<double>(i) - 300.0) / 37.0};
+        variables.emplace_back(variable);
+        doubleVariables.push_back(variable);
+    }
+
+    for (auto const& input : inputs)
+    {
+        auto const expression{interpreter.expression(input)};
+        QVERIFY(expression.has_value());
+
+        std::vector<Scalar> results(COUNT);
+        QVERIFY(expression->evaluateMany(variables, results));
+
+        std::vector<double> doubleResults(COUNT);
+        QVERIFY(expression->evaluateMany(doubleVariables, doubleResults));
+
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            // Undefined elements are NaN, without affecting the others
+            auto const expected{expression->evaluate(variables[i]).value()};
+            QVERIFY(
+                results[i] == expected
+                || (results[i].isNaN() && expected.isNaN())
+            );
+
+            // Within the batched kernels' error, with some slack for
+            // cancellation in the sums.
+            double const expectedDouble{expected.toDouble()};
+            double const actualDouble{doubleResults[i]};
+            if (std::isnan(expectedDouble) || std::isinf(expectedDouble))
+            {
+                QVERIFY(
+                    std::isnan(expectedDouble) ? std::isnan(actualDouble)
+                                               : actualDouble == expectedDouble
+                );
+                continue;
+            }
+            QVERIFY(
+                std::abs(actualDouble - expectedDouble)
+                <= 1e-11 * std::max(1.0, std::abs(expectedDouble))
+            );
+        }
+    }
+
+    // Results take the larger precision of the variables and the context,
+    // also when the variable is not the first argument of a call
+    size_t constexpr PRECISION{2 * calqmath::DEFAULT_BASE_2_PRECISION};
+    std::vector<Scalar> const precise{Scalar{"1.5", PRECISION}};
+    for (std::string const input : {"x / 3", "pow(2, x)", "min(1, x)"})
+    {
+        auto const expression{interpreter.expression(input)};
+        QVERIFY(expression.has_value());
+        std::vector<Scalar> preciseResults(1);
+        QVERIFY(expression->evaluateMany(precise, preciseResults));
+        QCOMPARE(preciseResults[0].precision(), PRECISION);
+        QCOMPARE(preciseResults[0], expression->evaluate(precise[0]).value());
+    }
+
+    std::vector<double> empty(3, 1.0);
+    QVERIFY(calqmath::Expression{}.evaluateMany(empty, empty));
+    QVERIFY(std::ranges::all_of(empty, [](double x) { return x == 0.0; }));
+}
+
+void testExecutor(calqmath::Interpreter const& interpreter)
+{
+    using calqmath::Scalar;
+
+    for (size_t const participants : {size_t{1}, size_t{4}})
+    {
+        calqmath::Executor executor{participants};
+        QCOMPARE(executor.participants(), participants);
+
+        // Every index exactly once, with uneven costs so that work is stolen
+        size_t constexpr COUNT{1000};
+        size_t constexpr GRAIN_SIZE{7};
+        std::vector<std::atomic<int>> visits(COUNT);
+        std::atomic<bool> grained{true};
+        executor.parallelFor(
+            COUNT,
+            GRAIN_SIZE,
+            [&](size_t const begin, size_t const end)
+        {
+            // Test macros are not safe to use off the main thread
+            if (end - begin > GRAIN_SIZE)
+            {
+                grained = false;
+            }
+            for (size_t i = begin; i < end; i++)
+            {
+                if (i < 100)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds{50});
+                }
+                visits[i]++;
+            }
+        }
+        );
+        QVERIFY(grained);
+        QVERIFY(std::ranges::all_of(
+            visits, [](std::atomic<int> const& count) { return count == 1; }
+        ));
+
+        auto const expression{interpreter.expression("gamma(x) + erf(x) * x")};
+        QVERIFY(expression.has_value());
+
+        std::vector<Scalar> variables{};
+        std::vector<double> doubleVariables{};
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            double const variable{(static_cast<double>(i) - 500.0) / 61.0};
+            variables.emplace_back(variable);
+            doubleVariables.push_back(variable);
+        }
+
+        std::vector<Scalar> expected(COUNT);
+        QVERIFY(expression->evaluateMany(variables, expected));
+        std::vector<double> doubleExpected(COUNT);
+        QVERIFY(expression->evaluateMany(doubleVariables, doubleExpected));
+
+        std::vector<Scalar> results(COUNT);
+        QVERIFY(executor.evaluateMany(expression.value(), variables, results));
+        std::vector<double> doubleResults(COUNT);
+        QVERIFY(executor.evaluateMany(
+            expression.value(), doubleVariables, doubleResults
+        ));
+
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            QVERIFY(
+                results[i] == expected[i]
+                || (results[i].isNaN() && expected[i].isNaN())
+            );
+            QVERIFY(
+                doubleResults[i] == doubleExpected[i]
+                || (std::isnan(doubleResults[i])
+                    && std::isnan(doubleExpected[i]))
+            );
+        }
+
+        // Workers run under the caller's context
+        calqmath::MathContext context{};
+        context.precision = 3 * calqmath::DEFAULT_BASE_2_PRECISION;
+        calqmath::MathContextScope const scope{context};
+
+        QVERIFY(executor.evaluateMany(expression.value(), variables, results));
+        QVERIFY(std::ranges::all_of(
+            results,
+            [&](Scalar const& result)
+        { return result.precision() == context.precision; }
+        ));
+    }
+}
+
+void testInPlaceFunctions(calqmath::FunctionDatabase const& functions)
+{
+    using calqmath::MathContext;
+    using calqmath::RoundingMode;
+    using calqmath::Scalar;
+
+    auto const same{[](Scalar const& lhs, Scalar const& rhs)
+                    {
+                        return lhs.precision() == rhs.precision()
+                            && (lhs == rhs || (lhs.isNaN() && rhs.isNaN()));
+                    }};
+
+    // Results take the argument's precision whatever the result had before,
+    // and may alias the argument.
+    for (auto const& function : functions.unaryFunctions())
+    {
+        for (size_t const precision : {size_t{24}, size_t{64}, size_t{200}})
+        {
+            for (std::string const text : {"0.3", "-0.75", "1.5", "4.25"})
+            {
+                Scalar const argument{text, precision};
+                auto const expected{calqmath::applyFunction(function, argument)
+                };
+                QCOMPARE(expected.precision(), precision);
+
+                Scalar wider{"7", 300};
+                function.function(wider, argument, MathContext::current());
+                QVERIFY(same(wider, expected));
+
+                Scalar aliased{argument};
+                function.function(aliased, aliased, MathContext::current());
+                QVERIFY(same(aliased, expected));
+            }
+        }
+    }
+
+    // The by-value overloads are the same computation.
+    Scalar const three{"3", 64};
+    Scalar result{};
+    calqmath::Functions::log(result, three, MathContext::current());
+    QCOMPARE(result, calqmath::Functions::log(three));
+
+    // Rounding comes from the given context.
+    Scalar up{};
+    Scalar down{};
+    calqmath::Functions::log(
+        up, three, MathContext{.rounding = RoundingMode::TOWARD_POSITIVE}
+    );
+    calqmath::Functions::log(
+        down, three, MathContext{.rounding = RoundingMode::TOWARD_NEGATIVE}
+    );
+    QVERIFY(down < up);
+}
+
+void testBatchFunctions(calqmath::FunctionDatabase const& functions)
+{
+    // The bounds documented in functions.h, in units in the last place.
+    std::map<std::string, double> const bounds{
+        {"id", 0.0},    {"abs", 0.0},   {"ceil", 0.0},      {"floor", 0.0},
+        {"round", 0.0}, {"trunc", 0.0}, {"roundeven", 0.0}, {"sqrt", 0.5},
+        {"exp", 2.0},   {"log", 2.0},   {"log2", 2.0},      {"atan", 2.0},
+        {"acos", 2.0},  {"erf", 2.0},   {"sin", 3.0},       {"cos", 3.0},
+        {"csc", 3.0},   {"sec", 3.0},   {"asin", 3.0},      {"sinh", 3.0},
+        {"cosh", 3.0},  {"tanh", 3.0},  {"asinh", 3.0},     {"acosh", 3.0},
+        {"atanh", 3.0}, {"cbrt", 3.0},  {"tan", 4.0},       {"cot", 4.0},
+        {"erfc", 5.0},  {"gamma", 20.0},
+    };
+
+    std::vector<double> arguments{
+        0.0,
+        -0.0,
+        1e-310,
+        -3e-300,
+        1e5,
+        -1e7,
+        1e300,
+        -1e300,
+        std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::quiet_NaN(),
+    };
+    // Every multiple of 1/128 in [-8, 8], which includes the integers, and
+    // a sweep in magnitude.
+    for (int i = -1024; i <= 1024; i++)
+    {
+        arguments.push_back(i / 128.0);
+    }
+    for (int i = -60; i <= 60; i++)
+    {
+        arguments.push_back(std::ldexp(1.1, 3 * i));
+        arguments.push_back(-std::ldexp(1.3, 3 * i + 1));
+    }
+
+    for (auto const& function : functions.unaryFunctions())
+    {
+        std::string const name{function.name};
+        QVERIFY(bounds.contains(name));
+        double const bound{bounds.at(name)};
+
+        std::vector<double> results(arguments.size());
+        function.batchFunction(arguments, results);
+
+        for (size_t i = 0; i < arguments.size(); i++)
+        {
+            calqmath::Scalar const argument{arguments[i], 128};
+            double const expected{
+                calqmath::applyFunction(function, argument).toDouble()
+            };
+            double const actual{results[i]};
+
+            if (std::isnan(expected) || std::isinf(expected))
+            {
+                QVERIFY(
+                    std::isnan(expected) ? std::isnan(actual)
+                                         : actual == expected
+                );
+                continue;
+            }
+            double const ulp{std::ldexp(
+                1.0,
+                std::max(std::ilogb(expected), -1022)
+                    - std::numeric_limits<double>::digits + 1
+            )};
+            QVERIFY(std::abs(actual - expected) <= bound * ulp);
+        }
+
+        // In place, and in sizes that leave a partial vector
+        std::vector<double> inPlace{arguments};
+        function.batchFunction(inPlace, inPlace);
+        QVERIFY(std::ranges::equal(
+            inPlace,
+            results,
+            [](double lhs, double rhs)
+            { return lhs == rhs || (std::isnan(lhs) && std::isnan(rhs)); }
+        ));
+        std::span<double const> const partial{arguments.data() + 1, 6};
+        function.batchFunction(partial, std::span{results}.first(6));
+        for (size_t i = 0; i < partial.size(); i++)
+        {
+            QVERIFY(
+                results[i] == inPlace[i + 1]
+                || (std::isnan(results[i]) && std::isnan(inPlace[i + 1]))
+            );
+        }
+    }
+}
+
+template <size_t N>
+void checkMultiDouble(
+    calqmath::MultiDouble<N> const& actual, calqmath::Scalar const& expected
+)
+{
+    using calqmath::MultiDouble;
+
+    // The last few bits are not correctly rounded
+    double const tolerance{
+        std::ldexp(1.0, 8 - static_cast<int>(MultiDouble<N>::PRECISION))
+    };
+
+    if (expected.isNaN())
+    {
+        QVERIFY(actual.isNaN());
+        return;
+    }
+    if (expected == calqmath::Scalar::zero())
+    {
+        QCOMPARE(actual.toScalar(expected.precision()), expected);
+        return;
+    }
+
+    auto const error{
+        (actual.toScalar(expected.precision()) - expected) / expected
+    };
+    QVERIFY(std::abs(error.toDouble()) <= tolerance);
+}
+
+template <size_t N>
+void testMultiDouble(
+    calqmath::FunctionDatabase const& functions,
+    calqmath::Interpreter const& interpreter
+)
+{
+    using calqmath::Functions;
+    using calqmath::MultiDouble;
+    using calqmath::Scalar;
+
+    size_t constexpr REFERENCE_PRECISION{2 * MultiDouble<N>::PRECISION};
+
+    QVERIFY(MultiDouble<N>::serves(N * 53));
+    QCOMPARE(
+        MultiDouble<N>::serves(calqmath::DEFAULT_BASE_2_PRECISION), N > 2
+    );
+
+    std::string const lhsString{"1.23456789012345678901234567890123456789012"
+                                "34567890123456789012345678901"};
+    std::string const rhsString{"-0.9876543210987654321098765432109876543210"
+                                "98765432109876543210987654321"};
+    MultiDouble<N> const lhs{lhsString};
+    MultiDouble<N> const rhs{rhsString};
+    Scalar const lhsReference{lhsString, REFERENCE_PRECISION};
+    Scalar const rhsReference{rhsString, REFERENCE_PRECISION};
+
+    checkMultiDouble(lhs, lhsReference);
+    checkMultiDouble(lhs + rhs, lhsReference + rhsReference);
+    checkMultiDouble(lhs - rhs, lhsReference - rhsReference);
+    checkMultiDouble(lhs * rhs, lhsReference * rhsReference);
+    checkMultiDouble(lhs / rhs, lhsReference / rhsReference);
+    checkMultiDouble(-lhs, -lhsReference);
+    QVERIFY(rhs < lhs);
+    QVERIFY((lhs / MultiDouble<N>{0.0}).toDouble() > 0.0);
+    QVERIFY(std::isinf((lhs / MultiDouble<N>{0.0}).toDouble()));
+
+    // Cancellation which double precision would lose entirely
+    MultiDouble<N> const tiny{std::ldexp(1.0, -100)};
+    checkMultiDouble(
+        (lhs + tiny) - lhs, Scalar{std::ldexp(1.0, -100), REFERENCE_PRECISION}
+    );
+
+    for (auto const& function : functions.unaryFunctions())
+    {
+        for (std::string const argument : {"0.3", "-0.75", "1.5", "4.25"})
+        {
+            Scalar const reference{argument, REFERENCE_PRECISION};
+            auto const expected{calqmath::applyFunction(function, reference)};
+
+            if constexpr (N == 2)
+            {
+                checkMultiDouble(
+                    function.doubleDoubleFunction(MultiDouble<N>{argument}),
+                    expected
+                );
+            }
+            else
+            {
+                checkMultiDouble(
+                    function.quadDoubleFunction(MultiDouble<N>{argument}),
+                    expected
+                );
+            }
+        }
+    }
+
+    // Evaluation, with literals parsed at a precision that covers the backend
+    calqmath::MathContextScope const context{
+        calqmath::MathContext{.precision = REFERENCE_PRECISION}
+    };
+    for (std::string const input :
+         {"1 + 2 * x - 3 / x", "-sin(x * 2) + cos(-(x - 1)) * x", "exp(x) / 3"})
+    {
+        auto const expression{interpreter.expression(input)};
+        QVERIFY(expression.has_value());
+
+        auto const actual{expression->evaluate(MultiDouble<N>{"0.7"})};
+        QVERIFY(actual.has_value());
+        checkMultiDouble(
+            actual.value(), expression->evaluate(Scalar{"0.7"}).value()
+        );
+    }
+
+    QCOMPARE(Functions::floor(MultiDouble<N>{"-2.5"}), MultiDouble<N>{-3.0});
+    QCOMPARE(Functions::round(MultiDouble<N>{"-2.5"}), MultiDouble<N>{-3.0});
+    QCOMPARE(Functions::roundeven(MultiDouble<N>{"2.5"}), MultiDouble<N>{2.0});
+    QCOMPARE(Functions::trunc(MultiDouble<N>{"-2.5"}), MultiDouble<N>{-2.0});
+}
+
+void testInterval(
+    calqmath::FunctionDatabase const& functions,
+    calqmath::Interpreter const& interpreter
+)
+{
+    using calqmath::Functions;
+    using calqmath::Interval;
+    using calqmath::Scalar;
+
+    size_t constexpr PRECISION{64};
+    auto const interval = [](std::string const& lower, std::string const& upper)
+    { return Interval{Scalar{lower, PRECISION}, Scalar{upper, PRECISION}}; };
+
+    QCOMPARE(interval("1", "2") + interval("3", "4"), interval("4", "6"));
+    QCOMPARE(interval("1", "2") - interval("3", "4"), interval("-3", "-1"));
+    QCOMPARE(interval("-1", "2") * interval("3", "4"), interval("-4", "8"));
+    QCOMPARE(interval("2", "4") / interval("-2", "-1"), interval("-4", "-1"));
+
+    // Outward rounding keeps the exact value inside
+    auto const third{Interval{1.0, PRECISION} / Interval{3.0, PRECISION}};
+    Scalar const thirdReference{
+        Scalar{1.0, 4 * PRECISION} / Scalar{3.0, 4 * PRECISION}
+    };
+    QVERIFY(third.lower() != third.upper());
+    QVERIFY(third.contains(thirdReference));
+
+    auto const reciprocal{Interval{1.0, PRECISION} / interval("-1", "1")};
+    QVERIFY(!reciprocal.continuous());
+    QCOMPARE(reciprocal.upper(), calqmath::Scalar::positiveInf());
+    QVERIFY((Interval{1.0, PRECISION} / Interval{0.0, PRECISION}).isEmpty());
+
+    // Every point of the argument must map into the enclosure
+    size_t constexpr SAMPLES{16};
+    for (auto const& function : functions.unaryFunctions())
+    {
+        for (auto const& [lower, upper] :
+             {std::pair{"0.3", "0.9"},
+              std::pair{"-0.75", "-0.25"},
+              std::pair{"1.5", "4.25"},
+              std::pair{"-3.75", "-3.25"},
+              std::pair{"-2", "7"}})
+        {
+            auto const argument{interval(lower, upper)};
+            auto const result{function.intervalFunction(argument)};
+
+            for (size_t sample = 0; sample <= SAMPLES; sample++)
+            {
+                Scalar const fraction{
+                    static_cast<double>(sample) / SAMPLES, PRECISION
+                };
+                auto const point{
+                    argument.lower()
+                    + (argument.upper() - argument.lower()) * fraction
+                };
+                auto const expected{calqmath::applyFunction(function, point)};
+                if (!expected.isNaN())
+                {
+                    QVERIFY(result.contains(expected));
+                }
+            }
+        }
+    }
+
+    // Poles and jumps are reported, smooth spans are not
+    QVERIFY(Functions::tan(interval("1", "1.5")).continuous());
+    QVERIFY(!Functions::tan(interval("1.5", "1.6")).continuous());
+    QVERIFY(!Functions::csc(interval("-0.1", "0.1")).continuous());
+    QVERIFY(!Functions::cot(interval("3.1", "3.2")).continuous());
+    QVERIFY(Functions::gamma(interval("-2.9", "-2.1")).continuous());
+    QVERIFY(!Functions::gamma(interval("-1.5", "-0.5")).continuous());
+    QVERIFY(!Functions::floor(interval("0.5", "1.5")).continuous());
+    QCOMPARE(Functions::floor(interval("1.2", "1.8")), interval("1", "1"));
+
+    QCOMPARE(Functions::sin(interval("-1", "7")), interval("-1", "1"));
+    QCOMPARE(Functions::abs(interval("-3", "2")), interval("0", "3"));
+
+    auto const clipped{Functions::sqrt(interval("-1", "4"))};
+    QVERIFY(!clipped.continuous());
+    QCOMPARE(clipped.lower(), Scalar::zero());
+    QVERIFY(Functions::log(interval("-2", "-1")).isEmpty());
+
+    auto const expression{interpreter.expression("sin(x) * x + 1 / (x - 2)")};
+    QVERIFY(expression.has_value());
+
+    auto const enclosure{expression->evaluate(interval("0.5", "0.6"))};
+    QVERIFY(enclosure.has_value() && enclosure->continuous());
+    QVERIFY(enclosure->contains(
+        expression->evaluate(Scalar{"0.55", PRECISION}).value()
+    ));
+    QVERIFY(!expression->evaluate(interval("1.9", "2.1"))->continuous());
+}
+
+void testDerivatives(
+    calqmath::FunctionDatabase const& functions,
+    calqmath::Interpreter const& interpreter
+)
+{
+    using calqmath::Jet;
+    using calqmath::Scalar;
+
+    size_t constexpr PRECISION{64};
+    size_t constexpr REFERENCE_PRECISION{512};
+    double const tolerance{std::ldexp(1.0, 8 - static_cast<int>(PRECISION))};
+
+    auto const close = [&](Scalar const& actual, Scalar const& expected)
+    {
+        if (expected.isNaN())
+        {
+            return actual.isNaN();
+        }
+        double const scale{std::max(1.0, std::abs(expected.toDouble()))};
+        return std::abs((actual - expected).toDouble()) <= tolerance * scale;
+    };
+
+    // Every rule against central differences at a much higher precision, away
+    // from the jumps of the rounding functions
+    Scalar const step{std::ldexp(1.0, -100), REFERENCE_PRECISION};
+    Scalar const two{2.0, REFERENCE_PRECISION};
+    for (auto const& function : functions.unaryFunctions())
+    {
+        for (std::string const argument : {"0.3", "-0.75", "1.25", "4.25"})
+        {
+            Scalar const x{argument, REFERENCE_PRECISION};
+            auto const value{calqmath::applyFunction(function, x)};
+            if (value.isNaN())
+            {
+                continue;
+            }
+            auto const above{calqmath::applyFunction(function, x + step)};
+            auto const below{calqmath::applyFunction(function, x - step)};
+
+            Scalar const point{argument, PRECISION};
+            auto const jet{function.jetFunction(Jet::variable(point))};
+            QVERIFY(close(jet.value(), value));
+            QVERIFY(close(jet.first(), (above - below) / (two * step)));
+            QVERIFY(close(
+                jet.second(), (above - two * value + below) / (step * step)
+            ));
+        }
+    }
+
+    auto const corner{calqmath::Functions::abs(Jet::variable(Scalar{0.0}))};
+    QVERIFY(corner.first().isNaN());
+
+    // Whole expressions, against their derivatives worked out by hand in
+    // doubles
+    auto const near = [](Scalar const& actual, double const expected)
+    {
+        double const scale{std::max(1.0, std::abs(expected))};
+        return std::abs(actual.toDouble() - expected) <= 1e-14 * scale;
+    };
+    auto const check = [&](std::string const& input,
+                           double const variable,
+                           double const value,
+                           double const first,
+                           double const second)
+    {
+        auto const expression{interpreter.expression(input)};
+        QVERIFY(expression.has_value());
+        auto const jet{
+            expression->evaluate(Jet::variable(Scalar{variable, PRECISION}))
+        };
+        QVERIFY(jet.has_value());
+        QVERIFY(near(jet->value(), value));
+        QVERIFY(near(jet->first(), first));
+        QVERIFY(near(jet->second(), second));
+    };
+
+    double const x{0.75};
+    check(
+        "x * sin(x) + 1 / x",
+        x,
+        (x * std::sin(x)) + (1 / x),
+        std::sin(x) + (x * std::cos(x)) - (1 / (x * x)),
+        (2 * std::cos(x)) - (x * std::sin(x)) + (2 / (x * x * x))
+    );
+    check(
+        "exp(x * x) - 3",
+        x,
+        std::exp(x * x) - 3,
+        2 * x * std::exp(x * x),
+        (2 + (4 * x * x)) * std::exp(x * x)
+    );
+    check(
+        "sin(x) * sin(x) - -(2)",
+        x,
+        (std::sin(x) * std::sin(x)) + 2,
+        std::sin(2 * x),
+        2 * std::cos(2 * x)
+    );
+    check("4 * 2 + sqrt(2)", x, 8 + std::sqrt(2.0), 0.0, 0.0);
+
+    // Without products to fuse, the value is the ordinary evaluation
+    auto const quotient{interpreter.expression("sin(x) / x - 2")};
+    QVERIFY(quotient.has_value());
+    Scalar const variable{"0.3"};
+    QCOMPARE(
+        quotient->evaluate(Jet::variable(variable))->value(),
+        quotient->evaluate(variable).value()
+    );
+}
+
+void testScalarStorage()
+{
+    // Cover both inline and heap-allocated limbs, and moves between them.
+    size_t constexpr HEAP_PRECISION{4 * calqmath::INLINE_BASE_2_PRECISION};
+
+    calqmath::Scalar const inlineValue{"1.5"};
+    calqmath::Scalar const heapValue{"1.5", HEAP_PRECISION};
+
+    for (auto const* const pValue : {&inlineValue, &heapValue})
+    {
+        auto const& value{*pValue};
+
+        calqmath::Scalar copy{value};
+        QCOMPARE(copy, value);
+
+        calqmath::Scalar moved{std::move(copy)};
+        QCOMPARE(moved, value);
+
+        calqmath::Scalar assigned{"2.5", HEAP_PRECISION};
+        assigned = std::move(moved);
+        QCOMPARE(assigned, value);
+
+        // Moved-from values can still be assigned to.
+        moved = assigned;
+        QCOMPARE(moved, value);
+
+        calqmath::Scalar inlineAssigned{};
+        inlineAssigned = calqmath::Scalar{"1.5", HEAP_PRECISION};
+        QCOMPARE(inlineAssigned, value);
+    }
+}
+
+void testScalarVector()
+{
+    using calqmath::Functions;
+    using calqmath::Scalar;
+    using calqmath::ScalarVector;
+
+    size_t constexpr PRECISION{96};
+    std::vector<double> const numbers{-2.5, -0.75, 0.0, 0.5, 1.25, 3.5, 7.0};
+    ScalarVector const arguments{numbers, PRECISION};
+
+    QCOMPARE(arguments.size(), numbers.size());
+    QCOMPARE(arguments.precision(), PRECISION);
+    QCOMPARE(arguments.get(4), Scalar("1.25", PRECISION));
+
+    std::vector<double> roundTrip(numbers.size());
+    arguments.toDoubles(roundTrip);
+    QVERIFY(roundTrip == numbers);
+
+    // Each element matches the Scalar function at the same precision
+    ScalarVector results{numbers.size(), PRECISION};
+    for (auto const& [vectorFunction, scalarFunction] :
+         {std::pair{
+              static_cast<void (*)(ScalarVector const&, ScalarVector&)>(
+                  Functions::sin
+              ),
+              static_cast<Scalar (*)(Scalar const&)>(Functions::sin)
+          },
+          std::pair{
+              static_cast<void (*)(ScalarVector const&, ScalarVector&)>(
+                  Functions::gamma
+              ),
+              static_cast<Scalar (*)(Scalar const&)>(Functions::gamma)
+          },
+          std::pair{
+              static_cast<void (*)(ScalarVector const&, ScalarVector&)>(
+                  Functions::roundeven
+              ),
+              static_cast<Scalar (*)(Scalar const&)>(Functions::roundeven)
+          }})
+    {
+        vectorFunction(arguments, results);
+        for (size_t i = 0; i < numbers.size(); i++)
+        {
+            auto const expected{scalarFunction(Scalar{numbers[i], PRECISION})};
+            QVERIFY(
+                results.get(i) == expected
+                || (results.get(i).isNaN() && expected.isNaN())
+            );
+        }
+    }
+
+    // Broadcast operands, and results aliasing an argument
+    Scalar const two{2.0, PRECISION};
+    Functions::multiply(results, arguments, two);
+    Functions::subtract(results, results, arguments);
+    QCOMPARE(results, arguments);
+
+    Functions::divide(results, two, arguments);
+    QCOMPARE(results.get(3), Scalar(4.0, PRECISION));
+    QCOMPARE(results.get(2), Scalar::positiveInf());
+
+    Functions::sqr(results, arguments);
+    Functions::negate(results, results);
+    QCOMPARE(results.get(0), Scalar("-6.25", PRECISION));
+
+    // Results grow to the arguments' precision, but never shrink
+    ScalarVector narrow{numbers.size(), 32};
+    Functions::add(narrow, arguments, arguments);
+    QCOMPARE(narrow.precision(), PRECISION);
+    QCOMPARE(narrow.get(5), Scalar(7.0, PRECISION));
+
+    ScalarVector wide{numbers.size(), 2 * PRECISION};
+    Functions::id(arguments, wide);
+    QCOMPARE(wide.precision(), 2 * PRECISION);
+    QCOMPARE(wide.get(1), Scalar(-0.75, PRECISION));
+
+    // Copies own their limbs
+    ScalarVector copy{arguments};
+    copy.set(0, Scalar{"0.1", PRECISION});
+    QCOMPARE(arguments.get(0), Scalar(-2.5, PRECISION));
+    QCOMPARE(copy.get(0), Scalar("0.1", PRECISION));
+
+    ScalarVector moved{std::move(copy)};
+    QCOMPARE(moved.get(0), Scalar("0.1", PRECISION));
+    copy = moved;
+    copy.fill(two);
+    QCOMPARE(copy.get(6), two);
+    QCOMPARE(moved.get(6), Scalar(7.0, PRECISION));
+}
+
+void testEvaluationArena()
+{
+    using calqmath::EvaluationArena;
+    using calqmath::Functions;
+
+    // Inline scalars never allocate, so use one large enough to hit the heap.
+    size_t constexpr HEAP_PRECISION{4 * calqmath::INLINE_BASE_2_PRECISION};
+    calqmath::Scalar const argument{"0.25", HEAP_PRECISION};
+
+    auto const expected{Functions::gamma(Functions::sin(argument))};
+
+    QCOMPARE(EvaluationArena::bytesInUse(), size_t{0});
+    {
+        EvaluationArena const arena{};
+
+        auto const actual{Functions::gamma(Functions::sin(argument))};
+        QCOMPARE(actual, expected);
+
+        size_t const outerBytes{EvaluationArena::bytesInUse()};
+        QVERIFY(outerBytes > 0);
+
+        {
+            EvaluationArena const nested{};
+
+            auto const nestedActual{Functions::erf(actual)};
+            QCOMPARE(nestedActual, Functions::erf(expected));
+        }
+
+        // Only the outermost scope releases memory.
+        QVERIFY(EvaluationArena::bytesInUse() >= outerBytes);
+        QCOMPARE(actual, expected);
+    }
+    QCOMPARE(EvaluationArena::bytesInUse(), size_t{0});
+
+    // Values allocated outside the scope can still be released within it.
+    auto outsideValue{std::make_optional(Functions::sin(argument))};
+    {
+        EvaluationArena const arena{};
+        outsideValue.reset();
+    }
+    // Compiled expressions keep no literal from a scope once it ends, even
+    // when first used within it.
+    auto const compiled{calqmath::compile<"0.1 * x + 1">()};
+    calqmath::MathContextScope const scope{{.precision = HEAP_PRECISION}};
+    calqmath::Scalar const one{"1", HEAP_PRECISION};
+    auto const literals{
+        Functions::fma(calqmath::Scalar{"0.1", HEAP_PRECISION}, argument, one)
+    };
+    {
+        EvaluationArena const arena{};
+        QCOMPARE(compiled(argument), literals);
+    }
+    QCOMPARE(EvaluationArena::bytesInUse(), size_t{0});
+    QCOMPARE(compiled(argument), literals);
+}
+
+void testNonOrdinaryScalarStringify()
+{
+    QCOMPARE(
+        calqmath::Scalar::zero().toString(),
+        calqmath::Scalar::ZERO_REPRESENTATION
+    );
+
+    QCOMPARE(
+        calqmath::Scalar::nan().toString(), calqmath::Scalar::NAN_REPRESENTATION
+    );
+
+    QCOMPARE(
+        calqmath::Scalar::positiveInf().toString(),
+        calqmath::Scalar::POSITIVE_INFINITY_REPRESENTATION
+    );
+
+    QCOMPARE(
+        calqmath::Scalar::negativeInf().toString(),
+        calqmath::Scalar::NEGATIVE_INFINITY_REPRESENTATION
+    );
+}
+
+void testMathContext(calqmath::Interpreter const& interpreter)
+{
+    using calqmath::MathContext;
+    using calqmath::MathContextScope;
+    using calqmath::RoundingMode;
+    using calqmath::Scalar;
+
+    QCOMPARE(MathContext::current(), MathContext{});
+    QCOMPARE(Scalar{}.precision(), calqmath::DEFAULT_BASE_2_PRECISION);
+
+    size_t constexpr OUTER_PRECISION{64};
+    size_t constexpr INNER_PRECISION{256};
+    {
+        MathContextScope const outer{
+            MathContext{.precision = OUTER_PRECISION}
+        };
+        QCOMPARE(Scalar{"1.5"}.precision(), OUTER_PRECISION);
+        {
+            MathContextScope const inner{
+                MathContext{.precision = INNER_PRECISION}
+            };
+            QCOMPARE(Scalar{"1.5"}.precision(), INNER_PRECISION);
+        }
+        QCOMPARE(Scalar{"1.5"}.precision(), OUTER_PRECISION);
+
+        // Other threads are unaffected
+        size_t otherThreadPrecision{0};
+        std::thread{[&]() { otherThreadPrecision = Scalar{}.precision(); }}
+            .join();
+        QCOMPARE(otherThreadPrecision, calqmath::DEFAULT_BASE_2_PRECISION);
+    }
+    QCOMPARE(MathContext::current(), MathContext{});
+
+    Scalar const one{"1"};
+    Scalar const three{"3"};
+    std::optional<Scalar> roundedUp{};
+    std::optional<Scalar> roundedDown{};
+    {
+        MathContextScope const scope{
+            MathContext{.rounding = RoundingMode::TOWARD_POSITIVE}
+        };
+        roundedUp = one / three;
+    }
+    {
+        MathContextScope const scope{
+            MathContext{.rounding = RoundingMode::TOWARD_NEGATIVE}
+        };
+        roundedDown = one / three;
+    }
+    QVERIFY(roundedUp != roundedDown);
+    QCOMPARE(
+        (roundedUp.value() - roundedDown.value()).sign(),
+        calqmath::Sign::POSITIVE
+    );
+
+    {
+        // 2048 needs a binary exponent of 12
+        MathContextScope const scope{MathContext{.exponentMax = 10}};
+        QCOMPARE(Scalar{"512"} * Scalar{"4"}, Scalar::positiveInf());
+    }
+    QCOMPARE(Scalar{"512"} * Scalar{"4"}, Scalar{"2048"});
+
+    auto const expression{interpreter.expression("1 / 3 + x")};
+    QVERIFY(expression.has_value());
+    auto const result{expression->evaluate(
+        Scalar{"1", OUTER_PRECISION}, MathContext{.precision = OUTER_PRECISION}
+    )};
+    QVERIFY(result.has_value());
+    QCOMPARE(result->precision(), OUTER_PRECISION);
+}
+
+void testMinimalPrecision(calqmath::Interpreter const& interpreter)
+{
+    for (size_t i = 0; i < calqmath::getBignumBackendPrecision(); i++)
+    {
+        std::string const input{std::format("1{0}+1-1{0}", std::string(i, '0'))
+        };
+        QCOMPARE(
+            interpreter.expression(input)->evaluate(), calqmath::Scalar{"1"}
+        );
+    }
+}
+
+void testLexerWhitespace()
+{
+    using enum calqmath::TokenKind;
+    using TestCase =
+        std::tuple<std::vector<std::string>, std::vector<LexedToken>>;
+    std::vector<TestCase> const cases{
+        {{" 0 - 1 + 2 / 3 * 4 ",
+          "   0   -  1  +  2  /  3  *  4  ",
+          "0-1  +2/3  *4",
+          "0  -1+2  /3*4",
+          "  0-1  +2/3*4",
+          "0  -1+2/3*4  ",
+          "\t0\n-1\r+2/3*4"},
+         {lex("0-1+2/3*4").value()}},
+        {{"1 2", " 1  2 "}, {{Number, "1"}, {Number, "2"}}},
+        {{"", "   "}, {}},
+    };
+    for (auto const& [inputs, output] : cases)
+    {
+        for (auto const& input : inputs)
+        {
+            auto const actual = lex(input);
+            QCOMPARE(actual, output);
+        }
+    }
+
+    // The echo keeps separated tokens apart, so it reads as it is lexed.
+    QCOMPARE(calqmath::Interpreter::prettify(" 1  2 "), std::string{"1 2"});
+    QCOMPARE(
+        calqmath::Interpreter::prettify("\t0\n-1\r+2/3*4 "),
+        std::string{"0 -1 +2/3*4"}
+    );
+    QCOMPARE(calqmath::Interpreter::prettify("   "), std::string{});
+}
+void testLexerNumbers()
+{
+    using enum calqmath::TokenKind;
+    using TestCase = std::tuple<std::string, std::vector<LexedToken>>;
+    std::vector<TestCase> const cases{
+        {"0.0", {{Number, "0.0"}}},
+        {"1.0", {{Number, "1.0"}}},
+        {"0.123", {{Number, "0.123"}}},
+        {"123.0", {{Number, "123.0"}}},
+        {".123", {{Number, ".123"}}},
+        {"123.", {{Number, "123."}}},
+        {"123456789.0", {{Number, "123456789.0"}}},
+        {"1.2.3", {{Number, "1.2"}, {Number, ".3"}}},
+        {"123.456.789", {{Number, "123.456"}, {Number, ".789"}}},
+        {"1.2.3.4.5.6.7.8.9",
+         {{Number, "1.2"},
+          {Number, ".3"},
+          {Number, ".4"},
+          {Number, ".5"},
+          {Number, ".6"},
+          {Number, ".7"},
+          {Number, ".8"},
+          {Number, ".9"}}}
+    };
+    for (auto const& [input, output] : cases)
+    {
+        auto const actual = lex(input);
+        QCOMPARE(actual, output);
+    }
+}
+void testLexerFunctionsAndNumbers()
+{
+    using enum calqmath::TokenKind;
+    using TestCase = std::tuple<std::string, std::vector<LexedToken>>;
+    std::vector<TestCase> const cases{
+        {"sin", {{Identifier, "sin"}}},
+        {"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ",
+         {{Identifier, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"}}
+        },
+        {"sin12345678901234567890", {{Identifier, "sin12345678901234567890"}}},
+        {"123sin", {{Number, "123"}, {Identifier, "sin"}}},
+        {"sin123", {{Identifier, "sin123"}}},
+        {"sin123sin", {{Identifier, "sin123sin"}}},
+        {"sin123.456", {{Identifier, "sin123"}, {Number, ".456"}}},
+        {"0.0sin", {{Number, "0.0"}, {Identifier, "sin"}}},
+        {"sin 123", {{Identifier, "sin"}, {Number, "123"}}},
+    };
+    for (auto const& [input, output] : cases)
+    {
+        auto const actual = lex(input);
+        QCOMPARE(actual, output);
+    }
+}
+
+void testLexerSingleCharacterTokens()
+{
+    using enum calqmath::TokenKind;
+    auto const actual = lex("+-*/(),");
+    std::vector<LexedToken> const expected{
+        {Plus, "+"},
+        {Minus, "-"},
+        {Multiply, "*"},
+        {Divide, "/"},
+        {OpenBracket, "("},
+        {ClosedBracket, ")"},
+        {Comma, ","},
+    };
+    QCOMPARE(actual, expected);
+}
+void testLexerOffsets()
+{
+    using calqmath::Token;
+    using enum calqmath::TokenKind;
+
+    // Tokens are slices of the input, whitespace excluded.
+    auto const actual = calqmath::Lexer::convert(" sin( 12.5 )*x");
+    std::vector<Token> const expected{
+        Token{.kind = Identifier, .offset = 1, .length = 3},
+        Token{.kind = OpenBracket, .offset = 4, .length = 1},
+        Token{.kind = Number, .offset = 6, .length = 4},
+        Token{.kind = ClosedBracket, .offset = 11, .length = 1},
+        Token{.kind = Multiply, .offset = 12, .length = 1},
+        Token{.kind = Identifier, .offset = 13, .length = 1},
+    };
+    QVERIFY(actual.has_value());
+    QVERIFY(actual.value() == expected);
+}
+void testLexerMisc()
+{
+    // Valid token streams, but invalid when parsed to an expression
+    std::vector<std::string> const invalidTestCases{
+        "0..",
+        ".",
+        ".0.",
+        "..0",
+        "1 + #",
+        "1 . 2",
+    };
+
+    for (auto const& input : invalidTestCases)
+    {
+        auto const tokens = calqmath::Lexer::convert(input);
+        QVERIFY(!tokens.has_value());
+    }
+}
+void testLexerVariable()
+{
+    using enum calqmath::TokenKind;
+    LexedToken const variableToken{
+        .kind = Identifier, .text = calqmath::InputVariable::RESERVED_NAME
+    };
+
+    using TestCase = std::pair<std::string, std::vector<LexedToken>>;
+    std::vector<TestCase> const testCases{
+        {"x", {variableToken}},
+        {"1+x", {{Number, "1"}, {Plus, "+"}, variableToken}},
+    };
+
+    for (auto const& [input, expected] : testCases)
+    {
+        auto const tokens = lex(input);
+        QCOMPARE(tokens, expected);
+    }
+}
+
+void testInterpretVariable(calqmath::FunctionDatabase const& functions)
+{
+    using calqmath::Scalar;
+
+    Scalar const variable{"2.5"};
+
+    using TestCase = std::pair<std::string, calqmath::Scalar>;
+    std::vector<TestCase> const testCases{
+        {"x", Scalar{"2.5"}},
+        {"1+x", Scalar{"3.5"}},
+        {"x+1", Scalar{"3.5"}},
+        {"2 * x", Scalar{"5.0"}},
+        {"x / 2", Scalar{"1.25"}},
+    };
+
+    for (auto const& [input, expected] : testCases)
+    {
+        auto const tokens = calqmath::Lexer::convert(input);
+        QVERIFY(tokens.has_value());
+
+        auto const expression =
+            calqmath::Parser::parse(functions, input, tokens.value());
+        QVERIFY(expression.has_value());
+
+        auto const result = expression.value().evaluate(variable);
+        QCOMPARE(result, expected);
+    }
+}
+
+void testFunctionLookup(calqmath::FunctionDatabase const& functions)
+{
+    QCOMPARE(&calqmath::FunctionDatabase::defaults(), &functions);
+
+    auto const all{functions.unaryFunctions()};
+    for (size_t id = 0; id < all.size(); id++)
+    {
+        QCOMPARE(
+            functions.lookup(all[id].name),
+            std::optional<calqmath::FunctionId>{id}
+        );
+    }
+    auto const nary{functions.naryFunctions()};
+    for (size_t index = 0; index < nary.size(); index++)
+    {
+        QCOMPARE(
+            functions.lookup(nary[index].name),
+            std::optional<calqmath::FunctionId>{
+                calqmath::FIRST_NARY_FUNCTION + index
+            }
+        );
+    }
+
+    // Every short lowercase name, which covers misses landing on a slot that
+    // some function occupies.
+    std::string name{};
+    auto const check{[&]()
+                     {
+                         bool const exists{
+                             std::ranges::find(
+                                 all, name, &calqmath::UnaryFunction::name
+                             ) != all.end()
+                             || std::ranges::find(
+                                    nary, name, &calqmath::NaryFunction::name
+                                ) != nary.end()
+                         };
+                         return functions.lookup(name).has_value() == exists;
+                     }};
+    for (char first = 'a'; first <= 'z'; first++)
+    {
+        for (char second = 'a'; second <= 'z'; second++)
+        {
+            for (char third = 'a'; third <= 'z'; third++)
+            {
+                name = {first, second, third};
+                QVERIFY(check());
+                name.pop_back();
+                QVERIFY(check());
+            }
+        }
+    }
+
+    for (std::string_view const miss : {"", "x", "SIN", "sin ", "atanhh"})
+    {
+        QVERIFY(!functions.lookup(miss).has_value());
     }
 }
 
@@ -556,7 +2545,17 @@ void testParserFunctions(calqmath::FunctionDatabase const& functions)
         "5.0 + id(",
         "id())",
         "id(5.0",
-        "5.0 + id(5.0"
+        "5.0 + id(5.0",
+        "pow(x)",
+        "pow(x, 2, 3)",
+        "pow(, 2)",
+        "pow(x, )",
+        "pow(1, 2",
+        "fma(1, 2)",
+        "logn(2)",
+        "sin(x, 2)",
+        "(1, 2)",
+        "1, 2",
     };
 
     for (auto const& input : invalidTestCases)
@@ -565,7 +2564,7 @@ void testParserFunctions(calqmath::FunctionDatabase const& functions)
         QVERIFY(tokens.has_value());
 
         auto const expression =
-            calqmath::Parser::parse(functions, tokens.value());
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(!expression.has_value());
     }
 }
@@ -598,7 +2597,8 @@ void testParserMisc(calqmath::FunctionDatabase const& functions)
         auto const tokens = calqmath::Lexer::convert(input);
         QVERIFY(tokens.has_value());
 
-        auto const actual = calqmath::Parser::parse(functions, tokens.value());
+        auto const actual =
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(!actual.has_value());
     }
 
@@ -610,7 +2610,8 @@ void testParserMisc(calqmath::FunctionDatabase const& functions)
         auto const tokens = calqmath::Lexer::convert(input);
         QVERIFY(tokens.has_value());
 
-        auto const actual = calqmath::Parser::parse(functions, tokens.value());
+        auto const actual =
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(actual.has_value());
         // Test both functions, although this would be redundant in actual
         // code
@@ -647,7 +2648,8 @@ void testInterpretNonOrdinaryScalars(calqmath::FunctionDatabase const& functions
         auto const tokens = calqmath::Lexer::convert(input);
         QVERIFY(tokens.has_value());
 
-        auto const actual = calqmath::Parser::parse(functions, tokens.value());
+        auto const actual =
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(actual.has_value());
 
         auto const actualResult = actual.value().evaluate();
@@ -664,7 +2666,8 @@ void testInterpretNonOrdinaryScalars(calqmath::FunctionDatabase const& functions
         auto const tokens = calqmath::Lexer::convert(input);
         QVERIFY(tokens.has_value());
 
-        auto const actual = calqmath::Parser::parse(functions, tokens.value());
+        auto const actual =
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(actual.has_value());
 
         auto const actualResult = actual.value().evaluate();
@@ -693,7 +2696,8 @@ void testInterpretMixedNegation(calqmath::FunctionDatabase const& functions)
         auto const tokens = calqmath::Lexer::convert(input);
         QVERIFY(tokens.has_value());
 
-        auto const actual = calqmath::Parser::parse(functions, tokens.value());
+        auto const actual =
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(actual.has_value());
 
         auto const actualResult = actual.value().evaluate();
@@ -737,7 +2741,8 @@ void testParserParantheses(calqmath::FunctionDatabase const& functions)
         auto const tokens = calqmath::Lexer::convert(input);
         QVERIFY(tokens.has_value());
 
-        auto const actual = calqmath::Parser::parse(functions, tokens.value());
+        auto const actual =
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(!actual.has_value());
     }
 
@@ -761,7 +2766,8 @@ void testParserParantheses(calqmath::FunctionDatabase const& functions)
         auto const tokens = calqmath::Lexer::convert(input);
         QVERIFY(tokens.has_value());
 
-        auto const actual = calqmath::Parser::parse(functions, tokens.value());
+        auto const actual =
+            calqmath::Parser::parse(functions, input, tokens.value());
         QVERIFY(actual.has_value());
     }
 }
@@ -769,12 +2775,18 @@ void testParserParantheses(calqmath::FunctionDatabase const& functions)
 
 void CalQTest::test()
 {
+    // Before anything touches the backend, least of all other threads.
+    calqmath::EvaluationArena::install();
     calqmath::Interpreter const interpreter{};
 
     // Test this first, since a lot, including debugging, relies on being
     // able to stringify properly.
     testScalarStringify();
     testScalarOperators();
+    testScalarPrecision();
+    testScalarStorage();
+    testScalarVector();
+    testEvaluationArena();
     testNonOrdinaryScalarStringify();
 
     // Test components in order of dependency
@@ -783,22 +2795,44 @@ void CalQTest::test()
     testLexerNumbers();
     testLexerFunctionsAndNumbers();
     testLexerSingleCharacterTokens();
+    testLexerOffsets();
     testLexerMisc();
     testLexerVariable();
 
-    auto const functions{calqmath::FunctionDatabase::createWithDefaults()};
+    auto const& functions{calqmath::FunctionDatabase::defaults()};
     testParserParantheses(functions);
     testParserMisc(functions);
     testParserFunctions(functions);
+    testFunctionLookup(functions);
 
     testInterpretVariable(functions);
     testInterpretNonOrdinaryScalars(functions);
     testInterpretMixedNegation(functions);
     testInterpret(interpreter);
     testOrderOfOperators(interpreter);
+    testPrecedenceAtParse(interpreter);
+    testExpressionCopy(interpreter);
     testFunctionParsing(interpreter);
     testAllFunctions(functions, interpreter);
+    testMultiArgumentFunctions(functions, interpreter);
     testMinimalPrecision(interpreter);
+    testMathContext(interpreter);
+    testScalarFusedOperators(interpreter);
+    testConstantFolding(functions);
+    testSimplify(functions);
+    testCommonSubexpressions(functions);
+    testBytecode(interpreter);
+    testDoubleEvaluation(functions, interpreter);
+    testNativeFunction(functions, interpreter);
+    testStaticExpression(interpreter);
+    testInPlaceFunctions(functions);
+    testBatchFunctions(functions);
+    testEvaluateMany(functions, interpreter);
+    testExecutor(interpreter);
+    testMultiDouble<2>(functions, interpreter);
+    testMultiDouble<4>(functions, interpreter);
+    testInterval(functions, interpreter);
+    testDerivatives(functions, interpreter);
 }
 
 QTEST_MAIN(CalQTest)